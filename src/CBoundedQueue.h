@@ -0,0 +1,136 @@
+/**
+ * @file CBoundedQueue.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header-only thread-safe bounded queue used to connect the pipeline stages
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+/**
+ * @brief Thread-safe FIFO queue with a fixed capacity
+ *
+ * push() blocks while the queue is full, which applies backpressure to the producing stage.
+ * pop() blocks while the queue is empty. After close() no more items are accepted and pop()
+ * returns false once the remaining items are drained.
+ *
+ * @tparam T Type of the stored items
+ */
+template <typename T>
+class CBoundedQueue
+{
+public:
+    /**
+     * @brief Capacity value for a queue that never blocks on push
+     *
+     */
+    static constexpr size_t UNBOUNDED = std::numeric_limits<size_t>::max();
+
+    /**
+     * @brief Construct a new CBoundedQueue object
+     *
+     * @param capacity Max number of items stored at once (at least 1)
+     */
+    explicit CBoundedQueue(size_t capacity)
+        : m_Capacity(capacity > 0 ? capacity : 1) {}
+
+    CBoundedQueue(const CBoundedQueue &) = delete;
+    CBoundedQueue &operator=(const CBoundedQueue &) = delete;
+
+    /**
+     * @brief Insert item to the end of the queue, block while the queue is full
+     *
+     * @param item Item to insert
+     * @return true If inserted
+     * @return false If the queue was closed
+     */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_NotFull.wait(lock, [this]
+                       { return m_Closed || m_Items.size() < m_Capacity; });
+
+        if (m_Closed)
+            return false;
+
+        m_Items.push_back(std::move(item));
+        lock.unlock();
+
+        m_NotEmpty.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Take item from the front of the queue, block while the queue is empty
+     *
+     * @param[out] item Taken item
+     * @return true If an item was taken
+     * @return false If the queue is closed and empty
+     */
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_NotEmpty.wait(lock, [this]
+                        { return m_Closed || !m_Items.empty(); });
+
+        if (m_Items.empty())
+            return false;
+
+        item = std::move(m_Items.front());
+        m_Items.pop_front();
+        lock.unlock();
+
+        m_NotFull.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief Close the queue and wake up all waiting threads
+     *
+     */
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Closed = true;
+        }
+
+        m_NotFull.notify_all();
+        m_NotEmpty.notify_all();
+    }
+
+    /**
+     * @brief Get the current number of items in the queue
+     *
+     * @return size_t
+     */
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Items.size();
+    }
+
+    /**
+     * @brief Get the capacity of the queue
+     *
+     * @return size_t
+     */
+    size_t capacity() const
+    {
+        return m_Capacity;
+    }
+
+private:
+    const size_t m_Capacity;
+    bool m_Closed = false;
+    std::deque<T> m_Items;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_NotFull;
+    std::condition_variable m_NotEmpty;
+};
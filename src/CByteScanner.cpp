@@ -0,0 +1,163 @@
+/**
+ * @file CByteScanner.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CByteScanner
+ *
+ */
+
+#include "CByteScanner.h"
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BYTE_SCANNER_X86
+#include <immintrin.h>
+#endif
+
+CByteScanner::CByteScanner(const string &bytes, EKernel kernel)
+    : m_Bytes(bytes),
+      m_Kernel(kernel)
+{
+    if (bytes.empty() || bytes.length() > MAX_BYTES)
+        throw std::invalid_argument("CByteScanner needs 1 to 8 bytes");
+
+    if (!isSupported(kernel))
+        throw std::invalid_argument("CByteScanner kernel " + getName(kernel) + " is not supported");
+
+    for (char c : bytes)
+        m_Table[static_cast<unsigned char>(c)] = true;
+}
+
+size_t CByteScanner::find(const char *data, size_t length, size_t from) const
+{
+    if (from >= length)
+        return string::npos;
+
+    switch (m_Kernel)
+    {
+    case EKernel::AVX2:
+        return findAvx2(data, length, from);
+    case EKernel::SSE2:
+        return findSse2(data, length, from);
+    default:
+        return findScalar(data, length, from);
+    }
+}
+
+size_t CByteScanner::find(const string &content, size_t from) const
+{
+    return find(content.data(), content.length(), from);
+}
+
+CByteScanner::EKernel CByteScanner::getKernel() const
+{
+    return m_Kernel;
+}
+
+CByteScanner::EKernel CByteScanner::getBestKernel()
+{
+    static const EKernel best = isSupported(EKernel::AVX2) ? EKernel::AVX2 : (isSupported(EKernel::SSE2) ? EKernel::SSE2 : EKernel::SCALAR);
+    return best;
+}
+
+bool CByteScanner::isSupported(EKernel kernel)
+{
+#ifdef BYTE_SCANNER_X86
+    if (kernel == EKernel::AVX2)
+        return __builtin_cpu_supports("avx2");
+
+    if (kernel == EKernel::SSE2)
+        return __builtin_cpu_supports("sse2");
+#endif
+
+    return kernel == EKernel::SCALAR;
+}
+
+string CByteScanner::getName(EKernel kernel)
+{
+    switch (kernel)
+    {
+    case EKernel::AVX2:
+        return "avx2";
+    case EKernel::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+size_t CByteScanner::findScalar(const char *data, size_t length, size_t from) const
+{
+    for (size_t i = from; i < length; i++)
+        if (m_Table[static_cast<unsigned char>(data[i])])
+            return i;
+
+    return string::npos;
+}
+
+#ifdef BYTE_SCANNER_X86
+
+__attribute__((target("sse2"))) size_t CByteScanner::findSse2(const char *data, size_t length, size_t from) const
+{
+    __m128i needles[MAX_BYTES];
+    size_t count = m_Bytes.length();
+
+    for (size_t k = 0; k < count; k++)
+        needles[k] = _mm_set1_epi8(m_Bytes[k]);
+
+    size_t i = from;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        __m128i found = _mm_cmpeq_epi8(chunk, needles[0]);
+
+        for (size_t k = 1; k < count; k++)
+            found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, needles[k]));
+
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(found));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    return findScalar(data, length, i);
+}
+
+__attribute__((target("avx2"))) size_t CByteScanner::findAvx2(const char *data, size_t length, size_t from) const
+{
+    __m256i needles[MAX_BYTES];
+    size_t count = m_Bytes.length();
+
+    for (size_t k = 0; k < count; k++)
+        needles[k] = _mm256_set1_epi8(m_Bytes[k]);
+
+    size_t i = from;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+        __m256i found = _mm256_cmpeq_epi8(chunk, needles[0]);
+
+        for (size_t k = 1; k < count; k++)
+            found = _mm256_or_si256(found, _mm256_cmpeq_epi8(chunk, needles[k]));
+
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(found));
+        if (mask != 0)
+            return i + __builtin_ctz(mask);
+    }
+
+    // The rest is shorter than one vector
+    return findSse2(data, length, i);
+}
+
+#else
+
+size_t CByteScanner::findSse2(const char *data, size_t length, size_t from) const
+{
+    return findScalar(data, length, from);
+}
+
+size_t CByteScanner::findAvx2(const char *data, size_t length, size_t from) const
+{
+    return findScalar(data, length, from);
+}
+
+#endif
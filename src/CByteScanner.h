@@ -0,0 +1,109 @@
+/**
+ * @file CByteScanner.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CByteScanner
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+using std::string;
+
+/**
+ * @brief Finds the next occurrence of any byte from a small set, used by the tokenizers to skip plain text
+ *
+ * The search runs on 32 (AVX2) or 16 (SSE2) bytes at once, the best kernel supported by the CPU is selected
+ * at runtime. The scalar kernel is used on other platforms and for the tail of the data.
+ *
+ */
+class CByteScanner
+{
+public:
+    /**
+     * @brief Implementation of the search
+     *
+     */
+    enum class EKernel
+    {
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * @brief Maximum number of bytes in the set
+     *
+     */
+    static constexpr size_t MAX_BYTES = 8;
+
+    /**
+     * @brief Construct a new CByteScanner object
+     *
+     * @param bytes Bytes to search for, at most MAX_BYTES
+     * @param kernel Implementation, the best supported one by default
+     * @throws std::invalid_argument If there are too many bytes or the kernel is not supported
+     */
+    explicit CByteScanner(const string &bytes, EKernel kernel = getBestKernel());
+
+    /**
+     * @brief Find the first byte from the set
+     *
+     * @param data
+     * @param length Length of the data
+     * @param from Position where to start
+     * @return size_t Position of the byte, string::npos if not found
+     */
+    size_t find(const char *data, size_t length, size_t from = 0) const;
+
+    /**
+     * @brief Find the first byte from the set
+     *
+     * @param content
+     * @param from Position where to start
+     * @return size_t Position of the byte, string::npos if not found
+     */
+    size_t find(const string &content, size_t from = 0) const;
+
+    /**
+     * @brief Get the kernel used by this scanner
+     *
+     * @return EKernel
+     */
+    EKernel getKernel() const;
+
+    /**
+     * @brief Get the fastest kernel supported by the CPU
+     *
+     * @return EKernel
+     */
+    static EKernel getBestKernel();
+
+    /**
+     * @brief Returns true if the kernel can run on this CPU
+     *
+     * @param kernel
+     * @return true
+     * @return false
+     */
+    static bool isSupported(EKernel kernel);
+
+    /**
+     * @brief Get the name of the kernel (eg. "avx2")
+     *
+     * @param kernel
+     * @return string
+     */
+    static string getName(EKernel kernel);
+
+private:
+    string m_Bytes;
+    bool m_Table[256] = {};
+    EKernel m_Kernel;
+
+    size_t findScalar(const char *data, size_t length, size_t from) const;
+    size_t findSse2(const char *data, size_t length, size_t from) const;
+    size_t findAvx2(const char *data, size_t length, size_t from) const;
+};
@@ -29,6 +29,23 @@ CConfig::CConfig()
     (*this)["advertisement"] = true;
     (*this)["limit"] = string("");
     (*this)["cert_store"] = string("");
+    (*this)["fetch_workers"] = 4;
+    (*this)["parse_workers"] = 1;
+    (*this)["rewrite_workers"] = 1;
+    (*this)["write_workers"] = 1;
+    (*this)["queue_size"] = 16;
+    (*this)["memory_limit"] = 256;
+    (*this)["dedup"] = false;
+    (*this)["output_backend"] = string("auto");
+    (*this)["io_threads"] = 4;
+    (*this)["warc"] = false;
+    (*this)["warc_max_size"] = 1024;
+    (*this)["metrics_file"] = string("");
+    (*this)["metrics_port"] = 0;
+    (*this)["trace"] = string("");
+    (*this)["request_log"] = string("");
+
+    updateSnapshot();
 }
 
 string CConfig::formatOption(size_t paramSize, const string &args, const string &helpText) const
@@ -48,6 +65,9 @@ void CConfig::printHelp(const string &programName) const
 {
     const size_t paramSize = 35;
 
+    // Errors logged so far are printed before the help
+    CLogger::getInstance().flush();
+
     stringstream ss;
     cout << "\nUSAGE:\n";
 
@@ -71,7 +91,7 @@ void CConfig::printHelp(const string &programName) const
 
     cout << formatOption(paramSize,
                          "-l, --limit <domain,domain,...>",
-                         "Limit download only to selected domains (comma separated list) (default = \"\"; downloads anything)");
+                         "Limit download only to selected domains (comma separated list, \"*.example.com\" allows all subdomains) (default = \"\"; downloads anything)");
 
     cout << formatOption(paramSize,
                          "-r, --remote",
@@ -109,6 +129,66 @@ void CConfig::printHelp(const string &programName) const
                          "--cert-store <path>",
                          "Path to user defined keys bundle .crt file (eg. \"./assets/certs/ca-certificates.crt\") (default = \"\"; uses system store)");
 
+    cout << formatOption(paramSize,
+                         "-j, --fetch-workers <int>",
+                         "Number of threads downloading files (default = 4)");
+
+    cout << formatOption(paramSize,
+                         "--parse-workers <int>",
+                         "Number of threads parsing downloaded files (default = 1)");
+
+    cout << formatOption(paramSize,
+                         "--rewrite-workers <int>",
+                         "Number of threads rewriting links in parsed files (default = 1)");
+
+    cout << formatOption(paramSize,
+                         "--write-workers <int>",
+                         "Number of threads writing files to disk (default = 1)");
+
+    cout << formatOption(paramSize,
+                         "--queue-size <int>",
+                         "Max number of files waiting between two stages (default = 16)");
+
+    cout << formatOption(paramSize,
+                         "-m, --memory-limit <MB>",
+                         "Max size of downloaded content kept in memory at once, larger files are streamed to disk (default = 256; 0 = unlimited)");
+
+    cout << formatOption(paramSize,
+                         "--dedup",
+                         "Store identical files only once, other copies are created as hardlinks");
+
+    cout << formatOption(paramSize,
+                         "--output-backend <backend>",
+                         "How files are written: auto, uring, pool or sync (default = auto; io_uring with thread pool fallback)");
+
+    cout << formatOption(paramSize,
+                         "--io-threads <int>",
+                         "Number of threads of the thread pool output backend (default = 4)");
+
+    cout << formatOption(paramSize,
+                         "--warc",
+                         "Store the downloaded responses into WARC files with CDX index in the output folder instead of separate files");
+
+    cout << formatOption(paramSize,
+                         "--warc-max-size <MB>",
+                         "Size of one WARC file, then the next one is started (default = 1024)");
+
+    cout << formatOption(paramSize,
+                         "--metrics-file <path>",
+                         "Periodically write Prometheus metrics into the file, eg. for the node exporter textfile collector");
+
+    cout << formatOption(paramSize,
+                         "--metrics-port <port>",
+                         "Serve Prometheus metrics on http://127.0.0.1:<port>/metrics during the crawl");
+
+    cout << formatOption(paramSize,
+                         "--trace <path>",
+                         "Write the timeline of the crawl as Chrome trace events (open in chrome://tracing or Perfetto)");
+
+    cout << formatOption(paramSize,
+                         "--request-log <path>",
+                         "Write the phase timings of every request into the file, one JSON object per line");
+
     cout << formatOption(paramSize,
                          "--disable-annoying-advertisement-that-nobody-wants-to-see",
                          "Self explanatory :)");
@@ -123,7 +203,7 @@ bool CConfig::parseArgs(int argc, char const *argv[])
     // Check args count
     if (argc < 2)
     {
-        logger.log(CLogger::ELogLevel::Error, "Too few arguments!");
+        LOG_ERROR("Too few arguments!");
         printHelp(argv[0]);
         return false;
     }
@@ -135,7 +215,7 @@ bool CConfig::parseArgs(int argc, char const *argv[])
 
         if (value == "-h" || value == "--help")
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: Read Help argument");
+            LOG_VERBOSE("Config: Read Help argument");
             printHelp(argv[0]);
             return false;
         }
@@ -149,11 +229,11 @@ bool CConfig::parseArgs(int argc, char const *argv[])
 
             if (value.find_first_not_of("0123456789") != string::npos)
             {
-                logger.log(CLogger::ELogLevel::Error, "Depth value is not a valid number!");
+                LOG_ERROR("Depth value is not a valid number!");
                 return false;
             }
 
-            logger.log(CLogger::ELogLevel::Verbose, "Config: depth = " + value);
+            LOG_VERBOSE("Config: depth = " + value);
             (*this)["depth"] = value;
         }
 
@@ -165,19 +245,19 @@ bool CConfig::parseArgs(int argc, char const *argv[])
 
         else if (value == "-r" || value == "--remote")
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: remote = true");
+            LOG_VERBOSE("Config: remote = true");
             (*this)["remote"] = true;
         }
 
         else if (value == "-R" || value == "--remote-images")
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: remote_images = true");
+            LOG_VERBOSE("Config: remote_images = true");
             (*this)["remote_images"] = true;
         }
 
         else if (value == "-e" || value == "--error-page")
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: error_page = true");
+            LOG_VERBOSE("Config: error_page = true");
             (*this)["error_page"] = true;
         }
 
@@ -189,7 +269,7 @@ bool CConfig::parseArgs(int argc, char const *argv[])
 
         else if (value == "-v" || value == "--verbose")
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: log_level = verbose");
+            LOG_VERBOSE("Config: log_level = verbose");
             (*this)["log_level"] = 0;
 
             logger.setLevel(CLogger::ELogLevel::Verbose);
@@ -197,7 +277,7 @@ bool CConfig::parseArgs(int argc, char const *argv[])
 
         else if (value == "-q" || value == "--quiet")
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: log_level = error");
+            LOG_VERBOSE("Config: log_level = error");
             (*this)["log_level"] = 2;
 
             logger.setLevel(CLogger::ELogLevel::Error);
@@ -229,31 +309,148 @@ bool CConfig::parseArgs(int argc, char const *argv[])
                 return false;
         }
 
+        else if (value == "-j" || value == "--fetch-workers")
+        {
+            if (!setCountWithNext("fetch_workers", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--parse-workers")
+        {
+            if (!setCountWithNext("parse_workers", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--rewrite-workers")
+        {
+            if (!setCountWithNext("rewrite_workers", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--write-workers")
+        {
+            if (!setCountWithNext("write_workers", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--queue-size")
+        {
+            if (!setCountWithNext("queue_size", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "-m" || value == "--memory-limit")
+        {
+            if (++i >= argc)
+                return false;
+
+            value = argv[i];
+
+            if (value.empty() || value.length() > 6 || value.find_first_not_of("0123456789") != string::npos)
+            {
+                LOG_ERROR("Memory limit value is not a valid number!");
+                return false;
+            }
+
+            LOG_VERBOSE("Config: memory_limit = " + value);
+            (*this)["memory_limit"] = value;
+        }
+
+        else if (value == "--dedup")
+        {
+            LOG_VERBOSE("Config: dedup = true");
+            (*this)["dedup"] = true;
+        }
+
+        else if (value == "--output-backend")
+        {
+            if (!setWithNext("output_backend", i, argc, argv))
+                return false;
+
+            string backend = (*this)["output_backend"];
+
+            if (backend != "auto" && backend != "uring" && backend != "pool" && backend != "sync")
+            {
+                LOG_ERROR("Unknown output backend: " + backend);
+                return false;
+            }
+        }
+
+        else if (value == "--io-threads")
+        {
+            if (!setCountWithNext("io_threads", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--warc")
+        {
+            LOG_VERBOSE("Config: warc = true");
+            (*this)["warc"] = true;
+        }
+
+        else if (value == "--warc-max-size")
+        {
+            if (!setCountWithNext("warc_max_size", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--metrics-file")
+        {
+            if (!setWithNext("metrics_file", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--metrics-port")
+        {
+            if (!setCountWithNext("metrics_port", i, argc, argv))
+                return false;
+
+            if (static_cast<int>((*this)["metrics_port"]) > 65535)
+            {
+                LOG_ERROR("Metrics port is out of range!");
+                return false;
+            }
+        }
+
+        else if (value == "--trace")
+        {
+            if (!setWithNext("trace", i, argc, argv))
+                return false;
+        }
+
+        else if (value == "--request-log")
+        {
+            if (!setWithNext("request_log", i, argc, argv))
+                return false;
+        }
+
         else if (value == "--disable-annoying-advertisement-that-nobody-wants-to-see")
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: advertisement = false");
+            LOG_VERBOSE("Config: advertisement = false");
             (*this)["advertisement"] = false;
         }
 
         else if (value != "" && !Utils::startsWith(value, "-"))
         {
-            logger.log(CLogger::ELogLevel::Verbose, "Config: url = " + value);
+            LOG_VERBOSE("Config: url = " + value);
             (*this)["url"] = value;
         }
 
         else
         {
-            logger.log(CLogger::ELogLevel::Error, "Unknown argument: " + value);
+            LOG_ERROR("Unknown argument: " + value);
             return false;
         }
     }
 
     if ((string)((*this)["url"]) == "")
     {
-        logger.log(CLogger::ELogLevel::Error, "No URL provided!");
+        LOG_ERROR("No URL provided!");
         return false;
     }
 
+    updateSnapshot();
+
     return true;
 }
 
@@ -264,12 +461,76 @@ bool CConfig::setWithNext(const string &configName, int &currentArg, int argc, c
 
     string value = argv[currentArg];
 
-    CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "Config: " + configName + " = " + value);
+    LOG_VERBOSE("Config: " + configName + " = " + value);
     (*this)[configName] = value;
 
     return true;
 }
 
+bool CConfig::setCountWithNext(const string &configName, int &currentArg, int argc, const char *argv[])
+{
+    if (currentArg + 1 >= argc)
+        return false;
+
+    string value = argv[currentArg + 1];
+
+    if (value.empty() || value.length() > 6 || value.find_first_not_of("0123456789") != string::npos || std::stoi(value) == 0)
+    {
+        LOG_ERROR("Value of " + configName + " is not a valid positive number!");
+        return false;
+    }
+
+    return setWithNext(configName, currentArg, argc, argv);
+}
+
+void CConfig::updateSnapshot()
+{
+    TSnapshot snapshot;
+
+    snapshot.m_Url = static_cast<string>((*this)["url"]);
+    snapshot.m_RootUrl = CURLHandler(snapshot.m_Url);
+    snapshot.m_Depth = static_cast<int>((*this)["depth"]);
+    snapshot.m_RemoteImages = static_cast<bool>((*this)["remote_images"]);
+    snapshot.m_Remote = static_cast<bool>((*this)["remote"]);
+    snapshot.m_ErrorPage = static_cast<bool>((*this)["error_page"]);
+    snapshot.m_Output = static_cast<string>((*this)["output"]);
+    snapshot.m_LogLevel = static_cast<int>((*this)["log_level"]);
+    snapshot.m_LogFile = static_cast<string>((*this)["log_file"]);
+    snapshot.m_Cookies = static_cast<string>((*this)["cookies"]);
+    snapshot.m_UserAgent = static_cast<string>((*this)["user_agent"]);
+    snapshot.m_Advertisement = static_cast<bool>((*this)["advertisement"]);
+    snapshot.m_Limit = static_cast<string>((*this)["limit"]);
+    snapshot.m_CertStore = static_cast<string>((*this)["cert_store"]);
+    snapshot.m_FetchWorkers = static_cast<int>((*this)["fetch_workers"]);
+    snapshot.m_ParseWorkers = static_cast<int>((*this)["parse_workers"]);
+    snapshot.m_RewriteWorkers = static_cast<int>((*this)["rewrite_workers"]);
+    snapshot.m_WriteWorkers = static_cast<int>((*this)["write_workers"]);
+    snapshot.m_QueueSize = static_cast<int>((*this)["queue_size"]);
+    snapshot.m_MemoryLimit = static_cast<size_t>(static_cast<int>((*this)["memory_limit"])) * 1024 * 1024;
+    snapshot.m_Dedup = static_cast<bool>((*this)["dedup"]);
+    snapshot.m_OutputBackend = static_cast<string>((*this)["output_backend"]);
+    snapshot.m_IoThreads = static_cast<int>((*this)["io_threads"]);
+    snapshot.m_Warc = static_cast<bool>((*this)["warc"]);
+    snapshot.m_WarcMaxSize = static_cast<size_t>(static_cast<int>((*this)["warc_max_size"])) * 1024 * 1024;
+    snapshot.m_MetricsFile = static_cast<string>((*this)["metrics_file"]);
+    snapshot.m_MetricsPort = static_cast<int>((*this)["metrics_port"]);
+    snapshot.m_Trace = static_cast<string>((*this)["trace"]);
+    snapshot.m_RequestLog = static_cast<string>((*this)["request_log"]);
+
+    if (!snapshot.m_Cookies.empty())
+        snapshot.m_RequestHeaders += "Cookie: " + snapshot.m_Cookies + "\r\n";
+
+    if (!snapshot.m_UserAgent.empty())
+        snapshot.m_RequestHeaders += "User-Agent: " + snapshot.m_UserAgent + "\r\n";
+
+    m_Snapshot = std::move(snapshot);
+}
+
+const CConfig::TSnapshot &CConfig::getSnapshot() const
+{
+    return m_Snapshot;
+}
+
 CConfig &CConfig::getInstance()
 {
     static CConfig instance;
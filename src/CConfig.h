@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include "CURLHandler.h"
+
+#include <cstddef>
 #include <string>
 #include <map>
 #include <iostream>
@@ -44,6 +47,44 @@ public:
         TSetting &operator=(const string &);
     };
 
+    /**
+     * @brief Typed values of the settings, converted once so the workers don't parse strings
+     *
+     */
+    struct TSnapshot
+    {
+        string m_Url;
+        CURLHandler m_RootUrl; // Parsed m_Url
+        int m_Depth = 1;
+        bool m_RemoteImages = false;
+        bool m_Remote = false;
+        bool m_ErrorPage = false;
+        string m_Output;
+        int m_LogLevel = 1;
+        string m_LogFile;
+        string m_Cookies;
+        string m_UserAgent;
+        string m_RequestHeaders; // "Cookie:" and "User-Agent:" lines of every request, ending with "\r\n"
+        bool m_Advertisement = true;
+        string m_Limit;
+        string m_CertStore;
+        int m_FetchWorkers = 4;
+        int m_ParseWorkers = 1;
+        int m_RewriteWorkers = 1;
+        int m_WriteWorkers = 1;
+        int m_QueueSize = 16;
+        size_t m_MemoryLimit = 0; // In bytes
+        bool m_Dedup = false;
+        string m_OutputBackend;
+        int m_IoThreads = 4;
+        bool m_Warc = false;
+        size_t m_WarcMaxSize = 0; // In bytes
+        string m_MetricsFile;
+        int m_MetricsPort = 0; // 0 = no listener
+        string m_Trace;
+        string m_RequestLog;
+    };
+
     /**
      * @brief Construct a new CConfig object, setting the default values
      *
@@ -67,6 +108,21 @@ public:
      */
     TSetting &operator[](const string &);
 
+    /**
+     * @brief Convert the current settings to the typed snapshot, called by parseArgs
+     *
+     * The snapshot is read by the workers without locking, so it must not be updated while they are running.
+     *
+     */
+    void updateSnapshot();
+
+    /**
+     * @brief Get the typed values as of the last updateSnapshot()
+     *
+     * @return const TSnapshot&
+     */
+    const TSnapshot &getSnapshot() const;
+
     // Singleton stuff:
 
     /**
@@ -91,6 +147,8 @@ public:
 private:
     map<string, TSetting> m_Settings;
 
+    TSnapshot m_Snapshot;
+
     /**
      * @brief Prints basic usage and all available arguments
      *
@@ -120,4 +178,16 @@ private:
      * @return false If error - can't read next argument
      */
     bool setWithNext(const string &configName, int &currentArg, int argc, const char *argv[]);
+
+    /**
+     * @brief Read next argument, check it's a positive number and set to configName TSetting
+     *
+     * @param configName Name of the TSetting config
+     * @param currentArg Index of current argument
+     * @param argc
+     * @param argv
+     * @return true If succesfully set
+     * @return false If error - can't read next argument or it's not a positive number
+     */
+    bool setCountWithNext(const string &configName, int &currentArg, int argc, const char *argv[]);
 };
@@ -0,0 +1,223 @@
+/**
+ * @file CContentStore.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CContentStore
+ *
+ */
+
+#include "CContentStore.h"
+#include "CLogger.h"
+#include "CDirectoryCache.h"
+
+#include <openssl/evp.h>
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+using std::string, std::unique_ptr;
+namespace fs = std::filesystem;
+
+void CContentStore::setEnabled(bool enabled)
+{
+    m_Enabled = enabled;
+}
+
+bool CContentStore::isEnabled() const
+{
+    return m_Enabled;
+}
+
+void CContentStore::write(COutputWriter::TRequest &&request)
+{
+    if (!m_Enabled)
+    {
+        writeFile(std::move(request));
+        return;
+    }
+
+    string key = hash(request.m_Content);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    auto [it, inserted] = m_Entries.try_emplace(key);
+
+    // First file with this content, write it normally and wake up the waiting duplicates once it's on disk
+    if (inserted)
+    {
+        it->second.m_Path = request.m_Path;
+        lock.unlock();
+
+        TEntry *entry = &it->second;
+        auto done = std::move(request.m_Done);
+
+        request.m_Done = [this, entry, done](bool result)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                entry->m_Ready = true;
+            }
+
+            m_Written.notify_all();
+
+            if (done)
+                done(result);
+        };
+
+        writeFile(std::move(request));
+        return;
+    }
+
+    // Duplicate, wait until the first file is written and link to it
+    m_Written.wait(lock, [&]
+                   { return it->second.m_Ready; });
+    string original = it->second.m_Path;
+    lock.unlock();
+
+    std::error_code error;
+    CDirectoryCache::getInstance().create(fs::path(request.m_Path).parent_path());
+    fs::create_hard_link(original, request.m_Path, error);
+
+    if (error)
+    {
+        LOG_VERBOSE("Can't hardlink " + request.m_Path + " (" + error.message() + "), writing a copy");
+        writeFile(std::move(request));
+        return;
+    }
+
+    LOG_VERBOSE("Deduplicated " + request.m_Path + " -> " + original);
+    m_DedupedBytes += request.m_Content.size();
+    m_DedupedFiles++;
+
+    request.m_Reservation.release();
+    if (request.m_Done)
+        request.m_Done(true);
+}
+
+void CContentStore::adopt(const string &path, size_t size)
+{
+    string key = m_Enabled ? hashFile(path) : "";
+
+    if (key.empty())
+    {
+        m_WrittenBytes += size;
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    auto [it, inserted] = m_Entries.try_emplace(key);
+
+    // First file with this content, it's on disk already
+    if (inserted)
+    {
+        it->second.m_Path = path;
+        it->second.m_Ready = true;
+        lock.unlock();
+
+        m_Written.notify_all();
+        m_WrittenBytes += size;
+        return;
+    }
+
+    m_Written.wait(lock, [&]
+                   { return it->second.m_Ready; });
+    string original = it->second.m_Path;
+    lock.unlock();
+
+    // Link next to the file and replace it, so the copy stays in place if linking fails
+    string link = path + ".link";
+    std::error_code error;
+    fs::create_hard_link(original, link, error);
+
+    if (!error)
+        fs::rename(link, path, error);
+
+    if (error)
+    {
+        LOG_VERBOSE("Can't hardlink " + path + " (" + error.message() + "), keeping a copy");
+        fs::remove(link, error);
+        m_WrittenBytes += size;
+        return;
+    }
+
+    LOG_VERBOSE("Deduplicated " + path + " -> " + original);
+    m_DedupedBytes += size;
+    m_DedupedFiles++;
+}
+
+void CContentStore::writeFile(COutputWriter::TRequest &&request)
+{
+    m_WrittenBytes += request.m_Content.size();
+
+    COutputWriter::getInstance().submit(std::move(request));
+}
+
+size_t CContentStore::getWrittenBytes() const
+{
+    return m_WrittenBytes;
+}
+
+size_t CContentStore::getDedupedBytes() const
+{
+    return m_DedupedBytes;
+}
+
+size_t CContentStore::getDedupedFiles() const
+{
+    return m_DedupedFiles;
+}
+
+string CContentStore::hash(const string &content)
+{
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+
+    EVP_Digest(content.data(), content.size(), digest, &digestLength, EVP_blake2b512(), nullptr);
+
+    return toHex(digest, digestLength);
+}
+
+string CContentStore::hashFile(const string &path)
+{
+    std::ifstream ifs(path, std::ios_base::in | std::ios_base::binary);
+
+    if (!ifs)
+        return "";
+
+    auto context = unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+    EVP_DigestInit_ex(context.get(), EVP_blake2b512(), nullptr);
+
+    // Read in parts, the file may be bigger than the memory budget
+    char buffer[64 * 1024];
+    while (ifs.read(buffer, sizeof(buffer)) || ifs.gcount() > 0)
+        EVP_DigestUpdate(context.get(), buffer, ifs.gcount());
+
+    if (ifs.bad())
+        return "";
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+    EVP_DigestFinal_ex(context.get(), digest, &digestLength);
+
+    return toHex(digest, digestLength);
+}
+
+string CContentStore::toHex(const unsigned char *digest, unsigned int length)
+{
+    static const char HEX[] = "0123456789abcdef";
+
+    // 256 bits are more than enough to tell files apart
+    string result;
+    for (unsigned int i = 0; i < length && i < 32; i++)
+    {
+        result += HEX[digest[i] >> 4];
+        result += HEX[digest[i] & 0x0f];
+    }
+
+    return result;
+}
+
+CContentStore &CContentStore::getInstance()
+{
+    static CContentStore instance;
+    return instance;
+}
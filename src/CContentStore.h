@@ -0,0 +1,158 @@
+/**
+ * @file CContentStore.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CContentStore
+ *
+ */
+
+#pragma once
+
+#include "COutputWriter.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using std::string;
+
+/**
+ * @brief Content-addressed storage singleton that writes every unique content to disk only once
+ *
+ * When enabled, the content is hashed with BLAKE2b and the first file with that hash is written normally
+ * by the output backend. Every other file with the same content is created as a hardlink to the first one
+ * (or written normally if hardlinks are not supported by the filesystem).
+ *
+ */
+class CContentStore
+{
+public:
+    /**
+     * @brief Enable or disable the deduplication, disabled store writes every file normally
+     *
+     * @param enabled
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * @brief Returns true if the deduplication is enabled
+     *
+     * @return true
+     * @return false
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Write the file through the output backend, or hardlink it to an already written file with the same content
+     *
+     * @param request Path, content and memory budget of the file
+     */
+    void write(COutputWriter::TRequest &&request);
+
+    /**
+     * @brief Register a file already written to disk by someone else (eg. a body streamed over the memory budget),
+     * replace it with a hardlink if the same content is already stored
+     *
+     * @param path Path of the written file
+     * @param size Size of the written file
+     */
+    void adopt(const string &path, size_t size);
+
+    /**
+     * @brief Get the number of bytes actually written to disk
+     *
+     * @return size_t
+     */
+    size_t getWrittenBytes() const;
+
+    /**
+     * @brief Get the number of bytes saved by hardlinking duplicates
+     *
+     * @return size_t
+     */
+    size_t getDedupedBytes() const;
+
+    /**
+     * @brief Get the number of files created as hardlinks
+     *
+     * @return size_t
+     */
+    size_t getDedupedFiles() const;
+
+    /**
+     * @brief Get hex encoded BLAKE2b hash of the content, truncated to 256 bits
+     *
+     * @param content
+     * @return string
+     */
+    static string hash(const string &content);
+
+    /**
+     * @brief Get the hash of the file content, see hash()
+     *
+     * @param path
+     * @return string Empty if the file can't be read
+     */
+    static string hashFile(const string &path);
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CContentStore
+     *
+     * @return CContentStore&
+     */
+    static CContentStore &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CContentStore being singleton
+     *
+     */
+    CContentStore(const CContentStore &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CContentStore being singleton
+     *
+     */
+    void operator=(const CContentStore &) = delete;
+
+private:
+    CContentStore() = default;
+
+    /**
+     * @brief The first file written with some content
+     *
+     */
+    struct TEntry
+    {
+        string m_Path;
+        bool m_Ready = false;
+    };
+
+    std::atomic<bool> m_Enabled{false};
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Written;
+    std::unordered_map<string, TEntry> m_Entries;
+
+    std::atomic<size_t> m_WrittenBytes{0};
+    std::atomic<size_t> m_DedupedBytes{0};
+    std::atomic<size_t> m_DedupedFiles{0};
+
+    /**
+     * @brief Write the file through the output backend without deduplication
+     *
+     * @param request
+     */
+    void writeFile(COutputWriter::TRequest &&request);
+
+    /**
+     * @brief Encode the digest as hex, truncated to 256 bits
+     *
+     * @param digest
+     * @param length
+     * @return string
+     */
+    static string toHex(const unsigned char *digest, unsigned int length);
+};
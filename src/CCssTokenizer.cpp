@@ -0,0 +1,515 @@
+/**
+ * @file CCssTokenizer.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CCssTokenizer
+ *
+ */
+
+#include "CCssTokenizer.h"
+#include "CByteScanner.h"
+#include "Utils.h"
+
+// Starts of comments, strings, at-keywords, escapes and parentheses of functions, everything else is skipped
+static const CByteScanner TOKEN_SCANNER("/\"'@()\\");
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static bool isNewline(char c)
+{
+    return c == '\n' || c == '\r' || c == '\f';
+}
+
+static bool isHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static unsigned hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+
+    return (c | 0x20) - 'a' + 10;
+}
+
+static bool isNameChar(char c)
+{
+    unsigned char u = static_cast<unsigned char>(c);
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_' || u >= 0x80;
+}
+
+static bool isNonPrintable(char c)
+{
+    unsigned char u = static_cast<unsigned char>(c);
+    return u <= 0x08 || u == 0x0B || (u >= 0x0E && u <= 0x1F) || u == 0x7F;
+}
+
+static bool isValidEscape(const string &content, size_t i)
+{
+    return content[i] == '\\' && i + 1 < content.length() && !isNewline(content[i + 1]);
+}
+
+static void addLink(vector<CCssTokenizer::TLink> &links, CCssTokenizer::EKind kind, size_t start, size_t end, const string &value, bool quoted)
+{
+    if (value.empty())
+        return;
+
+    links.push_back({kind, start, end - start, value, quoted});
+}
+
+void CCssTokenizer::feed(const string &content, bool final, vector<TLink> &links)
+{
+    size_t length = content.length();
+
+    while (m_Position < length)
+    {
+        size_t start = TOKEN_SCANNER.find(content, m_Position);
+        if (start == string::npos)
+        {
+            m_Position = length;
+            return;
+        }
+
+        size_t next = start + 1;
+        char c = content[start];
+
+        // Comment, or just a slash
+        if (c == '/')
+        {
+            if (start + 1 >= length)
+                next = final ? length : string::npos;
+            else if (content[start + 1] == '*')
+            {
+                size_t end = content.find("*/", start + 2);
+                next = end != string::npos ? end + 2 : (final ? length : string::npos);
+            }
+        }
+
+        // Strings are URLs only as arguments of image-set()
+        else if (c == '"' || c == '\'')
+        {
+            string value;
+            bool valid = true;
+            next = consumeString(content, start, final, value, valid);
+
+            if (next != string::npos && valid && m_ImageSetDepth == 1)
+                addLink(links, EKind::IMAGE_SET, start + 1, content[next - 1] == c && next - 1 > start ? next - 1 : next, value, true);
+        }
+
+        else if (c == '@')
+            next = parseAtKeyword(content, start, final, links);
+
+        else if (c == '(')
+            next = parseFunction(content, start, final, links);
+
+        else if (c == ')')
+        {
+            if (m_ImageSetDepth > 0)
+                m_ImageSetDepth--;
+        }
+
+        // Escaped character of a name, so it doesn't start a string or a comment
+        else if (c == '\\')
+        {
+            if (start + 1 >= length)
+                next = final ? length : string::npos;
+            else if (isValidEscape(content, start))
+            {
+                string ignored;
+                next = consumeEscape(content, start, ignored);
+            }
+        }
+
+        // Token may continue in the next data
+        if (next == string::npos)
+        {
+            m_Position = start;
+            return;
+        }
+
+        m_Position = next;
+    }
+}
+
+size_t CCssTokenizer::getPosition() const
+{
+    return m_Position;
+}
+
+vector<CCssTokenizer::TLink> CCssTokenizer::tokenize(const string &content)
+{
+    vector<TLink> links;
+
+    CCssTokenizer tokenizer;
+    tokenizer.feed(content, true, links);
+
+    return links;
+}
+
+string CCssTokenizer::escape(const string &url, bool quoted)
+{
+    static const char HEX[] = "0123456789abcdef";
+    string result;
+    result.reserve(url.length());
+
+    for (char c : url)
+    {
+        // Newlines can't be escaped with a backslash, whitespace ends the unquoted url, quotes would end the
+        // HTML attribute around inline CSS
+        if (isNewline(c) || isNonPrintable(c) || c == '"' || c == '\'' || (!quoted && isSpace(c)))
+        {
+            result += '\\';
+            if (static_cast<unsigned char>(c) >= 0x10)
+                result += HEX[static_cast<unsigned char>(c) >> 4];
+            result += HEX[c & 0x0F];
+            result += ' ';
+        }
+        else if (c == '\\' || (!quoted && (c == '(' || c == ')')))
+        {
+            result += '\\';
+            result += c;
+        }
+        else
+            result += c;
+    }
+
+    return result;
+}
+
+size_t CCssTokenizer::parseAtKeyword(const string &content, size_t start, bool final, vector<TLink> &links)
+{
+    size_t length = content.length();
+
+    string name;
+    size_t i = consumeName(content, start + 1, name);
+
+    if (i >= length && !final)
+        return string::npos;
+
+    if (name != "import")
+        return i;
+
+    // @import "url" or @import url(url)
+    i = skipWhitespace(content, i, final);
+    if (i == string::npos || (i >= length && !final))
+        return string::npos;
+
+    if (i >= length)
+        return length;
+
+    if (content[i] == '"' || content[i] == '\'')
+    {
+        string value;
+        bool valid = true;
+        size_t next = consumeString(content, i, final, value, valid);
+
+        if (next == string::npos)
+            return string::npos;
+
+        if (valid)
+            addLink(links, EKind::IMPORT, i + 1, content[next - 1] == content[i] && next - 1 > i ? next - 1 : next, value, true);
+
+        return next;
+    }
+
+    string function;
+    size_t end = consumeName(content, i, function);
+
+    if (end >= length)
+        return final ? length : string::npos;
+
+    if (function == "url" && content[end] == '(')
+        return parseUrl(content, end + 1, final, EKind::IMPORT, links);
+
+    return i;
+}
+
+size_t CCssTokenizer::parseFunction(const string &content, size_t start, bool final, vector<TLink> &links)
+{
+    // The name was already skipped, find its start and check it's really the whole function name
+    size_t nameStart = start;
+    while (nameStart > 0 && (isNameChar(content[nameStart - 1]) || content[nameStart - 1] == '\\'))
+        nameStart--;
+
+    string name;
+    bool isFunction = nameStart < start &&
+                      consumeName(content, nameStart, name) == start &&
+                      (nameStart == 0 || (content[nameStart - 1] != '@' && content[nameStart - 1] != '#'));
+
+    if (isFunction && name == "url")
+        return parseUrl(content, start + 1, final, EKind::URL, links);
+
+    if (isFunction && (name == "image-set" || name == "-webkit-image-set"))
+        m_ImageSetDepth++;
+    else if (m_ImageSetDepth > 0)
+        m_ImageSetDepth++;
+
+    return start + 1;
+}
+
+size_t CCssTokenizer::parseUrl(const string &content, size_t start, bool final, EKind kind, vector<TLink> &links)
+{
+    size_t length = content.length();
+    size_t i = start;
+
+    while (i < length && isSpace(content[i]))
+        i++;
+
+    if (i >= length)
+        return final ? length : string::npos;
+
+    // Function url( with a string argument
+    if (content[i] == '"' || content[i] == '\'')
+    {
+        string value;
+        bool valid = true;
+        size_t next = consumeString(content, i, final, value, valid);
+
+        if (next == string::npos)
+            return string::npos;
+
+        size_t end = next;
+        while (end < length && isSpace(content[end]))
+            end++;
+
+        if (end >= length && !final)
+            return string::npos;
+
+        if (valid)
+            addLink(links, kind, i + 1, content[next - 1] == content[i] && next - 1 > i ? next - 1 : next, value, true);
+
+        if (end < length && content[end] == ')')
+            return end + 1;
+
+        // More arguments, the closing parenthesis is handled as a plain one
+        if (m_ImageSetDepth > 0)
+            m_ImageSetDepth++;
+
+        return end;
+    }
+
+    // Url token
+    size_t urlStart = i;
+    string value;
+    bool bad = false;
+
+    while (true)
+    {
+        if (i >= length)
+        {
+            if (!final)
+                return string::npos;
+
+            if (!bad)
+                addLink(links, kind, urlStart, length, value, false);
+
+            return length;
+        }
+
+        char c = content[i];
+
+        if (c == ')')
+        {
+            if (!bad)
+                addLink(links, kind, urlStart, i, value, false);
+
+            return i + 1;
+        }
+
+        if (bad)
+        {
+            if (c == '\\' && i + 1 >= length && !final)
+                return string::npos;
+
+            i = isValidEscape(content, i) ? consumeEscape(content, i, value) : i + 1;
+            continue;
+        }
+
+        if (isSpace(c))
+        {
+            size_t end = i;
+            while (i < length && isSpace(content[i]))
+                i++;
+
+            if (i >= length)
+            {
+                if (!final)
+                    return string::npos;
+
+                addLink(links, kind, urlStart, end, value, false);
+                return length;
+            }
+
+            if (content[i] == ')')
+            {
+                addLink(links, kind, urlStart, end, value, false);
+                return i + 1;
+            }
+
+            bad = true;
+            continue;
+        }
+
+        if (c == '\\')
+        {
+            if (i + 1 >= length && !final)
+                return string::npos;
+
+            if (isValidEscape(content, i))
+            {
+                i = consumeEscape(content, i, value);
+                continue;
+            }
+
+            bad = true;
+            continue;
+        }
+
+        if (c == '"' || c == '\'' || c == '(' || isNonPrintable(c))
+        {
+            bad = true;
+            continue;
+        }
+
+        value += c;
+        i++;
+    }
+}
+
+size_t CCssTokenizer::consumeString(const string &content, size_t start, bool final, string &value, bool &valid)
+{
+    size_t length = content.length();
+    char quote = content[start];
+    size_t i = start + 1;
+
+    while (true)
+    {
+        if (i >= length)
+            return final ? length : string::npos;
+
+        char c = content[i];
+
+        if (c == quote)
+            return i + 1;
+
+        // Bad string, the newline is not part of it
+        if (isNewline(c))
+        {
+            valid = false;
+            return i;
+        }
+
+        if (c == '\\')
+        {
+            if (i + 1 >= length)
+            {
+                if (!final)
+                    return string::npos;
+
+                i++;
+                continue;
+            }
+
+            // Escaped newline continues the string
+            if (isNewline(content[i + 1]))
+            {
+                i += (content[i + 1] == '\r' && i + 2 < length && content[i + 2] == '\n') ? 3 : 2;
+                continue;
+            }
+
+            i = consumeEscape(content, i, value);
+            continue;
+        }
+
+        value += c;
+        i++;
+    }
+}
+
+size_t CCssTokenizer::consumeEscape(const string &content, size_t start, string &value)
+{
+    size_t length = content.length();
+    size_t i = start + 1;
+
+    if (i >= length)
+    {
+        Utils::appendUtf8(value, 0xFFFD);
+        return length;
+    }
+
+    if (!isHexDigit(content[i]))
+    {
+        value += content[i];
+        return i + 1;
+    }
+
+    unsigned long codePoint = 0;
+    for (size_t digits = 0; digits < 6 && i < length && isHexDigit(content[i]); digits++, i++)
+        codePoint = codePoint * 16 + hexValue(content[i]);
+
+    // One whitespace after the hex digits belongs to the escape
+    if (i < length && isSpace(content[i]))
+        i += (content[i] == '\r' && i + 1 < length && content[i + 1] == '\n') ? 2 : 1;
+
+    if (codePoint == 0 || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint > 0x10FFFF)
+        codePoint = 0xFFFD;
+
+    Utils::appendUtf8(value, codePoint);
+    return i;
+}
+
+size_t CCssTokenizer::consumeName(const string &content, size_t start, string &name)
+{
+    size_t length = content.length();
+    size_t i = start;
+
+    while (i < length)
+    {
+        if (isNameChar(content[i]))
+        {
+            char c = content[i++];
+            name += (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+        else if (isValidEscape(content, i))
+        {
+            string escaped;
+            i = consumeEscape(content, i, escaped);
+
+            for (char c : escaped)
+                name += (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+        else
+            break;
+    }
+
+    return i;
+}
+
+size_t CCssTokenizer::skipWhitespace(const string &content, size_t start, bool final)
+{
+    size_t length = content.length();
+    size_t i = start;
+
+    while (i < length)
+    {
+        if (isSpace(content[i]))
+            i++;
+        else if (content[i] == '/' && i + 1 >= length && !final)
+            return string::npos;
+        else if (content.compare(i, 2, "/*") == 0)
+        {
+            size_t end = content.find("*/", i + 2);
+            if (end == string::npos)
+                return final ? length : string::npos;
+
+            i = end + 2;
+        }
+        else
+            break;
+    }
+
+    return i;
+}
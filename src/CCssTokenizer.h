@@ -0,0 +1,169 @@
+/**
+ * @file CCssTokenizer.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CCssTokenizer
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::string, std::vector;
+
+/**
+ * @brief Single pass CSS tokenizer following CSS Syntax Level 3 that finds URLs with their byte offsets
+ *
+ * URLs are found in url() (both the url token and the url function with a string), in the string or url() of
+ * @import and in the strings of image-set(). Comments, other strings, escapes and functions whose name only ends
+ * with "url" are handled as tokens, so nothing inside them is matched. The tokenizer can be fed with growing
+ * content, a token that is not complete yet is tokenized again with the next data.
+ *
+ */
+class CCssTokenizer
+{
+public:
+    /**
+     * @brief Construct where the URL was found
+     *
+     */
+    enum class EKind
+    {
+        URL,
+        IMPORT,
+        IMAGE_SET
+    };
+
+    /**
+     * @brief URL found in the content
+     *
+     */
+    struct TLink
+    {
+        EKind m_Kind;    // Construct containing the URL
+        size_t m_Offset; // Position of the raw URL in the content, without quotes and whitespace
+        size_t m_Length; // Length of the raw URL
+        string m_Value;  // URL with escapes resolved
+        bool m_Quoted;   // True if the URL is a string, false for an unquoted url token
+    };
+
+    /**
+     * @brief Tokenize the content from the position where the last call ended
+     *
+     * @param content Whole content received so far
+     * @param final If false, stop before a token that may continue in the next data
+     * @param[out] links Found links are appended here
+     */
+    void feed(const string &content, bool final, vector<TLink> &links);
+
+    /**
+     * @brief Get the position in the content where the next call continues
+     *
+     * @return size_t
+     */
+    size_t getPosition() const;
+
+    /**
+     * @brief Tokenize the whole content at once
+     *
+     * @param content
+     * @return vector<TLink>
+     */
+    static vector<TLink> tokenize(const string &content);
+
+    /**
+     * @brief Escape the URL, so it can replace the raw URL of a link
+     *
+     * @param url
+     * @param quoted True if the replaced URL is a string
+     * @return string
+     */
+    static string escape(const string &url, bool quoted);
+
+private:
+    size_t m_Position = 0;
+
+    /**
+     * @brief Nesting of parentheses inside image-set(), 0 outside of it
+     *
+     */
+    size_t m_ImageSetDepth = 0;
+
+    /**
+     * @brief Tokenize the at-keyword and the URL of @import
+     *
+     * @param content
+     * @param start Position of '@'
+     * @param final
+     * @param[out] links
+     * @return size_t Position after the tokens, string::npos if they are not complete yet
+     */
+    size_t parseAtKeyword(const string &content, size_t start, bool final, vector<TLink> &links);
+
+    /**
+     * @brief Tokenize the function whose '(' is at the position, the name is found backwards
+     *
+     * @param content
+     * @param start Position of '('
+     * @param final
+     * @param[out] links
+     * @return size_t Position after the tokens, string::npos if they are not complete yet
+     */
+    size_t parseFunction(const string &content, size_t start, bool final, vector<TLink> &links);
+
+    /**
+     * @brief Tokenize the rest of url( after its name
+     *
+     * @param content
+     * @param start Position after '('
+     * @param final
+     * @param kind
+     * @param[out] links
+     * @return size_t Position after ')', string::npos if it's not complete yet
+     */
+    size_t parseUrl(const string &content, size_t start, bool final, EKind kind, vector<TLink> &links);
+
+    /**
+     * @brief Consume the string token starting with a quote
+     *
+     * @param content
+     * @param start Position of the quote
+     * @param final
+     * @param[out] value String with escapes resolved
+     * @param[out] valid False for a bad string (unescaped newline)
+     * @return size_t Position after the closing quote, string::npos if it's not complete yet
+     */
+    static size_t consumeString(const string &content, size_t start, bool final, string &value, bool &valid);
+
+    /**
+     * @brief Consume the escape starting with a backslash and append the escaped code point
+     *
+     * @param content
+     * @param start Position of the backslash
+     * @param[out] value
+     * @return size_t Position after the escape
+     */
+    static size_t consumeEscape(const string &content, size_t start, string &value);
+
+    /**
+     * @brief Consume the name (identifier characters and escapes)
+     *
+     * @param content
+     * @param start
+     * @param[out] name Lowercase name with escapes resolved
+     * @return size_t Position after the name
+     */
+    static size_t consumeName(const string &content, size_t start, string &name);
+
+    /**
+     * @brief Skip whitespace and comments
+     *
+     * @param content
+     * @param start
+     * @param final
+     * @return size_t Position of the next token, string::npos if a comment is not complete yet
+     */
+    static size_t skipWhitespace(const string &content, size_t start, bool final);
+};
@@ -0,0 +1,151 @@
+/**
+ * @file CDirectoryCache.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CDirectoryCache
+ *
+ */
+
+#include "CDirectoryCache.h"
+
+#include <cerrno>
+#include <vector>
+
+#include <sys/stat.h>
+
+bool CDirectoryCache::create(const string &directory)
+{
+    string dir = normalize(directory);
+    if (dir.empty())
+        return true;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Find the deepest level known to be on disk, everything below it has to be created
+    std::vector<string> missing;
+
+    for (size_t end = dir.length(); end != 0 && end != string::npos; end = dir.find_last_of('/', end - 1))
+    {
+        string level = dir.substr(0, end);
+        auto it = m_Directories.find(level);
+
+        if (it != m_Directories.end() && it->second != EState::MISSING)
+            break;
+
+        missing.push_back(level);
+    }
+
+    // Create from the top, each level only once per run
+    for (auto it = missing.rbegin(); it != missing.rend(); ++it)
+    {
+        m_MkdirCalls++;
+
+        if (::mkdir(it->c_str(), 0755) == 0)
+            m_Directories[*it] = EState::FRESH;
+        else if (errno == EEXIST)
+            m_Directories[*it] = EState::EXISTING;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+bool CDirectoryCache::fileExists(const string &file)
+{
+    size_t slash = file.find_last_of('/');
+    string dir = normalize(slash == string::npos ? "." : file.substr(0, slash));
+
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // Nothing from the previous runs can be inside a directory which didn't exist
+        for (size_t end = dir.length(); end != 0 && end != string::npos; end = dir.find_last_of('/', end - 1))
+        {
+            auto it = m_Directories.find(dir.substr(0, end));
+            if (it == m_Directories.end())
+                continue;
+
+            if (it->second != EState::EXISTING)
+                return false;
+
+            known = (end == dir.length());
+            break;
+        }
+    }
+
+    struct stat info;
+
+    // Check the directory first, its state is remembered for all other files inside
+    if (!known)
+    {
+        m_StatCalls++;
+        bool exists = ::stat(dir.c_str(), &info) == 0;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Directories.emplace(dir, exists ? EState::EXISTING : EState::MISSING);
+
+        if (!exists)
+            return false;
+    }
+
+    m_StatCalls++;
+    return ::stat(file.c_str(), &info) == 0;
+}
+
+bool CDirectoryCache::contains(const string &directory)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto it = m_Directories.find(normalize(directory));
+    return it != m_Directories.end() && it->second != EState::MISSING;
+}
+
+void CDirectoryCache::insert(const string &directory)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Whoever created it might have found older files inside
+    auto &state = m_Directories.emplace(normalize(directory), EState::EXISTING).first->second;
+    if (state == EState::MISSING)
+        state = EState::EXISTING;
+}
+
+void CDirectoryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Directories.clear();
+}
+
+size_t CDirectoryCache::getMkdirCalls() const
+{
+    return m_MkdirCalls;
+}
+
+size_t CDirectoryCache::getStatCalls() const
+{
+    return m_StatCalls;
+}
+
+string CDirectoryCache::normalize(const string &directory)
+{
+    string result;
+    result.reserve(directory.length());
+
+    // Collapse repeated slashes
+    for (char c : directory)
+        if (c != '/' || result.empty() || result.back() != '/')
+            result += c;
+
+    // Remove the trailing slash, but keep the root
+    if (result.length() > 1 && result.back() == '/')
+        result.pop_back();
+
+    return result;
+}
+
+CDirectoryCache &CDirectoryCache::getInstance()
+{
+    static CDirectoryCache instance;
+    return instance;
+}
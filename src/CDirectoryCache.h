@@ -0,0 +1,131 @@
+/**
+ * @file CDirectoryCache.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CDirectoryCache
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using std::string;
+
+/**
+ * @brief Directory cache singleton shared by all workers, remembers which output directories are already on disk
+ *
+ * Every directory is created (or found) only once per run, so saving thousands of files into the same folder
+ * doesn't repeat the mkdir/stat walk for every file. Directories that did not exist before the run are known
+ * to contain only files written by this run, so checking whether a file in them already exists needs no syscall.
+ *
+ */
+class CDirectoryCache
+{
+public:
+    /**
+     * @brief Create the directory with all its parents, only the levels not known to exist touch the disk
+     *
+     * @param directory
+     * @return true If the directory exists
+     * @return false If it can't be created
+     */
+    bool create(const string &directory);
+
+    /**
+     * @brief Returns true if the file exists, files inside directories missing before the run are never checked on disk
+     *
+     * @param file
+     * @return true
+     * @return false
+     */
+    bool fileExists(const string &file);
+
+    /**
+     * @brief Returns true if the directory is known to exist
+     *
+     * @param directory
+     * @return true
+     * @return false
+     */
+    bool contains(const string &directory);
+
+    /**
+     * @brief Remember directory created by someone else (eg. the io_uring writer), its content is not known
+     *
+     * @param directory
+     */
+    void insert(const string &directory);
+
+    /**
+     * @brief Forget all directories, needed when the output folder is changed or deleted
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of mkdir calls made by the cache
+     *
+     * @return size_t
+     */
+    size_t getMkdirCalls() const;
+
+    /**
+     * @brief Get the number of stat calls made by the cache
+     *
+     * @return size_t
+     */
+    size_t getStatCalls() const;
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CDirectoryCache
+     *
+     * @return CDirectoryCache&
+     */
+    static CDirectoryCache &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CDirectoryCache being singleton
+     *
+     */
+    CDirectoryCache(const CDirectoryCache &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CDirectoryCache being singleton
+     *
+     */
+    void operator=(const CDirectoryCache &) = delete;
+
+private:
+    CDirectoryCache() = default;
+
+    /**
+     * @brief State of the known directory
+     *
+     */
+    enum class EState
+    {
+        EXISTING, // Was on disk before the run, may contain older files
+        FRESH,    // Was created by this run, contains only files from this run
+        MISSING   // Not on disk yet, has to be created before writing into it
+    };
+
+    std::mutex m_Mutex;
+    std::unordered_map<string, EState> m_Directories;
+
+    std::atomic<size_t> m_MkdirCalls{0};
+    std::atomic<size_t> m_StatCalls{0};
+
+    /**
+     * @brief Remove trailing slashes so "a/b/" and "a/b" share one entry
+     *
+     * @param directory
+     * @return string
+     */
+    static string normalize(const string &directory);
+};
@@ -0,0 +1,116 @@
+/**
+ * @file CDomainMatcher.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CDomainMatcher
+ *
+ */
+
+#include "CDomainMatcher.h"
+
+#include <algorithm> // min
+#include <cctype>
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+void CDomainMatcher::setRules(const string &list)
+{
+    m_Rules.clear();
+    m_Domains.clear();
+
+    string_view rest = list;
+
+    while (!rest.empty())
+    {
+        size_t end = std::min(rest.find(','), rest.length());
+        string_view rule = rest.substr(0, end);
+        rest.remove_prefix(std::min(end + 1, rest.length()));
+
+        while (!rule.empty() && isSpace(rule.front()))
+            rule.remove_prefix(1);
+        while (!rule.empty() && isSpace(rule.back()))
+            rule.remove_suffix(1);
+
+        EKind kind = EXACT;
+        if (rule.substr(0, 2) == "*.")
+        {
+            kind = SUBDOMAINS;
+            rule.remove_prefix(2);
+        }
+
+        // Fully qualified "example.com." is the same domain
+        while (!rule.empty() && rule.back() == '.')
+            rule.remove_suffix(1);
+
+        if (rule.empty())
+            continue;
+
+        string domain;
+        domain.reserve(rule.length());
+        for (char c : rule)
+            domain += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+        auto it = m_Rules.find(domain);
+        if (it == m_Rules.end())
+        {
+            m_Domains.push_back(std::move(domain));
+            it = m_Rules.emplace(m_Domains.back(), 0).first;
+        }
+
+        it->second |= kind;
+    }
+}
+
+bool CDomainMatcher::isEmpty() const
+{
+    return m_Rules.empty();
+}
+
+size_t CDomainMatcher::size() const
+{
+    return m_Rules.size();
+}
+
+bool CDomainMatcher::matches(string_view host) const
+{
+    if (m_Rules.empty())
+        return true;
+
+    // Port is not part of the domain, IPv6 literals are matched whole
+    size_t colon = host.rfind(':');
+    if (colon != string_view::npos && host.find(']', colon) == string_view::npos)
+        host = host.substr(0, colon);
+
+    if (!host.empty() && host.back() == '.')
+        host.remove_suffix(1);
+
+    // The exact rule of the host, or of the host without "www."
+    auto it = m_Rules.find(host);
+    if (it != m_Rules.end() && (it->second & EXACT))
+        return true;
+
+    if (host.substr(0, 4) == "www.")
+    {
+        it = m_Rules.find(host.substr(4));
+        if (it != m_Rules.end() && (it->second & EXACT))
+            return true;
+    }
+
+    // Subdomain rules of the parent domains, one label shorter each time
+    for (size_t dot = host.find('.'); dot != string_view::npos; dot = host.find('.', dot + 1))
+    {
+        it = m_Rules.find(host.substr(dot + 1));
+        if (it != m_Rules.end() && (it->second & SUBDOMAINS))
+            return true;
+    }
+
+    return false;
+}
+
+CDomainMatcher &CDomainMatcher::getInstance()
+{
+    static CDomainMatcher instance;
+    return instance;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file CDomainMatcher.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CDomainMatcher
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using std::string, std::string_view;
+
+/**
+ * @brief Domain allowlist singleton for the --limit option, compiled once at startup and only read by the workers
+ *
+ * A rule "example.com" allows just that host (and its "www." variant), a rule "*.example.com" allows any of its
+ * subdomains. Rules are kept in one hash map keyed by the domain, so a lookup walks the labels of the host from the
+ * whole host to its parent domains, one hash lookup per label, regardless of the number of rules.
+ *
+ */
+class CDomainMatcher
+{
+public:
+    /**
+     * @brief Replace the rules, must not be called while the workers are running
+     *
+     * @param list Comma separated rules, whitespace around them is ignored
+     */
+    void setRules(const string &list);
+
+    /**
+     * @brief Returns true if there are no rules, so every domain is allowed
+     *
+     * @return true
+     * @return false
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Get the number of distinct rules
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Check the host against the rules
+     *
+     * @param host Lowercase host, may contain the port (eg. "localhost:8080")
+     * @return true If the host is allowed (always with no rules)
+     * @return false
+     */
+    bool matches(string_view host) const;
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CDomainMatcher
+     *
+     * @return CDomainMatcher&
+     */
+    static CDomainMatcher &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CDomainMatcher being singleton
+     *
+     */
+    CDomainMatcher(const CDomainMatcher &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CDomainMatcher being singleton
+     *
+     */
+    void operator=(const CDomainMatcher &) = delete;
+
+private:
+    CDomainMatcher() = default;
+
+    /**
+     * @brief Kind of the rules of one domain, both may be set
+     *
+     */
+    enum EKind : uint8_t
+    {
+        EXACT = 1,    // "example.com"
+        SUBDOMAINS = 2 // "*.example.com"
+    };
+
+    /**
+     * @brief Lowercase domains of the rules, a deque never moves them
+     *
+     */
+    std::deque<string> m_Domains;
+
+    /**
+     * @brief Kinds of rules by the domain, keys are views into m_Domains
+     *
+     */
+    std::unordered_map<string_view, uint8_t> m_Rules;
+};
@@ -0,0 +1,70 @@
+/**
+ * @file CEditList.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CEditList
+ *
+ */
+
+#include "CEditList.h"
+
+#include <algorithm> // stable_sort
+#include <stdexcept>
+
+void CEditList::add(size_t offset, size_t length, string replacement)
+{
+    if (!m_Edits.empty() && offset < m_Edits.back().m_Offset)
+        m_Sorted = false;
+
+    m_Edits.push_back({offset, length, std::move(replacement)});
+}
+
+void CEditList::apply(string &content)
+{
+    if (m_Edits.empty())
+        return;
+
+    // Insertions at the same offset keep the order they were added in
+    if (!m_Sorted)
+        std::stable_sort(m_Edits.begin(), m_Edits.end(), [](const TEdit &a, const TEdit &b)
+                         { return a.m_Offset < b.m_Offset; });
+
+    // Validate and compute the final size first, so the content is copied just once
+    size_t resultLength = content.length();
+    size_t end = 0;
+
+    for (const auto &edit : m_Edits)
+    {
+        if (edit.m_Offset < end || edit.m_Offset + edit.m_Length > content.length())
+            throw std::invalid_argument("Edits overlap or are out of the content");
+
+        end = edit.m_Offset + edit.m_Length;
+        resultLength = resultLength - edit.m_Length + edit.m_Replacement.length();
+    }
+
+    string result;
+    result.reserve(resultLength);
+    size_t copied = 0;
+
+    for (const auto &edit : m_Edits)
+    {
+        result.append(content, copied, edit.m_Offset - copied);
+        result += edit.m_Replacement;
+        copied = edit.m_Offset + edit.m_Length;
+    }
+
+    result.append(content, copied, string::npos);
+    content = std::move(result);
+
+    clear();
+}
+
+size_t CEditList::size() const
+{
+    return m_Edits.size();
+}
+
+void CEditList::clear()
+{
+    m_Edits.clear();
+    m_Sorted = true;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file CEditList.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CEditList
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::string, std::vector;
+
+/**
+ * @brief List of replacements at byte offsets of the content, applied in one linear pass
+ *
+ * Edits are collected while parsing, when the offsets still point to the original content. Applying them
+ * copies the content once into a buffer of the final size, so the cost doesn't depend on the number of edits.
+ *
+ */
+class CEditList
+{
+public:
+    /**
+     * @brief Replacement of a range of the content
+     *
+     */
+    struct TEdit
+    {
+        size_t m_Offset;      // Start of the replaced range
+        size_t m_Length;      // Length of the replaced range, 0 inserts before the offset
+        string m_Replacement; // New text of the range
+    };
+
+    /**
+     * @brief Add the edit, edits may be added in any order but must not overlap
+     *
+     * @param offset Start of the replaced range
+     * @param length Length of the replaced range
+     * @param replacement
+     */
+    void add(size_t offset, size_t length, string replacement);
+
+    /**
+     * @brief Apply all edits to the content and clear the list
+     *
+     * @param[in,out] content Content the offsets point to
+     * @throws std::invalid_argument If the edits overlap or are out of the content
+     */
+    void apply(string &content);
+
+    /**
+     * @brief Get the number of edits
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    /**
+     * @brief Remove all edits
+     *
+     */
+    void clear();
+
+private:
+    vector<TEdit> m_Edits;
+    bool m_Sorted = true;
+};
@@ -6,90 +6,194 @@
  */
 
 #include "CConfig.h"
+#include "CContentStore.h"
+#include "CDirectoryCache.h"
+#include "CDomainMatcher.h"
+#include "COutputWriter.h"
 #include "CFile.h"
 #include "CFileHtml.h"
 #include "CFileCss.h"
 #include "CLogger.h"
 #include "CResponse.h"
+#include "CURLParser.h"
+#include "CWarcWriter.h"
 #include "Utils.h"
 
 #include <stdlib.h>
+#include <algorithm> // min, max
 #include <iostream>
 #include <filesystem>
 #include <sstream>
-#include <regex>
 
-using std::string, std::ofstream, std::regex, std::make_shared, std::stringstream;
+using std::string, std::make_shared, std::stringstream;
 namespace fs = std::filesystem;
 
-bool CFile::download()
+bool CFile::prepare()
 {
-    auto &cfg = CConfig::getInstance();
-
     // Return if depth exceeded
-    if (static_cast<int>(m_Depth) > static_cast<int>(cfg["depth"]))
+    if (static_cast<int>(m_Depth) > CConfig::getInstance().getSnapshot().m_Depth)
         return false;
 
     // Parse path to get m_OutputPath and m_Filename
     parsePath();
 
-    if (fs::exists(m_OutputPath + m_Filename))
+    // Archived files are not saved to the output folder
+    if (!CWarcWriter::getInstance().isEnabled() && CDirectoryCache::getInstance().fileExists(getOutputFile()))
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Info, m_Filename + " already exists, skipping!");
+        LOG_INFO(m_Filename + " already exists, skipping!");
         return false;
     }
 
-    CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "Processing: " + m_Url.getNormURL() + " | (depth " + std::to_string(m_Depth) + ")");
+    return true;
+}
+
+void CFile::setScheduler(TScheduler scheduler)
+{
+    m_Scheduler = std::move(scheduler);
+}
+
+bool CFile::fetch()
+{
+    LOG_VERBOSE("Processing: " + m_Url.getNormURL() + " | (depth " + std::to_string(m_Depth) + ")");
+
+    // Content that has to be buffered waits until the memory budget has some room, the rest may be streamed to disk,
+    // or only to the archive
+    bool archived = CWarcWriter::getInstance().isEnabled();
+    bool keepBody = needsContent() || !archived;
+    string spillFile;
+
+    if (!needsContent() && !archived)
+        spillFile = getOutputFile();
+
+    // Links may be found while the rest of the content is being downloaded
+    CHttpsDownloader::TBodyCallback onBody;
+
+    if (m_Scheduler && needsContent())
+        onBody = [this](const string &body)
+        { parsePartial(body); };
 
-    // Fetch the content from server
-    auto response = m_HttpD->get(m_Url);
+    auto &budget = CMemoryBudget::getInstance();
+    CResponse response;
+    size_t expectedLength = 0;
 
-    // Repeat fetching if the files is moved (301, 302 etc.)
-    while (response.m_Status == CResponse::EStatus::MOVED)
+    do
     {
-        response = m_HttpD->get(response.m_MovedUrl);
-    }
+        if (needsContent())
+            budget.waitForHeadroom(expectedLength);
+
+        // Fetch the content from server
+        response = m_HttpD->get(m_Url, spillFile, keepBody, onBody, expectedLength);
+
+        // Repeat fetching if the files is moved (301, 302 etc.)
+        while (response.m_Status == CResponse::EStatus::MOVED)
+        {
+            response = m_HttpD->get(response.m_MovedUrl, spillFile, keepBody, onBody, expectedLength);
+        }
 
-    m_Content = response.m_Body;
+        // The body outgrew the memory budget, fetch it again with twice the received length reserved up front,
+        // so the other fetches can't take the budget again in the middle of it
+        if (response.m_Status == CResponse::EStatus::OVER_BUDGET)
+        {
+            LOG_INFO("Memory budget exhausted, deferring " + m_Url.getNormURL());
+
+            size_t received = response.getBodyLength();
+            expectedLength = std::max(received, std::min(2 * received, budget.getLimit()));
+            resetParsing();
+        }
+
+    } while (response.m_Status == CResponse::EStatus::OVER_BUDGET);
+
+    // The file is already on disk, only the write stage registers it
+    if (response.isSpilled())
+    {
+        m_Spilled = true;
+        m_SpilledLength = response.getBodyLength();
+        return true;
+    }
 
-    // Create folder structure
-    fs::create_directories(m_OutputPath);
+    // The file is only in the archive, nothing left to do
+    if (!keepBody)
+        return false;
 
-    save();
+    m_Content = std::move(response.m_Body);
+    m_Reservation = std::move(response.m_Reservation);
 
     return true;
 }
 
+set<shared_ptr<CFile>> CFile::parse()
+{
+    return {};
+}
+
+void CFile::rewrite()
+{
+}
+
+bool CFile::needsContent() const
+{
+    return false;
+}
+
+void CFile::parsePartial(const string &)
+{
+}
+
+void CFile::resetParsing()
+{
+}
+
 bool CFile::save()
 {
-    // Write content to a file in the prepared folder structure
-    ofstream ofs(m_OutputPath + m_Filename, std::ios_base::out | std::ios_base::binary);
-    ofs << m_Content;
-    ofs.close();
+    if (m_Spilled)
+    {
+        CContentStore::getInstance().adopt(getOutputFile(), m_SpilledLength);
+        return true;
+    }
+
+    // Hand the content over to the output backend, which creates the folder structure and writes the file,
+    // or links it to the same content if deduplicating
+    COutputWriter::TRequest request;
+    request.m_Path = m_OutputPath + m_Filename;
+    request.m_Content = std::move(m_Content);
+    request.m_Reservation = std::move(m_Reservation);
+
+    CContentStore::getInstance().write(std::move(request));
+
+    m_Content.clear();
 
     return true;
 }
 
+const CURLHandler &CFile::getUrl() const
+{
+    return m_Url;
+}
+
+string CFile::getOutputFile() const
+{
+    return m_OutputPath + m_Filename;
+}
+
 void CFile::parsePath()
 {
-    auto &logger = CLogger::getInstance();
-    auto &cfg = CConfig::getInstance();
+    const auto &cfg = CConfig::getInstance().getSnapshot();
 
     string fullPath;
 
     if (m_Url.isExternal())
     {
-        fullPath = m_Url.getDomain() + "/" + m_Url.getNormFilePath();
-        m_OutputPath = ((string)cfg["output"]) + "/__external/";
+        fullPath.append(m_Url.getDomain()).append("/").append(m_Url.getNormFilePath());
+        m_OutputPath = cfg.m_Output + "/__external/";
     }
     else
     {
         fullPath = m_Url.getNormFilePath();
-        m_OutputPath = ((string)cfg["output"]) + "/";
+        m_OutputPath = cfg.m_Output + "/";
     }
 
     m_Filename = fullPath;
-    logger.log(CLogger::ELogLevel::Verbose, "getNormFilePath(): " + fullPath);
+    LOG_VERBOSE("getNormFilePath(): " + fullPath);
 
     // Find position of the last slash
     size_t filenameStart = fullPath.find_last_of('/');
@@ -106,54 +210,34 @@ void CFile::parsePath()
         if ((filenameEndPos = m_Filename.find('?')) != string::npos)
             m_Filename = m_Filename.substr(0, filenameEndPos);
 
-        // Build the output path
-        std::stringstream ss;
-
-        ss << ((string)cfg["output"]) << "/";
-
-        if (m_Url.isExternal())
-            ss << "__external/";
-
-        ss << fullPath.substr(0, filenameStart + 1);
-
-        // Get only the path without filename
-        m_OutputPath = ss.str();
+        // Append the path without filename to the output folder
+        m_OutputPath.append(fullPath, 0, filenameStart + 1);
     }
 
     // If there's no filename, save it as index.html
     if (m_Filename.empty() || m_Filename == "/")
         m_Filename = "index.html";
 
-    logger.log(CLogger::ELogLevel::Verbose, "Path: " + m_OutputPath);
-    logger.log(CLogger::ELogLevel::Verbose, "Filename: " + m_Filename);
+    LOG_VERBOSE("Path: " + m_OutputPath);
+    LOG_VERBOSE("Filename: " + m_Filename);
 
     return;
 }
 
-set<string> CFile::getUrlsWithRegex(const string &regexPattern, const string &content)
+const CURLHandler &CFile::getRootUrl()
 {
-    set<string> foundUrls;
-
-    try
-    {
-        const regex re(regexPattern, std::regex_constants::icase);
+    return CConfig::getInstance().getSnapshot().m_RootUrl;
+}
 
-        std::sregex_iterator iter(content.begin(), content.end(), re);
-        std::sregex_iterator end;
+bool CFile::isAbsoluteUrl(const string &url)
+{
+    string lowerUrl = Utils::toLowerCase(url.substr(0, 11));
 
-        while (iter != end)
-        {
-            string value = (*iter)[1];
-            iter++;
-            foundUrls.emplace(value);
-        }
-    }
-    catch (std::regex_error &e)
-    {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Internal error in regex");
-    }
+    for (const char *scheme : {"http://", "https://", "data:", "tel:", "javascript:", "mailto:", "//"})
+        if (Utils::startsWith(lowerUrl, scheme))
+            return true;
 
-    return foundUrls;
+    return false;
 }
 
 void CFile::transformUrlsToFiles(bool isExternal, const set<string> &urls, set<shared_ptr<CFile>> &outputFileSet)
@@ -167,40 +251,20 @@ void CFile::transformUrlsToFiles(bool isExternal, const set<string> &urls, set<s
             newLink = CURLHandler(url, true);
 
             // Skip if we are referencing ourselves
-            CURLHandler mainPageUrl(static_cast<string>(CConfig::getInstance()["url"]));
-            if (newLink.getDomain() == mainPageUrl.getDomain())
+            if (newLink.getDomainId() == getRootUrl().getDomainId())
                 continue;
 
             // Skip if URL is not in limited links, if specified
-            string domainsList = static_cast<string>(CConfig::getInstance()["limit"]);
-
-            if (!domainsList.empty() && !Utils::contains(domainsList, newLink.getDomain()))
+            if (!CDomainMatcher::getInstance().matches(newLink.getDomain()))
             {
-                CLogger::getInstance().log(CLogger::ELogLevel::Info, "Skipping link due to limit: " + newLink.getNormURL());
+                LOG_INFO("Skipping link due to limit: " + newLink.getNormURL());
                 continue;
             }
         }
         else
         {
-            string urlNoFilename = m_Url.getDomain();
-
-            // If next URL starts with a slash, it's relative to the root domain, no need to get previous path
-            if (!Utils::startsWith(url, "/"))
-            {
-                urlNoFilename = m_Url.getNormURL();
-
-                // Find position of the last slash
-                size_t filenameStart = urlNoFilename.find_last_of('/');
-
-                // If it exists and it's not the last slash (meaning theres a filename at the end, eg. index.html)
-                if (filenameStart != string::npos && filenameStart != urlNoFilename.length())
-                {
-                    // Get only the path without filename
-                    urlNoFilename = urlNoFilename.substr(0, filenameStart + 1);
-                }
-            }
-
-            newLink = CURLHandler(urlNoFilename + url, m_Url.isExternal());
+            // Already resolved against this file
+            newLink = CURLHandler(url, m_Url.isExternal());
         }
 
         shared_ptr<CFile> newFile;
@@ -214,16 +278,54 @@ void CFile::transformUrlsToFiles(bool isExternal, const set<string> &urls, set<s
 
         outputFileSet.insert(newFile);
 
-        string logOutput = isExternal ? "Next external file: " : "Next relative file:";
-        CLogger::getInstance().log(CLogger::ELogLevel::Verbose, logOutput + newLink.getNormURL() + " | (depth " + std::to_string(m_Depth + 1) + ")");
+        LOG_VERBOSE(string(isExternal ? "Next external file: " : "Next relative file:") + newLink.getNormURL() +
+                    " | (depth " + std::to_string(m_Depth + 1) + ")");
 
         if (isExternal &&
-            static_cast<int>(m_Depth) + 1 <= static_cast<int>(CConfig::getInstance()["depth"]))
-            replaceExternalWithLocal(url, newLink);
+            static_cast<int>(m_Depth) + 1 <= CConfig::getInstance().getSnapshot().m_Depth)
+            m_ExternalLinks.emplace(CInternTable::getInstance().intern(url), getLocalLink(newLink));
     }
 }
 
-void CFile::replaceExternalWithLocal(const string &searchString, const CURLHandler &linkUrlHandler)
+void CFile::applyEdits()
+{
+    size_t count = m_Edits.size();
+    m_Edits.apply(m_Content);
+
+    if (count > 0)
+        LOG_VERBOSE("Rewrote " + std::to_string(count) + " links in " + m_Url.getNormURL());
+}
+
+bool CFile::findExternalLink(const string &url, string &localLink) const
+{
+    if (m_ExternalLinks.empty())
+        return false;
+
+    // Only absolute http(s) links are external
+    string lowerUrl = Utils::toLowerCase(url.substr(0, 8));
+    if (!Utils::startsWith(lowerUrl, "http://") && !Utils::startsWith(lowerUrl, "https://"))
+        return false;
+
+    // Fragment is not part of the interned link
+    size_t fragment = std::min(url.find('#'), url.length());
+
+    CInternTable::TId id = CInternTable::getInstance().find(resolveLink(url.substr(0, fragment)));
+    auto external = m_ExternalLinks.find(id);
+
+    if (id == CInternTable::NONE || external == m_ExternalLinks.end())
+        return false;
+
+    localLink = external->second + url.substr(fragment);
+    return true;
+}
+
+string CFile::resolveLink(const string &url) const
+{
+    // Relative to the folder of this file, or to the root of the domain if it starts with a slash
+    return CURLParser::canonicalize(CURLParser::resolve(m_Url.getNormURL(), url));
+}
+
+string CFile::getLocalLink(const CURLHandler &linkUrlHandler) const
 {
     stringstream replaceString;
 
@@ -233,7 +335,7 @@ void CFile::replaceExternalWithLocal(const string &searchString, const CURLHandl
         replaceString << "../";
     }
 
-    string pathWithFixedFilename = linkUrlHandler.getNormFilePath();
+    string pathWithFixedFilename(linkUrlHandler.getNormFilePath());
 
     // Remove query params (everything after '?') from filename
     size_t filenameEndPos = string::npos;
@@ -247,7 +349,5 @@ void CFile::replaceExternalWithLocal(const string &searchString, const CURLHandl
                   << "/"
                   << pathWithFixedFilename;
 
-    Utils::replaceAll(m_Content, searchString, replaceString.str());
-
-    CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "Replaced all '" + searchString + "' with '" + replaceString.str() + "'");
+    return replaceString.str();
 }
\ No newline at end of file
@@ -9,16 +9,23 @@
 
 #include "CHttpsDownloader.h"
 #include "CURLHandler.h"
+#include "CMemoryBudget.h"
+#include "CEditList.h"
+#include "CInternTable.h"
 
 #include <stdlib.h>
 #include <iostream>
 #include <filesystem>
+#include <functional>
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <memory> // shared_ptr<>
 #include <string>
 
-using std::string, std::shared_ptr, std::set;
+using std::string, std::shared_ptr, std::set, std::vector;
 
 /**
  * @brief Polymorphic base class to download and store file content, and save it to disk
@@ -40,16 +47,87 @@ public:
           m_Url(url) {}
 
     /**
-     * @brief Process the file, parse content and download other files if needed
+     * @brief Destroy the CFile object
      *
      */
-    virtual bool download();
+    virtual ~CFile() = default;
 
     /**
-     * @brief Destroy the CFile object
+     * @brief Function that sends a discovered file to the crawl frontier
      *
      */
-    virtual ~CFile() = default;
+    using TScheduler = std::function<void(shared_ptr<CFile>)>;
+
+    /**
+     * @brief Set the scheduler for files discovered while the content is still being downloaded
+     *
+     * Without the scheduler, all subsequent files are returned by parse().
+     *
+     * @param scheduler
+     */
+    void setScheduler(TScheduler scheduler);
+
+    /**
+     * @brief Check the depth and prepare the output path, first step of the fetch stage
+     *
+     * @return true If the file should be fetched
+     * @return false If the depth is exceeded or the file already exists
+     */
+    virtual bool prepare();
+
+    /**
+     * @brief Fetch the content from server (fetch stage)
+     *
+     * @return true If the content is ready to be processed
+     * @return false If there is nothing to process further
+     */
+    virtual bool fetch();
+
+    /**
+     * @brief Parse the content and return subsequent files to download (parse stage)
+     *
+     * @return set<shared_ptr<CFile>> Subsequent files, empty for files that don't need parsing
+     */
+    virtual set<shared_ptr<CFile>> parse();
+
+    /**
+     * @brief Rewrite links in the content to local links (rewrite stage)
+     *
+     */
+    virtual void rewrite();
+
+    /**
+     * @brief Hand the File content over to the output backend to be written on disk (write stage)
+     *
+     * Content streamed to disk during the fetch is only registered in CContentStore.
+     *
+     * The m_Filename and m_OutputPath variables need to be set beforehand
+     *
+     * @return true
+     * @return false
+     */
+    bool save();
+
+    /**
+     * @brief Get the path of the output file, valid after prepare()
+     *
+     * @return string
+     */
+    string getOutputFile() const;
+
+    /**
+     * @brief Get the URL of the file
+     *
+     * @return const CURLHandler&
+     */
+    const CURLHandler &getUrl() const;
+
+    /**
+     * @brief Get the configured root URL, parsed once with the config snapshot
+     *
+     * @return const CURLHandler&
+     */
+    static const CURLHandler &getRootUrl();
 
 protected:
     shared_ptr<CHttpsDownloader> m_HttpD;
@@ -59,6 +137,66 @@ protected:
     string m_OutputPath;
     string m_Content;
 
+    /**
+     * @brief Receives files discovered during download, may be empty
+     *
+     */
+    TScheduler m_Scheduler;
+
+    /**
+     * @brief Memory budget reserved for m_Content, released after the content is written
+     *
+     */
+    CMemoryBudget::TReservation m_Reservation;
+
+    /**
+     * @brief True if the content was streamed to the output file during the fetch instead of m_Content
+     *
+     */
+    bool m_Spilled = false;
+    size_t m_SpilledLength = 0;
+
+    /**
+     * @brief External links found during parsing (interned) and the local links they are replaced with
+     *
+     */
+    std::unordered_map<CInternTable::TId, string> m_ExternalLinks;
+
+    /**
+     * @brief Edits of the content collected in the parse stage, applied in the rewrite stage
+     *
+     */
+    CEditList m_Edits;
+
+    /**
+     * @brief Interned URLs already turned into subsequent files, so no file is created twice
+     *
+     */
+    std::unordered_set<CInternTable::TId> m_Scheduled;
+
+    /**
+     * @brief Returns true if the content has to stay in memory for parsing, otherwise it may be streamed directly to disk
+     *
+     * @return true
+     * @return false
+     */
+    virtual bool needsContent() const;
+
+    /**
+     * @brief Process the part of the content received so far, called only with the scheduler set
+     *
+     * @param body Body received so far, it grows with every call and becomes the content when finished
+     */
+    virtual void parsePartial(const string &body);
+
+    /**
+     * @brief Forget the links found by parsePartial(), the content is fetched again from the start
+     *
+     * Files already sent to the scheduler are not sent again.
+     *
+     */
+    virtual void resetParsing();
+
     /**
      * @brief Prepare the required folder structure
      *
@@ -66,36 +204,52 @@ protected:
     void parsePath();
 
     /**
-     * @brief Flush the File content to a file on disk
+     * @brief Get relative local link like "../../__external/google.com/index.html" for external link like "https://google.com/index.html"
      *
-     * The m_Filename and m_OutputPath variables need to be set beforehand
+     * @param linkUrlHandler External link
+     * @return string
+     */
+    string getLocalLink(const CURLHandler &linkUrlHandler) const;
+
+    /**
+     * @brief Get the local link of the downloaded external link, the fragment of the link stays
      *
-     * @return true
+     * @param url
+     * @param[out] localLink
+     * @return true If the link is a downloaded external link
      * @return false
      */
-    bool save();
+    bool findExternalLink(const string &url, string &localLink) const;
 
     /**
-     * @brief Replace external link like "https://google.com/index.html" with relative local link like "../../__external/google.com/index.html"
+     * @brief Get the canonical absolute URL of the link found in this file, links are interned in this form only
      *
+     * @param url Link without the fragment
+     * @return string
      */
-    void replaceExternalWithLocal(const string &searchString, const CURLHandler &linkUrlHandler);
+    string resolveLink(const string &url) const;
 
     /**
-     * @brief Get Urls from content with regex pattern
+     * @brief Returns true if the URL has a scheme (eg. "https:", "data:") or is protocol relative ("//")
      *
-     * @param regexPattern Search pattern
-     * @param content Content where to search
-     * @return set<string> Set of found URLs
+     * @param url
+     * @return true
+     * @return false
      */
-    set<string> getUrlsWithRegex(const string &regexPattern, const string &content);
+    static bool isAbsoluteUrl(const string &url);
 
     /**
      * @brief Create CFile objects from provied URLs
      *
      * @param isExternal True if the current 'urls' set contains external URLs that need different processing
-     * @param urls Set of found URLs
+     * @param urls Set of found URLs, resolved by resolveLink()
      * @param[out] outputFileSet Reference to a set where to insert new CFiles
      */
     void transformUrlsToFiles(bool isExternal, const set<string> &urls, set<shared_ptr<CFile>> &outputFileSet);
+
+    /**
+     * @brief Apply the edits collected in the parse stage to the content
+     *
+     */
+    void applyEdits();
 };
@@ -8,7 +8,7 @@
 #include <stdlib.h>
 #include <iostream>
 #include <set>
-#include <regex>
+#include <sstream>
 
 #include <memory> // shared_ptr<>
 #include <string> // string
@@ -17,40 +17,72 @@
 #include "CFileHtml.h"
 #include "CLogger.h"
 #include "CConfig.h"
+#include "CTracer.h"
 #include "Utils.h"
 
 // using namespace std;
-using std::string, std::stringstream, std::regex, std::regex_replace, std::set, std::cout, std::endl, std::make_shared;
+using std::string, std::stringstream, std::set, std::cout, std::endl, std::make_shared;
 
 // CFileCss::~CFileCss() = default;
 
-bool CFileCss::download()
+set<shared_ptr<CFile>> CFileCss::parse()
 {
-    // If file already exists or couldn't be downloaded, don't do anything
-    if (!CFile::download())
-        return false;
+    LOG_VERBOSE("Processing CSS: " + m_Url.getNormURL() + " | (depth " + std::to_string(m_Depth) + ")");
 
-    CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "Processing CSS: " + m_Url.getNormURL() + " | (depth " + std::to_string(m_Depth) + ")");
+    // Finish tokenizing, links found during download were already scheduled
+    size_t from = m_Links.size();
+    {
+        CTracer::CSpan span("tokenize", "parse", m_Url.getNormURL());
+        m_Tokenizer.feed(m_Content, true, m_Links);
+    }
 
-    prepareRootUrls();
+    set<shared_ptr<CFile>> nextFiles;
+    {
+        CTracer::CSpan span("parseFile", "parse", m_Url.getNormURL());
+        nextFiles = parseFile(from);
+    }
 
-    auto newFiles = parseFile();
+    CTracer::CSpan span("collectEdits", "parse", m_Url.getNormURL());
+    collectEdits();
 
-    insertAnnoyingAdvertisementThatNobodyWantsToSee();
+    return nextFiles;
+}
 
-    save();
+void CFileCss::rewrite()
+{
+    applyEdits();
 
-    for (auto &&i : newFiles)
-    {
-        i->download();
-    }
+    insertAnnoyingAdvertisementThatNobodyWantsToSee();
+}
 
+bool CFileCss::needsContent() const
+{
     return true;
 }
 
+void CFileCss::parsePartial(const string &body)
+{
+    CTracer::CSpan span("parsePartial", "parse", m_Url.getNormURL());
+
+    size_t from = m_Links.size();
+    m_Tokenizer.feed(body, false, m_Links);
+
+    if (m_Links.size() == from)
+        return;
+
+    for (const auto &next : parseFile(from))
+        m_Scheduler(next);
+}
+
+void CFileCss::resetParsing()
+{
+    m_Tokenizer = CCssTokenizer();
+    m_Links.clear();
+}
+
 void CFileCss::insertAnnoyingAdvertisementThatNobodyWantsToSee()
 {
-    if (static_cast<bool>(CConfig::getInstance()["advertisement"]) == false)
+    if (!CConfig::getInstance().getSnapshot().m_Advertisement)
         return;
 
     stringstream ss;
@@ -69,69 +101,79 @@ void CFileCss::insertAnnoyingAdvertisementThatNobodyWantsToSee()
     //    ¯\_(ツ)_/¯
 }
 
-void CFileCss::prepareRootUrls()
+void CFileCss::collectEdits()
 {
-    stringstream replaceString;
+    string prefix;
 
     for (size_t i = 0; i < m_Url.getPathDepth(); i++)
     {
-        replaceString << "../";
+        prefix += "../";
     }
 
-    replaceString << "$1\""; // the link itself
-
-    const regex re_url("(?:url ?\\([\"']?(?!data:|#)((?:\\/)[^;\"'\\s]+)[\"']?)\\)", std::regex_constants::icase);
-    const regex re_import("(?:@import [\"']?(?!url\\(|data:|#)((?:\\/)[^;\"'\\s]+)[\"']?)", std::regex_constants::icase);
-
-    m_Content = regex_replace(m_Content, re_url, replaceString.str());
-    m_Content = regex_replace(m_Content, re_import, replaceString.str());
+    for (const auto &link : m_Links)
+    {
+        const string &url = link.m_Value;
+        string replacement;
+
+        // Downloaded external link, the fragment stays
+        if (!findExternalLink(url, replacement))
+        {
+            // Root link (not "//"), the leading slash is replaced with the path to the root directory
+            if (url.length() > 1 && url[0] == '/' && url[1] != '/')
+                replacement = prefix + url.substr(1);
+
+            else
+                continue;
+        }
+
+        // The raw link may contain escapes, it's replaced whole
+        m_Edits.add(link.m_Offset, link.m_Length, CCssTokenizer::escape(replacement, link.m_Quoted));
+    }
 }
 
-set<shared_ptr<CFile>> CFileCss::parseFile()
+set<shared_ptr<CFile>> CFileCss::parseFile(size_t from)
 {
     set<shared_ptr<CFile>> nextFiles;
 
-    // RELATIVE links
+    // RELATIVE and EXTERNAL links
     set<string> nextUrls;
+    set<string> nextUrlsExternal;
 
-    // Get relative url() links
-    auto relUrls = getUrlsWithRegex("(?:url ?\\([\"']?(?!data:|#|http)([^;\"'\\s]+)[\"']?)\\)", m_Content);
-    for (const auto &url : relUrls)
+    for (size_t i = from; i < m_Links.size(); i++)
     {
-        nextUrls.emplace(url);
-    }
+        // Fragment is not part of the file (eg. "icons.svg#home")
+        string url = m_Links[i].m_Value;
+        url = url.substr(0, url.find('#'));
 
-    // Get relative @import links
-    auto relImports = getUrlsWithRegex("(?:@import [\"']?(?!url\\(|data:|#|http)([^;\"'\\s]+)[\"']?)", m_Content);
-    for (const auto &import : relImports)
-    {
-        nextUrls.emplace(import);
+        if (url.empty())
+            continue;
+
+        string lowerUrl = Utils::toLowerCase(url.substr(0, 8));
+        bool isExternal = Utils::startsWith(lowerUrl, "http://") || Utils::startsWith(lowerUrl, "https://");
+
+        // Skip data:, protocol relative links etc.
+        if (!isExternal && isAbsoluteUrl(url))
+            continue;
+
+        // Already scheduled during download, or linked in another form
+        string target = resolveLink(url);
+
+        if (!m_Scheduled.insert(CInternTable::getInstance().intern(target)).second)
+            continue;
+
+        if (isExternal)
+            nextUrlsExternal.emplace(target);
+        else
+            nextUrls.emplace(target);
     }
 
     // Transform each URL to correct File and insert into nextFiles set
     transformUrlsToFiles(false, nextUrls, nextFiles);
 
     // Skip external links if desired
-    if (static_cast<bool>(CConfig::getInstance()["remote"]) == true)
+    if (CConfig::getInstance().getSnapshot().m_Remote)
         return nextFiles;
 
-    // EXTERNAL links
-    set<string> nextUrlsExternal;
-
-    // Get external url() links
-    auto externUrls = getUrlsWithRegex("(?:url ?\\([\"']?(?!data:|#)((?:http:\\/\\/|https:\\/\\/)[^;\"'\\s]+)[\"']?)\\)", m_Content);
-    for (const auto &url : externUrls)
-    {
-        nextUrls.emplace(url);
-    }
-
-    // Get external @import links
-    auto externImports = getUrlsWithRegex("(?:@import [\"']?(?!url\\(|data:|#)((?:http:\\/\\/|https:\\/\\/)[^;\"'\\s]+)[\"']?)", m_Content);
-    for (const auto &import : externImports)
-    {
-        nextUrls.emplace(import);
-    }
-
     // Transform each URL to correct File and insert into nextFiles set
     transformUrlsToFiles(true, nextUrlsExternal, nextFiles);
 
@@ -8,15 +8,16 @@
 
 #include "CFile.h"
 #include "CURLHandler.h"
+#include "CCssTokenizer.h"
 
 #include <stdlib.h>
 #include <iostream>
 #include <set>
-#include <regex>
 #include <memory> // shared_ptr<>
 #include <string>
+#include <vector>
 
-using std::set, std::shared_ptr, std::string;
+using std::set, std::shared_ptr, std::string, std::vector;
 
 /**
  * @brief Polymorphic derived class that also parses the CSS document and recursively downloads subsequent files
@@ -42,26 +43,65 @@ public:
     virtual ~CFileCss() = default;
 
     /**
-     * @brief Fetch the File from URL and save it to disk, recursively download subsequent files
+     * @brief Find links and return subsequent files to download
      *
      */
-    virtual bool download() override;
+    virtual set<shared_ptr<CFile>> parse() override;
+
+    /**
+     * @brief Replace external links with local links
+     *
+     */
+    virtual void rewrite() override;
+
+protected:
+    /**
+     * @brief The content is always needed for parsing
+     *
+     */
+    virtual bool needsContent() const override;
+
+    /**
+     * @brief Tokenize the newly received part of the body and schedule the found files right away
+     *
+     */
+    virtual void parsePartial(const string &body) override;
+
+    /**
+     * @brief Start tokenizing from the beginning of the content
+     *
+     */
+    virtual void resetParsing() override;
 
 private:
     /**
-     * @brief Parse the file and return subsequent files to download
+     * @brief Tokenizer fed with the body during download and with the whole content in parse()
+     *
+     */
+    CCssTokenizer m_Tokenizer;
+
+    /**
+     * @brief All links found by the tokenizer so far
+     *
+     */
+    vector<CCssTokenizer::TLink> m_Links;
+
+    /**
+     * @brief Create subsequent files to download from links that were not processed yet
      *
+     * @param from Index of the first link in m_Links to process
      * @return set<CFile>
      */
-    set<shared_ptr<CFile>> parseFile();
+    set<shared_ptr<CFile>> parseFile(size_t from);
 
     /**
-     * @brief Preproccess the CSS source code - replace absolute paths with relative paths
+     * @brief Collect the edits of all links, applied in the rewrite stage
      *
-     * For example: url("/assets/main.css") may become url("../../assets/main.css")
+     * Root links like url("/assets/font.woff") may become url("../../assets/font.woff") and downloaded external
+     * links point to the local copy
      *
      */
-    void prepareRootUrls();
+    void collectEdits();
 
     /**
      * @brief Insert ASCII art with project link to the end of CSS file
@@ -7,82 +7,143 @@
 
 #include "CFileHtml.h"
 #include "CFileCss.h"
+#include "CDirectoryCache.h"
+#include "CWarcWriter.h"
 #include "CLogger.h"
 #include "CConfig.h"
+#include "CTracer.h"
 #include "Utils.h"
 
 #include <stdlib.h>
 #include <iostream>
 #include <set>
-#include <regex>
 #include <filesystem>
 #include <fstream>
+#include <sstream>
 
 #include <memory> // shared_ptr<>
 #include <string>
 
-using std::string, std::stringstream, std::regex, std::regex_replace, std::set, std::endl, std::make_shared, std::ifstream, std::ofstream;
+using std::string, std::stringstream, std::set, std::endl, std::make_shared, std::ifstream;
 namespace fs = std::filesystem;
 
 // CFileHtml::~CFileHtml() = default;
 
-bool CFileHtml::download()
+// Images are loaded from the server with remote images
+static bool isImage(const string &url)
 {
-    // If file already exists or couldn't be downloaded, don't do anything
-    if (!CFile::download())
-    {
-        auto &cfg = CConfig::getInstance();
+    return Utils::endsWith(url, ".png") ||
+           Utils::endsWith(url, ".jpg") ||
+           Utils::endsWith(url, ".jpeg") ||
+           Utils::endsWith(url, ".webp") ||
+           Utils::endsWith(url, ".gif");
+}
 
-        // If download failed because of depth, insert error page
-        if (static_cast<int>(m_Depth) > static_cast<int>(cfg["depth"]) &&
-            static_cast<bool>(cfg["error_page"]))
-        {
-            parsePath();
+bool CFileHtml::prepare()
+{
+    if (CFile::prepare())
+        return true;
 
-            if (fs::exists(m_OutputPath + m_Filename))
-                return false;
+    const auto &cfg = CConfig::getInstance().getSnapshot();
 
-            // Create folder structure
-            fs::create_directories(m_OutputPath);
+    // If the file is skipped because of depth, insert error page (not into the archive)
+    if (static_cast<int>(m_Depth) > cfg.m_Depth &&
+        cfg.m_ErrorPage &&
+        !CWarcWriter::getInstance().isEnabled())
+    {
+        parsePath();
 
-            // Copy 404.html file into this file
-            ifstream errorFile("./assets/404.html", std::ios::binary | std::ios::in);
-            if (errorFile.fail())
-                throw std::runtime_error("Cannot open asset 404.html!");
+        if (CDirectoryCache::getInstance().fileExists(getOutputFile()))
+            return false;
 
-            ofstream saveFile(m_OutputPath + m_Filename, std::ios::binary | std::ios::out);
+        m_IsErrorPage = true;
+        return true;
+    }
 
-            saveFile << errorFile.rdbuf();
-            saveFile.close();
-        }
+    return false;
+}
 
-        return false;
-    }
+bool CFileHtml::fetch()
+{
+    if (!m_IsErrorPage)
+        return CFile::fetch();
 
-    CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "Processing HTML: " + m_Url.getNormURL() + " | (depth " + std::to_string(m_Depth) + ")");
+    // Copy 404.html file into this file
+    ifstream errorFile("./assets/404.html", std::ios::binary | std::ios::in);
+    if (errorFile.fail())
+        throw std::runtime_error("Cannot open asset 404.html!");
 
-    prepareRootUrls();
+    stringstream ss;
+    ss << errorFile.rdbuf();
+    m_Content = ss.str();
 
-    auto newFiles = parseFile();
+    return true;
+}
 
-    if (static_cast<bool>(CConfig::getInstance()["remote_images"]))
-        makeRelativeImagesExternal();
+set<shared_ptr<CFile>> CFileHtml::parse()
+{
+    if (m_IsErrorPage)
+        return {};
 
-    insertAnnoyingAdvertisementThatNobodyWantsToSee();
+    LOG_VERBOSE("Processing HTML: " + m_Url.getNormURL() + " | (depth " + std::to_string(m_Depth) + ")");
 
-    save();
+    // Finish tokenizing, links found during download were already scheduled
+    size_t from = m_Links.size();
+    {
+        CTracer::CSpan span("tokenize", "parse", m_Url.getNormURL());
+        m_Tokenizer.feed(m_Content, true, m_Links);
+    }
 
-    for (const auto &i : newFiles)
+    set<shared_ptr<CFile>> nextFiles;
     {
-        i->download();
+        CTracer::CSpan span("parseFile", "parse", m_Url.getNormURL());
+        nextFiles = parseFile(from);
     }
 
+    CTracer::CSpan span("collectEdits", "parse", m_Url.getNormURL());
+    collectEdits();
+
+    return nextFiles;
+}
+
+void CFileHtml::rewrite()
+{
+    if (m_IsErrorPage)
+        return;
+
+    applyEdits();
+
+    insertAnnoyingAdvertisementThatNobodyWantsToSee();
+}
+
+bool CFileHtml::needsContent() const
+{
     return true;
 }
 
+void CFileHtml::parsePartial(const string &body)
+{
+    CTracer::CSpan span("parsePartial", "parse", m_Url.getNormURL());
+
+    size_t from = m_Links.size();
+    m_Tokenizer.feed(body, false, m_Links);
+
+    if (m_Links.size() == from)
+        return;
+
+    for (const auto &next : parseFile(from))
+        m_Scheduler(next);
+}
+
+void CFileHtml::resetParsing()
+{
+    m_Tokenizer = CHtmlTokenizer();
+    m_Links.clear();
+}
+
 void CFileHtml::insertAnnoyingAdvertisementThatNobodyWantsToSee()
 {
-    if (static_cast<bool>(CConfig::getInstance()["advertisement"]) == false)
+    if (!CConfig::getInstance().getSnapshot().m_Advertisement)
         return;
 
     stringstream ss;
@@ -101,128 +162,112 @@ void CFileHtml::insertAnnoyingAdvertisementThatNobodyWantsToSee()
     //    ¯\_(ツ)_/¯
 }
 
-void CFileHtml::prepareRootUrls()
+void CFileHtml::collectEdits()
 {
-    stringstream replaceString;
+    bool remoteImages = CConfig::getInstance().getSnapshot().m_RemoteImages;
 
-    replaceString << "$1\""; // src= or href=
+    string prefix;
 
     for (size_t i = 0; i < m_Url.getPathDepth(); i++)
     {
-        replaceString << "../";
+        prefix += "../";
     }
 
-    replaceString << "$2\""; // the link itself
+    // Relative links are relative to the folder of this page
+    string base = m_Url.getNormURL();
+    base = base.substr(0, base.find_last_of('/') + 1);
+    string origin = base.substr(0, base.find('/', base.find("//") + 2));
 
-    const regex re("(srcset=|src=|href=)[\"']\\/([^\\/][^\"']*)[\"']", std::regex_constants::icase);
-    m_Content = regex_replace(m_Content, re, replaceString.str());
-}
+    for (const auto &link : m_Links)
+    {
+        const string &url = link.m_Value;
+        bool isStyle = link.m_Attribute == CHtmlTokenizer::EAttribute::STYLE;
+        bool isRemoteImage = remoteImages && ((link.m_Tag == "img" && link.m_Attribute == CHtmlTokenizer::EAttribute::SRC) ||
+                                              (isStyle && isImage(url.substr(0, url.find('#')))));
+        string replacement;
+
+        // Downloaded external link, the fragment stays
+        if (!findExternalLink(url, replacement))
+        {
+            // Root link (not "//"), the leading slash is replaced with the path to the root directory
+            if (url.length() > 1 && url[0] == '/' && url[1] != '/')
+                replacement = isRemoteImage ? origin + url : prefix + url.substr(1);
 
-void CFileHtml::makeRelativeImagesExternal()
-{
-    stringstream replaceString;
+            // Relative image is loaded from the server
+            else if (isRemoteImage && !isAbsoluteUrl(url))
+                replacement = base + url;
 
-    replaceString << "$1\""; // <img src=
+            else
+                continue;
+        }
 
-    replaceString << m_Url.getNormURL();
+        // Links in inline CSS may contain CSS escapes, the raw link is replaced whole
+        if (isStyle)
+            replacement = CCssTokenizer::escape(replacement, link.m_Quoted);
 
-    replaceString << "$2\""; // the link itself
+        // Links in attributes had their character references decoded, the replacement is encoded back
+        if (!link.m_Element)
+            replacement = CHtmlTokenizer::escape(replacement);
 
-    const regex re("(<(?:img) (?:src=))[\"'](?!http:\\/\\/|https:\\/\\/|data:|tel:|javascript:|mailto:|\\/\\/)([^\\/][^\"']*)[\"']", std::regex_constants::icase);
-    m_Content = regex_replace(m_Content, re, replaceString.str());
+        m_Edits.add(link.m_Offset, link.m_Length, replacement);
+    }
 }
 
-set<shared_ptr<CFile>> CFileHtml::parseFile()
+set<shared_ptr<CFile>> CFileHtml::parseFile(size_t from)
 {
+    const auto &cfg = CConfig::getInstance().getSnapshot();
+    bool remoteImages = cfg.m_RemoteImages;
+
     set<shared_ptr<CFile>> nextFiles;
 
-    // RELATIVE links
+    // RELATIVE and EXTERNAL links
     set<string> nextUrls;
+    set<string> nextUrlsExternal;
 
-    // Get relative src= and href=
-    auto relSrcHrefs = getUrlsWithRegex("(?:src=|href=)[\"'](?!http:\\/\\/|https:\\/\\/|data:|tel:|javascript:|mailto:|\\/\\/)([^\"'#]*)(#?[^\"']*)[\"']", m_Content);
-    for (const auto &srcHref : relSrcHrefs)
+    for (size_t i = from; i < m_Links.size(); i++)
     {
+        const auto &link = m_Links[i];
+
+        // Fragment is not part of the file
+        string url = link.m_Value;
+        url = url.substr(0, url.find('#'));
+
+        if (url.empty())
+            continue;
+
+        string lowerUrl = Utils::toLowerCase(url.substr(0, 8));
+        bool isExternal = Utils::startsWith(lowerUrl, "http://") || Utils::startsWith(lowerUrl, "https://");
+
+        // Skip data:, mailto: etc.
+        if (!isExternal && isAbsoluteUrl(url))
+            continue;
+
         // If remote images, skip them
-        if (static_cast<bool>(CConfig::getInstance()["remote_images"]))
+        if (remoteImages)
         {
-            if (Utils::endsWith(srcHref, ".png") ||
-                Utils::endsWith(srcHref, ".jpg") ||
-                Utils::endsWith(srcHref, ".jpeg") ||
-                Utils::endsWith(srcHref, ".webp") ||
-                Utils::endsWith(srcHref, ".gif") ||
-                Utils::endsWith(srcHref, ".png"))
+            if (link.m_Attribute == CHtmlTokenizer::EAttribute::SRCSET || isImage(url))
                 continue;
         }
 
-        nextUrls.emplace(srcHref);
-    }
+        // Already scheduled during download, or linked in another form
+        string target = resolveLink(url);
 
-    // If NOT remote images, also get relative srcset=
-    if (!static_cast<bool>(CConfig::getInstance()["remote_images"]))
-    {
-        auto relSourcesets = getUrlsWithRegex("(?:srcset=)[\"'](?!http:\\/\\/|https:\\/\\/|data:|tel:|javascript:|mailto:|\\/\\/)([^\"'#]*)(#?[^\"']*)[\"']", m_Content);
+        if (!m_Scheduled.insert(CInternTable::getInstance().intern(target)).second)
+            continue;
 
-        // Get each sourceset tag
-        for (const auto &sourceset : relSourcesets)
-        {
-            // Get each URL in one sourceset tag
-            auto sourcesetUrls = getUrlsWithRegex("([^\"'=\\s]+\\.[^\\s]+)", sourceset);
-            for (const auto &url : sourcesetUrls)
-            {
-                if (!Utils::startsWith(url, "/"))
-                    nextUrls.emplace(url);
-            }
-        }
+        if (isExternal)
+            nextUrlsExternal.emplace(target);
+        else
+            nextUrls.emplace(target);
     }
 
     // Transform each URL to correct File and insert into nextFiles set
     transformUrlsToFiles(false, nextUrls, nextFiles);
 
     // Skip external links if desired
-    if (static_cast<bool>(CConfig::getInstance()["remote"]) == true)
+    if (cfg.m_Remote)
         return nextFiles;
 
-    // EXTERNAL links
-    set<string> nextUrlsExternal;
-
-    // Get external src= and href=
-    auto externSrcHrefs = getUrlsWithRegex("(?:src=|href=)[\"']((?:http:\\/\\/|https:\\/\\/)[^\"'#]*)(#?[^\"']*)[\"']", m_Content);
-    for (const auto &srcHref : externSrcHrefs)
-    {
-        // If remote images, skip them
-        if (static_cast<bool>(CConfig::getInstance()["remote_images"]))
-        {
-            if (Utils::endsWith(srcHref, ".png") ||
-                Utils::endsWith(srcHref, ".jpg") ||
-                Utils::endsWith(srcHref, ".jpeg") ||
-                Utils::endsWith(srcHref, ".webp") ||
-                Utils::endsWith(srcHref, ".gif") ||
-                Utils::endsWith(srcHref, ".png"))
-                continue;
-        }
-
-        nextUrlsExternal.emplace(srcHref);
-    }
-
-    // Get external srcset=
-    if (!static_cast<bool>(CConfig::getInstance()["remote_images"]))
-    {
-        auto relSourcesets = getUrlsWithRegex("(?:srcset=)[\"'](?!http:\\/\\/|https:\\/\\/|data:|tel:|javascript:|mailto:|\\/\\/)([^\"'#]*)(#?[^\"']*)[\"']", m_Content);
-
-        // Get each sourceset tag
-        for (const auto &sourceset : relSourcesets)
-        {
-            // Get each URL in one sourceset tag
-            auto sourcesetUrls = getUrlsWithRegex("([^\"'=\\s]+\\.[^\\s]+)", sourceset);
-            for (const auto &url : sourcesetUrls)
-            {
-                if (!Utils::startsWith(url, "/"))
-                    nextUrlsExternal.emplace(url);
-            }
-        }
-    }
-
     // Transform each URL to correct File and insert into nextFiles set
     transformUrlsToFiles(true, nextUrlsExternal, nextFiles);
 
@@ -9,15 +9,16 @@
 
 #include "CFile.h"
 #include "CURLHandler.h"
+#include "CHtmlTokenizer.h"
 
 #include <stdlib.h>
 #include <iostream>
 #include <set>
-#include <regex>
 #include <memory> // shared_ptr<>
 #include <string>
+#include <vector>
 
-using std::set, std::shared_ptr, std::string;
+using std::set, std::shared_ptr, std::string, std::vector;
 
 /**
  * @brief Polymorphic derived class that also parses the HTML document and recursively downloads subsequent files
@@ -43,34 +44,84 @@ public:
     virtual ~CFileHtml() = default;
 
     /**
-     * @brief Fetch the File from URL and save it to disk, recursively download subsequent files
+     * @brief Check the depth and prepare the output path, prepare the error page instead if the depth is exceeded
      *
      */
-    virtual bool download() override;
+    virtual bool prepare() override;
+
+    /**
+     * @brief Fetch the File from URL, or load the error page asset
+     *
+     */
+    virtual bool fetch() override;
+
+    /**
+     * @brief Preprocess root links and return subsequent files to download
+     *
+     */
+    virtual set<shared_ptr<CFile>> parse() override;
+
+    /**
+     * @brief Replace external links with local links and apply other configured changes to the Html
+     *
+     */
+    virtual void rewrite() override;
+
+protected:
+    /**
+     * @brief The content is always needed for parsing
+     *
+     */
+    virtual bool needsContent() const override;
+
+    /**
+     * @brief Tokenize the newly received part of the body and schedule the found files right away
+     *
+     */
+    virtual void parsePartial(const string &body) override;
+
+    /**
+     * @brief Start tokenizing from the beginning of the content
+     *
+     */
+    virtual void resetParsing() override;
 
 private:
     /**
-     * @brief Parse the file and return subsequent files to download
+     * @brief True if the file is replaced with the 404 error page
      *
-     * @return set<CFile>
      */
-    set<shared_ptr<CFile>> parseFile();
+    bool m_IsErrorPage = false;
 
     /**
-     * @brief Preproccess the Html source code - replace absolute paths with relative paths
+     * @brief Tokenizer fed with the body during download and with the whole content in parse()
      *
-     * For example: src="/assets/main.js" may become src="../../assets/main.js"
+     */
+    CHtmlTokenizer m_Tokenizer;
+
+    /**
+     * @brief All links found by the tokenizer so far
+     *
+     */
+    vector<CHtmlTokenizer::TLink> m_Links;
+
+    /**
+     * @brief Create subsequent files to download from links that were not processed yet
      *
+     * @param from Index of the first link in m_Links to process
+     * @return set<CFile>
      */
-    void prepareRootUrls();
+    set<shared_ptr<CFile>> parseFile(size_t from);
 
     /**
-     * @brief Replace all relative local links in images to external links
+     * @brief Collect the edits of all links, applied in the rewrite stage
      *
-     * For example: <img src="assets/main.js"> may become <img src="https://google.com/assets/main.js"
+     * Root links like src="/assets/main.js" may become src="../../assets/main.js", downloaded external links
+     * point to the local copy and with remote images, <img src="assets/img.png"> may become
+     * <img src="https://google.com/assets/img.png">. Links in inline CSS are rewritten the same way.
      *
      */
-    void makeRelativeImagesExternal();
+    void collectEdits();
 
     /**
      * @brief Insert ASCII art with project link to the end of Html file
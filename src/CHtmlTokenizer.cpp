@@ -0,0 +1,454 @@
+/**
+ * @file CHtmlTokenizer.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CHtmlTokenizer
+ *
+ */
+
+#include "CHtmlTokenizer.h"
+#include "CByteScanner.h"
+#include "Utils.h"
+
+#include <algorithm> // max
+
+// Markup start, the text between tags is skipped with SIMD
+static const CByteScanner TAG_SCANNER("<");
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static char toLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Named character references that may appear in links, other names stay as written
+static const char *namedReference(const string &name)
+{
+    if (name == "amp")
+        return "&";
+    if (name == "quot")
+        return "\"";
+    if (name == "apos")
+        return "'";
+    if (name == "lt")
+        return "<";
+    if (name == "gt")
+        return ">";
+
+    return nullptr;
+}
+
+// Elements whose content is not parsed as HTML
+static bool isRawText(const string &tag)
+{
+    return tag == "script" || tag == "style" || tag == "textarea" || tag == "title" || tag == "xmp";
+}
+
+void CHtmlTokenizer::feed(const string &content, bool final, vector<TLink> &links)
+{
+    size_t length = content.length();
+
+    while (m_Position < length)
+    {
+        // Skip the content of script, style etc. until its end tag
+        if (!m_RawText.empty())
+        {
+            size_t end = m_Position;
+
+            while ((end = TAG_SCANNER.find(content, end)) != string::npos)
+            {
+                if (end + 1 >= length || content[end + 1] != '/')
+                {
+                    // '<' as the last byte may start the end tag
+                    if (end + 1 >= length && !final)
+                    {
+                        m_Position = end;
+                        return;
+                    }
+
+                    end++;
+                    continue;
+                }
+
+                size_t nameEnd = end + 2 + m_RawText.length();
+                bool matches = nameEnd < length;
+
+                for (size_t i = 0; matches && i < m_RawText.length(); i++)
+                    matches = toLower(content[end + 2 + i]) == m_RawText[i];
+
+                if (matches && (isSpace(content[nameEnd]) || content[nameEnd] == '>' || content[nameEnd] == '/'))
+                {
+                    // The whole style element is available, tokenize its CSS
+                    if (m_RawText == "style")
+                        addCssLinks({content.substr(m_RawTextStart, end - m_RawTextStart), m_RawTextStart, {}}, m_RawText, true, links);
+
+                    break;
+                }
+
+                // End tag split by the end of the data
+                if (nameEnd >= length && !final)
+                {
+                    m_Position = end;
+                    return;
+                }
+
+                end += 2;
+            }
+
+            if (end == string::npos)
+            {
+                // Only the last bytes may be the start of the end tag
+                if (!final && length > m_RawText.length() + 2)
+                    m_Position = std::max(m_Position, length - m_RawText.length() - 2);
+                else if (final)
+                    m_Position = length;
+
+                return;
+            }
+
+            m_Position = end;
+            m_RawText.clear();
+        }
+
+        size_t start = TAG_SCANNER.find(content, m_Position);
+        if (start == string::npos)
+        {
+            m_Position = length;
+            return;
+        }
+
+        // Links of an incomplete tag are added when the whole tag is available
+        vector<TLink> found;
+        size_t end = parseMarkup(content, start, found);
+
+        if (end == string::npos)
+        {
+            m_Position = final ? length : start;
+            return;
+        }
+
+        links.insert(links.end(), found.begin(), found.end());
+        m_Position = end;
+    }
+}
+
+size_t CHtmlTokenizer::getPosition() const
+{
+    return m_Position;
+}
+
+vector<CHtmlTokenizer::TLink> CHtmlTokenizer::tokenize(const string &content)
+{
+    vector<TLink> links;
+
+    CHtmlTokenizer tokenizer;
+    tokenizer.feed(content, true, links);
+
+    return links;
+}
+
+string CHtmlTokenizer::escape(const string &value)
+{
+    // Most links have nothing to encode
+    if (value.find_first_of("&\"'<>") == string::npos)
+        return value;
+
+    string result;
+    result.reserve(value.length() + 16);
+
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '&':
+            result += "&amp;";
+            break;
+        case '"':
+            result += "&quot;";
+            break;
+        case '\'':
+            result += "&#39;";
+            break;
+        case '<':
+            result += "&lt;";
+            break;
+        case '>':
+            result += "&gt;";
+            break;
+        default:
+            result += c;
+        }
+    }
+
+    return result;
+}
+
+size_t CHtmlTokenizer::TValue::toContent(size_t position) const
+{
+    return m_Start + (m_Offsets.empty() ? position : m_Offsets[position]);
+}
+
+size_t CHtmlTokenizer::parseMarkup(const string &content, size_t start, vector<TLink> &links)
+{
+    size_t length = content.length();
+    size_t next = start + 1;
+
+    if (next >= length)
+        return string::npos;
+
+    char c = content[next];
+
+    // Comment
+    if (c == '!' && content.compare(next, 3, "!--") == 0)
+    {
+        size_t end = content.find("-->", next + 3);
+        return end == string::npos ? string::npos : end + 3;
+    }
+
+    // Prefix of the comment, not enough data to decide
+    if (c == '!' && length - next < 3 && content.compare(next, string::npos, string("!--", length - next)) == 0)
+        return string::npos;
+
+    // Doctype, processing instruction or end tag
+    if (c == '!' || c == '?' || c == '/')
+    {
+        size_t end = content.find('>', next);
+        return end == string::npos ? string::npos : end + 1;
+    }
+
+    // Start tag
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+        return parseTag(content, next, links);
+
+    // Just a '<' in text
+    return next;
+}
+
+size_t CHtmlTokenizer::parseTag(const string &content, size_t start, vector<TLink> &links)
+{
+    size_t length = content.length();
+    size_t i = start;
+
+    string tag;
+    while (i < length && !isSpace(content[i]) && content[i] != '>' && content[i] != '/')
+        tag += toLower(content[i++]);
+
+    while (true)
+    {
+        // Whitespace and self-closing slashes between attributes
+        while (i < length && (isSpace(content[i]) || content[i] == '/'))
+            i++;
+
+        if (i >= length)
+            return string::npos;
+
+        if (content[i] == '>')
+            break;
+
+        // Attribute name, '=' at its start belongs to the name
+        string attribute;
+        if (content[i] == '=')
+            attribute += content[i++];
+
+        while (i < length && !isSpace(content[i]) && content[i] != '=' && content[i] != '>' && content[i] != '/')
+            attribute += toLower(content[i++]);
+
+        while (i < length && isSpace(content[i]))
+            i++;
+
+        if (i >= length)
+            return string::npos;
+
+        // Attribute without value
+        if (content[i] != '=')
+            continue;
+
+        i++;
+        while (i < length && isSpace(content[i]))
+            i++;
+
+        if (i >= length)
+            return string::npos;
+
+        size_t valueStart, valueEnd;
+
+        if (content[i] == '"' || content[i] == '\'')
+        {
+            valueStart = i + 1;
+            valueEnd = content.find(content[i], valueStart);
+
+            if (valueEnd == string::npos)
+                return string::npos;
+
+            i = valueEnd + 1;
+        }
+        else
+        {
+            valueStart = i;
+            while (i < length && !isSpace(content[i]) && content[i] != '>')
+                i++;
+
+            if (i >= length)
+                return string::npos;
+
+            valueEnd = i;
+        }
+
+        addAttribute(content, tag, attribute, valueStart, valueEnd, links);
+    }
+
+    if (isRawText(tag))
+    {
+        m_RawText = tag;
+        m_RawTextStart = i + 1;
+    }
+
+    return i + 1;
+}
+
+void CHtmlTokenizer::addAttribute(const string &content, const string &tag, const string &attribute, size_t start, size_t end, vector<TLink> &links)
+{
+    if (attribute != "src" && attribute != "href" && attribute != "srcset" && attribute != "style")
+        return;
+
+    TValue value = decode(content, start, end);
+    const string &text = value.m_Text;
+
+    if (attribute == "src")
+        addLink(value, tag, EAttribute::SRC, 0, text.length(), links);
+
+    else if (attribute == "href")
+        addLink(value, tag, EAttribute::HREF, 0, text.length(), links);
+
+    // Comma separated candidates "url descriptor"
+    else if (attribute == "srcset")
+    {
+        size_t i = 0;
+
+        while (i < text.length())
+        {
+            while (i < text.length() && (isSpace(text[i]) || text[i] == ','))
+                i++;
+
+            size_t urlStart = i;
+            while (i < text.length() && !isSpace(text[i]))
+                i++;
+
+            // Trailing commas belong to the separator
+            size_t urlEnd = i;
+            bool hasDescriptor = true;
+            while (urlEnd > urlStart && text[urlEnd - 1] == ',')
+            {
+                urlEnd--;
+                hasDescriptor = false;
+            }
+
+            addLink(value, tag, EAttribute::SRCSET, urlStart, urlEnd, links);
+
+            // Skip the descriptor (eg. "2x")
+            if (hasDescriptor)
+                while (i < text.length() && text[i] != ',')
+                    i++;
+        }
+    }
+
+    // Inline CSS
+    else
+        addCssLinks(value, tag, false, links);
+}
+
+CHtmlTokenizer::TValue CHtmlTokenizer::decode(const string &content, size_t start, size_t end)
+{
+    TValue value{content.substr(start, end - start), start, {}};
+
+    // Most values have no references, the offsets stay the same
+    if (value.m_Text.find('&') == string::npos)
+        return value;
+
+    const string &raw = value.m_Text;
+    string text;
+    text.reserve(raw.length());
+
+    for (size_t i = 0; i < raw.length();)
+    {
+        size_t next = i + 1;
+        string decoded(1, raw[i]);
+
+        // Only complete references ending with ';' are decoded, the names are short
+        size_t semicolon = raw[i] == '&' ? i + 1 : raw.length();
+        while (semicolon < raw.length() && semicolon - i <= 32 && raw[semicolon] != ';' && raw[semicolon] != '&')
+            semicolon++;
+
+        if (semicolon < raw.length() && raw[semicolon] == ';')
+        {
+            string name = raw.substr(i + 1, semicolon - i - 1);
+
+            if (name.length() > 1 && name[0] == '#')
+            {
+                bool hex = name[1] == 'x' || name[1] == 'X';
+                size_t digits = hex ? 2 : 1;
+                unsigned long codePoint = 0;
+                bool valid = digits < name.length();
+
+                for (size_t j = digits; valid && j < name.length(); j++)
+                {
+                    char c = toLower(name[j]);
+                    valid = (c >= '0' && c <= '9') || (hex && c >= 'a' && c <= 'f');
+                    codePoint = codePoint * (hex ? 16 : 10) + (c <= '9' ? c - '0' : c - 'a' + 10);
+                    valid = valid && codePoint <= 0x10FFFF;
+                }
+
+                if (valid && codePoint != 0)
+                {
+                    decoded.clear();
+                    Utils::appendUtf8(decoded, codePoint);
+                    next = semicolon + 1;
+                }
+            }
+            else if (const char *character = namedReference(name))
+            {
+                decoded = character;
+                next = semicolon + 1;
+            }
+        }
+
+        // Every decoded byte points to the start of its reference
+        text += decoded;
+        value.m_Offsets.insert(value.m_Offsets.end(), decoded.length(), i);
+        i = next;
+    }
+
+    value.m_Offsets.push_back(raw.length());
+    value.m_Text = std::move(text);
+
+    return value;
+}
+
+void CHtmlTokenizer::addLink(const TValue &value, const string &tag, EAttribute attribute, size_t start, size_t end, vector<TLink> &links)
+{
+    const string &text = value.m_Text;
+
+    while (start < end && isSpace(text[start]))
+        start++;
+
+    while (end > start && isSpace(text[end - 1]))
+        end--;
+
+    if (start == end)
+        return;
+
+    size_t offset = value.toContent(start);
+    links.push_back({tag, attribute, offset, value.toContent(end) - offset, text.substr(start, end - start)});
+}
+
+void CHtmlTokenizer::addCssLinks(const TValue &css, const string &tag, bool element, vector<TLink> &links)
+{
+    for (auto &link : CCssTokenizer::tokenize(css.m_Text))
+    {
+        size_t offset = css.toContent(link.m_Offset);
+        links.push_back({tag, EAttribute::STYLE, offset, css.toContent(link.m_Offset + link.m_Length) - offset, std::move(link.m_Value), link.m_Quoted, element});
+    }
+}
@@ -0,0 +1,187 @@
+/**
+ * @file CHtmlTokenizer.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CHtmlTokenizer
+ *
+ */
+
+#pragma once
+
+#include "CCssTokenizer.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::string, std::vector;
+
+/**
+ * @brief Single pass HTML tokenizer that walks tags and attributes and finds links with their byte offsets
+ *
+ * Links are found in src, href and srcset attributes. The content of style elements and style attributes is
+ * tokenized by CCssTokenizer in the same pass. Character references in attribute values are decoded, the offsets
+ * of the links still point to the raw content. Comments, doctype and the content of script and other raw text
+ * elements are skipped. The tokenizer can be fed with growing content, a tag or a style element that is not
+ * complete yet is tokenized again with the next data.
+ *
+ */
+class CHtmlTokenizer
+{
+public:
+    /**
+     * @brief Attribute containing the link
+     *
+     */
+    enum class EAttribute
+    {
+        SRC,
+        HREF,
+        SRCSET,
+        STYLE
+    };
+
+    /**
+     * @brief Link found in the content
+     *
+     */
+    struct TLink
+    {
+        string m_Tag;           // Lowercase name of the tag (eg. "img"), "style" for the style element
+        EAttribute m_Attribute; // Attribute containing the link, STYLE for the style element too
+        size_t m_Offset;        // Position of the link in the content, without quotes and whitespace
+        size_t m_Length;        // Length of the link
+        string m_Value;         // The link, with character references and CSS escapes resolved
+        bool m_Quoted = false;  // For STYLE links, true if the CSS URL is a string
+        bool m_Element = false; // True for links in the style element, their raw text has no character references
+    };
+
+    /**
+     * @brief Tokenize the content from the position where the last call ended
+     *
+     * @param content Whole content received so far
+     * @param final If false, stop before a tag or comment that may continue in the next data
+     * @param[out] links Found links are appended here
+     */
+    void feed(const string &content, bool final, vector<TLink> &links);
+
+    /**
+     * @brief Get the position in the content where the next call continues
+     *
+     * @return size_t
+     */
+    size_t getPosition() const;
+
+    /**
+     * @brief Tokenize the whole content at once
+     *
+     * @param content
+     * @return vector<TLink>
+     */
+    static vector<TLink> tokenize(const string &content);
+
+    /**
+     * @brief Encode the characters that would end the attribute value or start a character reference
+     *
+     * @param value
+     * @return string
+     */
+    static string escape(const string &value);
+
+private:
+    /**
+     * @brief Attribute value with its character references decoded
+     *
+     */
+    struct TValue
+    {
+        string m_Text;
+        size_t m_Start = 0;       // Position of the raw value in the content
+        vector<size_t> m_Offsets; // Raw offset of every decoded byte and of the end, empty if nothing was decoded
+
+        /**
+         * @brief Get the position in the content of the decoded position
+         *
+         * @param position
+         * @return size_t
+         */
+        size_t toContent(size_t position) const;
+    };
+
+    size_t m_Position = 0;
+
+    /**
+     * @brief Name of the element whose content is raw text (eg. script), empty outside of such element
+     *
+     */
+    string m_RawText;
+
+    /**
+     * @brief Position where the content of the raw text element starts
+     *
+     */
+    size_t m_RawTextStart = 0;
+
+    /**
+     * @brief Tokenize comment, doctype or tag starting with '<'
+     *
+     * @param content
+     * @param start Position of '<'
+     * @param[out] links
+     * @return size_t Position after the construct, string::npos if it's not complete yet
+     */
+    size_t parseMarkup(const string &content, size_t start, vector<TLink> &links);
+
+    /**
+     * @brief Tokenize the start tag and its attributes
+     *
+     * @param content
+     * @param start Position of the tag name
+     * @param[out] links
+     * @return size_t Position after '>', string::npos if it's not complete yet
+     */
+    size_t parseTag(const string &content, size_t start, vector<TLink> &links);
+
+    /**
+     * @brief Add links from the attribute value
+     *
+     * @param content
+     * @param tag Lowercase tag name
+     * @param attribute Lowercase attribute name
+     * @param start Start of the value
+     * @param end End of the value
+     * @param[out] links
+     */
+    static void addAttribute(const string &content, const string &tag, const string &attribute, size_t start, size_t end, vector<TLink> &links);
+
+    /**
+     * @brief Decode the character references of the attribute value (eg. "&amp;" or "&#39;")
+     *
+     * @param content
+     * @param start Start of the value
+     * @param end End of the value
+     * @return TValue
+     */
+    static TValue decode(const string &content, size_t start, size_t end);
+
+    /**
+     * @brief Add the link without surrounding whitespace, empty links are skipped
+     *
+     * @param value
+     * @param tag
+     * @param attribute
+     * @param start Start of the link in the decoded value
+     * @param end End of the link in the decoded value
+     * @param[out] links
+     */
+    static void addLink(const TValue &value, const string &tag, EAttribute attribute, size_t start, size_t end, vector<TLink> &links);
+
+    /**
+     * @brief Add links from the CSS
+     *
+     * @param css
+     * @param tag
+     * @param element True for the style element
+     * @param[out] links
+     */
+    static void addCssLinks(const TValue &css, const string &tag, bool element, vector<TLink> &links);
+};
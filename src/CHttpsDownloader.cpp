@@ -8,6 +8,11 @@
 #include "CHttpsDownloader.h"
 #include "CLogger.h"
 #include "CConfig.h"
+#include "CMetrics.h"
+#include "CRegexRegistry.h"
+#include "CTracer.h"
+#include "CRequestStats.h"
+#include "CWarcWriter.h"
 #include "Utils.h"
 
 using std::unique_ptr, std::regex, std::smatch, std::regex_match, std::stringstream;
@@ -26,96 +31,151 @@ CHttpsDownloader::CHttpsDownloader()
 #endif
 
     // Add user defined certificates
-    string certStore = static_cast<string>(CConfig::getInstance()["cert_store"]);
+    const string &certStore = CConfig::getInstance().getSnapshot().m_CertStore;
 
     if (!certStore.empty())
     {
         int result = SSL_CTX_load_verify_locations(m_Ctx.get(), certStore.c_str(), NULL);
         if (result == 1)
-            CLogger::getInstance().log(CLogger::ELogLevel::Info, "Custom SSL trust store \"" + certStore + "\" successfully loaded!");
+            LOG_INFO("Custom SSL trust store \"" + certStore + "\" successfully loaded!");
         else
-            CLogger::getInstance().log(CLogger::ELogLevel::Error, "Cannot load custom SSL trust store \"" + certStore + "\"!");
+            LOG_ERROR("Cannot load custom SSL trust store \"" + certStore + "\"!");
     }
 
     // Add system preinstalled certificates
     if (SSL_CTX_set_default_verify_paths(m_Ctx.get()) != 1)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Can't setup SSL trust store! Use flag --cert-store to specify custom path.");
+        LOG_ERROR("Can't setup SSL trust store! Use flag --cert-store to specify custom path.");
     }
 
     SSL_CTX_set_timeout(m_Ctx.get(), 10L);
+
+    // Sessions are cached by this class per host, OpenSSL's internal cache is keyed by the session ID only
+    SSL_CTX_set_app_data(m_Ctx.get(), this);
+    SSL_CTX_set_session_cache_mode(m_Ctx.get(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(m_Ctx.get(), storeSession);
+}
+
+int CHttpsDownloader::storeSession(SSL *ssl, SSL_SESSION *session)
+{
+    auto *downloader = static_cast<CHttpsDownloader *>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl)));
+    auto *key = static_cast<const string *>(SSL_get_app_data(ssl));
+
+    if (downloader == nullptr || key == nullptr)
+        return 0;
+
+    std::lock_guard<std::mutex> lock(downloader->m_SessionsMutex);
+    downloader->m_Sessions[*key] = unique_ptr<SSL_SESSION, TDeleter<SSL_SESSION>>(session);
+    return 1;
+}
+
+CResponse CHttpsDownloader::get(CURLHandler &url, const string &spillFile, bool keepBody, const TBodyCallback &onBody, size_t expectedLength)
+{
+    auto &metrics = CMetrics::getInstance();
+    static auto &inFlight = metrics.gauge("wget_connections_in_flight", "Requests being made right now");
+    static auto &received = metrics.counter("wget_received_bytes_total", "Bytes received from the servers, including headers");
+    static auto &duration = metrics.histogram("wget_request_duration_seconds", "Duration of the requests", CMetrics::SECONDS_BOUNDS);
+
+    // Decremented even if the request throws
+    struct TInFlight
+    {
+        CMetrics::CGauge &m_Gauge;
+        explicit TInFlight(CMetrics::CGauge &gauge) : m_Gauge(gauge) { m_Gauge.add(1); }
+        ~TInFlight() { m_Gauge.add(-1); }
+    } guard(inFlight);
+
+    CResponse::TTimings timings;
+    timings.m_Start = CResponse::TTimings::TClock::now();
+
+    CResponse response = request(url, spillFile, keepBody, onBody, expectedLength, timings);
+
+    timings.m_Finished = CResponse::TTimings::TClock::now();
+    response.m_Timings = timings;
+
+    CRequestStats::getInstance().record(url, response.m_StatusCode, timings);
+    trace(url, timings);
+
+    received.add(timings.m_BytesReceived);
+    duration.observe(timings.getTotal() / 1000);
+    metrics.counter("wget_http_requests_total", "Requests by the HTTP status code, 0 if no response was received",
+                    {{"code", std::to_string(response.m_StatusCode)}})
+        .add();
+    metrics.counter("wget_responses_total", "Requests by the result", {{"status", CResponse::getStatusName(response.m_Status)}}).add();
+
+    return response;
 }
 
-CResponse CHttpsDownloader::get(CURLHandler &url)
+CResponse CHttpsDownloader::request(CURLHandler &url, const string &spillFile, bool keepBody, const TBodyCallback &onBody, size_t expectedLength,
+                                    CResponse::TTimings &timings)
 {
     // Setup variables
-    string host = url.getDomain();
+    string host(url.getDomain());
     string port = url.isHttps() ? HTTPS_PORT : HTTP_PORT;
     string resource = "/" + url.getNormURLPath();
 
-    CLogger::getInstance().log(CLogger::ELogLevel::Info, "Downloading " + url.getNormURL());
+    // Use the explicit port if present (eg. 'localhost:8080')
+    size_t portStart = host.find(':');
+    if (portStart != string::npos)
+    {
+        port = host.substr(portStart + 1);
+        host = host.substr(0, portStart);
+    }
 
-    // Create connection with BIO
-    auto bio = unique_ptr<BIO, TDeleter<BIO>>(BIO_new_connect((host + ":" + port).c_str()));
+    LOG_INFO("Downloading " + url.getNormURL());
 
-    if (bio.get() == nullptr)
+    // Resolve the host first, so the lookup is timed separately from the connection
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *resolved = nullptr;
+
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &resolved) != 0)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Can't create connection!");
+        LOG_ERROR("Can't resolve " + host + "!");
         return CResponse(CResponse::EStatus::CONN_ERROR);
     }
 
-    // Make BIO non-blocking
-    BIO_set_nbio(bio.get(), 1);
+    auto addresses = unique_ptr<addrinfo, TDeleter<addrinfo>>(resolved);
+    timings.m_Resolved = CResponse::TTimings::TClock::now();
 
-    // Establish connection
-    // (Socket connection for old OpenSSL version @inspiredBy https://stackoverflow.com/a/39060166)
-    int connectResult = BIO_do_connect(bio.get());
-    int fd;
-    fd_set confds;
+    // Connect to the first address that accepts the connection (eg. IPv4 if nothing listens on IPv6)
+    unique_ptr<BIO, TDeleter<BIO>> bio;
+    bool timedOut = false;
 
-    // Return if connection failed and shouldn't try again
-    if ((connectResult <= 0) && !BIO_should_retry(bio.get()))
+    for (const addrinfo *address = addresses.get(); address != nullptr && bio == nullptr && !timedOut; address = address->ai_next)
+        bio = connect(address, port, timedOut);
+
+    if (timedOut)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Can't connect, error occured!");
-        return CResponse(CResponse::EStatus::CONN_ERROR);
+        LOG_ERROR("Can't connect, timed out!");
+        return CResponse(CResponse::EStatus::TIMED_OUT);
     }
 
-    // Return if socket failed
-    if (BIO_get_fd(bio.get(), &fd) < 0)
+    if (bio == nullptr)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Can't get socket file descriptor");
+        LOG_ERROR("Can't connect, error occured!");
         return CResponse(CResponse::EStatus::CONN_ERROR);
     }
 
-    // Try again repeatedly until timeout
-    if (connectResult <= 0)
-    {
-        FD_ZERO(&confds);
-        FD_SET(fd, &confds);
-        timeval tv;
-        tv.tv_usec = 0;
-        tv.tv_sec = 10;
-        connectResult = select(fd + 1, NULL, &confds, NULL, &tv);
-        if (connectResult == 0)
-        {
-            CLogger::getInstance().log(CLogger::ELogLevel::Error, "Can't connect, timed out!");
-            return CResponse(CResponse::EStatus::TIMED_OUT);
-        }
-    }
-    // End of @inspiredBy
+    timings.m_Connected = CResponse::TTimings::TClock::now();
 
     // If not HTTPS, simply download and return
     if (!url.isHttps())
     {
         // Send HTTP request
-        sendHttpRequest(bio.get(), resource, host);
+        string request = sendHttpRequest(bio.get(), resource, string(url.getDomain()));
+        timings.m_RequestSent = CResponse::TTimings::TClock::now();
 
         // Download the content
-        return receiveHttpMessage(bio.get(), url);
+        return receiveHttpMessage(bio.get(), url, request, spillFile, keepBody, onBody, expectedLength, timings);
     }
 
     // Make SSL handshake if HTTPS
 
+    // Outlives the BIO, new sessions of the connection are stored under it
+    string sessionKey = host + ":" + port;
+
     // Create new BIO with SSL from SSL Context
     auto ssl_bio = unique_ptr<BIO, TDeleter<BIO>>(BIO_new_ssl(m_Ctx.get(), 1));
 
@@ -130,6 +190,17 @@ CResponse CHttpsDownloader::get(CURLHandler &url)
     SSL_set1_host(getSSL(ssl_bio.get()), host.c_str());
 #endif
 
+    // Resume the last session with the host, if any
+    SSL_set_app_data(getSSL(ssl_bio.get()), &sessionKey);
+
+    {
+        std::lock_guard<std::mutex> lock(m_SessionsMutex);
+        auto session = m_Sessions.find(sessionKey);
+
+        if (session != m_Sessions.end())
+            SSL_set_session(getSSL(ssl_bio.get()), session->second.get());
+    }
+
     // Try to make a handshake
     int handshakeResult;
     do
@@ -138,27 +209,113 @@ CResponse CHttpsDownloader::get(CURLHandler &url)
 
     } while (BIO_should_retry(ssl_bio.get()));
 
+    auto handshakes = [](const string &result) -> CMetrics::CCounter &
+    {
+        return CMetrics::getInstance().counter("wget_tls_handshakes_total", "TLS handshakes by the result", {{"result", result}});
+    };
+
     // Return if failed
     if (handshakeResult <= 0)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Can't make SSL handshake!");
+        LOG_ERROR("Can't make SSL handshake!");
+        handshakes("failure").add();
         return CResponse(CResponse::EStatus::CONN_ERROR);
     }
     else
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "SSL handshake successful!");
+        LOG_VERBOSE("SSL handshake successful!");
     }
 
     // Get SSL certificate from server and verify it
     SSL *sslpointer = getSSL(ssl_bio.get());
     if (!verifyCertificate(sslpointer, host.c_str()))
+    {
+        handshakes("invalid_certificate").add();
         return CResponse(CResponse::EStatus::CONN_ERROR);
+    }
+
+    handshakes("success").add();
+
+    timings.m_Handshaked = CResponse::TTimings::TClock::now();
+    timings.m_SessionReused = SSL_session_reused(sslpointer) == 1;
 
     // Send HTTP request with SSL
-    sendHttpRequest(ssl_bio.get(), resource, host);
+    string request = sendHttpRequest(ssl_bio.get(), resource, string(url.getDomain()));
+    timings.m_RequestSent = CResponse::TTimings::TClock::now();
 
     // Download the content
-    return receiveHttpMessage(ssl_bio.get(), url);
+    return receiveHttpMessage(ssl_bio.get(), url, request, spillFile, keepBody, onBody, expectedLength, timings);
+}
+
+unique_ptr<BIO, TDeleter<BIO>> CHttpsDownloader::connect(const addrinfo *address, const string &port, bool &timedOut)
+{
+    char name[NI_MAXHOST];
+
+    if (getnameinfo(address->ai_addr, address->ai_addrlen, name, sizeof(name), nullptr, 0, NI_NUMERICHOST) != 0)
+        return nullptr;
+
+    string target = address->ai_family == AF_INET6 ? "[" + string(name) + "]:" + port : string(name) + ":" + port;
+
+    // Create connection with BIO
+    auto bio = unique_ptr<BIO, TDeleter<BIO>>(BIO_new_connect(target.c_str()));
+
+    if (bio.get() == nullptr)
+    {
+        LOG_VERBOSE("Can't create connection to " + target + "!");
+        return nullptr;
+    }
+
+    // Make BIO non-blocking
+    BIO_set_nbio(bio.get(), 1);
+
+    // Establish connection
+    // (Socket connection for old OpenSSL version @inspiredBy https://stackoverflow.com/a/39060166)
+    int connectResult = BIO_do_connect(bio.get());
+    int fd;
+    fd_set confds;
+
+    // Return if connection failed and shouldn't try again
+    if ((connectResult <= 0) && !BIO_should_retry(bio.get()))
+    {
+        LOG_VERBOSE("Can't connect to " + target + "!");
+        return nullptr;
+    }
+
+    // Return if socket failed
+    if (BIO_get_fd(bio.get(), &fd) < 0)
+    {
+        LOG_ERROR("Can't get socket file descriptor");
+        return nullptr;
+    }
+
+    // Try again repeatedly until timeout
+    if (connectResult <= 0)
+    {
+        FD_ZERO(&confds);
+        FD_SET(fd, &confds);
+        timeval tv;
+        tv.tv_usec = 0;
+        tv.tv_sec = 10;
+        connectResult = select(fd + 1, NULL, &confds, NULL, &tv);
+        if (connectResult == 0)
+        {
+            timedOut = true;
+            return nullptr;
+        }
+
+        // The socket is also writable when the connection was refused
+        int error = 0;
+        socklen_t length = sizeof(error);
+
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0)
+        {
+            LOG_VERBOSE("Can't connect to " + target + ": " + string(strerror(error)));
+            return nullptr;
+        }
+    }
+    // End of @inspiredBy
+
+    return bio;
 }
 
 string CHttpsDownloader::receiveData(BIO *bio)
@@ -179,11 +336,15 @@ string CHttpsDownloader::receiveData(BIO *bio)
     return ss.str();
 }
 
-CResponse CHttpsDownloader::receiveHttpMessage(BIO *bio, CURLHandler &currentUrl)
+CResponse CHttpsDownloader::receiveHttpMessage(BIO *bio, CURLHandler &currentUrl, const string &request, const string &spillFile, bool keepBody,
+                                               const TBodyCallback &onBody, size_t expectedLength, CResponse::TTimings &timings)
 {
     string content = receiveData(bio);
     string headerDelimiter = "\r\n\r\n";
 
+    if (!content.empty())
+        timings.m_FirstByte = CResponse::TTimings::TClock::now();
+
     size_t headerEnd = content.find(headerDelimiter);
 
     // Read data until delimiter
@@ -191,32 +352,119 @@ CResponse CHttpsDownloader::receiveHttpMessage(BIO *bio, CURLHandler &currentUrl
     {
         content += receiveData(bio);
         headerEnd = content.find(headerDelimiter);
+
+        if (!content.empty() && timings.m_FirstByte == CResponse::TTimings::TClock::time_point())
+            timings.m_FirstByte = CResponse::TTimings::TClock::now();
     }
 
+    timings.m_BytesReceived = content.length();
+
     // Copy everything after delimiter to body
     string body = content.substr(headerEnd + headerDelimiter.length());
 
-    // Remove part after delimiter from header
-    string header = content.substr(0, headerEnd + 2);
+    // Parse the header without the part after delimiter
+    CResponse response = parseHeader(content.substr(0, headerEnd + 2), currentUrl);
+
+    if (response.m_Status == CResponse::EStatus::SERVER_ERROR)
+        return response;
 
+    int statusCode = response.m_StatusCode;
+
+    // Archive the raw response as it's being received
+    auto &warc = CWarcWriter::getInstance();
+    CWarcWriter::TRecord record;
+
+    if (warc.isEnabled())
+        record = warc.begin(currentUrl.getNormURL(), request, content.substr(0, headerEnd + headerDelimiter.length()));
+
+    record.append(body);
+
+    // If finished, don't download body (eg. 404 or 301 etc occured)
+    if (response.m_Status == CResponse::EStatus::FINISHED ||
+        response.m_Status == CResponse::EStatus::MOVED)
+    {
+        warc.commit(std::move(record), statusCode, response.m_ContentType,
+                    response.m_ContentLength > static_cast<int>(body.length()));
+        return response;
+    }
+
+    // Store the body under the memory budget, possibly streaming it to spillFile
+    response.setSpillFile(spillFile);
+
+    if (!keepBody)
+        response.discardBody();
+
+    if (response.m_ContentLength > 0)
+        response.reserveBody(response.m_ContentLength);
+
+    else if (response.m_ContentLength == -1 && expectedLength > 0)
+        response.reserveBody(expectedLength);
+
+    // Let the caller process the body while the rest is being received
+    auto notify = [&]
+    {
+        if (onBody && keepBody && !response.isSpilled() && !response.m_Body.empty())
+            onBody(response.m_Body);
+    };
+
+    response.appendBody(body);
+    body.clear();
+    notify();
+
+    // Read data if possible, the body dropped over the budget is not received further
+    while (!response.isOverBudget())
+    {
+        string newData = receiveData(bio);
+
+        // If server sent Content-Length, we can check it
+        if (response.m_ContentLength != -1)
+            if (response.getBodyLength() >= static_cast<size_t>(response.m_ContentLength))
+                break;
+
+        // Otherwise we have to try until there are no more data present
+        if (newData.length() <= 0)
+            break;
+
+        timings.m_BytesReceived += newData.length();
+        record.append(newData);
+        response.appendBody(newData);
+        notify();
+    }
+
+    response.finishBody();
+
+    // Not archived, the repeated request is
+    if (response.isOverBudget())
+    {
+        response.m_Status = CResponse::EStatus::OVER_BUDGET;
+        return response;
+    }
+
+    warc.commit(std::move(record), statusCode, response.m_ContentType,
+                response.m_ContentLength != -1 && response.getBodyLength() < static_cast<size_t>(response.m_ContentLength));
+    response.m_Status = CResponse::EStatus::FINISHED;
+
+    return response;
+}
+
+CResponse CHttpsDownloader::parseHeader(const string &header, CURLHandler &currentUrl)
+{
     // Split headers
     vector<string> headers = Utils::splitString(header, "\r\n");
 
     // Check HTTP response validity
-    regex re_httpStatus("HTTP/\\d\\.\\d\\s+(\\d+)\\s+(.*)", std::regex_constants::icase);
+    const regex &re_httpStatus = CRegexRegistry::getInstance().get(CRegexRegistry::EPattern::HTTP_STATUS);
     smatch result;
 
-    if (regex_match(headers[0], result, re_httpStatus) == false)
+    if (headers.empty() || regex_match(headers[0], result, re_httpStatus) == false)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "The server didn't send valid HTTP response!");
+        LOG_ERROR("The server didn't send valid HTTP response!");
         return CResponse(CResponse::EStatus::SERVER_ERROR);
     }
 
     // Set status code
-    int statusCode = std::stoi(result[1].str());
-
     CResponse response(CResponse::EStatus::IN_PROGRESS);
-    response.m_StatusCode = statusCode;
+    response.m_StatusCode = std::stoi(result[1].str());
 
     // Parse other headers
     for (const string &line : headers)
@@ -226,51 +474,59 @@ CResponse CHttpsDownloader::receiveHttpMessage(BIO *bio, CURLHandler &currentUrl
         if (colon == string::npos)
             continue;
 
-        string key = line.substr(0, colon);
+        // Header names are case-insensitive (eg. 'Content-type')
+        string key = Utils::toLowerCase(line.substr(0, colon));
         string value = line.substr(colon + 2); // +2 to skip colon and whitespace
 
-        if (key == "Content-Length")
+        if (key == "content-length")
             response.m_ContentLength = std::stoi(value);
 
-        if (key == "Location")
+        if (key == "location")
             response.setMovedUrl(value, currentUrl);
 
-        if (key == "Content-Type")
+        if (key == "content-type")
             response.m_ContentType = value;
 
-        if (key == "Content-Disposition")
+        if (key == "content-disposition")
             response.m_ContentDisposition = value;
     }
 
-    // If finished, don't download body (eg. 404 or 301 etc occured)
-    if (response.m_Status == CResponse::EStatus::FINISHED ||
-        response.m_Status == CResponse::EStatus::MOVED)
-        return response;
+    return response;
+}
 
-    // Read data if possible
-    while (true)
-    {
-        string newData = receiveData(bio);
+void CHttpsDownloader::trace(const CURLHandler &url, const CResponse::TTimings &timings)
+{
+    auto &tracer = CTracer::getInstance();
+    if (!tracer.isEnabled())
+        return;
 
-        // If server sent Content-Length, we can check it
-        if (response.m_ContentLength != -1)
-            if (body.length() >= static_cast<size_t>(response.m_ContentLength))
-                break;
+    const string &normUrl = url.getNormURL();
+    CResponse::TTimings::TClock::time_point none;
 
-        // Otherwise we have to try until there are no more data present
-        if (newData.length() <= 0)
-            break;
+    tracer.addSpan("request", "network", timings.m_Start, timings.m_Finished, normUrl);
 
-        body += newData;
-    }
+    // Each phase ends at its time point and starts where the previous reached phase ended
+    const std::pair<const char *, CResponse::TTimings::TClock::time_point> phases[] = {
+        {"dns", timings.m_Resolved},
+        {"connect", timings.m_Connected},
+        {"tls", timings.m_Handshaked},
+        {"send", timings.m_RequestSent},
+        {"wait", timings.m_FirstByte},
+        {"transfer", timings.m_FirstByte != none ? timings.m_Finished : none}};
 
-    response.m_Status = CResponse::EStatus::FINISHED;
-    response.m_Body = body;
+    auto start = timings.m_Start;
 
-    return response;
+    for (const auto &[name, end] : phases)
+    {
+        if (end == none)
+            continue;
+
+        tracer.addSpan(name, "network", start, end, normUrl);
+        start = end;
+    }
 }
 
-void CHttpsDownloader::sendHttpRequest(BIO *bio, const string &resource, const string &host)
+string CHttpsDownloader::sendHttpRequest(BIO *bio, const string &resource, const string &host)
 {
     // Construct the GET header
     stringstream ss;
@@ -284,25 +540,22 @@ void CHttpsDownloader::sendHttpRequest(BIO *bio, const string &resource, const s
     ss << "Connection: close"
        << "\r\n";
 
-    // Add other values from config
-    auto &cfg = CConfig::getInstance();
-    string cookies = cfg["cookies"];
-    string userAgent = cfg["cookies"];
-
-    if (!cookies.empty())
-        ss << "Cookie: " << cookies << "\r\n";
-
-    if (!userAgent.empty())
-        ss << "User-Agent: " << userAgent << "\r\n";
+    // Add other values from config, formatted once
+    ss << CConfig::getInstance().getSnapshot().m_RequestHeaders;
 
     // End the header
     ss << "\r\n";
 
     string request = ss.str();
 
+    static auto &sent = CMetrics::getInstance().counter("wget_sent_bytes_total", "Bytes of the requests sent to the servers");
+    sent.add(request.size());
+
     // Send
     BIO_write(bio, request.data(), request.size());
     BIO_flush(bio);
+
+    return request;
 }
 
 SSL *CHttpsDownloader::getSSL(BIO *bio)
@@ -312,7 +565,7 @@ SSL *CHttpsDownloader::getSSL(BIO *bio)
     BIO_get_ssl(bio, &ssl);
 
     if (ssl == nullptr)
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Can't modify connection to use SSL!");
+        LOG_ERROR("Can't modify connection to use SSL!");
 
     return ssl;
 }
@@ -324,7 +577,7 @@ bool CHttpsDownloader::verifyCertificate(SSL *ssl, const std::string &expectedHo
     if (result != X509_V_OK)
     {
         const char *message = X509_verify_cert_error_string(result);
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Certificate verification error: " + string(message) + " - " + std::to_string(result));
+        LOG_ERROR("Certificate verification error: " + string(message) + " - " + std::to_string(result));
         return false;
     }
 
@@ -332,14 +585,14 @@ bool CHttpsDownloader::verifyCertificate(SSL *ssl, const std::string &expectedHo
 
     if (cert.get() == nullptr)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "No certificate was presented by the server!");
+        LOG_ERROR("No certificate was presented by the server!");
         return false;
     }
 
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
     if (X509_check_host(cert, expectedHostname.data(), expectedHostname.size(), 0, nullptr) != 1)
     {
-        CLogger::getInstance().log(CLogger::LogLevel::Error, "Certificate verification error in X509_check_host");
+        LOG_ERROR("Certificate verification error in X509_check_host");
         return false;
     }
 #else
@@ -32,8 +32,11 @@
 #include <fstream>
 #include <regex>
 #include <filesystem> // Kvuli tvorbe slozek
+#include <functional>
 #include <memory>     // unique_ptr<>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 using std::string, std::vector, std::unique_ptr;
@@ -61,12 +64,24 @@ struct TDeleter<SSL_CTX>
     void operator()(SSL_CTX *p) const { SSL_CTX_free(p); }
 };
 
+template <>
+struct TDeleter<SSL_SESSION>
+{
+    void operator()(SSL_SESSION *p) const { SSL_SESSION_free(p); }
+};
+
 template <>
 struct TDeleter<X509>
 {
     void operator()(X509 *p) const { X509_free(p); }
 };
 
+template <>
+struct TDeleter<addrinfo>
+{
+    void operator()(addrinfo *p) const { freeaddrinfo(p); }
+};
+
 /**
  * @brief Class that interacts through sockets with web server, makes SSL handshake and validates certificates, downloads content and parses headers
  *
@@ -81,14 +96,60 @@ public:
     CHttpsDownloader();
 
     /**
-     * @brief Makes GET request to the URL and returns content
+     * @brief Function called with the body received so far, after every received chunk of the body
+     *
+     */
+    using TBodyCallback = std::function<void(const string &body)>;
+
+    /**
+     * @brief Makes GET request to the URL and returns content, records the timings of the request phases
      *
      * @param url CURLHandler url of the remote file
+     * @param spillFile If not empty, the body may be streamed to this file when it doesn't fit into the memory budget
+     * @param keepBody If false, the body is only archived (if enabled) and not stored in the response
+     * @param onBody If set, called while the body is being received in memory (not when it's spilled or discarded)
+     * @param expectedLength Bytes reserved for the body before receiving it when the server doesn't send Content-Length
+     * (eg. the length received by a previous attempt)
      * @return CResponse Content of the downloaded file
      */
-    CResponse get(CURLHandler &url);
+    CResponse get(CURLHandler &url, const string &spillFile = "", bool keepBody = true, const TBodyCallback &onBody = nullptr,
+                  size_t expectedLength = 0);
+
+    /**
+     * @brief Parse the status line and the headers of the response
+     *
+     * @param header Status line and headers, each ending with "\r\n", without the empty line
+     * @param currentUrl URL of the request, redirects are resolved against it
+     * @return CResponse In progress with the status code and the headers set, moved for redirects, server error if the
+     * status line is not valid
+     */
+    static CResponse parseHeader(const string &header, CURLHandler &currentUrl);
 
 private:
+    /**
+     * @brief Makes the GET request, see get()
+     *
+     * @param url
+     * @param spillFile
+     * @param keepBody
+     * @param onBody
+     * @param expectedLength
+     * @param[out] timings Timestamps of the phases are set as they are reached
+     * @return CResponse
+     */
+    CResponse request(CURLHandler &url, const string &spillFile, bool keepBody, const TBodyCallback &onBody, size_t expectedLength,
+                      CResponse::TTimings &timings);
+
+    /**
+     * @brief Open a non-blocking connection to the resolved address
+     *
+     * @param address
+     * @param port
+     * @param[out] timedOut True if the connection timed out
+     * @return unique_ptr<BIO, TDeleter<BIO>> Connected BIO, nullptr if the connection failed
+     */
+    unique_ptr<BIO, TDeleter<BIO>> connect(const addrinfo *address, const string &port, bool &timedOut);
+
     /**
      * @brief Receives data through socket using BIO, retries the connection if appropriate
      *
@@ -102,9 +163,16 @@ private:
      *
      * @param bio
      * @param currentUrl
+     * @param request Sent HTTP request, for the archive
+     * @param spillFile File where the body may be streamed, or empty
+     * @param keepBody If false, the body is not stored in the response
+     * @param onBody Called with the body received so far, or empty
+     * @param expectedLength Bytes reserved for the body without Content-Length, or 0
+     * @param[out] timings The first byte and the received bytes are recorded here
      * @return CResponse
      */
-    CResponse receiveHttpMessage(BIO *bio, CURLHandler &currentUrl);
+    CResponse receiveHttpMessage(BIO *bio, CURLHandler &currentUrl, const string &request, const string &spillFile, bool keepBody,
+                                 const TBodyCallback &onBody, size_t expectedLength, CResponse::TTimings &timings);
 
     /**
      * @brief Sends the HTTP/HTTPS request using provided BIO
@@ -112,8 +180,17 @@ private:
      * @param bio Pointer to BIO object
      * @param resource Required remote resource (eg. '/file/index.html')
      * @param host Host of the resource (eg. 'google.com')
+     * @return string The sent request
+     */
+    string sendHttpRequest(BIO *bio, const string &resource, const string &host);
+
+    /**
+     * @brief Record the phases of the finished request as trace spans, if tracing is enabled
+     *
+     * @param url
+     * @param timings
      */
-    void sendHttpRequest(BIO *bio, const string &resource, const string &host);
+    static void trace(const CURLHandler &url, const CResponse::TTimings &timings);
 
     /**
      * @brief Extract SSL certificate from SSL BIO
@@ -141,4 +218,21 @@ private:
 
     const string HTTP_PORT = "80";
     const string HTTPS_PORT = "443";
+
+private:
+    /**
+     * @brief The last TLS session of every "host:port", resumed by the next connection to skip the full handshake
+     *
+     */
+    std::unordered_map<string, unique_ptr<SSL_SESSION, TDeleter<SSL_SESSION>>> m_Sessions;
+    std::mutex m_SessionsMutex;
+
+    /**
+     * @brief OpenSSL callback for a new session (or a TLS 1.3 ticket), stores it under the key set as the SSL app data
+     *
+     * @param ssl
+     * @param session
+     * @return int 1 if the session is kept
+     */
+    static int storeSession(SSL *ssl, SSL_SESSION *session);
 };
@@ -0,0 +1,86 @@
+/**
+ * @file CInternTable.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CInternTable
+ *
+ */
+
+#include "CInternTable.h"
+
+#include <functional> // hash
+#include <mutex>
+#include <stdexcept>
+
+CInternTable::TId CInternTable::intern(string_view value)
+{
+    size_t index = getShard(value);
+    TShard &shard = m_Shards[index];
+
+    // Most strings are already known, look them up under the shared lock first
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.m_Mutex);
+
+        auto it = shard.m_Ids.find(value);
+        if (it != shard.m_Ids.end())
+            return it->second;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.m_Mutex);
+
+    // Another worker may have inserted it in the meantime
+    auto it = shard.m_Ids.find(value);
+    if (it != shard.m_Ids.end())
+        return it->second;
+
+    if (shard.m_Values.size() >= (static_cast<size_t>(NONE) - index) / SHARDS)
+        throw std::overflow_error("Too many interned strings!");
+
+    TId id = static_cast<TId>(shard.m_Values.size() * SHARDS + index);
+
+    shard.m_Values.emplace_back(value);
+    shard.m_Ids.emplace(shard.m_Values.back(), id);
+
+    return id;
+}
+
+CInternTable::TId CInternTable::find(string_view value) const
+{
+    const TShard &shard = m_Shards[getShard(value)];
+    std::shared_lock<std::shared_mutex> lock(shard.m_Mutex);
+
+    auto it = shard.m_Ids.find(value);
+    return it != shard.m_Ids.end() ? it->second : NONE;
+}
+
+string_view CInternTable::get(TId id) const
+{
+    const TShard &shard = m_Shards[id % SHARDS];
+    std::shared_lock<std::shared_mutex> lock(shard.m_Mutex);
+
+    return shard.m_Values.at(id / SHARDS);
+}
+
+size_t CInternTable::size() const
+{
+    size_t count = 0;
+
+    for (const auto &shard : m_Shards)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.m_Mutex);
+        count += shard.m_Values.size();
+    }
+
+    return count;
+}
+
+size_t CInternTable::getShard(string_view value)
+{
+    // The low bits of the hash select the bucket inside the shard, use the high ones
+    return (std::hash<string_view>{}(value) >> (sizeof(size_t) * 4)) % SHARDS;
+}
+
+CInternTable &CInternTable::getInstance()
+{
+    static CInternTable instance;
+    return instance;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file CInternTable.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CInternTable
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+using std::string, std::string_view;
+
+/**
+ * @brief Interning table singleton shared by all workers, maps normalized URLs, hostnames and paths to 32-bit IDs
+ *
+ * Every distinct string is stored only once for the whole run, sets and maps of the crawler keep just the IDs,
+ * so checking whether an URL was already seen is an integer hash lookup. The table is split into shards with
+ * their own lock, the IDs and views returned by it stay valid until the end of the program.
+ *
+ */
+class CInternTable
+{
+public:
+    using TId = uint32_t;
+
+    /**
+     * @brief ID returned by find() for a string that was never interned
+     *
+     */
+    static constexpr TId NONE = UINT32_MAX;
+
+    /**
+     * @brief Get the ID of the string, store the string if it's new
+     *
+     * @param value
+     * @return TId
+     */
+    TId intern(string_view value);
+
+    /**
+     * @brief Get the ID of the string without storing it
+     *
+     * @param value
+     * @return TId NONE if the string was never interned
+     */
+    TId find(string_view value) const;
+
+    /**
+     * @brief Get the string of the ID
+     *
+     * @param id ID returned by intern()
+     * @return string_view
+     */
+    string_view get(TId id) const;
+
+    /**
+     * @brief Get the number of interned strings
+     *
+     * @return size_t
+     */
+    size_t size() const;
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CInternTable
+     *
+     * @return CInternTable&
+     */
+    static CInternTable &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CInternTable being singleton
+     *
+     */
+    CInternTable(const CInternTable &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CInternTable being singleton
+     *
+     */
+    void operator=(const CInternTable &) = delete;
+
+private:
+    CInternTable() = default;
+
+    /**
+     * @brief Number of shards, the lowest bits of the ID select the shard
+     *
+     */
+    static constexpr size_t SHARDS = 16;
+
+    /**
+     * @brief Part of the table with its own lock
+     *
+     */
+    struct TShard
+    {
+        mutable std::shared_mutex m_Mutex;
+
+        /**
+         * @brief Stored strings indexed by the ID without the shard bits, a deque never moves them
+         *
+         */
+        std::deque<string> m_Values;
+
+        /**
+         * @brief IDs of the stored strings, keys are views into m_Values
+         *
+         */
+        std::unordered_map<string_view, TId> m_Ids;
+    };
+
+    TShard m_Shards[SHARDS];
+
+    /**
+     * @brief Get the shard the string belongs to
+     *
+     * @param value
+     * @return size_t
+     */
+    static size_t getShard(string_view value);
+};
@@ -7,15 +7,26 @@
 
 #include "CLogger.h"
 
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <fstream>
-#include <sstream>
 
-using std::string, std::cout, std::endl, std::ofstream, std::stringstream;
+using std::string, std::cout, std::ofstream;
+
+// Longest time a message waits in the ring buffer or in the stream buffer
+static const auto FLUSH_INTERVAL = std::chrono::milliseconds(50);
 
 CLogger::~CLogger()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_WakeMutex);
+        m_Stop = true;
+    }
+
+    m_WakeCv.notify_one();
+    m_Writer.join();
+
     if (m_Type == ELogType::File)
         m_Ofs.close();
 }
@@ -30,6 +41,11 @@ void CLogger::setLevel(const ELogLevel level)
     m_Level = level;
 }
 
+size_t CLogger::getDropped() const
+{
+    return m_Dropped;
+}
+
 void CLogger::init(ELogLevel level)
 {
     getInstanceImpl(&level);
@@ -41,12 +57,31 @@ CLogger &CLogger::getInstanceImpl(const CLogger::ELogLevel *level)
     return instance;
 }
 
-CLogger::CLogger(ELogLevel logLevel)
+CLogger::CLogger(ELogLevel logLevel, size_t capacity)
     : m_Level(logLevel),
-      m_Type(CLogger::ELogType::Terminal) {}
+      m_Type(CLogger::ELogType::Terminal)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size *= 2;
+
+    m_Ring = std::make_unique<TSlot[]>(size);
+    m_Mask = size - 1;
+
+    // Slot i is free for the message at position i
+    for (size_t i = 0; i < size; i++)
+        m_Ring[i].m_Sequence.store(i, std::memory_order_relaxed);
+
+    m_Writer = std::thread(&CLogger::writerLoop, this);
+}
 
 void CLogger::setToFile(const string &filePath)
 {
+    // Messages logged before go to the previous output
+    flush();
+
+    std::lock_guard<std::mutex> lock(m_OutputMutex);
+
     m_Type = ELogType::File;
     m_FilePath = filePath;
     m_Ofs = ofstream(m_FilePath, std::ios_base::app);
@@ -54,46 +89,218 @@ void CLogger::setToFile(const string &filePath)
 
 void CLogger::log(const CLogger::ELogLevel level, const string &msg)
 {
-    if (level < m_Level)
+    if (level < m_Level.load(std::memory_order_relaxed))
+        return;
+
+    bool enqueued = tryEnqueue(level, msg);
+
+    // Verbose messages are dropped if the writer can't keep up, others wait for it
+    if (!enqueued && level == ELogLevel::Verbose)
+    {
+        m_Dropped.fetch_add(1, std::memory_order_relaxed);
         return;
+    }
 
-    stringstream ss;
+    while (!enqueued)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_Wake = true;
+        }
+        m_WakeCv.notify_one();
 
-    ss << "[";
+        std::this_thread::yield();
+        enqueued = tryEnqueue(level, msg);
+    }
 
+    // Errors are written right away
     if (level == ELogLevel::Error)
-        ss << "ERROR";
-    else if (level == ELogLevel::Info)
-        ss << "INFO";
-    else if (level == ELogLevel::Verbose)
-        ss << "VERBOSE";
-
-    ss << "] ("
-       << getDateTimeNow()
-       << "): "
-       << msg;
-
-    logToOutput(ss.str());
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_Wake = true;
+        }
+        m_WakeCv.notify_one();
+    }
+}
+
+void CLogger::flush()
+{
+    size_t target = m_Head.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(m_WakeMutex);
+    m_Wake = true;
+    m_WakeCv.notify_one();
+
+    m_WrittenCv.wait(lock, [&]
+                     { return m_Written >= target; });
+}
+
+bool CLogger::tryEnqueue(ELogLevel level, const string &msg)
+{
+    size_t position = m_Head.load(std::memory_order_relaxed);
+    TSlot *slot;
+
+    while (true)
+    {
+        slot = &m_Ring[position & m_Mask];
+        size_t sequence = slot->m_Sequence.load(std::memory_order_acquire);
+
+        // Free slot, try to claim it
+        if (sequence == position)
+        {
+            if (m_Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+
+        // The slot still holds the message from the previous round, the ring buffer is full
+        else if (sequence < position)
+            return false;
+
+        // Another producer claimed the position
+        else
+            position = m_Head.load(std::memory_order_relaxed);
+    }
+
+    slot->m_Level = level;
+    slot->m_Time = time(nullptr);
+    slot->m_Message.assign(msg);
+
+    // Publish the message to the writer
+    slot->m_Sequence.store(position + 1, std::memory_order_release);
+
+    // Wake the writer before the ring buffer fills up
+    if (position - m_Tail.load(std::memory_order_relaxed) == (m_Mask + 1) / 2)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_Wake = true;
+        }
+        m_WakeCv.notify_one();
+    }
+
+    return true;
+}
+
+size_t CLogger::drain(string &batch, bool &hasError)
+{
+    size_t tail = m_Tail.load(std::memory_order_relaxed);
+    size_t count = 0;
+
+    // Limit the batch, so flood of messages doesn't delay the output
+    while (count <= m_Mask)
+    {
+        TSlot &slot = m_Ring[tail & m_Mask];
+
+        if (slot.m_Sequence.load(std::memory_order_acquire) != tail + 1)
+            break;
+
+        batch += "[";
+
+        if (slot.m_Level == ELogLevel::Error)
+            batch += "ERROR";
+        else if (slot.m_Level == ELogLevel::Info)
+            batch += "INFO";
+        else if (slot.m_Level == ELogLevel::Verbose)
+            batch += "VERBOSE";
+
+        batch.append("] (").append(getDateTime(slot.m_Time)).append("): ").append(slot.m_Message).append("\n");
+
+        hasError |= slot.m_Level == ELogLevel::Error;
+
+        // Free the slot for the next round
+        slot.m_Sequence.store(tail + m_Mask + 1, std::memory_order_release);
+        m_Tail.store(++tail, std::memory_order_relaxed);
+        count++;
+    }
+
+    size_t dropped = m_Dropped.load(std::memory_order_relaxed);
+
+    if (dropped != m_ReportedDropped)
+    {
+        batch.append("[INFO] (").append(getDateTime(time(nullptr))).append("): ");
+        batch.append(std::to_string(dropped - m_ReportedDropped)).append(" verbose log messages dropped\n");
+        m_ReportedDropped = dropped;
+    }
+
+    return count;
 }
 
-void CLogger::logToOutput(const string &msg)
+void CLogger::writerLoop()
 {
-    if (m_Type == CLogger::ELogType::Terminal)
-        cout << msg << endl;
+    string batch;
 
-    else if (m_Type == CLogger::ELogType::File)
-        m_Ofs << msg << endl;
+    while (true)
+    {
+        bool stop;
 
-    return;
+        {
+            std::unique_lock<std::mutex> lock(m_WakeMutex);
+            m_WakeCv.wait_for(lock, FLUSH_INTERVAL, [&]
+                              { return m_Wake || m_Stop; });
+
+            m_Wake = false;
+            stop = m_Stop;
+        }
+
+        // Write everything available, then flush once
+        bool hasError = false;
+        bool written = false;
+
+        while (true)
+        {
+            batch.clear();
+            size_t count = drain(batch, hasError);
+
+            if (!batch.empty())
+            {
+                logToOutput(batch, false);
+                written = true;
+            }
+
+            if (count == 0)
+                break;
+        }
+
+        if (written || hasError)
+            logToOutput("", true);
+
+        {
+            std::lock_guard<std::mutex> lock(m_WakeMutex);
+            m_Written = m_Tail.load(std::memory_order_relaxed);
+        }
+        m_WrittenCv.notify_all();
+
+        // Producers are done when the logger is destroyed
+        if (stop && m_Tail.load(std::memory_order_relaxed) == m_Head.load(std::memory_order_acquire))
+            break;
+    }
 }
 
-string CLogger::getDateTimeNow() const
+void CLogger::logToOutput(const string &batch, bool flush)
 {
-    time_t now = time(0);
-    struct tm tstruct;
-    char buf[80];
-    tstruct = *localtime(&now);
-    strftime(buf, sizeof(buf), "%Y-%m-%d %X", &tstruct);
+    std::lock_guard<std::mutex> lock(m_OutputMutex);
+
+    std::ostream &output = m_Type == CLogger::ELogType::File ? static_cast<std::ostream &>(m_Ofs) : cout;
+
+    output.write(batch.data(), batch.size());
+
+    if (flush)
+        output.flush();
+}
+
+const string &CLogger::getDateTime(time_t time)
+{
+    if (time != m_CachedTime)
+    {
+        struct tm tstruct;
+        char buf[80];
+        localtime_r(&time, &tstruct);
+        strftime(buf, sizeof(buf), "%Y-%m-%d %X", &tstruct);
+
+        m_CachedDateTime = buf;
+        m_CachedTime = time;
+    }
 
-    return buf;
+    return m_CachedDateTime;
 }
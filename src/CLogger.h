@@ -7,15 +7,51 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <ctime>
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <memory> // unique_ptr<>
+#include <mutex>
+#include <thread>
 
 using std::string, std::ofstream;
 
+/**
+ * @brief Lowest log level compiled into the program (0 = verbose, 1 = info, 2 = error), set by the Makefile
+ *
+ */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+/**
+ * @brief Log the message if the level is enabled, the message is not evaluated otherwise
+ *
+ * Levels below LOG_MIN_LEVEL are removed at compile time. The message is any expression convertible to string.
+ *
+ */
+#define LOG_AT(logger, level, ...)                                                    \
+    do                                                                                \
+    {                                                                                 \
+        if (CLogger::isCompiled(level) && (logger).isEnabled(level))                  \
+            (logger).log(level, __VA_ARGS__);                                         \
+    } while (0)
+
+#define LOG_VERBOSE(...) LOG_AT(CLogger::getInstance(), CLogger::ELogLevel::Verbose, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(CLogger::getInstance(), CLogger::ELogLevel::Info, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(CLogger::getInstance(), CLogger::ELogLevel::Error, __VA_ARGS__)
+
 /**
  * @brief Logger singleton class that provides various logging levels and basic interface to log messages to output or log file
  *
+ * Messages are put into a lock-free ring buffer and written by a background thread in batches, so the pipeline
+ * workers never wait for the output. The output is flushed periodically, after an error and on flush(). When the
+ * ring buffer is full, verbose messages are dropped (and counted), other messages wait for the writer.
+ *
  */
 class CLogger
 {
@@ -38,17 +74,18 @@ public:
     CLogger() = delete;
 
     /**
-     * @brief Destroy the CLogger object, close ofstream if needed
+     * @brief Destroy the CLogger object, write the remaining messages and close ofstream if needed
      *
      */
     ~CLogger();
 
     /**
-     * @brief Construct a new CLogger object, with logging to 'cout'
+     * @brief Construct a new CLogger object, with logging to 'cout', and start the writer thread
      *
      * @param logLevel Minimal level to log
+     * @param capacity Number of messages the ring buffer holds, rounded up to a power of two
      */
-    explicit CLogger(ELogLevel logLevel);
+    explicit CLogger(ELogLevel logLevel, size_t capacity = DEFAULT_CAPACITY);
 
     /**
      * @brief Set the logger to send next logs to file instead of terminal
@@ -58,13 +95,43 @@ public:
     void setToFile(const string &filePath);
 
     /**
-     * @brief Log a message
+     * @brief Log a message, it's written later by the writer thread
      *
      * @param level ELogLevel level of this message
      * @param msg The message
      */
     void log(const ELogLevel level, const string &msg);
 
+    /**
+     * @brief Check if messages of the level are logged, so the message doesn't have to be built otherwise
+     *
+     * @param level
+     * @return true
+     * @return false
+     */
+    bool isEnabled(const ELogLevel level) const
+    {
+        return isCompiled(level) && level >= m_Level.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Check if the level is compiled in, see LOG_MIN_LEVEL
+     *
+     * @param level
+     * @return true
+     * @return false
+     */
+    static constexpr bool isCompiled(const ELogLevel level)
+    {
+        return static_cast<int>(level) >= LOG_MIN_LEVEL;
+    }
+
+    /**
+     * @brief Wait until all messages logged so far are written and flushed
+     *
+     */
+    void flush();
+
     /**
      * @brief Set current log level
      *
@@ -72,6 +139,13 @@ public:
      */
     void setLevel(const ELogLevel level);
 
+    /**
+     * @brief Get the number of verbose messages dropped because the ring buffer was full
+     *
+     * @return size_t
+     */
+    size_t getDropped() const;
+
     // Singleton stuff
     /**
      * @brief Init a new singleton instance of CLogger with desired level
@@ -99,6 +173,8 @@ public:
      */
     void operator=(const CLogger &) = delete;
 
+    static const size_t DEFAULT_CAPACITY = 16384;
+
 private:
     static CLogger &getInstanceImpl(const ELogLevel *level = nullptr);
 
@@ -112,22 +188,115 @@ private:
         File
     };
 
-    ELogLevel m_Level;
+    /**
+     * @brief Slot of the ring buffer, the sequence tells whether it's free or holds a message
+     *
+     */
+    struct TSlot
+    {
+        std::atomic<size_t> m_Sequence{0};
+        ELogLevel m_Level = ELogLevel::Info;
+        time_t m_Time = 0;
+        string m_Message; // Keeps its capacity, so reused slots don't allocate
+    };
+
+    std::atomic<ELogLevel> m_Level;
     ELogType m_Type;
     string m_FilePath;
     ofstream m_Ofs;
 
     /**
-     * @brief Print the message to COUT or FILE
+     * @brief Mutex guarding the output, held by the writer thread while writing a batch
+     *
+     */
+    std::mutex m_OutputMutex;
+
+    std::unique_ptr<TSlot[]> m_Ring;
+    size_t m_Mask;
+
+    /**
+     * @brief Position of the next message, claimed by the producers
+     *
+     */
+    alignas(64) std::atomic<size_t> m_Head{0};
+
+    /**
+     * @brief Position of the next message to write, only changed by the writer thread
+     *
+     */
+    alignas(64) std::atomic<size_t> m_Tail{0};
+
+    std::atomic<size_t> m_Dropped{0};
+
+    /**
+     * @brief Number of dropped messages already reported in the output
      *
+     */
+    size_t m_ReportedDropped = 0;
+
+    /**
+     * @brief Wakes up the writer thread on an error, flush() or destruction, and the flush() callers after a batch
+     *
+     */
+    std::mutex m_WakeMutex;
+    std::condition_variable m_WakeCv;
+    std::condition_variable m_WrittenCv;
+    bool m_Wake = false;
+    bool m_Stop = false;
+
+    /**
+     * @brief Number of messages written and flushed so far
+     *
+     */
+    size_t m_Written = 0;
+
+    /**
+     * @brief Timestamp of the last batch, formatted again only when the second changes
+     *
+     */
+    time_t m_CachedTime = -1;
+    string m_CachedDateTime;
+
+    std::thread m_Writer;
+
+    /**
+     * @brief Put the message into the ring buffer
+     *
+     * @param level
      * @param msg
+     * @return true If enqueued
+     * @return false If the ring buffer is full
+     */
+    bool tryEnqueue(ELogLevel level, const string &msg);
+
+    /**
+     * @brief Loop of the writer thread, writes batches of messages until stopped
+     *
+     */
+    void writerLoop();
+
+    /**
+     * @brief Format the messages waiting in the ring buffer into the batch
+     *
+     * @param[out] batch
+     * @param[out] hasError True if one of the messages is an error
+     * @return size_t Number of messages taken from the ring buffer
+     */
+    size_t drain(string &batch, bool &hasError);
+
+    /**
+     * @brief Print the batch to COUT or FILE
+     *
+     * @param batch
+     * @param flush Flush the stream after writing
      */
-    void logToOutput(const string &msg);
+    void logToOutput(const string &batch, bool flush);
 
     /**
-     * @brief Return formatted string with current date and time
+     * @brief Return formatted string with the date and time, cached for the same second
      *
-     * @return string
+     * @param time
+     * @return const string&
      */
-    string getDateTimeNow() const;
+    const string &getDateTime(time_t time);
 };
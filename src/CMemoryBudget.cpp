@@ -0,0 +1,172 @@
+/**
+ * @file CMemoryBudget.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CMemoryBudget
+ *
+ */
+
+#include "CMemoryBudget.h"
+
+#include <algorithm> // max
+
+#ifdef __GLIBC__
+#include <malloc.h> // mallopt
+#endif
+
+CMemoryBudget::TReservation::~TReservation()
+{
+    release();
+}
+
+CMemoryBudget::TReservation::TReservation(TReservation &&other) noexcept
+    : m_Bytes(other.m_Bytes)
+{
+    other.m_Bytes = 0;
+}
+
+CMemoryBudget::TReservation &CMemoryBudget::TReservation::operator=(TReservation &&other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        m_Bytes = other.m_Bytes;
+        other.m_Bytes = 0;
+    }
+
+    return *this;
+}
+
+void CMemoryBudget::TReservation::acquire(size_t bytes)
+{
+    auto &budget = CMemoryBudget::getInstance();
+
+    std::unique_lock<std::mutex> lock(budget.m_Mutex);
+
+    // Waiting while holding bytes could deadlock with another waiting fetch
+    if (m_Bytes == 0)
+        budget.m_Released.wait(lock, [&]
+                               { return budget.fits(bytes) || budget.m_Used == 0; });
+
+    budget.add(bytes);
+    m_Bytes += bytes;
+}
+
+bool CMemoryBudget::TReservation::tryAcquire(size_t bytes)
+{
+    auto &budget = CMemoryBudget::getInstance();
+
+    std::lock_guard<std::mutex> lock(budget.m_Mutex);
+
+    if (!budget.fits(bytes))
+        return false;
+
+    budget.add(bytes);
+    m_Bytes += bytes;
+    return true;
+}
+
+bool CMemoryBudget::TReservation::tryExtend(size_t bytes)
+{
+    auto &budget = CMemoryBudget::getInstance();
+
+    std::lock_guard<std::mutex> lock(budget.m_Mutex);
+
+    if (!budget.fits(bytes) && budget.m_Used != m_Bytes)
+        return false;
+
+    budget.add(bytes);
+    m_Bytes += bytes;
+    return true;
+}
+
+void CMemoryBudget::TReservation::shrink(size_t bytes)
+{
+    if (m_Bytes <= bytes)
+        return;
+
+    CMemoryBudget::getInstance().remove(m_Bytes - bytes);
+    m_Bytes = bytes;
+}
+
+void CMemoryBudget::TReservation::release()
+{
+    if (m_Bytes == 0)
+        return;
+
+    CMemoryBudget::getInstance().remove(m_Bytes);
+    m_Bytes = 0;
+}
+
+size_t CMemoryBudget::TReservation::size() const
+{
+    return m_Bytes;
+}
+
+void CMemoryBudget::setLimit(size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Limit = bytes;
+    }
+
+#ifdef __GLIBC__
+    // Bodies are big and short-lived, glibc would otherwise raise its mmap threshold after the first one is freed and
+    // keep the following ones in the heaps of the fetch threads, so the process would not shrink with the budget
+    if (bytes > 0)
+        mallopt(M_MMAP_THRESHOLD, MMAP_THRESHOLD);
+#endif
+
+    m_Released.notify_all();
+}
+
+size_t CMemoryBudget::getLimit() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Limit;
+}
+
+size_t CMemoryBudget::getUsed() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Used;
+}
+
+size_t CMemoryBudget::getPeak() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Peak;
+}
+
+void CMemoryBudget::waitForHeadroom(size_t bytes)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Released.wait(lock, [&]
+                    { return m_Used == 0 || (bytes == 0 ? m_Limit == 0 || m_Used < m_Limit : fits(bytes)); });
+}
+
+CMemoryBudget &CMemoryBudget::getInstance()
+{
+    static CMemoryBudget instance;
+    return instance;
+}
+
+bool CMemoryBudget::fits(size_t bytes) const
+{
+    return m_Limit == 0 || (m_Used <= m_Limit && bytes <= m_Limit - m_Used);
+}
+
+void CMemoryBudget::add(size_t bytes)
+{
+    m_Used += bytes;
+    m_Peak = std::max(m_Peak, m_Used);
+}
+
+void CMemoryBudget::remove(size_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Used -= std::min(bytes, m_Used);
+    }
+
+    m_Released.notify_all();
+}
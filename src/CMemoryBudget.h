@@ -0,0 +1,187 @@
+/**
+ * @file CMemoryBudget.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CMemoryBudget
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+/**
+ * @brief Global byte budget singleton for the content buffered in memory (response bodies and file contents)
+ *
+ * Files are charged when their content is received and released once it is written to disk. Waiting is allowed
+ * only while holding no reserved bytes, so two fetches can never wait for each other.
+ *
+ */
+class CMemoryBudget
+{
+public:
+    /**
+     * @brief Allocations of at least this many bytes are mapped separately when the budget is limited
+     *
+     */
+    static constexpr int MMAP_THRESHOLD = 1024 * 1024;
+
+    /**
+     * @brief Bytes reserved by one file, released automatically on destruction
+     *
+     */
+    struct TReservation
+    {
+        TReservation() = default;
+        ~TReservation();
+
+        TReservation(TReservation &&other) noexcept;
+        TReservation &operator=(TReservation &&other) noexcept;
+
+        TReservation(const TReservation &) = delete;
+        TReservation &operator=(const TReservation &) = delete;
+
+        /**
+         * @brief Reserve bytes, wait while they don't fit into the budget (or until the budget is completely free)
+         *
+         * @param bytes
+         */
+        void acquire(size_t bytes);
+
+        /**
+         * @brief Reserve bytes only if they fit into the budget right now
+         *
+         * @param bytes
+         * @return true If reserved
+         * @return false If the budget is exhausted
+         */
+        bool tryAcquire(size_t bytes);
+
+        /**
+         * @brief Reserve more bytes without waiting, if they fit into the budget or if this reservation is the only one
+         * (a single file may be larger than the whole budget)
+         *
+         * @param bytes
+         * @return true If reserved
+         * @return false If the budget is exhausted by other reservations
+         */
+        bool tryExtend(size_t bytes);
+
+        /**
+         * @brief Return the reserved bytes over the given size to the budget
+         *
+         * @param bytes Number of bytes to keep
+         */
+        void shrink(size_t bytes);
+
+        /**
+         * @brief Return all reserved bytes to the budget
+         *
+         */
+        void release();
+
+        /**
+         * @brief Get the number of reserved bytes
+         *
+         * @return size_t
+         */
+        size_t size() const;
+
+    private:
+        size_t m_Bytes = 0;
+    };
+
+    /**
+     * @brief Set the limit in bytes, 0 means unlimited
+     *
+     * A limit also makes the allocator map the allocations from MMAP_THRESHOLD up separately, so they are returned to
+     * the system as soon as they are freed.
+     *
+     * @param bytes
+     */
+    void setLimit(size_t bytes);
+
+    /**
+     * @brief Get the limit in bytes, 0 means unlimited
+     *
+     * @return size_t
+     */
+    size_t getLimit() const;
+
+    /**
+     * @brief Get the number of currently reserved bytes
+     *
+     * @return size_t
+     */
+    size_t getUsed() const;
+
+    /**
+     * @brief Get the highest number of reserved bytes at once
+     *
+     * @return size_t
+     */
+    size_t getPeak() const;
+
+    /**
+     * @brief Wait until the budget is not exhausted, used to defer new fetches
+     *
+     * @param bytes Wait until this many bytes fit into the budget (or until the budget is completely free), 0 to wait
+     * only until the budget is not full
+     */
+    void waitForHeadroom(size_t bytes = 0);
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CMemoryBudget
+     *
+     * @return CMemoryBudget&
+     */
+    static CMemoryBudget &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CMemoryBudget being singleton
+     *
+     */
+    CMemoryBudget(const CMemoryBudget &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CMemoryBudget being singleton
+     *
+     */
+    void operator=(const CMemoryBudget &) = delete;
+
+private:
+    CMemoryBudget() = default;
+
+    size_t m_Limit = 0;
+    size_t m_Used = 0;
+    size_t m_Peak = 0;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Released;
+
+    /**
+     * @brief Check if bytes fit into the budget, m_Mutex has to be locked
+     *
+     * @param bytes
+     * @return true
+     * @return false
+     */
+    bool fits(size_t bytes) const;
+
+    /**
+     * @brief Add bytes to the used amount, m_Mutex has to be locked
+     *
+     * @param bytes
+     */
+    void add(size_t bytes);
+
+    /**
+     * @brief Return bytes to the budget and wake up the waiting threads
+     *
+     * @param bytes
+     */
+    void remove(size_t bytes);
+};
@@ -0,0 +1,334 @@
+/**
+ * @file CMetrics.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CMetrics
+ *
+ */
+
+#include "CMetrics.h"
+
+#include <algorithm> // upper_bound
+#include <cmath>     // isinf
+#include <cstdio>    // snprintf
+#include <cstdlib>   // strtod
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+using std::stringstream;
+
+const vector<double> CMetrics::SECONDS_BOUNDS = {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+size_t CMetrics::getShard()
+{
+    // Threads get consecutive shards in the order they first update a metric
+    static std::atomic<size_t> nextShard{0};
+    thread_local size_t shard = nextShard++ % SHARDS;
+
+    return shard;
+}
+
+// ============ CCounter ============
+
+void CMetrics::CCounter::add(uint64_t value)
+{
+    m_Shards[getShard()].m_Value.fetch_add(value, std::memory_order_relaxed);
+}
+
+uint64_t CMetrics::CCounter::get() const
+{
+    uint64_t sum = 0;
+
+    for (const auto &shard : m_Shards)
+        sum += shard.m_Value.load(std::memory_order_relaxed);
+
+    return sum;
+}
+
+// ============ CGauge ============
+
+void CMetrics::CGauge::set(int64_t value)
+{
+    m_Value.store(value, std::memory_order_relaxed);
+}
+
+void CMetrics::CGauge::add(int64_t value)
+{
+    m_Value.fetch_add(value, std::memory_order_relaxed);
+}
+
+int64_t CMetrics::CGauge::get() const
+{
+    return m_Value.load(std::memory_order_relaxed);
+}
+
+// ============ CHistogram ============
+
+CMetrics::CHistogram::CHistogram(const vector<double> &bounds)
+    : m_Bounds(bounds)
+{
+    for (auto &shard : m_Shards)
+    {
+        shard.m_Buckets = std::make_unique<std::atomic<uint64_t>[]>(m_Bounds.size() + 1);
+
+        for (size_t i = 0; i <= m_Bounds.size(); i++)
+            shard.m_Buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void CMetrics::CHistogram::observe(double value)
+{
+    TShard &shard = m_Shards[getShard()];
+
+    // Bucket of the first bound greater or equal to the value, the last one is +Inf
+    size_t bucket = std::lower_bound(m_Bounds.begin(), m_Bounds.end(), value) - m_Bounds.begin();
+    shard.m_Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    double sum = shard.m_Sum.load(std::memory_order_relaxed);
+    while (!shard.m_Sum.compare_exchange_weak(sum, sum + value, std::memory_order_relaxed))
+        ;
+}
+
+const vector<double> &CMetrics::CHistogram::getBounds() const
+{
+    return m_Bounds;
+}
+
+vector<uint64_t> CMetrics::CHistogram::getCounts() const
+{
+    vector<uint64_t> counts(m_Bounds.size() + 1, 0);
+
+    for (const auto &shard : m_Shards)
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += shard.m_Buckets[i].load(std::memory_order_relaxed);
+
+    return counts;
+}
+
+uint64_t CMetrics::CHistogram::getCount() const
+{
+    uint64_t count = 0;
+
+    for (uint64_t bucket : getCounts())
+        count += bucket;
+
+    return count;
+}
+
+double CMetrics::CHistogram::getSum() const
+{
+    double sum = 0;
+
+    for (const auto &shard : m_Shards)
+        sum += shard.m_Sum.load(std::memory_order_relaxed);
+
+    return sum;
+}
+
+// ============ Registry ============
+
+CMetrics::TFamily &CMetrics::getFamily(const string &name, const string &help, EType type)
+{
+    auto [it, inserted] = m_Families.try_emplace(name);
+
+    if (inserted)
+    {
+        it->second.m_Help = help;
+        it->second.m_Type = type;
+    }
+    else if (it->second.m_Type != type)
+        throw std::logic_error("Metric " + name + " is already registered with another type!");
+
+    return it->second;
+}
+
+CMetrics::CCounter &CMetrics::counter(const string &name, const string &help, const TLabels &labels)
+{
+    string key = formatLabels(labels);
+
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+        auto family = m_Families.find(name);
+        if (family != m_Families.end() && family->second.m_Type == EType::COUNTER)
+        {
+            auto it = family->second.m_Counters.find(key);
+            if (it != family->second.m_Counters.end())
+                return *it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+    auto &series = getFamily(name, help, EType::COUNTER).m_Counters[key];
+    if (!series)
+        series = std::make_unique<CCounter>();
+
+    return *series;
+}
+
+CMetrics::CGauge &CMetrics::gauge(const string &name, const string &help, const TLabels &labels)
+{
+    string key = formatLabels(labels);
+
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+        auto family = m_Families.find(name);
+        if (family != m_Families.end() && family->second.m_Type == EType::GAUGE)
+        {
+            auto it = family->second.m_Gauges.find(key);
+            if (it != family->second.m_Gauges.end())
+                return *it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+    auto &series = getFamily(name, help, EType::GAUGE).m_Gauges[key];
+    if (!series)
+        series = std::make_unique<CGauge>();
+
+    return *series;
+}
+
+CMetrics::CHistogram &CMetrics::histogram(const string &name, const string &help, const vector<double> &bounds, const TLabels &labels)
+{
+    string key = formatLabels(labels);
+
+    {
+        std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+        auto family = m_Families.find(name);
+        if (family != m_Families.end() && family->second.m_Type == EType::HISTOGRAM)
+        {
+            auto it = family->second.m_Histograms.find(key);
+            if (it != family->second.m_Histograms.end())
+                return *it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(m_Mutex);
+
+    auto &series = getFamily(name, help, EType::HISTOGRAM).m_Histograms[key];
+    if (!series)
+        series = std::make_unique<CHistogram>(bounds);
+
+    return *series;
+}
+
+string CMetrics::render() const
+{
+    std::shared_lock<std::shared_mutex> lock(m_Mutex);
+
+    stringstream ss;
+
+    for (const auto &[name, family] : m_Families)
+    {
+        ss << "# HELP " << name << " " << escape(family.m_Help, false) << "\n";
+
+        if (family.m_Type == EType::COUNTER)
+        {
+            ss << "# TYPE " << name << " counter\n";
+
+            for (const auto &[labels, counter] : family.m_Counters)
+                ss << name << labels << " " << counter->get() << "\n";
+        }
+
+        else if (family.m_Type == EType::GAUGE)
+        {
+            ss << "# TYPE " << name << " gauge\n";
+
+            for (const auto &[labels, gauge] : family.m_Gauges)
+                ss << name << labels << " " << gauge->get() << "\n";
+        }
+
+        else
+        {
+            ss << "# TYPE " << name << " histogram\n";
+
+            for (const auto &[labels, histogram] : family.m_Histograms)
+            {
+                // The bucket label is added to the other labels
+                string prefix = labels.empty() ? "{" : labels.substr(0, labels.length() - 1) + ",";
+
+                vector<uint64_t> counts = histogram->getCounts();
+                const vector<double> &bounds = histogram->getBounds();
+                uint64_t cumulative = 0;
+
+                for (size_t i = 0; i < counts.size(); i++)
+                {
+                    cumulative += counts[i];
+                    string bound = i < bounds.size() ? formatValue(bounds[i]) : "+Inf";
+                    ss << name << "_bucket" << prefix << "le=\"" << bound << "\"} " << cumulative << "\n";
+                }
+
+                ss << name << "_sum" << labels << " " << formatValue(histogram->getSum()) << "\n";
+                ss << name << "_count" << labels << " " << cumulative << "\n";
+            }
+        }
+    }
+
+    return ss.str();
+}
+
+string CMetrics::formatLabels(const TLabels &labels)
+{
+    if (labels.empty())
+        return "";
+
+    string text = "{";
+
+    for (const auto &[key, value] : labels)
+    {
+        if (text.length() > 1)
+            text += ",";
+
+        text += key + "=\"" + escape(value, true) + "\"";
+    }
+
+    return text + "}";
+}
+
+string CMetrics::escape(const string &text, bool quotes)
+{
+    string escaped;
+
+    for (char c : text)
+    {
+        if (c == '\\' || (quotes && c == '"'))
+            escaped += '\\';
+
+        if (c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+
+    return escaped;
+}
+
+string CMetrics::formatValue(double value)
+{
+    if (std::isinf(value))
+        return value > 0 ? "+Inf" : "-Inf";
+
+    // Shortest text that reads back as the same value (eg. "0.001", not "0.0010000000000000000208")
+    char buffer[32];
+
+    for (int precision = 1; precision <= 17; precision++)
+    {
+        snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+
+        if (strtod(buffer, nullptr) == value)
+            break;
+    }
+
+    return buffer;
+}
+
+CMetrics &CMetrics::getInstance()
+{
+    static CMetrics instance;
+    return instance;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file CMetrics.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CMetrics
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory> // unique_ptr<>
+#include <shared_mutex>
+#include <string>
+#include <utility> // pair<>
+#include <vector>
+
+using std::string, std::vector;
+
+/**
+ * @brief Singleton registry of counters, gauges and histograms, rendered in the Prometheus text format
+ *
+ * Metrics are registered (or looked up) by the name and labels once, the returned reference stays valid for the
+ * whole run, so hot paths keep it and only update it. Counters and histograms are split into shards padded to a
+ * cache line, each thread updates its own shard and the shards are summed only when rendered.
+ *
+ */
+class CMetrics
+{
+public:
+    /**
+     * @brief Label names and values of one series, eg. {{"code", "200"}}
+     *
+     */
+    using TLabels = vector<std::pair<string, string>>;
+
+    static const size_t SHARDS = 16;
+
+    /**
+     * @brief Monotonic counter
+     *
+     */
+    class CCounter
+    {
+    public:
+        void add(uint64_t value = 1);
+        uint64_t get() const;
+
+    private:
+        struct alignas(64) TShard
+        {
+            std::atomic<uint64_t> m_Value{0};
+        };
+
+        TShard m_Shards[SHARDS];
+    };
+
+    /**
+     * @brief Value that can go up and down
+     *
+     */
+    class CGauge
+    {
+    public:
+        void set(int64_t value);
+        void add(int64_t value);
+        int64_t get() const;
+
+    private:
+        std::atomic<int64_t> m_Value{0};
+    };
+
+    /**
+     * @brief Distribution of observed values in buckets with fixed upper bounds
+     *
+     */
+    class CHistogram
+    {
+    public:
+        /**
+         * @brief Construct a new CHistogram object
+         *
+         * @param bounds Sorted upper bounds of the buckets, the +Inf bucket is added automatically
+         */
+        explicit CHistogram(const vector<double> &bounds);
+
+        void observe(double value);
+
+        const vector<double> &getBounds() const;
+
+        /**
+         * @brief Get the number of observations in each bucket (not cumulative), the last one is +Inf
+         *
+         * @return vector<uint64_t>
+         */
+        vector<uint64_t> getCounts() const;
+
+        uint64_t getCount() const;
+        double getSum() const;
+
+    private:
+        struct alignas(64) TShard
+        {
+            std::unique_ptr<std::atomic<uint64_t>[]> m_Buckets;
+            std::atomic<double> m_Sum{0};
+        };
+
+        vector<double> m_Bounds;
+        TShard m_Shards[SHARDS];
+    };
+
+    /**
+     * @brief Default histogram bounds for durations in seconds
+     *
+     */
+    static const vector<double> SECONDS_BOUNDS;
+
+    /**
+     * @brief Get or register the counter
+     *
+     * @param name Metric name, counters should end with "_total"
+     * @param help Description, used when the metric is registered
+     * @param labels
+     * @return CCounter&
+     */
+    CCounter &counter(const string &name, const string &help, const TLabels &labels = {});
+
+    /**
+     * @brief Get or register the gauge
+     *
+     * @param name
+     * @param help
+     * @param labels
+     * @return CGauge&
+     */
+    CGauge &gauge(const string &name, const string &help, const TLabels &labels = {});
+
+    /**
+     * @brief Get or register the histogram
+     *
+     * @param name
+     * @param help
+     * @param bounds Upper bounds of the buckets, used when the series is registered
+     * @param labels
+     * @return CHistogram&
+     */
+    CHistogram &histogram(const string &name, const string &help, const vector<double> &bounds, const TLabels &labels = {});
+
+    /**
+     * @brief Render all metrics in the Prometheus text exposition format
+     *
+     * @return string
+     */
+    string render() const;
+
+    /**
+     * @brief Get the shard of the current thread
+     *
+     * @return size_t
+     */
+    static size_t getShard();
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CMetrics
+     *
+     * @return CMetrics&
+     */
+    static CMetrics &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CMetrics being singleton
+     *
+     */
+    CMetrics(const CMetrics &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CMetrics being singleton
+     *
+     */
+    void operator=(const CMetrics &) = delete;
+
+private:
+    CMetrics() = default;
+
+    enum class EType
+    {
+        COUNTER,
+        GAUGE,
+        HISTOGRAM
+    };
+
+    /**
+     * @brief Metric with all its series, keyed by the rendered labels
+     *
+     */
+    struct TFamily
+    {
+        string m_Help;
+        EType m_Type;
+        std::map<string, std::unique_ptr<CCounter>> m_Counters;
+        std::map<string, std::unique_ptr<CGauge>> m_Gauges;
+        std::map<string, std::unique_ptr<CHistogram>> m_Histograms;
+    };
+
+    mutable std::shared_mutex m_Mutex;
+    std::map<string, TFamily> m_Families;
+
+    /**
+     * @brief Find the family, or register it
+     *
+     * @param name
+     * @param help
+     * @param type
+     * @return TFamily&
+     */
+    TFamily &getFamily(const string &name, const string &help, EType type);
+
+    /**
+     * @brief Render the labels as {key="value",...}, empty without labels
+     *
+     * @param labels
+     * @return string
+     */
+    static string formatLabels(const TLabels &labels);
+
+    /**
+     * @brief Escape backslashes and newlines, and quotes in label values
+     *
+     * @param text
+     * @param quotes True to escape quotes too
+     * @return string
+     */
+    static string escape(const string &text, bool quotes);
+
+    /**
+     * @brief Format the number as Prometheus expects it (eg. "+Inf")
+     *
+     * @param value
+     * @return string
+     */
+    static string formatValue(double value);
+};
@@ -0,0 +1,179 @@
+/**
+ * @file CMetricsExporter.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CMetricsExporter
+ *
+ */
+
+#include "CMetricsExporter.h"
+#include "CMetrics.h"
+#include "CLogger.h"
+
+#include <cerrno>
+#include <cstring> // strerror
+#include <filesystem>
+#include <fstream>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Longest time the thread waits for a scrape before checking whether it should stop
+static const int POLL_TIMEOUT_MS = 100;
+
+CMetricsExporter::CMetricsExporter(const string &filePath, int port, std::chrono::milliseconds interval)
+    : m_FilePath(filePath),
+      m_Interval(interval)
+{
+    if (port != NO_LISTENER)
+    {
+        m_Socket = socket(AF_INET, SOCK_STREAM, 0);
+
+        int enable = 1;
+        setsockopt(m_Socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        // Only local scrapers, the metrics contain the crawled hosts
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        socklen_t length = sizeof(address);
+
+        if (m_Socket < 0 ||
+            bind(m_Socket, reinterpret_cast<sockaddr *>(&address), length) != 0 ||
+            listen(m_Socket, 16) != 0 ||
+            getsockname(m_Socket, reinterpret_cast<sockaddr *>(&address), &length) != 0)
+        {
+            LOG_ERROR("Can't listen for metrics on port " + std::to_string(port) + ": " + string(strerror(errno)));
+
+            if (m_Socket >= 0)
+                close(m_Socket);
+            m_Socket = -1;
+        }
+        else
+        {
+            m_Port = ntohs(address.sin_port);
+            LOG_INFO("Serving metrics on http://127.0.0.1:" + std::to_string(m_Port) + "/metrics");
+        }
+    }
+
+    if (m_Socket >= 0 || !m_FilePath.empty())
+        m_Thread = std::thread(&CMetricsExporter::loop, this);
+}
+
+CMetricsExporter::~CMetricsExporter()
+{
+    m_Stop = true;
+
+    if (m_Thread.joinable())
+        m_Thread.join();
+
+    if (m_Socket >= 0)
+        close(m_Socket);
+
+    // Final values of the run
+    if (!m_FilePath.empty())
+        writeFile();
+}
+
+int CMetricsExporter::getPort() const
+{
+    return m_Port;
+}
+
+bool CMetricsExporter::isListening() const
+{
+    return m_Socket >= 0;
+}
+
+bool CMetricsExporter::writeFile() const
+{
+    string temporary = m_FilePath + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file << CMetrics::getInstance().render();
+
+        if (!file.good())
+            return false;
+    }
+
+    std::error_code error;
+    fs::rename(temporary, m_FilePath, error);
+
+    return !error;
+}
+
+void CMetricsExporter::loop()
+{
+    auto nextWrite = std::chrono::steady_clock::now();
+
+    while (!m_Stop)
+    {
+        if (!m_FilePath.empty() && std::chrono::steady_clock::now() >= nextWrite)
+        {
+            if (!writeFile())
+                LOG_ERROR("Can't write metrics to " + m_FilePath);
+
+            nextWrite = std::chrono::steady_clock::now() + m_Interval;
+        }
+
+        if (m_Socket < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_TIMEOUT_MS));
+            continue;
+        }
+
+        pollfd descriptor = {m_Socket, POLLIN, 0};
+
+        if (poll(&descriptor, 1, POLL_TIMEOUT_MS) <= 0 || !(descriptor.revents & POLLIN))
+            continue;
+
+        int client = accept(m_Socket, nullptr, nullptr);
+
+        if (client >= 0)
+        {
+            respond(client);
+            close(client);
+        }
+    }
+}
+
+void CMetricsExporter::respond(int client) const
+{
+    // Read the request header, the path doesn't matter
+    string request;
+    char buffer[1024];
+
+    while (request.find("\r\n\r\n") == string::npos && request.length() < 8192)
+    {
+        pollfd descriptor = {client, POLLIN, 0};
+
+        if (poll(&descriptor, 1, POLL_TIMEOUT_MS * 10) <= 0)
+            return;
+
+        ssize_t length = recv(client, buffer, sizeof(buffer), 0);
+
+        if (length <= 0)
+            return;
+
+        request.append(buffer, length);
+    }
+
+    string body = CMetrics::getInstance().render();
+    string response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                      std::to_string(body.length()) + "\r\nConnection: close\r\n\r\n" + body;
+
+    for (size_t sent = 0; sent < response.length();)
+    {
+        ssize_t length = send(client, response.data() + sent, response.length() - sent, MSG_NOSIGNAL);
+
+        if (length <= 0)
+            return;
+
+        sent += length;
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file CMetricsExporter.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CMetricsExporter
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using std::string;
+
+/**
+ * @brief Exports CMetrics in the Prometheus text format in a background thread, periodically to a textfile (for the
+ * node exporter textfile collector) and/or from a tiny HTTP listener on the loopback interface
+ *
+ */
+class CMetricsExporter
+{
+public:
+    /**
+     * @brief Port value that disables the HTTP listener
+     *
+     */
+    static constexpr int NO_LISTENER = -1;
+
+    /**
+     * @brief Start the export
+     *
+     * @param filePath Textfile rewritten every interval, or empty
+     * @param port Port of the HTTP listener on 127.0.0.1, 0 for any free port, NO_LISTENER to disable it
+     * @param interval How often the textfile is rewritten
+     */
+    CMetricsExporter(const string &filePath, int port, std::chrono::milliseconds interval = std::chrono::seconds(5));
+
+    /**
+     * @brief Stop the export and write the final textfile
+     *
+     */
+    ~CMetricsExporter();
+
+    /**
+     * @brief Get the port the HTTP listener is bound to
+     *
+     * @return int NO_LISTENER if there's no listener
+     */
+    int getPort() const;
+
+    /**
+     * @brief Returns false if the HTTP listener was requested but can't be started
+     *
+     * @return true
+     * @return false
+     */
+    bool isListening() const;
+
+    /**
+     * @brief Write the textfile now, through a temporary file, so readers never see it half written
+     *
+     * @return true If written
+     * @return false If it can't be written
+     */
+    bool writeFile() const;
+
+    CMetricsExporter(const CMetricsExporter &) = delete;
+    void operator=(const CMetricsExporter &) = delete;
+
+private:
+    string m_FilePath;
+    int m_Socket = -1;
+    int m_Port = NO_LISTENER;
+    std::chrono::milliseconds m_Interval;
+
+    std::atomic<bool> m_Stop{false};
+    std::thread m_Thread;
+
+    /**
+     * @brief Loop of the export thread, serves the scrapes and rewrites the textfile until stopped
+     *
+     */
+    void loop();
+
+    /**
+     * @brief Read the request and respond with the metrics
+     *
+     * @param client Socket of the accepted connection
+     */
+    void respond(int client) const;
+};
@@ -0,0 +1,90 @@
+/**
+ * @file COutputWriter.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of COutputWriter
+ *
+ */
+
+#include "COutputWriter.h"
+#include "CThreadPoolWriter.h"
+#include "CUringWriter.h"
+#include "CLogger.h"
+#include "CDirectoryCache.h"
+
+#include <filesystem>
+#include <fstream>
+
+using std::string, std::ofstream, std::make_unique;
+namespace fs = std::filesystem;
+
+void COutputWriter::submit(TRequest &&request)
+{
+    bool result = writeNow(request.m_Path, request.m_Content);
+
+    request.m_Reservation.release();
+
+    if (request.m_Done)
+        request.m_Done(result);
+}
+
+void COutputWriter::flush()
+{
+}
+
+string COutputWriter::getName() const
+{
+    return "sync";
+}
+
+bool COutputWriter::writeNow(const string &path, const string &content)
+{
+    CDirectoryCache::getInstance().create(fs::path(path).parent_path());
+
+    ofstream ofs(path, std::ios_base::out | std::ios_base::binary);
+    ofs << content;
+    ofs.close();
+
+    return !ofs.fail();
+}
+
+bool COutputWriter::setBackend(const string &name, size_t threads)
+{
+    unique_ptr<COutputWriter> backend;
+
+    if (name == "auto" || name == "uring")
+    {
+        auto uring = make_unique<CUringWriter>();
+
+        if (uring->isAvailable())
+            backend = std::move(uring);
+        else
+        {
+            LOG_AT(CLogger::getInstance(), name == "uring" ? CLogger::ELogLevel::Error : CLogger::ELogLevel::Verbose,
+                   "io_uring is not available, using thread pool output");
+            backend = make_unique<CThreadPoolWriter>(threads);
+        }
+    }
+    else if (name == "pool")
+        backend = make_unique<CThreadPoolWriter>(threads);
+    else if (name == "sync")
+        backend = make_unique<COutputWriter>();
+    else
+        return false;
+
+    // Finish the writes of the previous backend before replacing it
+    getInstance().flush();
+    getInstanceImpl() = std::move(backend);
+
+    return true;
+}
+
+COutputWriter &COutputWriter::getInstance()
+{
+    return *getInstanceImpl();
+}
+
+unique_ptr<COutputWriter> &COutputWriter::getInstanceImpl()
+{
+    static unique_ptr<COutputWriter> instance = make_unique<COutputWriter>();
+    return instance;
+}
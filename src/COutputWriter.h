@@ -0,0 +1,119 @@
+/**
+ * @file COutputWriter.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for COutputWriter
+ *
+ */
+
+#pragma once
+
+#include "CMemoryBudget.h"
+
+#include <functional>
+#include <memory> // unique_ptr<>
+#include <string>
+
+using std::string, std::unique_ptr;
+
+/**
+ * @brief Polymorphic base class of the output backends, writes files synchronously in the calling thread
+ *
+ * Derived backends complete the writes asynchronously, so the caller only hands over the content.
+ * The singleton instance is the backend selected at startup (synchronous by default).
+ *
+ */
+class COutputWriter
+{
+public:
+    /**
+     * @brief Callback called once the file is written, with true on success
+     *
+     */
+    using TCallback = std::function<void(bool)>;
+
+    /**
+     * @brief One file to write, owns the content until the write is completed
+     *
+     */
+    struct TRequest
+    {
+        string m_Path;
+        string m_Content;
+
+        /**
+         * @brief Memory budget of the content, released after the write is completed
+         *
+         */
+        CMemoryBudget::TReservation m_Reservation;
+
+        TCallback m_Done;
+    };
+
+    COutputWriter() = default;
+
+    /**
+     * @brief Destroy the COutputWriter object
+     *
+     */
+    virtual ~COutputWriter() = default;
+
+    COutputWriter(const COutputWriter &) = delete;
+    COutputWriter &operator=(const COutputWriter &) = delete;
+
+    /**
+     * @brief Create the folder structure and write the file
+     *
+     * @param request
+     */
+    virtual void submit(TRequest &&request);
+
+    /**
+     * @brief Wait until all submitted files are written
+     *
+     */
+    virtual void flush();
+
+    /**
+     * @brief Get the name of the backend
+     *
+     * @return string
+     */
+    virtual string getName() const;
+
+    /**
+     * @brief Create the folder structure and write the file in the calling thread
+     *
+     * @param path Path to the output file
+     * @param content Content of the file
+     * @return true If written
+     * @return false If error occured
+     */
+    static bool writeNow(const string &path, const string &content);
+
+    /**
+     * @brief Select the backend used by getInstance()
+     *
+     * 'uring' and 'auto' fall back to the thread pool if io_uring is not available, 'sync' writes in the calling thread.
+     *
+     * @param name Name of the backend (auto, uring, pool, sync)
+     * @param threads Number of threads of the thread pool backend
+     * @return true If the name is valid
+     * @return false If the name is unknown
+     */
+    static bool setBackend(const string &name, size_t threads);
+
+    /**
+     * @brief Get the selected backend
+     *
+     * @return COutputWriter&
+     */
+    static COutputWriter &getInstance();
+
+private:
+    /**
+     * @brief Get the pointer to the selected backend
+     *
+     * @return unique_ptr<COutputWriter>&
+     */
+    static unique_ptr<COutputWriter> &getInstanceImpl();
+};
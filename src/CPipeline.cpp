@@ -0,0 +1,261 @@
+/**
+ * @file CPipeline.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CPipeline
+ *
+ */
+
+#include "CPipeline.h"
+#include "CLogger.h"
+#include "COutputWriter.h"
+#include "CWarcWriter.h"
+#include "CTracer.h"
+
+#include <iomanip>
+#include <sstream>
+
+using std::string, std::stringstream, std::thread, std::shared_ptr;
+using TClock = std::chrono::steady_clock;
+
+CPipeline::TStage::TStage(const string &name, size_t workers, TQueue &input, TQueue *output)
+    : m_Name(name),
+      m_Workers(workers > 0 ? workers : 1),
+      m_Input(input),
+      m_Output(output),
+      m_InputDepth(getQueueDepth(name)),
+      m_Duration(CMetrics::getInstance().histogram("wget_stage_duration_seconds", "Time a pipeline stage spent on one file",
+                                                   CMetrics::SECONDS_BOUNDS, {{"stage", name}})) {}
+
+double CPipeline::TStageStats::getUtilization(std::chrono::nanoseconds wall) const
+{
+    if (wall.count() <= 0 || m_Workers == 0)
+        return 0;
+
+    return static_cast<double>(m_Busy.count()) / (static_cast<double>(wall.count()) * m_Workers);
+}
+
+double CPipeline::TStageStats::getBlockedRatio(std::chrono::nanoseconds wall) const
+{
+    if (wall.count() <= 0 || m_Workers == 0)
+        return 0;
+
+    return static_cast<double>(m_Blocked.count()) / (static_cast<double>(wall.count()) * m_Workers);
+}
+
+CPipeline::CPipeline(const TSettings &settings)
+    : m_Settings(settings),
+      m_Frontier(TQueue::UNBOUNDED),
+      m_ParseQueue(settings.m_QueueSize),
+      m_RewriteQueue(settings.m_QueueSize),
+      m_WriteQueue(settings.m_QueueSize),
+      m_FrontierDepth(getQueueDepth("fetch")) {}
+
+void CPipeline::run(shared_ptr<CFile> root)
+{
+    TStage fetch("fetch", m_Settings.m_FetchWorkers, m_Frontier, &m_ParseQueue);
+    TStage parse("parse", m_Settings.m_ParseWorkers, m_ParseQueue, &m_RewriteQueue);
+    TStage rewrite("rewrite", m_Settings.m_RewriteWorkers, m_RewriteQueue, &m_WriteQueue);
+    TStage write("write", m_Settings.m_WriteWorkers, m_WriteQueue, nullptr);
+
+    fetch.m_OutputDepth = &parse.m_InputDepth;
+    parse.m_OutputDepth = &rewrite.m_InputDepth;
+    rewrite.m_OutputDepth = &write.m_InputDepth;
+
+    // Network: check whether the file is needed and download it, files found in the partial content go
+    // to the frontier right away, so they are fetched while this file is still being received
+    TProcess fetchProcess = [this](shared_ptr<CFile> &file)
+    {
+        CTracer::CSpan span("fetch", "pipeline", file->getUrl().getNormURL());
+
+        // Archived responses are stored by the URL, not by the output file (the query isn't part of the file name)
+        if (!file->prepare() ||
+            !claim(CWarcWriter::getInstance().isEnabled() ? file->getUrl().getNormURL() : file->getOutputFile()))
+            return false;
+
+        file->setScheduler([this](shared_ptr<CFile> next)
+                           { submit(next); });
+
+        return file->fetch();
+    };
+
+    // CPU: find subsequent files and send them back to the frontier, archived files are done here
+    TProcess parseProcess = [this](shared_ptr<CFile> &file)
+    {
+        CTracer::CSpan span("parse", "pipeline", file->getUrl().getNormURL());
+
+        for (const auto &next : file->parse())
+            submit(next);
+
+        return !CWarcWriter::getInstance().isEnabled();
+    };
+
+    // CPU: rewrite links in the content
+    TProcess rewriteProcess = [](shared_ptr<CFile> &file)
+    {
+        CTracer::CSpan span("rewrite", "pipeline", file->getUrl().getNormURL());
+        file->rewrite();
+        return true;
+    };
+
+    // Disk: flush the content
+    TProcess writeProcess = [](shared_ptr<CFile> &file)
+    {
+        CTracer::CSpan span("save", "pipeline", file->getUrl().getNormURL());
+        file->save();
+        return true;
+    };
+
+    auto start = TClock::now();
+
+    submit(root);
+
+    vector<thread> threads;
+    for (auto [stage, process] : {std::make_pair(&fetch, &fetchProcess),
+                                  std::make_pair(&parse, &parseProcess),
+                                  std::make_pair(&rewrite, &rewriteProcess),
+                                  std::make_pair(&write, &writeProcess)})
+    {
+        stage->m_Alive = stage->m_Workers;
+
+        for (size_t i = 0; i < stage->m_Workers; i++)
+            threads.emplace_back([this, stage = stage, process = process, i]()
+                                 {
+                                     CTracer::getInstance().setThreadName(stage->m_Name + " " + std::to_string(i));
+                                     work(*stage, *process); });
+    }
+
+    for (auto &t : threads)
+        t.join();
+
+    // Wait until the output backend writes everything
+    COutputWriter::getInstance().flush();
+
+    m_Wall = std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now() - start);
+
+    // Save metrics
+    m_Stats.clear();
+    for (const TStage *stage : {&fetch, &parse, &rewrite, &write})
+    {
+        TStageStats stats;
+        stats.m_Name = stage->m_Name;
+        stats.m_Workers = stage->m_Workers;
+        stats.m_Items = stage->m_Items;
+        stats.m_Busy = std::chrono::nanoseconds(stage->m_BusyNs.load());
+        stats.m_Blocked = std::chrono::nanoseconds(stage->m_BlockedNs.load());
+        m_Stats.push_back(stats);
+    }
+
+    if (m_Error)
+        std::rethrow_exception(m_Error);
+}
+
+void CPipeline::work(TStage &stage, const TProcess &process)
+{
+    shared_ptr<CFile> file;
+
+    while (stage.m_Input.pop(file))
+    {
+        stage.m_InputDepth.set(stage.m_Input.size());
+
+        bool next = false;
+        auto busyStart = TClock::now();
+
+        try
+        {
+            next = process(file);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(m_ErrorMutex);
+            if (!m_Error)
+                m_Error = std::current_exception();
+        }
+
+        auto blockedStart = TClock::now();
+        stage.m_BusyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(blockedStart - busyStart).count();
+        stage.m_Items++;
+        stage.m_Duration.observe(std::chrono::duration<double>(blockedStart - busyStart).count());
+
+        // Send the file further, or mark it as done if it's the last stage or the file was dropped
+        if (next && stage.m_Output != nullptr && stage.m_Output->push(file))
+        {
+            stage.m_BlockedNs += std::chrono::duration_cast<std::chrono::nanoseconds>(TClock::now() - blockedStart).count();
+            stage.m_OutputDepth->set(stage.m_Output->size());
+        }
+        else
+            finish();
+
+        // Release the content before waiting for the next file
+        file.reset();
+    }
+
+    // The last worker of the stage closes the next queue
+    if (--stage.m_Alive == 0 && stage.m_Output != nullptr)
+        stage.m_Output->close();
+}
+
+void CPipeline::submit(shared_ptr<CFile> file)
+{
+    m_Pending++;
+
+    if (!m_Frontier.push(file))
+        finish();
+    else
+        m_FrontierDepth.set(m_Frontier.size());
+}
+
+CMetrics::CGauge &CPipeline::getQueueDepth(const string &stage)
+{
+    return CMetrics::getInstance().gauge("wget_queue_depth", "Files waiting for a pipeline stage", {{"stage", stage}});
+}
+
+void CPipeline::finish()
+{
+    if (--m_Pending == 0)
+        m_Frontier.close();
+}
+
+bool CPipeline::claim(const string &key)
+{
+    CInternTable::TId id = CInternTable::getInstance().intern(key);
+
+    std::lock_guard<std::mutex> lock(m_ClaimedMutex);
+    return m_Claimed.insert(id).second;
+}
+
+const vector<CPipeline::TStageStats> &CPipeline::getStats() const
+{
+    return m_Stats;
+}
+
+std::chrono::nanoseconds CPipeline::getWallTime() const
+{
+    return m_Wall;
+}
+
+void CPipeline::logStats() const
+{
+    if (!CLogger::getInstance().isEnabled(CLogger::ELogLevel::Info))
+        return;
+
+    const TStageStats *bottleneck = nullptr;
+
+    for (const auto &stats : m_Stats)
+    {
+        stringstream ss;
+        ss << std::fixed << std::setprecision(1)
+           << "Stage " << std::setw(7) << std::left << stats.m_Name
+           << " | workers: " << stats.m_Workers
+           << " | items: " << stats.m_Items
+           << " | busy: " << stats.getUtilization(m_Wall) * 100 << " %"
+           << " | blocked: " << stats.getBlockedRatio(m_Wall) * 100 << " %";
+
+        LOG_INFO(ss.str());
+
+        if (bottleneck == nullptr || stats.getUtilization(m_Wall) > bottleneck->getUtilization(m_Wall))
+            bottleneck = &stats;
+    }
+
+    if (bottleneck != nullptr)
+        LOG_INFO("Bottleneck stage: " + bottleneck->m_Name);
+}
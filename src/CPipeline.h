@@ -0,0 +1,229 @@
+/**
+ * @file CPipeline.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CPipeline
+ *
+ */
+
+#pragma once
+
+#include "CBoundedQueue.h"
+#include "CFile.h"
+#include "CInternTable.h"
+#include "CMetrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory> // shared_ptr<>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using std::string, std::shared_ptr, std::vector;
+
+/**
+ * @brief Crawl pipeline running the fetch, parse, rewrite and write stages of CFile on separate worker threads
+ *
+ * Stages are connected by bounded queues, so a slow stage blocks the stages before it instead of letting the
+ * downloaded content pile up in memory. Newly discovered files go back to the unbounded frontier, which holds
+ * only not yet fetched files without any content. Files found while the content is still being downloaded are
+ * submitted by the fetch stage, the rest by the parse stage.
+ *
+ */
+class CPipeline
+{
+public:
+    /**
+     * @brief Worker counts and queue size of the pipeline
+     *
+     */
+    struct TSettings
+    {
+        size_t m_FetchWorkers = 4;
+        size_t m_ParseWorkers = 1;
+        size_t m_RewriteWorkers = 1;
+        size_t m_WriteWorkers = 1;
+        size_t m_QueueSize = 16;
+    };
+
+    /**
+     * @brief Utilization metrics of one stage
+     *
+     */
+    struct TStageStats
+    {
+        string m_Name;
+        size_t m_Workers = 0;
+        size_t m_Items = 0;
+
+        /**
+         * @brief Time spent processing items, summed over all workers
+         *
+         */
+        std::chrono::nanoseconds m_Busy{0};
+
+        /**
+         * @brief Time spent waiting for the next stage to accept an item (backpressure), summed over all workers
+         *
+         */
+        std::chrono::nanoseconds m_Blocked{0};
+
+        /**
+         * @brief Get the ratio of busy time to the total available worker time
+         *
+         * @param wall Wall time of the whole run
+         * @return double Utilization between 0 and 1
+         */
+        double getUtilization(std::chrono::nanoseconds wall) const;
+
+        /**
+         * @brief Get the ratio of blocked time to the total available worker time
+         *
+         * @param wall Wall time of the whole run
+         * @return double Ratio between 0 and 1
+         */
+        double getBlockedRatio(std::chrono::nanoseconds wall) const;
+    };
+
+    /**
+     * @brief Construct a new CPipeline object
+     *
+     * @param settings Worker counts and queue size
+     */
+    explicit CPipeline(const TSettings &settings);
+
+    /**
+     * @brief Process the root file and recursively all files discovered from it, block until everything is done
+     *
+     * Rethrows the first exception thrown by any of the stages.
+     *
+     * @param root The first file to download
+     */
+    void run(shared_ptr<CFile> root);
+
+    /**
+     * @brief Get the stage metrics in the pipeline order (fetch, parse, rewrite, write)
+     *
+     * @return const vector<TStageStats>&
+     */
+    const vector<TStageStats> &getStats() const;
+
+    /**
+     * @brief Get the wall time of the last run
+     *
+     * @return std::chrono::nanoseconds
+     */
+    std::chrono::nanoseconds getWallTime() const;
+
+    /**
+     * @brief Log the per-stage utilization and the bottleneck stage
+     *
+     */
+    void logStats() const;
+
+private:
+    using TQueue = CBoundedQueue<shared_ptr<CFile>>;
+
+    /**
+     * @brief Runtime state of one stage shared by its workers
+     *
+     */
+    struct TStage
+    {
+        TStage(const string &name, size_t workers, TQueue &input, TQueue *output);
+
+        string m_Name;
+        size_t m_Workers;
+        TQueue &m_Input;
+        TQueue *m_Output;
+
+        CMetrics::CGauge &m_InputDepth;            // Depth of m_Input, labeled by this stage
+        CMetrics::CGauge *m_OutputDepth = nullptr; // Depth of m_Output, the input of the next stage
+        CMetrics::CHistogram &m_Duration;          // Processing time of each file
+
+        std::atomic<size_t> m_Alive{0};
+        std::atomic<size_t> m_Items{0};
+        std::atomic<long long> m_BusyNs{0};
+        std::atomic<long long> m_BlockedNs{0};
+    };
+
+    /**
+     * @brief Process function of a stage, returns true if the file should continue to the next stage
+     *
+     */
+    using TProcess = std::function<bool(shared_ptr<CFile> &)>;
+
+    TSettings m_Settings;
+
+    TQueue m_Frontier;
+    TQueue m_ParseQueue;
+    TQueue m_RewriteQueue;
+    TQueue m_WriteQueue;
+
+    /**
+     * @brief Number of submitted files that didn't leave the pipeline yet
+     *
+     */
+    std::atomic<size_t> m_Pending{0};
+
+    /**
+     * @brief Depth of m_Frontier, the input of the fetch stage
+     *
+     */
+    CMetrics::CGauge &m_FrontierDepth;
+
+    /**
+     * @brief Interned output files of fetched files
+     *
+     */
+    std::mutex m_ClaimedMutex;
+    std::unordered_set<CInternTable::TId> m_Claimed;
+
+    std::mutex m_ErrorMutex;
+    std::exception_ptr m_Error;
+
+    vector<TStageStats> m_Stats;
+    std::chrono::nanoseconds m_Wall{0};
+
+    /**
+     * @brief Insert file to the frontier
+     *
+     * @param file
+     */
+    void submit(shared_ptr<CFile> file);
+
+    /**
+     * @brief Get the gauge of the input queue of the stage
+     *
+     * @param stage
+     * @return CMetrics::CGauge&
+     */
+    static CMetrics::CGauge &getQueueDepth(const string &stage);
+
+    /**
+     * @brief Mark one file as done, close the frontier when nothing is left
+     *
+     */
+    void finish();
+
+    /**
+     * @brief Claim the output file, so no other worker downloads the same file again
+     *
+     * @param key Path to the output file, or the URL when archiving
+     * @return true If claimed by this call
+     * @return false If it was already claimed before
+     */
+    bool claim(const string &key);
+
+    /**
+     * @brief Worker loop of a stage, takes files from input queue until it's closed
+     *
+     * @param stage Stage of this worker
+     * @param process Process function of the stage
+     */
+    void work(TStage &stage, const TProcess &process);
+};
@@ -0,0 +1,47 @@
+/**
+ * @file CRegexRegistry.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CRegexRegistry
+ *
+ */
+
+#include "CRegexRegistry.h"
+
+#include <stdexcept>
+
+CRegexRegistry::CRegexRegistry()
+{
+    for (size_t i = 0; i < static_cast<size_t>(EPattern::COUNT); i++)
+    {
+        std::regex_constants::syntax_option_type flags;
+        string source = getSource(static_cast<EPattern>(i), flags);
+
+        m_Patterns.emplace_back(source, flags);
+    }
+}
+
+const regex &CRegexRegistry::get(EPattern pattern) const
+{
+    return m_Patterns.at(static_cast<size_t>(pattern));
+}
+
+string CRegexRegistry::getSource(EPattern pattern, std::regex_constants::syntax_option_type &flags)
+{
+    flags = std::regex_constants::ECMAScript | std::regex_constants::optimize;
+
+    switch (pattern)
+    {
+    case EPattern::HTTP_STATUS:
+        flags |= std::regex_constants::icase;
+        return "HTTP/\\d\\.\\d\\s+(\\d+)\\s+(.*)";
+
+    default:
+        throw std::invalid_argument("Unknown regex pattern!");
+    }
+}
+
+CRegexRegistry &CRegexRegistry::getInstance()
+{
+    static CRegexRegistry instance;
+    return instance;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file CRegexRegistry.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CRegexRegistry
+ *
+ */
+
+#pragma once
+
+#include <regex>
+#include <string>
+#include <vector>
+
+using std::string, std::vector, std::regex;
+
+/**
+ * @brief Registry singleton of precompiled regular expressions shared by all workers
+ *
+ * Every pattern is compiled once when the registry is first used, instead of on every call. The compiled
+ * expressions are only read afterwards, so they can be matched from many threads at the same time.
+ *
+ */
+class CRegexRegistry
+{
+public:
+    /**
+     * @brief Patterns in the registry
+     *
+     */
+    enum class EPattern
+    {
+        HTTP_STATUS, // Status line of the HTTP response, captures the code and the reason
+        COUNT
+    };
+
+    /**
+     * @brief Get the compiled pattern
+     *
+     * @param pattern
+     * @return const regex&
+     */
+    const regex &get(EPattern pattern) const;
+
+    /**
+     * @brief Get the source of the pattern and its flags
+     *
+     * @param pattern
+     * @param[out] flags
+     * @return string
+     */
+    static string getSource(EPattern pattern, std::regex_constants::syntax_option_type &flags);
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CRegexRegistry
+     *
+     * @return CRegexRegistry&
+     */
+    static CRegexRegistry &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CRegexRegistry being singleton
+     *
+     */
+    CRegexRegistry(const CRegexRegistry &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CRegexRegistry being singleton
+     *
+     */
+    void operator=(const CRegexRegistry &) = delete;
+
+private:
+    /**
+     * @brief Compile all patterns
+     *
+     */
+    CRegexRegistry();
+
+    /**
+     * @brief Compiled patterns indexed by EPattern
+     *
+     */
+    vector<regex> m_Patterns;
+};
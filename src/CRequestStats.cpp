@@ -0,0 +1,197 @@
+/**
+ * @file CRequestStats.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CRequestStats
+ *
+ */
+
+#include "CRequestStats.h"
+#include "CLogger.h"
+
+#include <algorithm> // sort
+#include <cmath>     // ceil
+#include <iomanip>
+#include <sstream>
+
+using std::stringstream;
+
+static const char *PHASE_NAMES[CRequestStats::PHASE_COUNT] = {"dns", "connect", "tls", "ttfb", "transfer", "total"};
+
+void CRequestStats::record(const CURLHandler &url, int statusCode, const CResponse::TTimings &timings)
+{
+    LOG_VERBOSE("Request timings: " + toJson(url.getNormURL(), statusCode, timings));
+
+    double durations[PHASE_COUNT] = {timings.getDns(), timings.getConnect(), timings.getTls(),
+                                     timings.getTtfb(), timings.getTransfer(), timings.getTotal()};
+
+    // Phases that were not reached are left out, instead of counting as zero
+    bool reached[PHASE_COUNT] = {timings.m_Resolved != CResponse::TTimings::TClock::time_point(),
+                                 timings.m_Connected != CResponse::TTimings::TClock::time_point(),
+                                 timings.m_Handshaked != CResponse::TTimings::TClock::time_point(),
+                                 timings.m_FirstByte != CResponse::TTimings::TClock::time_point(),
+                                 timings.m_FirstByte != CResponse::TTimings::TClock::time_point(),
+                                 true};
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (m_Log.is_open())
+        m_Log << toJson(url.getNormURL(), statusCode, timings) << '\n';
+
+    THostStats &host = m_Hosts[string(url.getDomain())];
+    host.m_Requests++;
+    host.m_Failed += statusCode == 0;
+    host.m_Bytes += timings.m_BytesReceived;
+    host.m_ResumedSessions += timings.m_SessionReused;
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+        if (reached[phase])
+            sample(host.m_Phases[phase], durations[phase]);
+}
+
+void CRequestStats::sample(TReservoir &reservoir, double duration)
+{
+    reservoir.m_Seen++;
+
+    if (reservoir.m_Samples.size() < RESERVOIR_SIZE)
+    {
+        reservoir.m_Samples.push_back(duration);
+        return;
+    }
+
+    // Every duration seen so far stays in the sample with the same probability
+    size_t index = std::uniform_int_distribution<size_t>(0, reservoir.m_Seen - 1)(m_Random);
+    if (index < RESERVOIR_SIZE)
+        reservoir.m_Samples[index] = duration;
+}
+
+void CRequestStats::logSummary() const
+{
+    if (!CLogger::getInstance().isEnabled(CLogger::ELogLevel::Info))
+        return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    for (const auto &[name, host] : m_Hosts)
+    {
+        stringstream ss;
+        ss << std::fixed << std::setprecision(1)
+           << "Host " << name
+           << " | requests: " << host.m_Requests;
+
+        if (host.m_Failed > 0)
+            ss << " (" << host.m_Failed << " failed)";
+
+        ss << " | received: " << host.m_Bytes / 1024 << " kB";
+
+        if (host.m_ResumedSessions > 0)
+            ss << " | resumed TLS sessions: " << host.m_ResumedSessions;
+
+        ss << " | p50/p90/p99 ms:";
+
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            vector<double> sorted = getSorted(host, static_cast<EPhase>(phase));
+
+            if (sorted.empty())
+                continue;
+
+            ss << " " << PHASE_NAMES[phase] << " "
+               << percentile(sorted, 50) << "/" << percentile(sorted, 90) << "/" << percentile(sorted, 99);
+        }
+
+        LOG_INFO(ss.str());
+    }
+}
+
+bool CRequestStats::openLog(const string &path)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_Log = std::ofstream(path, std::ios_base::out | std::ios_base::trunc);
+    return m_Log.is_open();
+}
+
+bool CRequestStats::closeLog()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (!m_Log.is_open())
+        return true;
+
+    m_Log.close();
+    return !m_Log.fail();
+}
+
+size_t CRequestStats::getRequests(const string &host) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto it = m_Hosts.find(host);
+    return it == m_Hosts.end() ? 0 : it->second.m_Requests;
+}
+
+double CRequestStats::getPercentile(const string &host, EPhase phase, double value) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    auto it = m_Hosts.find(host);
+    if (it == m_Hosts.end())
+        return 0;
+
+    return percentile(getSorted(it->second, phase), value);
+}
+
+void CRequestStats::clear()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Hosts.clear();
+}
+
+vector<double> CRequestStats::getSorted(const THostStats &host, EPhase phase) const
+{
+    vector<double> sorted = host.m_Phases[phase].m_Samples;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+double CRequestStats::percentile(const vector<double> &values, double percentile)
+{
+    if (values.empty())
+        return 0;
+
+    // Nearest rank, the smallest value with at least the percentile of values below or equal to it
+    size_t rank = static_cast<size_t>(std::ceil(percentile / 100 * values.size()));
+    return values[std::min(std::max<size_t>(rank, 1), values.size()) - 1];
+}
+
+string CRequestStats::toJson(const string &url, int statusCode, const CResponse::TTimings &timings)
+{
+    stringstream ss;
+    ss << std::fixed << std::setprecision(3) << "{\"url\":\"";
+
+    for (char c : url)
+    {
+        if (c == '"' || c == '\\')
+            ss << '\\';
+        ss << c;
+    }
+
+    ss << "\",\"status\":" << statusCode
+       << ",\"dns_ms\":" << timings.getDns()
+       << ",\"connect_ms\":" << timings.getConnect()
+       << ",\"tls_ms\":" << timings.getTls()
+       << ",\"ttfb_ms\":" << timings.getTtfb()
+       << ",\"transfer_ms\":" << timings.getTransfer()
+       << ",\"total_ms\":" << timings.getTotal()
+       << ",\"bytes\":" << timings.m_BytesReceived
+       << ",\"connection_reused\":" << (timings.m_ConnectionReused ? "true" : "false")
+       << ",\"session_reused\":" << (timings.m_SessionReused ? "true" : "false") << "}";
+
+    return ss.str();
+}
+
+CRequestStats &CRequestStats::getInstance()
+{
+    static CRequestStats instance;
+    return instance;
+}
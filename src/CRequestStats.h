@@ -0,0 +1,199 @@
+/**
+ * @file CRequestStats.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CRequestStats
+ *
+ */
+
+#pragma once
+
+#include "CResponse.h"
+#include "CURLHandler.h"
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+using std::string, std::vector;
+
+/**
+ * @brief Singleton collecting the phase timings of all requests, writes every request as a JSON line into the
+ * request log (if open) and summarizes the percentiles of each phase per host at the end of the run
+ *
+ * The percentiles are computed from a bounded reservoir sample of every phase, exact until the reservoir is full.
+ *
+ */
+class CRequestStats
+{
+public:
+    /**
+     * @brief Phases of a request, in the order they happen
+     *
+     */
+    enum EPhase
+    {
+        DNS,
+        CONNECT,
+        TLS,
+        TTFB,
+        TRANSFER,
+        TOTAL,
+        PHASE_COUNT
+    };
+
+    /**
+     * @brief Record the finished (or failed) request
+     *
+     * @param url Requested URL
+     * @param statusCode HTTP status code, 0 if no response was received
+     * @param timings
+     */
+    void record(const CURLHandler &url, int statusCode, const CResponse::TTimings &timings);
+
+    /**
+     * @brief Log the percentiles of every phase for every host
+     *
+     */
+    void logSummary() const;
+
+    /**
+     * @brief Start writing every recorded request into the file, one JSON object per line
+     *
+     * @param path
+     * @return true
+     * @return false If the file can't be opened
+     */
+    bool openLog(const string &path);
+
+    /**
+     * @brief Stop writing the requests and close the file
+     *
+     * @return true
+     * @return false If any of the records couldn't be written
+     */
+    bool closeLog();
+
+    /**
+     * @brief Get the number of recorded requests of the host
+     *
+     * @param host Domain with the port
+     * @return size_t
+     */
+    size_t getRequests(const string &host) const;
+
+    /**
+     * @brief Get the percentile of the phase durations of the host
+     *
+     * @param host Domain with the port
+     * @param phase
+     * @param percentile 0 to 100
+     * @return double Milliseconds
+     */
+    double getPercentile(const string &host, EPhase phase, double percentile) const;
+
+    /**
+     * @brief Remove all recorded requests (the request log stays open)
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Get the nearest-rank percentile of the values
+     *
+     * @param values Sorted values
+     * @param percentile 0 to 100
+     * @return double 0 if there are no values
+     */
+    static double percentile(const vector<double> &values, double percentile);
+
+    /**
+     * @brief Format the request as a single line JSON object
+     *
+     * @param url
+     * @param statusCode
+     * @param timings
+     * @return string
+     */
+    static string toJson(const string &url, int statusCode, const CResponse::TTimings &timings);
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CRequestStats
+     *
+     * @return CRequestStats&
+     */
+    static CRequestStats &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CRequestStats being singleton
+     *
+     */
+    CRequestStats(const CRequestStats &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CRequestStats being singleton
+     *
+     */
+    void operator=(const CRequestStats &) = delete;
+
+private:
+    CRequestStats() = default;
+
+    /**
+     * @brief Uniform sample of the durations of one phase, keeps at most RESERVOIR_SIZE of them
+     *
+     */
+    struct TReservoir
+    {
+        vector<double> m_Samples; // Milliseconds
+        size_t m_Seen = 0;
+    };
+
+    /**
+     * @brief Durations of all requests of one host
+     *
+     */
+    struct THostStats
+    {
+        size_t m_Requests = 0;
+        size_t m_Failed = 0; // No response received
+        size_t m_Bytes = 0;
+        size_t m_ResumedSessions = 0;
+        TReservoir m_Phases[PHASE_COUNT]; // Only of the requests that reached the phase
+    };
+
+    static constexpr size_t RESERVOIR_SIZE = 1024;
+
+    mutable std::mutex m_Mutex;
+
+    std::minstd_rand m_Random;
+    std::ofstream m_Log;
+
+    /**
+     * @brief Stats by the host, ordered for the summary
+     *
+     */
+    std::map<string, THostStats> m_Hosts;
+
+    /**
+     * @brief Add the duration to the reservoir, replacing a random sample once it's full
+     *
+     * @param reservoir
+     * @param duration
+     */
+    void sample(TReservoir &reservoir, double duration);
+
+    /**
+     * @brief Get the sampled durations of the phase sorted
+     *
+     * @param host
+     * @param phase
+     * @return vector<double>
+     */
+    vector<double> getSorted(const THostStats &host, EPhase phase) const;
+};
@@ -1,55 +1,210 @@
-#include <sstream>
-
 #include "CResponse.h"
-#include "Utils.h"
 #include "CLogger.h"
-#include "CConfig.h"
+#include "CDirectoryCache.h"
+#include "CFile.h"
+#include "CURLParser.h"
 
 #include <iostream>
 #include <iomanip>
+#include <filesystem>
 
-using std::stringstream;
+namespace fs = std::filesystem;
 
 CResponse::CResponse(EStatus status)
     : m_Status(status) {}
 
-void CResponse::setMovedUrl(const string &location, CURLHandler currentUrl)
+const char *CResponse::getStatusName(EStatus status)
 {
-    string newLocation = location;
+    switch (status)
+    {
+    case EStatus::FINISHED:
+        return "finished";
+    case EStatus::IN_PROGRESS:
+        return "in_progress";
+    case EStatus::MOVED:
+        return "moved";
+    case EStatus::TIMED_OUT:
+        return "timed_out";
+    case EStatus::CONN_ERROR:
+        return "conn_error";
+    case EStatus::SERVER_ERROR:
+        return "server_error";
+    case EStatus::OVER_BUDGET:
+        return "over_budget";
+    }
 
-    if (m_StatusCode == 301)
-        CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "301 Moved Permanently - New location: " + newLocation);
+    return "unknown";
+}
 
-    else if (m_StatusCode == 302)
-    {
-        CLogger::getInstance().log(CLogger::ELogLevel::Verbose, "302 Found - New location: " + newLocation);
+double CResponse::TTimings::getMs(TClock::time_point from, TClock::time_point to)
+{
+    if (from == TClock::time_point() || to == TClock::time_point())
+        return 0;
 
-        // If the URL is not full, but only relative to domain, prepend it with domain
-        if (Utils::startsWith(newLocation, "/"))
-        {
-            stringstream ss;
-            if (currentUrl.isHttps())
-                ss << "https://";
-            else
-                ss << "http://";
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
 
-            ss << currentUrl.getDomain();
-            ss << location;
+double CResponse::TTimings::getDns() const
+{
+    return getMs(m_Start, m_Resolved);
+}
 
-            newLocation = ss.str();
-        }
+double CResponse::TTimings::getConnect() const
+{
+    return getMs(m_Resolved, m_Connected);
+}
 
-        else
-            newLocation = location;
-    }
+double CResponse::TTimings::getTls() const
+{
+    return getMs(m_Connected, m_Handshaked);
+}
+
+double CResponse::TTimings::getTtfb() const
+{
+    return getMs(m_RequestSent, m_FirstByte);
+}
+
+double CResponse::TTimings::getTransfer() const
+{
+    return getMs(m_FirstByte, m_Finished);
+}
+
+double CResponse::TTimings::getTotal() const
+{
+    return getMs(m_Start, m_Finished);
+}
+
+void CResponse::setMovedUrl(const string &location, CURLHandler currentUrl)
+{
+    if (m_StatusCode == 301)
+        LOG_VERBOSE("301 Moved Permanently - New location: " + location);
+
+    else if (m_StatusCode == 302)
+        LOG_VERBOSE("302 Found - New location: " + location);
+
+    // The location may be relative to the current URL
+    string newLocation = CURLParser::resolve(currentUrl.getNormURL(), location);
 
     CURLHandler newUrl(newLocation);
 
-    if (CURLHandler(static_cast<string>(CConfig::getInstance()["url"])).getDomainNorm() != newUrl.getDomainNorm())
+    if (CFile::getRootUrl().getDomainNorm() != newUrl.getDomainNorm())
         newUrl.setExternal(true);
     else
         newUrl.setExternal(currentUrl.isExternal());
 
     m_MovedUrl = newUrl;
     m_Status = EStatus::MOVED;
+}
+
+void CResponse::setSpillFile(const string &path)
+{
+    m_SpillFile = path;
+}
+
+void CResponse::discardBody()
+{
+    m_Discarded = true;
+}
+
+void CResponse::reserveBody(size_t length)
+{
+    if (m_Discarded)
+        return;
+
+    if (m_SpillFile.empty())
+        m_Reservation.acquire(length);
+
+    else if (!m_Reservation.tryAcquire(length))
+    {
+        startSpill();
+        return;
+    }
+
+    // The whole reserved body fits into the buffer without growing
+    m_Body.reserve(length);
+}
+
+void CResponse::appendBody(const string &data)
+{
+    m_BodyLength += data.length();
+
+    if (m_Discarded || m_OverBudget)
+        return;
+
+    if (m_Spilled)
+    {
+        m_Spill.write(data.data(), data.length());
+        return;
+    }
+
+    // Charge only the part not covered by the reservation
+    size_t needed = m_Body.length() + data.length();
+
+    if (needed > m_Reservation.size())
+    {
+        needed -= m_Reservation.size();
+
+        // Content that has to stay in memory is not buffered over the budget, the request is repeated later
+        if (m_SpillFile.empty())
+        {
+            if (!m_Reservation.tryExtend(needed))
+            {
+                LOG_VERBOSE("Memory budget exhausted, dropping the body after " + std::to_string(m_BodyLength) + " B");
+
+                m_OverBudget = true;
+                string().swap(m_Body);
+                m_Reservation.release();
+                return;
+            }
+        }
+
+        else if (!m_Reservation.tryAcquire(needed))
+        {
+            startSpill();
+            m_Spill.write(data.data(), data.length());
+            return;
+        }
+    }
+
+    m_Body += data;
+}
+
+void CResponse::finishBody()
+{
+    if (m_Spilled)
+        m_Spill.close();
+
+    // The reservation may have been larger than the body (eg. expected length of a repeated request)
+    else if (!m_Discarded)
+        m_Reservation.shrink(m_Body.length());
+}
+
+size_t CResponse::getBodyLength() const
+{
+    return m_BodyLength;
+}
+
+bool CResponse::isSpilled() const
+{
+    return m_Spilled;
+}
+
+bool CResponse::isOverBudget() const
+{
+    return m_OverBudget;
+}
+
+void CResponse::startSpill()
+{
+    LOG_VERBOSE("Memory budget exhausted, streaming to disk: " + m_SpillFile);
+
+    CDirectoryCache::getInstance().create(fs::path(m_SpillFile).parent_path());
+
+    m_Spill = ofstream(m_SpillFile, std::ios_base::out | std::ios_base::binary);
+    m_Spill.write(m_Body.data(), m_Body.length());
+    m_Spilled = true;
+
+    // Free the buffered part
+    string().swap(m_Body);
+    m_Reservation.release();
 }
\ No newline at end of file
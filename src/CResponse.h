@@ -8,10 +8,13 @@
 #pragma once
 
 #include "CURLHandler.h"
+#include "CMemoryBudget.h"
 
+#include <chrono>
+#include <fstream>
 #include <string>
 
-using std::string;
+using std::string, std::ofstream;
 
 /**
  * @brief Http Response class containing header info, content and status
@@ -31,7 +34,45 @@ public:
         MOVED,
         TIMED_OUT,
         CONN_ERROR,
-        SERVER_ERROR
+        SERVER_ERROR,
+        OVER_BUDGET // Body didn't fit into the memory budget and was not received whole, the request has to be repeated
+    };
+
+    /**
+     * @brief Timestamps of the request phases, a phase that was not reached has an unset (zero) timestamp
+     *
+     */
+    struct TTimings
+    {
+        using TClock = std::chrono::steady_clock;
+
+        TClock::time_point m_Start;       // get() was called
+        TClock::time_point m_Resolved;    // DNS lookup is done
+        TClock::time_point m_Connected;   // TCP connection is established
+        TClock::time_point m_Handshaked;  // TLS handshake and certificate check are done (HTTPS only)
+        TClock::time_point m_RequestSent; // Request is written
+        TClock::time_point m_FirstByte;   // First data of the response arrived
+        TClock::time_point m_Finished;    // Whole response is received, or the request failed
+
+        size_t m_BytesReceived = 0;     // Header and body
+        bool m_ConnectionReused = false; // Always false with "Connection: close"
+        bool m_SessionReused = false;    // TLS session was resumed
+
+        /**
+         * @brief Get the milliseconds between the timestamps, 0 if one of them is unset
+         *
+         * @param from
+         * @param to
+         * @return double
+         */
+        static double getMs(TClock::time_point from, TClock::time_point to);
+
+        double getDns() const;
+        double getConnect() const;
+        double getTls() const;
+        double getTtfb() const; // From the sent request to the first byte, the server think time
+        double getTransfer() const;
+        double getTotal() const;
     };
 
     /**
@@ -47,6 +88,14 @@ public:
      */
     explicit CResponse(EStatus status);
 
+    /**
+     * @brief Get the name of the status, eg. for metrics labels
+     *
+     * @param status
+     * @return const char*
+     */
+    static const char *getStatusName(EStatus status);
+
     /**
      * @brief Set next moved URL
      *
@@ -55,11 +104,92 @@ public:
      */
     void setMovedUrl(const string &location, CURLHandler currentUrl);
 
+    /**
+     * @brief Allow the body to be streamed directly to a file when it doesn't fit into the memory budget
+     *
+     * @param path Path to the file, its folder structure is created when needed
+     */
+    void setSpillFile(const string &path);
+
+    /**
+     * @brief Don't store the body at all, only count its length (eg. when it's only archived)
+     *
+     */
+    void discardBody();
+
+    /**
+     * @brief Reserve memory budget for the whole body of known length
+     *
+     * Waits for the budget if the body can't be streamed to a file, otherwise starts streaming if the budget is exhausted.
+     *
+     * @param length Expected body length
+     */
+    void reserveBody(size_t length);
+
+    /**
+     * @brief Append received data to the body, or to the spill file if streaming
+     *
+     * Body that can't be streamed and outgrows the memory budget is dropped, see isOverBudget().
+     *
+     * @param data
+     */
+    void appendBody(const string &data);
+
+    /**
+     * @brief Close the spill file after all data is received, return the unused part of the reservation
+     *
+     */
+    void finishBody();
+
+    /**
+     * @brief Get the number of received body bytes, including the streamed ones
+     *
+     * @return size_t
+     */
+    size_t getBodyLength() const;
+
+    /**
+     * @brief Returns true if the body was streamed to the spill file instead of m_Body
+     *
+     * @return true
+     * @return false
+     */
+    bool isSpilled() const;
+
+    /**
+     * @brief Returns true if the body outgrew the memory budget and was dropped, the rest of it doesn't have to be received
+     *
+     * @return true
+     * @return false
+     */
+    bool isOverBudget() const;
+
     CURLHandler m_MovedUrl;
     EStatus m_Status = EStatus::IN_PROGRESS;
     int m_ContentLength = -1;
-    int m_StatusCode;
+    int m_StatusCode = 0;
     string m_ContentType;
     string m_ContentDisposition;
     string m_Body;
+    TTimings m_Timings;
+
+    /**
+     * @brief Memory budget reserved for m_Body
+     *
+     */
+    CMemoryBudget::TReservation m_Reservation;
+
+private:
+    string m_SpillFile;
+    ofstream m_Spill;
+    bool m_Spilled = false;
+    bool m_Discarded = false;
+    bool m_OverBudget = false;
+    size_t m_BodyLength = 0;
+
+    /**
+     * @brief Move the buffered body to the spill file and stream all next data there
+     *
+     */
+    void startSpill();
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+/**
+ * @file CThreadPoolWriter.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CThreadPoolWriter
+ *
+ */
+
+#include "CThreadPoolWriter.h"
+
+#include <algorithm> // max
+
+CThreadPoolWriter::CThreadPoolWriter(size_t threads)
+    : m_Queue(64)
+{
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); i++)
+        m_Threads.emplace_back(&CThreadPoolWriter::work, this);
+}
+
+CThreadPoolWriter::~CThreadPoolWriter()
+{
+    m_Queue.close();
+
+    for (auto &t : m_Threads)
+        t.join();
+}
+
+void CThreadPoolWriter::submit(TRequest &&request)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Pending++;
+    }
+
+    m_Queue.push(std::move(request));
+}
+
+void CThreadPoolWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this]
+                { return m_Pending == 0; });
+}
+
+string CThreadPoolWriter::getName() const
+{
+    return "pool";
+}
+
+void CThreadPoolWriter::work()
+{
+    TRequest request;
+
+    while (m_Queue.pop(request))
+    {
+        COutputWriter::submit(std::move(request));
+        request = TRequest();
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (--m_Pending == 0)
+            m_Idle.notify_all();
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file CThreadPoolWriter.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CThreadPoolWriter
+ *
+ */
+
+#pragma once
+
+#include "COutputWriter.h"
+#include "CBoundedQueue.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @brief Output backend writing files on a pool of background threads
+ *
+ */
+class CThreadPoolWriter : public COutputWriter
+{
+public:
+    /**
+     * @brief Construct a new CThreadPoolWriter object and start the threads
+     *
+     * @param threads Number of threads
+     */
+    explicit CThreadPoolWriter(size_t threads);
+
+    /**
+     * @brief Write the remaining files and stop the threads
+     *
+     */
+    virtual ~CThreadPoolWriter();
+
+    /**
+     * @brief Queue the file to be written, block while too many files are waiting
+     *
+     * @param request
+     */
+    virtual void submit(TRequest &&request) override;
+
+    /**
+     * @brief Wait until all submitted files are written
+     *
+     */
+    virtual void flush() override;
+
+    /**
+     * @brief Get the name of the backend
+     *
+     * @return string
+     */
+    virtual string getName() const override;
+
+private:
+    CBoundedQueue<TRequest> m_Queue;
+    vector<std::thread> m_Threads;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Idle;
+    size_t m_Pending = 0;
+
+    /**
+     * @brief Thread loop, writes files until the queue is closed
+     *
+     */
+    void work();
+};
@@ -0,0 +1,204 @@
+/**
+ * @file CTracer.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CTracer
+ *
+ */
+
+#include "CTracer.h"
+
+#include <cstdio> // snprintf
+#include <fstream>
+#include <utility> // move
+
+// ============ CSpan ============
+
+CTracer::CSpan::CSpan(const char *name, const char *category, const string &url)
+    : m_Name(name),
+      m_Category(category),
+      m_Enabled(CTracer::getInstance().isEnabled())
+{
+    if (!m_Enabled)
+        return;
+
+    m_Url = url;
+    m_Start = TClock::now();
+}
+
+CTracer::CSpan::~CSpan()
+{
+    if (m_Enabled)
+        CTracer::getInstance().addSpan(m_Name, m_Category, m_Start, TClock::now(), std::move(m_Url));
+}
+
+// ============ CTracer ============
+
+void CTracer::start(const string &path)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    for (auto &buffer : m_Buffers)
+    {
+        std::lock_guard<std::mutex> bufferLock(buffer->m_Mutex);
+        buffer->m_Events.clear();
+    }
+
+    m_Path = path;
+    m_Origin = TClock::now();
+    m_Enabled = true;
+}
+
+bool CTracer::stop()
+{
+    if (!m_Enabled.exchange(false))
+        return false;
+
+    std::ofstream file(m_Path, std::ios::binary | std::ios::trunc);
+    file << render();
+
+    return file.good();
+}
+
+bool CTracer::isEnabled() const
+{
+    return m_Enabled.load(std::memory_order_relaxed);
+}
+
+void CTracer::setThreadName(const string &name)
+{
+    if (!isEnabled())
+        return;
+
+    TBuffer &buffer = getBuffer();
+
+    std::lock_guard<std::mutex> lock(buffer.m_Mutex);
+    buffer.m_ThreadName = name;
+}
+
+void CTracer::addSpan(const char *name, const char *category, TClock::time_point start, TClock::time_point end, string url)
+{
+    if (!isEnabled())
+        return;
+
+    TBuffer &buffer = getBuffer();
+
+    std::lock_guard<std::mutex> lock(buffer.m_Mutex);
+    buffer.m_Events.push_back({name, category, start, end, std::move(url)});
+}
+
+size_t CTracer::getSpans() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    size_t spans = 0;
+    for (const auto &buffer : m_Buffers)
+    {
+        std::lock_guard<std::mutex> bufferLock(buffer->m_Mutex);
+        spans += buffer->m_Events.size();
+    }
+
+    return spans;
+}
+
+string CTracer::render() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Formatted by hand, a trace has thousands of events and a stream is several times slower
+    string json = "{\"traceEvents\":[";
+    char numbers[128];
+
+    auto separate = [&]()
+    {
+        if (json.back() != '[')
+            json += ",\n";
+    };
+
+    // Microseconds since start()
+    auto toUs = [this](TClock::time_point time)
+    {
+        return std::chrono::duration<double, std::micro>(time - m_Origin).count();
+    };
+
+    for (const auto &buffer : m_Buffers)
+    {
+        std::lock_guard<std::mutex> bufferLock(buffer->m_Mutex);
+
+        // Threads that ended before start()
+        if (buffer->m_Events.empty())
+            continue;
+
+        string tid = std::to_string(buffer->m_Tid);
+
+        if (!buffer->m_ThreadName.empty())
+        {
+            separate();
+            json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + tid +
+                    ",\"args\":{\"name\":\"" + escape(buffer->m_ThreadName) + "\"}}";
+        }
+
+        for (const auto &event : buffer->m_Events)
+        {
+            separate();
+            snprintf(numbers, sizeof(numbers), ",\"ts\":%.3f,\"dur\":%.3f",
+                     toUs(event.m_Start), toUs(event.m_End) - toUs(event.m_Start));
+
+            json += "{\"name\":\"";
+            json += event.m_Name;
+            json += "\",\"cat\":\"";
+            json += event.m_Category;
+            json += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid;
+            json += numbers;
+            json += ",\"args\":{\"url\":\"" + escape(event.m_Url) + "\"}}";
+        }
+    }
+
+    json += "],\"displayTimeUnit\":\"ms\"}\n";
+
+    return json;
+}
+
+CTracer::TBuffer &CTracer::getBuffer()
+{
+    // Cached per thread, the buffers are never removed
+    thread_local TBuffer *buffer = nullptr;
+
+    if (buffer == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        m_Buffers.push_back(std::make_unique<TBuffer>());
+        buffer = m_Buffers.back().get();
+        buffer->m_Tid = m_Buffers.size();
+    }
+
+    return *buffer;
+}
+
+string CTracer::escape(const string &text)
+{
+    string escaped;
+
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+
+        if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        }
+        else
+            escaped += c;
+    }
+
+    return escaped;
+}
+
+CTracer &CTracer::getInstance()
+{
+    static CTracer instance;
+    return instance;
+}
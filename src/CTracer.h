@@ -0,0 +1,196 @@
+/**
+ * @file CTracer.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CTracer
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory> // unique_ptr<>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string, std::vector;
+
+/**
+ * @brief Singleton recording spans of the crawl (request phases and pipeline stages) and writing them as Chrome trace
+ * events, viewable in chrome://tracing or Perfetto
+ *
+ * Every thread appends to its own buffer, so recording doesn't contend with other threads. When tracing is not
+ * started, a span only checks one flag.
+ *
+ */
+class CTracer
+{
+public:
+    using TClock = std::chrono::steady_clock;
+
+    /**
+     * @brief Span measured from the construction to the destruction
+     *
+     */
+    class CSpan
+    {
+    public:
+        /**
+         * @brief Start the span if tracing is enabled
+         *
+         * @param name Static string, eg. "parse"
+         * @param category Static string, eg. "pipeline"
+         * @param url URL the span works on
+         */
+        CSpan(const char *name, const char *category, const string &url);
+
+        /**
+         * @brief Record the span
+         *
+         */
+        ~CSpan();
+
+        CSpan(const CSpan &) = delete;
+        void operator=(const CSpan &) = delete;
+
+    private:
+        const char *m_Name;
+        const char *m_Category;
+        bool m_Enabled;
+        TClock::time_point m_Start;
+        string m_Url;
+    };
+
+    /**
+     * @brief Start recording, the trace is written into the file by stop()
+     *
+     * @param path
+     */
+    void start(const string &path);
+
+    /**
+     * @brief Stop recording and write the trace file
+     *
+     * @return true If written
+     * @return false If the file can't be written
+     */
+    bool stop();
+
+    /**
+     * @brief Returns true if the spans are recorded
+     *
+     * @return true
+     * @return false
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Name the calling thread in the trace, eg. "fetch 2"
+     *
+     * @param name
+     */
+    void setThreadName(const string &name);
+
+    /**
+     * @brief Record the span of the calling thread, if tracing is enabled
+     *
+     * @param name Static string
+     * @param category Static string
+     * @param start
+     * @param end
+     * @param url
+     */
+    void addSpan(const char *name, const char *category, TClock::time_point start, TClock::time_point end, string url);
+
+    /**
+     * @brief Get the number of spans recorded since start()
+     *
+     * @return size_t
+     */
+    size_t getSpans() const;
+
+    /**
+     * @brief Render the recorded spans as a Chrome trace JSON object
+     *
+     * @return string
+     */
+    string render() const;
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CTracer
+     *
+     * @return CTracer&
+     */
+    static CTracer &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CTracer being singleton
+     *
+     */
+    CTracer(const CTracer &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CTracer being singleton
+     *
+     */
+    void operator=(const CTracer &) = delete;
+
+private:
+    CTracer() = default;
+
+    /**
+     * @brief Recorded span
+     *
+     */
+    struct TEvent
+    {
+        const char *m_Name;
+        const char *m_Category;
+        TClock::time_point m_Start;
+        TClock::time_point m_End;
+        string m_Url;
+    };
+
+    /**
+     * @brief Spans of one thread, the mutex is only contended while the trace is rendered
+     *
+     */
+    struct TBuffer
+    {
+        size_t m_Tid;
+        string m_ThreadName;
+        vector<TEvent> m_Events;
+        std::mutex m_Mutex;
+    };
+
+    std::atomic<bool> m_Enabled{false};
+    string m_Path;
+    TClock::time_point m_Origin;
+
+    /**
+     * @brief Buffers of all threads that recorded something, they are kept (only emptied) so the cached pointers
+     * of the threads stay valid
+     *
+     */
+    vector<std::unique_ptr<TBuffer>> m_Buffers;
+    mutable std::mutex m_Mutex;
+
+    /**
+     * @brief Get the buffer of the calling thread, created on the first use
+     *
+     * @return TBuffer&
+     */
+    TBuffer &getBuffer();
+
+    /**
+     * @brief Escape the text for a JSON string
+     *
+     * @param text
+     * @return string
+     */
+    static string escape(const string &text);
+};
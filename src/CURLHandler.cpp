@@ -5,178 +5,222 @@
  */
 
 #include "CURLHandler.h"
-#include "Utils.h"
-#include "CLogger.h"
+#include "CURLParser.h"
 
-using std::regex, std::smatch, std::cout, std::endl, std::stringstream;
+#include <algorithm> // min, max
+#include <cctype>    // tolower
+
+// Compare the beginning of the text with the lowercase prefix, ignoring case
+static bool startsWithNoCase(string_view text, string_view prefix)
+{
+    if (text.length() < prefix.length())
+        return false;
+
+    for (size_t i = 0; i < prefix.length(); i++)
+        if (std::tolower(static_cast<unsigned char>(text[i])) != prefix[i])
+            return false;
+
+    return true;
+}
+
+CURLHandler::CURLHandler()
+    : m_DomainId(CInternTable::getInstance().intern("")) {}
 
 CURLHandler::CURLHandler(const string &url, bool isExternal)
     : m_IsExternal(isExternal)
 {
-    regex re("((?:http://|https://)?[^/]*)/?(.*)");
-    smatch result;
+    // Without the protocol, the URL starts with the domain (eg. "localhost:8080/index.html")
+    string withProtocol;
+    string_view source = url;
 
-    if (!regex_match(url, result, re))
+    if (!startsWithNoCase(url, "http://") && !startsWithNoCase(url, "https://"))
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, "Failed to parse URL: " + url + "!");
-        return;
+        withProtocol = "http://" + url;
+        source = withProtocol;
     }
 
-    setDomain(result[1].str());
-    addPath(result[2].str());
+    auto components = CURLParser::parse(source);
+    m_IsHttps = components.m_Scheme.length() == string_view("https").length();
+
+    // Domain includes the port, unless it's the default one, the user info is not used
+    string_view domain = components.m_Host;
+    if (!components.m_Port.empty() && components.m_Port != CURLParser::getDefaultPort(m_IsHttps ? "https" : "http"))
+        domain = string_view(components.m_Host.data(), components.m_Host.length() + 1 + components.m_Port.length());
+
+    // Room for the slashes added by the normalization, so the path is normalized without reallocating
+    setDomain(domain, source.length() + 2);
+    addPath(components.m_Path);
+
+    if (components.m_HasQuery)
+    {
+        size_t queryStart = m_Url.length();
+
+        m_Url += '?';
+        CURLParser::appendNormalized(m_Url, components.m_Query);
+        m_QueryLength = m_Url.length() - queryStart;
+    }
 }
 
-void CURLHandler::setDomain(const string &urlDomain)
+void CURLHandler::setDomain(string_view urlDomain)
 {
-    // Transform the input to all lower case
-    string tmpUrl = Utils::toLowerCase(urlDomain);
+    setDomain(urlDomain, 0);
+}
 
-    // Check domain starts with https:// and remove it
-    if (tmpUrl.rfind("https://", 0) == 0)
+void CURLHandler::setDomain(string_view urlDomain, size_t capacity)
+{
+    // Check domain starts with https:// or http:// and remove it
+    if (startsWithNoCase(urlDomain, "https://"))
     {
         m_IsHttps = true;
-        tmpUrl = tmpUrl.substr(string("https://").size(), tmpUrl.length());
+        urlDomain.remove_prefix(8);
     }
-
-    // Check domain starts with http:// and remove it
-    else if (tmpUrl.rfind("http://", 0) == 0)
+    else if (startsWithNoCase(urlDomain, "http://"))
     {
         m_IsHttps = false;
-        tmpUrl = tmpUrl.substr(string("http://").size(), tmpUrl.length());
+        urlDomain.remove_prefix(7);
     }
 
     // Remove trailing slash if present
-    if (tmpUrl.rfind("/") == tmpUrl.size() - string("/").size())
-    {
-        tmpUrl = tmpUrl.substr(0, tmpUrl.size() - 1);
-    }
+    if (!urlDomain.empty() && urlDomain.back() == '/')
+        urlDomain.remove_suffix(1);
 
-    m_Domain = tmpUrl;
-}
+    string_view protocol = m_IsHttps ? "https://" : "http://";
+    string_view path = string_view(m_Url).substr(m_PathStart);
 
-void CURLHandler::addPath(const string &path)
-{
-    // cout << "Adding path: " << path << endl;
-    string delimiter = "/";
+    // The domain may be a view into the current URL, so the new one is built aside
+    string url;
+    url.reserve(std::max(capacity, protocol.length() + urlDomain.length() + 1 + path.length()));
 
-    // If path starts with /, it's relative to the base domain
-    if (Utils::startsWith(path, delimiter))
-        m_PathLevels.clear();
+    url += protocol;
 
-    // If the path doesn't end with trailing slash, don't add it later with normalization
-    if (!Utils::endsWith(path, delimiter))
-        m_HasTrailingSlash = false;
-
-    auto start = 0U;
-    auto end = path.find(delimiter);
-
-    while (end != string::npos)
-    {
-        // Get current level
-        string level = path.substr(start, end - start);
+    // Transform the domain to all lower case
+    size_t domainStart = url.length();
+    CURLParser::appendNormalized(url, urlDomain, true);
+    size_t domainEnd = url.length();
 
-        // Add level to vector
-        m_PathLevels.push_back(level);
+    url += '/';
+    url += path;
 
-        // Get new delimiter position
-        start = end + delimiter.length();
-        end = path.find(delimiter, start);
-    }
+    m_DomainStart = domainStart;
+    m_PathStart = domainEnd + 1;
+    m_Url.swap(url);
 
-    // Add also the last level to vector
-    string level = path.substr(start, end - start);
-    m_PathLevels.push_back(level);
+    m_DomainId = CInternTable::getInstance().intern(getDomain());
 }
 
-string CURLHandler::getNormFilePath() const
+void CURLHandler::addPath(string_view path)
 {
-    vector<string> tempPath = getNormalizedLevels();
-
-    // Build the final normalized path
-    stringstream path;
-
-    // Add every level separate by slash
-    size_t tempPathSize = tempPath.size();
-    for (size_t i = 0; i < tempPathSize; i++)
+    // The query belongs to the previous path
+    if (m_QueryLength > 0)
     {
-        path << tempPath[i];
+        m_Url.resize(m_Url.length() - m_QueryLength);
+        m_QueryLength = 0;
+    }
 
-        // Don't include trailing slash after the last element if its a file (contains dot)
-        if (i != tempPathSize - 1 || tempPath[i].find('.') == string::npos)
-            path << "/";
+    // If path starts with /, it's relative to the base domain
+    if (!path.empty() && path.front() == '/')
+    {
+        m_Url.resize(m_PathStart);
+        m_Levels = 0;
+        m_HasDirectorySlash = false;
     }
 
-    return path.str();
-}
+    // If the path doesn't end with trailing slash, don't add it later with normalization
+    if (path.empty() || path.back() != '/')
+        m_HasTrailingSlash = false;
 
-vector<string> CURLHandler::getNormalizedLevels() const
-{
-    vector<string> tempPath;
+    // The last level continues without the slash of a directory
+    if (m_HasDirectorySlash)
+        m_Url.pop_back();
 
-    // Normalize path
-    for (auto &level : m_PathLevels)
+    // Normalize every level of the path right into the URL
+    while (true)
     {
+        size_t end = std::min(path.find('/'), path.length());
+        size_t levelEnd = m_Url.length();
+
+        // Add level to path, percent-encodings are normalized first, so encoded dots are dots too
+        if (m_Levels > 0)
+            m_Url += '/';
+
+        size_t levelStart = m_Url.length();
+        CURLParser::appendNormalized(m_Url, path.substr(0, end));
+        string_view level = string_view(m_Url).substr(levelStart);
+
         // Move back one level
         if (level == "..")
         {
-            if (tempPath.size() > 0)
-                tempPath.pop_back();
+            m_Url.resize(levelEnd);
 
-            continue;
+            if (m_Levels > 0)
+            {
+                m_Url.resize(std::max(m_Url.rfind('/'), m_PathStart));
+                m_Levels--;
+            }
         }
 
         // Skip redundant dots or empty levels
         else if (level == "." || level.empty())
-            continue;
+            m_Url.resize(levelEnd);
 
-        // Add level to path
-        tempPath.push_back(level);
-    }
+        else
+            m_Levels++;
 
-    return tempPath;
-}
+        if (end == path.length())
+            break;
 
-string CURLHandler::getNormURL() const
-{
-    // Build the final normalized URL
-    stringstream url;
+        path.remove_prefix(end + 1);
+    }
 
-    // Add protocol
-    if (m_IsHttps)
-        url << "https://";
-    else
-        url << "http://";
+    // Include trailing slash after the last level only if it's not a file (doesn't contain a dot)
+    m_HasDirectorySlash = m_Levels > 0 && m_Url.find('.', m_Url.rfind('/') + 1) == string::npos;
 
-    // Add domain string with slash
-    url << m_Domain << "/";
+    if (m_HasDirectorySlash)
+        m_Url += '/';
+}
 
-    // Add normalized path
-    url << getNormFilePath();
+string_view CURLHandler::getNormFilePath() const
+{
+    return string_view(m_Url).substr(m_PathStart);
+}
 
-    return url.str();
+const string &CURLHandler::getNormURL() const
+{
+    return m_Url;
 }
 
 string CURLHandler::getNormURLPath() const
 {
-    string path = getNormFilePath();
+    string_view path = string_view(m_Url).substr(m_PathStart, m_Url.length() - m_PathStart - m_QueryLength);
+
+    if (!m_HasTrailingSlash && !path.empty() && path.back() == '/')
+        path.remove_suffix(1);
 
-    if (!m_HasTrailingSlash && !path.empty() && Utils::endsWith(path, "/"))
-        path.pop_back();
+    string result;
+    result.reserve(path.length() + m_QueryLength);
+    result.append(path).append(string_view(m_Url).substr(m_Url.length() - m_QueryLength));
 
-    return path;
+    return result;
 }
 
-string CURLHandler::getDomain() const
+string_view CURLHandler::getDomain() const
 {
-    return m_Domain;
+    return string_view(m_Url).substr(m_DomainStart, m_PathStart - 1 - m_DomainStart);
 }
 
-string CURLHandler::getDomainNorm() const
+string_view CURLHandler::getDomainNorm() const
 {
-    if (Utils::startsWith(m_Domain, "www."))
-        return m_Domain.substr(4);
+    string_view domain = getDomain();
+
+    if (domain.substr(0, 4) == "www.")
+        domain.remove_prefix(4);
 
-    return m_Domain;
+    return domain;
+}
+
+CInternTable::TId CURLHandler::getDomainId() const
+{
+    return m_DomainId;
 }
 
 bool CURLHandler::isHttps() const
@@ -196,15 +240,6 @@ void CURLHandler::setExternal(bool isExternal)
 
 size_t CURLHandler::getPathDepth() const
 {
-    auto levels = getNormalizedLevels();
-
-    // If there is no path after domain name
-    if ((levels.size() == 1 && levels.back() == "") || levels.size() <= 0)
-        return 0;
-
-    // If last element is a file (contains a dot)
-    if (levels.back().find('.') != string::npos)
-        return levels.size() - 1;
-
-    return levels.size();
+    // If last level is a file (contains a dot), it's not a directory
+    return m_HasDirectorySlash ? m_Levels : m_Levels - (m_Levels > 0);
 }
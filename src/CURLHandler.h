@@ -6,24 +6,31 @@
 
 #pragma once
 
+#include "CInternTable.h"
+
+#include <cstddef>
 #include <string>
-#include <vector>
-#include <sstream>
-#include <algorithm> // transform
-#include <regex>
-#include <iostream>
+#include <string_view>
 
 // using namespace std;
-using std::string, std::vector;
+using std::string, std::string_view;
 
 /**
  * @brief URL Handler to parse various URLs, append relative paths to existings URLs, and to provide normalized URLs and file paths
  *
+ * The URL is parsed by CURLParser and normalized once when it's changed (case, percent-encoding, dot segments and
+ * default port). It's kept in one buffer with the offsets of its components, so the getters only return views
+ * into it without building any strings. The fragment and the user info are dropped.
+ *
  */
 class CURLHandler
 {
 public:
-    CURLHandler() = default;
+    /**
+     * @brief Construct an empty "http:///" URL
+     *
+     */
+    CURLHandler();
 
     /**
      * @brief Construct a new CURLHandler object
@@ -37,49 +44,57 @@ public:
      *
      * @param urlDomain Domain of the URL, eg. https://google.com/
      */
-    void setDomain(const string &urlDomain);
+    void setDomain(string_view urlDomain);
 
     /**
-     * @brief Add additional relative part of path to the existing URL
+     * @brief Add additional relative part of path to the existing URL, the query of the URL is removed
      *
      * @param path Additional relative path (eg. "next/directory/../index.html")
      */
-    void addPath(const string &path);
+    void addPath(string_view path);
 
     /**
      * @brief Returns the full normalized URL with fixed path changes (eg. '../')
      *
-     * @return string Normalized URL
+     * @return const string& Normalized URL
      */
-    string getNormURL() const;
+    const string &getNormURL() const;
 
     /**
-     * @brief Like getNormFilePath(), returns only the normalized path without domain, but includes trailing slash if suitable
+     * @brief Like getNormFilePath(), returns only the normalized path with the query without domain, but includes
+     * trailing slash only if the original path had it, as it's requested from the server
      *
      * @return string Normalized path only, including trailing slash if suitable
      */
     string getNormURLPath() const;
 
     /**
-     * @brief Returns only the normalized path without domain, with fixed path changes (eg. '../')
+     * @brief Returns only the normalized path with the query without domain, with fixed path changes (eg. '../')
      *
-     * @return string Normalized path only
+     * @return string_view Normalized path only
      */
-    string getNormFilePath() const;
+    string_view getNormFilePath() const;
 
     /**
      * @brief Get the Domain
      *
-     * @return string Domain
+     * @return string_view Domain
      */
-    string getDomain() const;
+    string_view getDomain() const;
 
     /**
      * @brief Get the Domain normalized (remove www. if present)
      *
-     * @return string Normalized Domain
+     * @return string_view Normalized Domain
+     */
+    string_view getDomainNorm() const;
+
+    /**
+     * @brief Get the ID of the Domain in CInternTable, equal domains have equal IDs
+     *
+     * @return CInternTable::TId
      */
-    string getDomainNorm() const;
+    CInternTable::TId getDomainId() const;
 
     /**
      * @brief Returns bool is current URL uses https protocol
@@ -90,7 +105,7 @@ public:
     bool isHttps() const;
 
     /**
-     * @brief Get depth of the current URL based on m_PathLevels
+     * @brief Get depth of the current URL, the number of directories in the normalized path
      *
      * @return size_t
      */
@@ -115,20 +130,57 @@ private:
     bool m_IsHttps = false;
     bool m_HasTrailingSlash = true;
     bool m_IsExternal = false;
-    string m_Domain;
 
     /**
-     * @brief Vector of strings containing levels of path
+     * @brief Normalized URL, eg. "https://example.com/directory/file.html"
      *
-     * eg. URL path "../directory/file.html" is split into "..", "directory", "file.html"
+     * Levels of the path are separated by single slashes, a directory (last level without a dot) ends with a slash,
+     * the query follows the path.
+     *
+     */
+    string m_Url = "http:///";
+
+    /**
+     * @brief Interned domain
+     *
+     */
+    CInternTable::TId m_DomainId = CInternTable::NONE;
+
+    /**
+     * @brief Position of the domain in m_Url
+     *
+     */
+    size_t m_DomainStart = 7;
+
+    /**
+     * @brief Position of the path in m_Url, after the slash following the domain
+     *
+     */
+    size_t m_PathStart = 8;
+
+    /**
+     * @brief Number of levels of the normalized path
+     *
+     */
+    size_t m_Levels = 0;
+
+    /**
+     * @brief Length of the query at the end of m_Url, including '?'
+     *
+     */
+    size_t m_QueryLength = 0;
+
+    /**
+     * @brief True if the path in m_Url ends with the slash of a directory, it's not part of the last level
      *
      */
-    vector<string> m_PathLevels;
+    bool m_HasDirectorySlash = false;
 
     /**
-     * @brief Returns m_PathLevels normalized, eg. won't include '../' etc.
+     * @brief Set the domain and reserve the buffer for the whole URL
      *
-     * @return vector<string> Normalized m_PathLevels
+     * @param urlDomain
+     * @param capacity Expected length of the whole URL
      */
-    vector<string> getNormalizedLevels() const;
+    void setDomain(string_view urlDomain, size_t capacity);
 };
@@ -0,0 +1,366 @@
+/**
+ * @file CURLParser.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CURLParser
+ *
+ */
+
+#include "CURLParser.h"
+
+#include <algorithm> // sort
+#include <cctype>
+#include <vector>
+
+using std::vector;
+
+// ALPHA / DIGIT / "-" / "." / "_" / "~"
+static bool isUnreserved(unsigned char c)
+{
+    return std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+}
+
+CURLParser::TComponents CURLParser::parse(string_view uri)
+{
+    // ^(([^:/?#]+):)?(//([^/?#]*))?([^?#]*)(\?([^#]*))?(#(.*))?
+    TComponents result;
+
+    size_t schemeEnd = uri.find_first_of(":/?#");
+    if (schemeEnd != string_view::npos && schemeEnd > 0 && uri[schemeEnd] == ':')
+    {
+        result.m_HasScheme = true;
+        result.m_Scheme = uri.substr(0, schemeEnd);
+        uri.remove_prefix(schemeEnd + 1);
+    }
+
+    if (uri.substr(0, 2) == "//")
+    {
+        size_t authorityEnd = std::min(uri.find_first_of("/?#", 2), uri.length());
+
+        result.m_HasAuthority = true;
+        result.m_Authority = uri.substr(2, authorityEnd - 2);
+        uri.remove_prefix(authorityEnd);
+
+        string_view hostPort = result.m_Authority;
+
+        size_t at = hostPort.rfind('@');
+        if (at != string_view::npos)
+        {
+            result.m_HasUserInfo = true;
+            result.m_UserInfo = hostPort.substr(0, at);
+            hostPort.remove_prefix(at + 1);
+        }
+
+        // The port follows the last colon, except the colons inside of an IP literal
+        size_t colon = hostPort.rfind(':');
+        if (colon != string_view::npos && hostPort.find(']', colon) == string_view::npos)
+        {
+            result.m_HasPort = true;
+            result.m_Port = hostPort.substr(colon + 1);
+            hostPort = hostPort.substr(0, colon);
+        }
+
+        result.m_Host = hostPort;
+    }
+
+    size_t pathEnd = std::min(uri.find_first_of("?#"), uri.length());
+    result.m_Path = uri.substr(0, pathEnd);
+    uri.remove_prefix(pathEnd);
+
+    if (!uri.empty() && uri.front() == '?')
+    {
+        size_t queryEnd = std::min(uri.find('#'), uri.length());
+
+        result.m_HasQuery = true;
+        result.m_Query = uri.substr(1, queryEnd - 1);
+        uri.remove_prefix(queryEnd);
+    }
+
+    if (!uri.empty())
+    {
+        result.m_HasFragment = true;
+        result.m_Fragment = uri.substr(1);
+    }
+
+    return result;
+}
+
+string CURLParser::compose(const TComponents &components)
+{
+    string result;
+    result.reserve(components.m_Scheme.length() + components.m_Authority.length() + components.m_Path.length() +
+                   components.m_Query.length() + components.m_Fragment.length() + 6);
+
+    if (components.m_HasScheme)
+        result.append(components.m_Scheme).append(":");
+
+    if (components.m_HasAuthority)
+        result.append("//").append(components.m_Authority);
+
+    // Path that would be parsed as the authority or as the scheme (eg. after removing dot segments) is protected
+    // by a dot segment (RFC 3986 section 4.2)
+    size_t schemeEnd = components.m_Path.find_first_of(":/?#");
+
+    if (!components.m_HasAuthority && components.m_Path.substr(0, 2) == "//")
+        result.append("/.");
+    else if (!components.m_HasScheme && schemeEnd != string_view::npos && schemeEnd > 0 && components.m_Path[schemeEnd] == ':')
+        result.append("./");
+
+    result.append(components.m_Path);
+
+    if (components.m_HasQuery)
+        result.append("?").append(components.m_Query);
+
+    if (components.m_HasFragment)
+        result.append("#").append(components.m_Fragment);
+
+    return result;
+}
+
+string CURLParser::resolve(string_view base, string_view reference)
+{
+    TComponents b = parse(base);
+    TComponents r = parse(reference);
+    TComponents t;
+
+    // Owns the path of the target, the other components are views into the base or the reference
+    string path;
+
+    if (r.m_HasScheme)
+    {
+        t = r;
+        path = removeDotSegments(r.m_Path);
+    }
+    else
+    {
+        if (r.m_HasAuthority)
+        {
+            t = r;
+            path = removeDotSegments(r.m_Path);
+        }
+        else
+        {
+            if (r.m_Path.empty())
+            {
+                path = b.m_Path;
+                t.m_HasQuery = r.m_HasQuery || b.m_HasQuery;
+                t.m_Query = r.m_HasQuery ? r.m_Query : b.m_Query;
+            }
+            else
+            {
+                path = removeDotSegments(r.m_Path.front() == '/' ? string(r.m_Path) : merge(b, r.m_Path));
+                t.m_HasQuery = r.m_HasQuery;
+                t.m_Query = r.m_Query;
+            }
+
+            t.m_HasAuthority = b.m_HasAuthority;
+            t.m_Authority = b.m_Authority;
+        }
+
+        t.m_HasScheme = b.m_HasScheme;
+        t.m_Scheme = b.m_Scheme;
+    }
+
+    t.m_HasFragment = r.m_HasFragment;
+    t.m_Fragment = r.m_Fragment;
+    t.m_Path = path;
+
+    return compose(t);
+}
+
+string CURLParser::canonicalize(string_view uri, bool sortQuery)
+{
+    TComponents c = parse(uri);
+
+    // Normalized components, composed at the end
+    string scheme;
+    string authority;
+    string path;
+    string query;
+
+    appendNormalized(scheme, c.m_Scheme, true);
+    bool isHttp = scheme == "http" || scheme == "https";
+
+    if (c.m_HasAuthority)
+    {
+        if (c.m_HasUserInfo)
+        {
+            appendNormalized(authority, c.m_UserInfo);
+            authority += '@';
+        }
+
+        appendNormalized(authority, c.m_Host, true);
+
+        // Empty and default ports are the same as no port
+        if (!c.m_Port.empty() && c.m_Port != getDefaultPort(scheme))
+            authority.append(":").append(c.m_Port);
+    }
+
+    // Decode first, so encoded dots are removed as dot segments too
+    appendNormalized(path, c.m_Path);
+    path = removeDotSegments(path);
+
+    if (path.empty() && c.m_HasAuthority && isHttp)
+        path = "/";
+
+    appendNormalized(query, c.m_Query);
+
+    if (sortQuery && c.m_HasQuery)
+    {
+        vector<string_view> parameters;
+        string_view rest = query;
+
+        while (true)
+        {
+            size_t end = std::min(rest.find('&'), rest.length());
+            parameters.push_back(rest.substr(0, end));
+
+            if (end == rest.length())
+                break;
+
+            rest.remove_prefix(end + 1);
+        }
+
+        std::stable_sort(parameters.begin(), parameters.end());
+
+        string sorted;
+        sorted.reserve(query.length());
+
+        for (size_t i = 0; i < parameters.size(); i++)
+        {
+            if (i > 0)
+                sorted += '&';
+            sorted += parameters[i];
+        }
+
+        query.swap(sorted);
+    }
+
+    c.m_Scheme = scheme;
+    c.m_Authority = authority;
+    c.m_Path = path;
+    c.m_Query = query;
+    c.m_HasFragment = false;
+    c.m_Fragment = string_view();
+
+    return compose(c);
+}
+
+string CURLParser::removeDotSegments(string_view path)
+{
+    string output;
+    output.reserve(path.length());
+
+    // Remove the last segment and its preceding slash from the output
+    auto popSegment = [&output]
+    {
+        size_t slash = output.rfind('/');
+        output.resize(slash == string::npos ? 0 : slash);
+    };
+
+    while (!path.empty())
+    {
+        if (path.substr(0, 3) == "../")
+            path.remove_prefix(3);
+
+        else if (path.substr(0, 2) == "./")
+            path.remove_prefix(2);
+
+        else if (path.substr(0, 3) == "/./")
+            path.remove_prefix(2);
+
+        else if (path == "/.")
+            path = "/";
+
+        else if (path.substr(0, 4) == "/../")
+        {
+            path.remove_prefix(3);
+            popSegment();
+        }
+
+        else if (path == "/..")
+        {
+            path = "/";
+            popSegment();
+        }
+
+        else if (path == "." || path == "..")
+            path = "";
+
+        // Move the first segment with its leading slash to the output
+        else
+        {
+            size_t end = std::min(path.find('/', 1), path.length());
+            output += path.substr(0, end);
+            path.remove_prefix(end);
+        }
+    }
+
+    return output;
+}
+
+void CURLParser::appendNormalized(string &output, string_view text, bool lowercase)
+{
+    static const char HEX[] = "0123456789ABCDEF";
+
+    for (size_t i = 0; i < text.length(); i++)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+
+        if (c == '%' && i + 2 < text.length() && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0)
+        {
+            unsigned char decoded = static_cast<unsigned char>(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+
+            // Encoded unreserved characters are the same as the characters themselves
+            if (isUnreserved(decoded))
+                output += static_cast<char>(lowercase ? std::tolower(decoded) : decoded);
+            else
+            {
+                output += '%';
+                output += HEX[decoded >> 4];
+                output += HEX[decoded & 0x0F];
+            }
+
+            i += 2;
+        }
+        else
+            output += static_cast<char>(lowercase ? std::tolower(c) : c);
+    }
+}
+
+string_view CURLParser::getDefaultPort(string_view scheme)
+{
+    if (scheme == "http")
+        return "80";
+
+    if (scheme == "https")
+        return "443";
+
+    return "";
+}
+
+string CURLParser::merge(const TComponents &base, string_view path)
+{
+    if (base.m_HasAuthority && base.m_Path.empty())
+        return "/" + string(path);
+
+    size_t slash = base.m_Path.rfind('/');
+    string_view directory = slash == string_view::npos ? string_view() : base.m_Path.substr(0, slash + 1);
+
+    string result;
+    result.reserve(directory.length() + path.length());
+    result.append(directory).append(path);
+
+    return result;
+}
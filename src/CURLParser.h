@@ -0,0 +1,123 @@
+/**
+ * @file CURLParser.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CURLParser
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+using std::string, std::string_view;
+
+/**
+ * @brief RFC 3986 URI parser, reference resolver and canonicalizer
+ *
+ * Parsing splits the URI exactly like the regular expression of RFC 3986 Appendix B, without allocating, the
+ * components are views into the parsed string. Canonicalization applies the syntax-based and scheme-based
+ * normalization of RFC 3986 section 6.2 (case, percent-encoding, dot segments, default port and empty path),
+ * so equivalent URLs become the same string.
+ *
+ */
+class CURLParser
+{
+public:
+    /**
+     * @brief Components of the URI, undefined components are empty and have their flag unset
+     *
+     */
+    struct TComponents
+    {
+        string_view m_Scheme;
+        string_view m_Authority; // Whole authority, "userinfo@host:port"
+        string_view m_UserInfo;
+        string_view m_Host;      // Including the brackets of an IP literal
+        string_view m_Port;
+        string_view m_Path;
+        string_view m_Query;
+        string_view m_Fragment;
+
+        bool m_HasScheme = false;
+        bool m_HasAuthority = false;
+        bool m_HasUserInfo = false;
+        bool m_HasPort = false;
+        bool m_HasQuery = false;
+        bool m_HasFragment = false;
+    };
+
+    /**
+     * @brief Split the URI into its components
+     *
+     * @param uri
+     * @return TComponents Views into the uri
+     */
+    static TComponents parse(string_view uri);
+
+    /**
+     * @brief Build the URI from its components (RFC 3986 section 5.3)
+     *
+     * @param components
+     * @return string
+     */
+    static string compose(const TComponents &components);
+
+    /**
+     * @brief Resolve the reference against the base URI (RFC 3986 section 5.2)
+     *
+     * @param base Absolute URI
+     * @param reference Absolute or relative reference
+     * @return string Target URI
+     */
+    static string resolve(string_view base, string_view reference);
+
+    /**
+     * @brief Normalize the URI, so equivalent URIs are equal strings
+     *
+     * The scheme and host are lowercased, percent-encodings get uppercase hex digits and the encoded unreserved
+     * characters are decoded, dot segments and the default port of http and https are removed and an empty http
+     * path becomes "/". Other characters are kept as they are. The fragment is dropped, it's never sent to the
+     * server.
+     *
+     * @param uri
+     * @param sortQuery Sort the '&' separated parameters of the query
+     * @return string
+     */
+    static string canonicalize(string_view uri, bool sortQuery = false);
+
+    /**
+     * @brief Remove "." and ".." segments from the path (RFC 3986 section 5.2.4)
+     *
+     * @param path
+     * @return string
+     */
+    static string removeDotSegments(string_view path);
+
+    /**
+     * @brief Append the text with normalized percent-encodings
+     *
+     * @param[out] output
+     * @param text
+     * @param lowercase Lowercase also the characters (for the scheme and host)
+     */
+    static void appendNormalized(string &output, string_view text, bool lowercase = false);
+
+    /**
+     * @brief Get the default port of the scheme
+     *
+     * @param scheme Lowercase scheme
+     * @return string_view Empty for unknown schemes
+     */
+    static string_view getDefaultPort(string_view scheme);
+
+private:
+    /**
+     * @brief Merge the relative path with the path of the base URI (RFC 3986 section 5.2.3)
+     *
+     * @param base
+     * @param path
+     * @return string
+     */
+    static string merge(const TComponents &base, string_view path);
+};
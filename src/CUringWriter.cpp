@@ -0,0 +1,450 @@
+/**
+ * @file CUringWriter.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CUringWriter
+ *
+ */
+
+#include "CUringWriter.h"
+#include "CLogger.h"
+#include "CDirectoryCache.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm> // max, min
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+using std::string;
+namespace fs = std::filesystem;
+
+// io_uring is used directly through syscalls (there's no liburing dependency)
+static int uringSetup(unsigned entries, io_uring_params *params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int uringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int uringRegister(int fd, unsigned opcode, const void *arg, unsigned count)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+CUringWriter::CUringWriter(unsigned entries)
+{
+    m_Available = setup(entries);
+
+    if (!m_Available)
+        return;
+
+    for (unsigned i = 0; i < SLOTS; i++)
+        m_FreeSlots.push_back(i);
+
+    m_Thread = std::thread(&CUringWriter::loop, this);
+}
+
+CUringWriter::~CUringWriter()
+{
+    if (m_Thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stop = true;
+        }
+
+        m_Changed.notify_all();
+        m_Thread.join();
+    }
+
+    if (m_Sqes != nullptr)
+        munmap(m_Sqes, m_SqesSize);
+
+    if (m_CqRing != nullptr && m_CqRing != m_SqRing)
+        munmap(m_CqRing, m_CqRingSize);
+
+    if (m_SqRing != nullptr)
+        munmap(m_SqRing, m_SqRingSize);
+
+    if (m_RingFd >= 0)
+        close(m_RingFd);
+}
+
+bool CUringWriter::isAvailable() const
+{
+    return m_Available;
+}
+
+size_t CUringWriter::getFallbacks() const
+{
+    return m_Fallbacks;
+}
+
+string CUringWriter::getName() const
+{
+    return "uring";
+}
+
+bool CUringWriter::setup(unsigned entries)
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    m_RingFd = uringSetup(entries, &params);
+    if (m_RingFd < 0)
+        return false;
+
+    // Map the rings, both are in one mapping on newer kernels
+    m_SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        m_SqRingSize = m_CqRingSize = std::max(m_SqRingSize, m_CqRingSize);
+
+    m_SqRing = mmap(nullptr, m_SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQ_RING);
+    if (m_SqRing == MAP_FAILED)
+    {
+        m_SqRing = nullptr;
+        return false;
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        m_CqRing = m_SqRing;
+    else
+    {
+        m_CqRing = mmap(nullptr, m_CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_CQ_RING);
+        if (m_CqRing == MAP_FAILED)
+        {
+            m_CqRing = nullptr;
+            return false;
+        }
+    }
+
+    m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+        return false;
+
+    m_Sqes = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(m_SqRing);
+    m_SqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    m_SqMask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    m_SqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    m_SqEntries = params.sq_entries;
+
+    char *cq = static_cast<char *>(m_CqRing);
+    m_CqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    m_CqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    m_CqMask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    m_Cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    m_CqEntries = params.cq_entries;
+
+    // Register empty slots for direct descriptors
+    vector<int> slots(SLOTS, -1);
+    if (uringRegister(m_RingFd, IORING_REGISTER_FILES, slots.data(), SLOTS) < 0)
+        return false;
+
+    // Check that all needed operations are supported
+    vector<char> probeBuffer(sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op), 0);
+    auto *probe = reinterpret_cast<io_uring_probe *>(probeBuffer.data());
+
+    if (uringRegister(m_RingFd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0)
+        return false;
+
+    for (auto op : {IORING_OP_MKDIRAT, IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE})
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+            return false;
+
+    return true;
+}
+
+void CUringWriter::submit(TRequest &&request)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Space.wait(lock, [this]
+                 { return m_Waiting.size() < MAX_WAITING; });
+
+    m_Waiting.push_back(std::move(request));
+    m_Pending++;
+    lock.unlock();
+
+    m_Changed.notify_one();
+}
+
+void CUringWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this]
+                { return m_Pending == 0; });
+}
+
+void CUringWriter::loop()
+{
+    while (true)
+    {
+        vector<uint64_t> batch;
+        vector<TRequest> synchronous;
+        unsigned batchSqes = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+
+            // Sleep only if there's nothing to complete
+            if (m_InFlight.empty())
+                m_Changed.wait(lock, [this]
+                               { return m_Stop || !m_Waiting.empty(); });
+
+            if (m_Stop && m_Waiting.empty() && m_InFlight.empty())
+                break;
+
+            // Take as many waiting files as fit into the free slots and rings
+            while (!m_Waiting.empty() && (m_Broken || !m_FreeSlots.empty()))
+            {
+                // The ring can't be used anymore, write everything synchronously
+                if (m_Broken)
+                {
+                    synchronous.push_back(std::move(m_Waiting.front()));
+                    m_Waiting.pop_front();
+                    continue;
+                }
+
+                TInFlight file;
+                file.m_Request = std::move(m_Waiting.front());
+
+                // Only the levels not yet known to exist need mkdirat
+                for (fs::path dir = fs::path(file.m_Request.m_Path).parent_path(); !dir.empty() && dir != dir.root_path(); dir = dir.parent_path())
+                {
+                    if (CDirectoryCache::getInstance().contains(dir.string()))
+                        break;
+
+                    file.m_Directories.insert(file.m_Directories.begin(), dir.string());
+                }
+
+                // A chain longer than the rings would never fit (too many new folder levels)
+                unsigned sqes = file.m_Directories.size() + 3;
+                if (sqes > m_SqEntries || sqes > m_CqEntries)
+                {
+                    synchronous.push_back(std::move(file.m_Request));
+                    m_Waiting.pop_front();
+                    continue;
+                }
+
+                if (batchSqes + sqes > m_SqEntries || m_InFlightSqes + sqes > m_CqEntries)
+                {
+                    m_Waiting.front() = std::move(file.m_Request);
+                    break;
+                }
+
+                m_Waiting.pop_front();
+
+                file.m_Slot = m_FreeSlots.back();
+                m_FreeSlots.pop_back();
+                file.m_Remaining = sqes;
+                m_InFlightSqes += sqes;
+                batchSqes += sqes;
+
+                uint64_t id = m_NextId++;
+                m_InFlight.emplace(id, std::move(file));
+                batch.push_back(id);
+            }
+        }
+
+        m_Space.notify_all();
+
+        for (auto &request : synchronous)
+            fallback(request);
+
+        if (m_Broken)
+            continue;
+
+        // Submit the whole batch in one call
+        unsigned tail = *m_SqTail;
+        unsigned start = tail;
+
+        for (uint64_t id : batch)
+            prepare(id, m_InFlight[id], tail);
+
+        __atomic_store_n(m_SqTail, tail, __ATOMIC_RELEASE);
+
+        unsigned toSubmit = tail - start;
+        while (true)
+        {
+            int result = uringEnter(m_RingFd, toSubmit, m_InFlight.empty() ? 0 : 1, IORING_ENTER_GETEVENTS);
+
+            if (result >= 0)
+            {
+                toSubmit -= std::min<unsigned>(result, toSubmit);
+                if (toSubmit == 0)
+                    break;
+            }
+            else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            {
+                LOG_ERROR("io_uring_enter failed: " + string(strerror(errno)) + ", writing synchronously");
+                m_Broken = true;
+                break;
+            }
+        }
+
+        // No completions would come anymore, finish the files in flight synchronously. Their buffers are kept
+        // until the ring is closed, the kernel may still hold some of the operations.
+        if (m_Broken)
+        {
+            for (auto &[id, file] : m_InFlight)
+            {
+                fallback(file.m_Request);
+                m_Abandoned.push_back(std::move(file));
+            }
+
+            m_InFlight.clear();
+            m_InFlightSqes = 0;
+            continue;
+        }
+
+        // Reap all completions
+        unsigned head = *m_CqHead;
+        while (head != __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE))
+        {
+            io_uring_cqe cqe = m_Cqes[head & *m_CqMask];
+            head++;
+            __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+
+            complete(cqe);
+        }
+    }
+}
+
+io_uring_sqe *CUringWriter::getSqe(unsigned &tail)
+{
+    unsigned index = tail & *m_SqMask;
+    m_SqArray[index] = index;
+    tail++;
+
+    io_uring_sqe *sqe = &m_Sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+
+    return sqe;
+}
+
+void CUringWriter::prepare(uint64_t id, TInFlight &file, unsigned &tail)
+{
+    const string &content = file.m_Request.m_Content;
+
+    // Create every level of the folder structure, hardlinks continue the chain even if it already exists
+    for (const auto &dir : file.m_Directories)
+    {
+        io_uring_sqe *sqe = getSqe(tail);
+        sqe->opcode = IORING_OP_MKDIRAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64_t>(dir.c_str());
+        sqe->len = 0755;
+        sqe->flags = IOSQE_IO_HARDLINK;
+        sqe->user_data = (id << 2) | MKDIR;
+    }
+
+    // Open into the direct descriptor slot (O_CLOEXEC is not allowed there), write fails if the open failed
+    io_uring_sqe *sqe = getSqe(tail);
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = reinterpret_cast<uint64_t>(file.m_Request.m_Path.c_str());
+    sqe->len = 0644;
+    sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    sqe->file_index = file.m_Slot + 1;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = (id << 2) | OPEN;
+
+    sqe = getSqe(tail);
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = static_cast<int>(file.m_Slot);
+    sqe->addr = reinterpret_cast<uint64_t>(content.data());
+    sqe->len = static_cast<unsigned>(content.size());
+    sqe->off = 0;
+    sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_HARDLINK;
+    sqe->user_data = (id << 2) | WRITE;
+
+    sqe = getSqe(tail);
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->file_index = file.m_Slot + 1;
+    sqe->user_data = (id << 2) | CLOSE;
+}
+
+void CUringWriter::complete(const io_uring_cqe &cqe)
+{
+    uint64_t id = cqe.user_data >> 2;
+    auto it = m_InFlight.find(id);
+
+    if (it == m_InFlight.end())
+        return;
+
+    TInFlight &file = it->second;
+
+    switch (cqe.user_data & 3)
+    {
+    case OPEN:
+        file.m_OpenResult = cqe.res;
+        break;
+    case WRITE:
+        file.m_WriteResult = cqe.res;
+        break;
+    case CLOSE:
+        file.m_CloseResult = cqe.res;
+        break;
+    default:
+        break;
+    }
+
+    m_InFlightSqes--;
+    if (--file.m_Remaining > 0)
+        return;
+
+    // All operations done, retry synchronously if any of them failed (eg. short write or unsupported filesystem)
+    TRequest &request = file.m_Request;
+    bool result = file.m_OpenResult >= 0 &&
+                  file.m_CloseResult >= 0 &&
+                  static_cast<size_t>(file.m_WriteResult) == request.m_Content.size();
+
+    if (!result)
+    {
+        LOG_VERBOSE("io_uring write of " + request.m_Path + " failed (open " + std::to_string(file.m_OpenResult) +
+                    ", write " + std::to_string(file.m_WriteResult) +
+                    ", close " + std::to_string(file.m_CloseResult) + "), writing synchronously");
+        result = writeNow(request.m_Path, request.m_Content);
+        m_Fallbacks++;
+    }
+
+    // The folders exist now, next files in them skip the mkdirat
+    if (file.m_OpenResult >= 0)
+        for (const auto &dir : file.m_Directories)
+            CDirectoryCache::getInstance().insert(dir);
+
+    finish(request, result);
+
+    m_FreeSlots.push_back(file.m_Slot);
+    m_InFlight.erase(it);
+}
+
+void CUringWriter::fallback(TRequest &request)
+{
+    bool result = writeNow(request.m_Path, request.m_Content);
+    m_Fallbacks++;
+
+    finish(request, result);
+}
+
+void CUringWriter::finish(TRequest &request, bool result)
+{
+    request.m_Reservation.release();
+    if (request.m_Done)
+        request.m_Done(result);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (--m_Pending == 0)
+        m_Idle.notify_all();
+}
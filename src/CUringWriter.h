@@ -0,0 +1,210 @@
+/**
+ * @file CUringWriter.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CUringWriter
+ *
+ */
+
+#pragma once
+
+#include "COutputWriter.h"
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using std::vector;
+
+/**
+ * @brief Output backend submitting mkdirat, openat, write and close of every file as one linked io_uring chain
+ *
+ * All files waiting at the time of submission are sent in a single io_uring_enter call. The files are opened
+ * as direct descriptors, so the whole chain completes in the kernel without returning file descriptors.
+ * Failed chains, chains longer than the rings and everything after a failure of the ring itself are written
+ * synchronously.
+ *
+ */
+class CUringWriter : public COutputWriter
+{
+public:
+    /**
+     * @brief Construct a new CUringWriter object, setup the ring and start the completion thread
+     *
+     * @param entries Number of submission queue entries
+     */
+    explicit CUringWriter(unsigned entries = 256);
+
+    /**
+     * @brief Write the remaining files, stop the thread and close the ring
+     *
+     */
+    virtual ~CUringWriter();
+
+    /**
+     * @brief Returns true if io_uring is supported by the kernel with all needed operations
+     *
+     * @return true
+     * @return false
+     */
+    bool isAvailable() const;
+
+    /**
+     * @brief Get the number of files that had to be written synchronously instead of through the ring
+     *
+     * @return size_t
+     */
+    size_t getFallbacks() const;
+
+    /**
+     * @brief Queue the file to be written, block while too many files are waiting
+     *
+     * @param request
+     */
+    virtual void submit(TRequest &&request) override;
+
+    /**
+     * @brief Wait until all submitted files are written
+     *
+     */
+    virtual void flush() override;
+
+    /**
+     * @brief Get the name of the backend
+     *
+     * @return string
+     */
+    virtual string getName() const override;
+
+private:
+    /**
+     * @brief File submitted to the ring, waiting for the completion of its operations
+     *
+     */
+    struct TInFlight
+    {
+        TRequest m_Request;
+        vector<string> m_Directories;
+        unsigned m_Slot = 0;
+        unsigned m_Remaining = 0;
+        int m_OpenResult = 0;
+        int m_WriteResult = 0;
+        int m_CloseResult = 0;
+    };
+
+    /**
+     * @brief Operation kind stored in the lowest bits of user_data
+     *
+     */
+    enum EOperation : uint64_t
+    {
+        MKDIR = 0,
+        OPEN = 1,
+        WRITE = 2,
+        CLOSE = 3
+    };
+
+    static constexpr size_t MAX_WAITING = 64;
+    static constexpr unsigned SLOTS = 64;
+
+    bool m_Available = false;
+    int m_RingFd = -1;
+
+    void *m_SqRing = nullptr;
+    void *m_CqRing = nullptr;
+    size_t m_SqRingSize = 0;
+    size_t m_CqRingSize = 0;
+    io_uring_sqe *m_Sqes = nullptr;
+    size_t m_SqesSize = 0;
+
+    unsigned *m_SqTail = nullptr;
+    unsigned *m_SqMask = nullptr;
+    unsigned *m_SqArray = nullptr;
+    unsigned m_SqEntries = 0;
+
+    unsigned *m_CqHead = nullptr;
+    unsigned *m_CqTail = nullptr;
+    unsigned *m_CqMask = nullptr;
+    io_uring_cqe *m_Cqes = nullptr;
+    unsigned m_CqEntries = 0;
+
+    // Used only by the ring thread
+    std::unordered_map<uint64_t, TInFlight> m_InFlight;
+    vector<unsigned> m_FreeSlots;
+    unsigned m_InFlightSqes = 0;
+    uint64_t m_NextId = 0;
+    bool m_Broken = false;
+    vector<TInFlight> m_Abandoned;
+    std::atomic<size_t> m_Fallbacks{0};
+
+    // Shared with the submitting threads
+    std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    std::condition_variable m_Space;
+    std::condition_variable m_Idle;
+    std::deque<TRequest> m_Waiting;
+    size_t m_Pending = 0;
+    bool m_Stop = false;
+
+    std::thread m_Thread;
+
+    /**
+     * @brief Create the ring, map its memory, register the direct descriptor slots and probe the operations
+     *
+     * @param entries
+     * @return true If everything is supported
+     * @return false
+     */
+    bool setup(unsigned entries);
+
+    /**
+     * @brief Thread loop, submits waiting files and handles completions
+     *
+     */
+    void loop();
+
+    /**
+     * @brief Fill the submission queue entries of one file
+     *
+     * @param id Id of the file
+     * @param file
+     * @param tail Current submission queue tail, moved after the new entries
+     */
+    void prepare(uint64_t id, TInFlight &file, unsigned &tail);
+
+    /**
+     * @brief Process one completion, finish the file after its last operation
+     *
+     * @param cqe
+     */
+    void complete(const io_uring_cqe &cqe);
+
+    /**
+     * @brief Write the file synchronously, used for the files that can't go through the ring
+     *
+     * @param request
+     */
+    void fallback(TRequest &request);
+
+    /**
+     * @brief Release the file's memory budget, report the result and wake up flush after the last file
+     *
+     * @param request
+     * @param result
+     */
+    void finish(TRequest &request, bool result);
+
+    /**
+     * @brief Get the next free submission queue entry, cleared
+     *
+     * @param tail Current submission queue tail, moved after the entry
+     * @return io_uring_sqe*
+     */
+    io_uring_sqe *getSqe(unsigned &tail);
+};
@@ -0,0 +1,639 @@
+/**
+ * @file CWarcWriter.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Implementation of CWarcWriter
+ *
+ */
+
+#include "CWarcWriter.h"
+#include "CDirectoryCache.h"
+#include "CLogger.h"
+#include "Utils.h"
+
+#include <openssl/rand.h>
+
+#include <algorithm> // sort
+#include <ctime>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+#include <unistd.h>
+
+using std::stringstream;
+namespace fs = std::filesystem;
+
+// Fixed gzip member header: deflate, no flags, no mtime, unknown OS
+static const string GZIP_HEADER("\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\xff", 10);
+
+CWarcWriter::TRecord::~TRecord()
+{
+    if (m_Stream)
+        deflateEnd(m_Stream.get());
+}
+
+bool CWarcWriter::TRecord::isActive() const
+{
+    return m_Stream != nullptr;
+}
+
+void CWarcWriter::TRecord::append(const string &data)
+{
+    if (!isActive() || data.empty())
+        return;
+
+    EVP_DigestUpdate(m_BlockDigest.get(), data.data(), data.length());
+    EVP_DigestUpdate(m_PayloadDigest.get(), data.data(), data.length());
+    m_BlockLength += data.length();
+
+    compress(data.data(), data.length(), Z_NO_FLUSH);
+}
+
+void CWarcWriter::TRecord::compress(const char *data, size_t length, int flush)
+{
+    m_Crc = crc32(m_Crc, reinterpret_cast<const Bytef *>(data), length);
+    m_StreamLength += length;
+
+    m_Stream->next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    m_Stream->avail_in = length;
+
+    do
+    {
+        char buffer[16384];
+        m_Stream->next_out = reinterpret_cast<Bytef *>(buffer);
+        m_Stream->avail_out = sizeof(buffer);
+
+        if (deflate(m_Stream.get(), flush) == Z_STREAM_ERROR)
+        {
+            drop("can't compress it");
+            return;
+        }
+
+        m_Compressed.append(buffer, sizeof(buffer) - m_Stream->avail_out);
+        m_CompressedLength += sizeof(buffer) - m_Stream->avail_out;
+
+    } while (m_Stream->avail_out == 0);
+
+    if (m_Compressed.length() >= SPOOL_THRESHOLD)
+        spool();
+}
+
+void CWarcWriter::TRecord::drop(const string &reason)
+{
+    LOG_ERROR("WARC record of " + m_Url + " is not archived, " + reason);
+
+    deflateEnd(m_Stream.get());
+    m_Stream.reset();
+    m_Spool.reset();
+    m_Compressed.clear();
+}
+
+void CWarcWriter::TRecord::spool()
+{
+    if (!m_Spool)
+    {
+        // Unlinked right away, the file disappears with the record even if the crawl fails
+        string path = m_SpoolPrefix + "-spool-XXXXXX";
+        int fd = mkstemp(path.data());
+
+        if (fd >= 0)
+        {
+            unlink(path.c_str());
+            m_Spool.reset(fdopen(fd, "w+b"));
+
+            if (!m_Spool)
+                ::close(fd);
+        }
+    }
+
+    if (!m_Spool || fwrite(m_Compressed.data(), 1, m_Compressed.length(), m_Spool.get()) != m_Compressed.length())
+    {
+        drop("can't spool it");
+        return;
+    }
+
+    m_Compressed.clear();
+}
+
+CWarcWriter::~CWarcWriter()
+{
+    close();
+}
+
+bool CWarcWriter::open(const string &prefix, size_t maxFileSize)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    CDirectoryCache::getInstance().create(fs::path(prefix).parent_path().string());
+
+    m_Prefix = prefix;
+    m_MaxFileSize = maxFileSize;
+    m_FileIndex = 0;
+    m_Records = 0;
+    m_Bytes = 0;
+    m_Failed = false;
+    m_Index.clear();
+    m_Buffer.resize(BUFFER_SIZE);
+
+    m_Enabled = rotate();
+    return m_Enabled;
+}
+
+bool CWarcWriter::close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Stopped by a failure, the records written before it are still indexed
+    if (!m_Enabled && !m_Failed)
+        return true;
+
+    if (m_File.is_open())
+    {
+        m_File.close();
+
+        if (m_File.fail())
+            fail("can't finish " + m_FileName);
+    }
+
+    m_Enabled = false;
+
+    // Index sorted by the SURT key (and date) for binary search
+    std::sort(m_Index.begin(), m_Index.end());
+
+    std::ofstream cdx(m_Prefix + ".cdx", std::ios_base::out | std::ios_base::binary);
+    cdx << " CDX N b a m s k r M S V g\n";
+
+    for (const auto &line : m_Index)
+        cdx << line << "\n";
+
+    cdx.close();
+    m_Index.clear();
+
+    if (cdx.fail())
+    {
+        LOG_ERROR("Can't write CDX index " + m_Prefix + ".cdx");
+        return false;
+    }
+
+    if (m_Failed)
+    {
+        LOG_ERROR("WARC archive " + m_Prefix + " is incomplete, only " + std::to_string(m_Records) + " responses are stored");
+        m_Failed = false;
+        return false;
+    }
+
+    return true;
+}
+
+bool CWarcWriter::isEnabled() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Enabled;
+}
+
+CWarcWriter::TRecord CWarcWriter::begin(const string &url, const string &request, const string &header)
+{
+    TRecord record;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        record.m_SpoolPrefix = m_Prefix;
+    }
+
+    record.m_Stream = std::make_unique<z_stream>();
+    *record.m_Stream = z_stream();
+
+    // Raw deflate, the gzip wrapper is added when the record is committed
+    if (deflateInit2(record.m_Stream.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        record.m_Stream.reset();
+        return record;
+    }
+
+    record.m_BlockDigest.reset(EVP_MD_CTX_new());
+    record.m_PayloadDigest.reset(EVP_MD_CTX_new());
+    EVP_DigestInit_ex(record.m_BlockDigest.get(), EVP_sha1(), nullptr);
+    EVP_DigestInit_ex(record.m_PayloadDigest.get(), EVP_sha1(), nullptr);
+
+    record.m_Url = url;
+    record.m_Date = now();
+    record.m_Request = request;
+
+    // The HTTP header is the start of the block, but not of the payload
+    EVP_DigestUpdate(record.m_BlockDigest.get(), header.data(), header.length());
+    record.m_BlockLength = header.length();
+    record.compress(header.data(), header.length(), Z_NO_FLUSH);
+
+    return record;
+}
+
+void CWarcWriter::commit(TRecord &&record, int statusCode, const string &contentType, bool truncated)
+{
+    if (!record.isActive())
+        return;
+
+    // Block is followed by two empty lines
+    record.compress("\r\n\r\n", 4, Z_FINISH);
+
+    if (!record.isActive())
+        return;
+
+    // The spooled part is read back from the start
+    if (record.m_Spool && fflush(record.m_Spool.get()) != 0)
+    {
+        record.drop("can't spool it");
+        return;
+    }
+
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestLength = 0;
+
+    EVP_DigestFinal_ex(record.m_BlockDigest.get(), digest, &digestLength);
+    string blockDigest = "sha1:" + base32(string(reinterpret_cast<char *>(digest), digestLength));
+
+    EVP_DigestFinal_ex(record.m_PayloadDigest.get(), digest, &digestLength);
+    string payloadDigest = base32(string(reinterpret_cast<char *>(digest), digestLength));
+
+    string responseId = recordId();
+
+    stringstream ss;
+    ss << "WARC/1.1\r\n"
+       << "WARC-Type: response\r\n"
+       << "WARC-Record-ID: " << responseId << "\r\n"
+       << "WARC-Date: " << record.m_Date << "\r\n"
+       << "WARC-Target-URI: " << record.m_Url << "\r\n"
+       << "WARC-Block-Digest: " << blockDigest << "\r\n"
+       << "WARC-Payload-Digest: sha1:" << payloadDigest << "\r\n";
+
+    if (truncated)
+        ss << "WARC-Truncated: length\r\n";
+
+    ss << "Content-Type: application/http; msgtype=response\r\n"
+       << "Content-Length: " << record.m_BlockLength << "\r\n"
+       << "\r\n";
+
+    string warcHeader = ss.str();
+
+    // The WARC header is known only now, its deflate stream ends on a byte boundary without the final block,
+    // so the already compressed block can follow it in the same gzip member
+    z_stream stream = z_stream();
+
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        record.drop("can't compress it");
+        return;
+    }
+
+    string head = GZIP_HEADER;
+    string buffer(deflateBound(&stream, warcHeader.length()) + 64, '\0');
+
+    stream.next_in = reinterpret_cast<Bytef *>(warcHeader.data());
+    stream.avail_in = warcHeader.length();
+    stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+    stream.avail_out = buffer.length();
+    int result = deflate(&stream, Z_FULL_FLUSH);
+    head.append(buffer.data(), buffer.length() - stream.avail_out);
+    deflateEnd(&stream);
+
+    if (result != Z_OK || stream.avail_in != 0)
+    {
+        record.drop("can't compress it");
+        return;
+    }
+
+    uLong crc = crc32(0, reinterpret_cast<const Bytef *>(warcHeader.data()), warcHeader.length());
+    crc = crc32_combine(crc, record.m_Crc, record.m_StreamLength);
+    string tail = trailer(crc, warcHeader.length() + record.m_StreamLength);
+
+    // The member is written in parts, the compressed block may be spooled on disk
+    size_t responseLength = head.length() + record.m_CompressedLength + tail.length();
+
+    // Request record, points to the response
+    ss.str("");
+    ss << "WARC/1.1\r\n"
+       << "WARC-Type: request\r\n"
+       << "WARC-Record-ID: " << recordId() << "\r\n"
+       << "WARC-Date: " << record.m_Date << "\r\n"
+       << "WARC-Target-URI: " << record.m_Url << "\r\n"
+       << "WARC-Concurrent-To: " << responseId << "\r\n"
+       << "Content-Type: application/http; msgtype=request\r\n"
+       << "Content-Length: " << record.m_Request.length() << "\r\n"
+       << "\r\n"
+       << record.m_Request
+       << "\r\n\r\n";
+
+    string request = gzip(ss.str());
+
+    if (request.empty())
+    {
+        record.drop("can't compress it");
+        return;
+    }
+
+    // CDX fields, the mime type is without parameters
+    string mime = Utils::toLowerCase(contentType.substr(0, contentType.find(';')));
+    mime.erase(0, mime.find_first_not_of(' '));
+    mime.erase(mime.find_last_not_of(' ') + 1);
+
+    string date = record.m_Date;
+    date.erase(std::remove_if(date.begin(), date.end(), [](char c)
+                              { return !isdigit(static_cast<unsigned char>(c)); }),
+               date.end());
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if (!m_Enabled)
+        return;
+
+    // Even the largest record is stored, but not after another one
+    if (m_FileRecords > 0 && m_FileSize + request.length() + responseLength > m_MaxFileSize && !rotate())
+    {
+        fail("can't start the next file");
+        return;
+    }
+
+    size_t offset = m_FileSize + request.length();
+    write(request);
+    write(head);
+
+    // Spooled data are copied in parts
+    size_t spooled = record.m_CompressedLength - record.m_Compressed.length();
+    size_t copied = 0;
+
+    if (record.m_Spool)
+    {
+        char chunk[SPOOL_THRESHOLD];
+        size_t length;
+
+        rewind(record.m_Spool.get());
+
+        while ((length = fread(chunk, 1, sizeof(chunk), record.m_Spool.get())) > 0)
+        {
+            write(chunk, length);
+            copied += length;
+        }
+    }
+
+    write(record.m_Compressed);
+    write(tail);
+
+    // Flushed, so the index never points to a record that didn't reach the disk
+    m_File.flush();
+
+    if (copied != spooled)
+    {
+        fail("can't read the spooled record of " + record.m_Url);
+        return;
+    }
+
+    if (m_File.fail())
+    {
+        fail("can't write " + m_FileName);
+        return;
+    }
+
+    ss.str("");
+    ss << surt(record.m_Url) << " " << date << " " << record.m_Url << " "
+       << (mime.empty() ? "-" : mime) << " " << statusCode << " " << payloadDigest << " - - "
+       << responseLength << " " << offset << " " << m_FileName;
+
+    m_Index.push_back(ss.str());
+    m_Records++;
+    m_FileRecords++;
+}
+
+size_t CWarcWriter::getRecords() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Records;
+}
+
+size_t CWarcWriter::getBytes() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Bytes;
+}
+
+bool CWarcWriter::rotate()
+{
+    if (m_File.is_open())
+    {
+        m_File.close();
+
+        if (m_File.fail())
+        {
+            LOG_ERROR("Can't finish WARC file " + m_FileName);
+            return false;
+        }
+    }
+
+    stringstream ss;
+    ss << m_Prefix << "-" << std::setw(5) << std::setfill('0') << m_FileIndex++ << ".warc.gz";
+
+    string path = ss.str();
+    m_FileName = fs::path(path).filename().string();
+    m_FileSize = 0;
+    m_FileRecords = 0;
+
+    // Large buffer, the records are flushed to the disk in big sequential writes
+    m_File.rdbuf()->pubsetbuf(m_Buffer.data(), m_Buffer.size());
+    m_File.open(path, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+
+    if (!m_File.is_open())
+    {
+        LOG_ERROR("Can't create WARC file " + path);
+        return false;
+    }
+
+    LOG_VERBOSE("Writing WARC file " + path);
+
+    string fields = "software: wget-clone\r\n"
+                    "format: WARC File Format 1.1\r\n"
+                    "conformsTo: https://iipc.github.io/warc-specifications/specifications/warc-format/warc-1.1/\r\n";
+
+    ss.str("");
+    ss << "WARC/1.1\r\n"
+       << "WARC-Type: warcinfo\r\n"
+       << "WARC-Record-ID: " << recordId() << "\r\n"
+       << "WARC-Date: " << now() << "\r\n"
+       << "WARC-Filename: " << m_FileName << "\r\n"
+       << "Content-Type: application/warc-fields\r\n"
+       << "Content-Length: " << fields.length() << "\r\n"
+       << "\r\n"
+       << fields
+       << "\r\n\r\n";
+
+    string warcinfo = gzip(ss.str());
+    write(warcinfo);
+
+    if (warcinfo.empty() || m_File.fail())
+    {
+        LOG_ERROR("Can't write WARC file " + path);
+        return false;
+    }
+
+    return true;
+}
+
+void CWarcWriter::fail(const string &reason)
+{
+    LOG_ERROR("WARC archiving stopped, " + reason);
+
+    m_Enabled = false;
+    m_Failed = true;
+}
+
+void CWarcWriter::write(const string &data)
+{
+    write(data.data(), data.length());
+}
+
+void CWarcWriter::write(const char *data, size_t length)
+{
+    m_File.write(data, length);
+    m_FileSize += length;
+    m_Bytes += length;
+}
+
+string CWarcWriter::gzip(const string &record)
+{
+    z_stream stream = z_stream();
+
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return "";
+
+    string buffer(deflateBound(&stream, record.length()), '\0');
+
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(record.data()));
+    stream.avail_in = record.length();
+    stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+    stream.avail_out = buffer.length();
+    int result = deflate(&stream, Z_FINISH);
+    buffer.resize(buffer.length() - stream.avail_out);
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END)
+        return "";
+
+    uLong crc = crc32(0, reinterpret_cast<const Bytef *>(record.data()), record.length());
+    return GZIP_HEADER + buffer + trailer(crc, record.length());
+}
+
+string CWarcWriter::trailer(uLong crc, size_t length)
+{
+    string result(8, '\0');
+
+    // Little endian CRC-32 and size modulo 2^32
+    for (int i = 0; i < 4; i++)
+    {
+        result[i] = static_cast<char>((crc >> (8 * i)) & 0xff);
+        result[4 + i] = static_cast<char>((length >> (8 * i)) & 0xff);
+    }
+
+    return result;
+}
+
+string CWarcWriter::recordId()
+{
+    unsigned char bytes[16];
+    RAND_bytes(bytes, sizeof(bytes));
+
+    // UUID version 4
+    bytes[6] = (bytes[6] & 0x0f) | 0x40;
+    bytes[8] = (bytes[8] & 0x3f) | 0x80;
+
+    stringstream ss;
+    ss << "<urn:uuid:" << std::hex << std::setfill('0');
+
+    for (int i = 0; i < 16; i++)
+    {
+        if (i == 4 || i == 6 || i == 8 || i == 10)
+            ss << "-";
+        ss << std::setw(2) << static_cast<int>(bytes[i]);
+    }
+
+    ss << ">";
+    return ss.str();
+}
+
+string CWarcWriter::now()
+{
+    std::time_t time = std::time(nullptr);
+    std::tm utc;
+    gmtime_r(&time, &utc);
+
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return buffer;
+}
+
+string CWarcWriter::surt(const string &url)
+{
+    string rest = url;
+
+    size_t schemeEnd = rest.find("://");
+    if (schemeEnd != string::npos)
+        rest = rest.substr(schemeEnd + 3);
+
+    size_t pathStart = rest.find_first_of("/?");
+    string authority = Utils::toLowerCase(rest.substr(0, pathStart));
+    string path = pathStart == string::npos ? "/" : rest.substr(pathStart);
+
+    if (path[0] != '/')
+        path = "/" + path;
+
+    string port;
+    size_t portStart = authority.find(':');
+    if (portStart != string::npos)
+    {
+        port = authority.substr(portStart);
+        authority = authority.substr(0, portStart);
+    }
+
+    if (Utils::startsWith(authority, "www."))
+        authority = authority.substr(4);
+
+    // Reverse the domain parts
+    vector<string> parts = Utils::splitString(authority, ".");
+    string host;
+
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it)
+        host += (host.empty() ? "" : ",") + *it;
+
+    return host + port + ")" + Utils::toLowerCase(path);
+}
+
+string CWarcWriter::base32(const string &data)
+{
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+    string result;
+    unsigned buffer = 0;
+    int bits = 0;
+
+    for (unsigned char c : data)
+    {
+        buffer = (buffer << 8) | c;
+        bits += 8;
+
+        while (bits >= 5)
+        {
+            result += ALPHABET[(buffer >> (bits - 5)) & 31];
+            bits -= 5;
+        }
+    }
+
+    if (bits > 0)
+        result += ALPHABET[(buffer << (5 - bits)) & 31];
+
+    while (result.length() % 8 != 0)
+        result += '=';
+
+    return result;
+}
+
+CWarcWriter &CWarcWriter::getInstance()
+{
+    static CWarcWriter instance;
+    return instance;
+}
@@ -0,0 +1,306 @@
+/**
+ * @file CWarcWriter.h
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief Header file for CWarcWriter
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <openssl/evp.h>
+#include <zlib.h>
+
+using std::string, std::vector;
+
+/**
+ * @brief WARC archive singleton, stores the request and response records of every download into rotating
+ * .warc.gz files and writes a CDX index of the responses alongside
+ *
+ * Every record is a separate gzip member, so the CDX offsets allow reading any response without decompressing
+ * the whole file. The response body is compressed while it's being received, big bodies are spooled to an unlinked
+ * temporary file next to the archive, so they are never held in memory. The records are then appended to the current
+ * file in one sequential write.
+ *
+ */
+class CWarcWriter
+{
+public:
+    /**
+     * @brief Response record being received, compresses and hashes the data as they come
+     *
+     */
+    struct TRecord
+    {
+        TRecord() = default;
+        ~TRecord();
+
+        TRecord(TRecord &&other) noexcept = default;
+        TRecord &operator=(TRecord &&other) noexcept = default;
+
+        TRecord(const TRecord &) = delete;
+        TRecord &operator=(const TRecord &) = delete;
+
+        /**
+         * @brief Returns true if the record was started by CWarcWriter::begin
+         *
+         * @return true
+         * @return false
+         */
+        bool isActive() const;
+
+        /**
+         * @brief Add received part of the response body
+         *
+         * @param data
+         */
+        void append(const string &data);
+
+    private:
+        friend class CWarcWriter;
+
+        /**
+         * @brief Deleter of the OpenSSL digest context
+         *
+         */
+        struct TDigestDeleter
+        {
+            void operator()(EVP_MD_CTX *ctx) const { EVP_MD_CTX_free(ctx); }
+        };
+
+        /**
+         * @brief Deleter of the spool file
+         *
+         */
+        struct TFileDeleter
+        {
+            void operator()(FILE *file) const { fclose(file); }
+        };
+
+        std::unique_ptr<z_stream> m_Stream;
+        std::unique_ptr<EVP_MD_CTX, TDigestDeleter> m_BlockDigest;
+        std::unique_ptr<EVP_MD_CTX, TDigestDeleter> m_PayloadDigest;
+
+        string m_Url;
+        string m_Date;
+        string m_Request;
+        string m_SpoolPrefix;
+        string m_Compressed;
+        std::unique_ptr<FILE, TFileDeleter> m_Spool;
+        size_t m_CompressedLength = 0;
+        uLong m_Crc = 0;
+        size_t m_StreamLength = 0;
+        size_t m_BlockLength = 0;
+
+        /**
+         * @brief Compress the data into m_Compressed and update the checksums
+         *
+         * @param data
+         * @param length
+         * @param flush zlib flush mode
+         */
+        void compress(const char *data, size_t length, int flush);
+
+        /**
+         * @brief Move m_Compressed to the spool file, created on the first call, the record is dropped if it fails
+         *
+         */
+        void spool();
+
+        /**
+         * @brief Log the error and stop the record, it's not archived
+         *
+         * @param reason
+         */
+        void drop(const string &reason);
+    };
+
+    /**
+     * @brief Start writing the archive, files are named <prefix>-00000.warc.gz and the index <prefix>.cdx
+     *
+     * @param prefix Path and name prefix of the files
+     * @param maxFileSize When the current file exceeds this size, the next one is started
+     * @return true
+     * @return false If the file can't be created
+     */
+    bool open(const string &prefix, size_t maxFileSize);
+
+    /**
+     * @brief Finish the current file and write the sorted CDX index, also after the writing failed
+     *
+     * @return true
+     * @return false If the archive or the index could not be written completely
+     */
+    bool close();
+
+    /**
+     * @brief Returns true if the archive is open
+     *
+     * @return true
+     * @return false
+     */
+    bool isEnabled() const;
+
+    /**
+     * @brief Start the response record after the header is received
+     *
+     * @param url Requested URL
+     * @param request Raw HTTP request sent to the server
+     * @param header Raw HTTP response header including the empty line
+     * @return TRecord
+     */
+    TRecord begin(const string &url, const string &request, const string &header);
+
+    /**
+     * @brief Append the request and response records to the archive
+     *
+     * @param record
+     * @param statusCode HTTP status for the index
+     * @param contentType Content-Type header for the index
+     * @param truncated True if less than Content-Length was received
+     */
+    void commit(TRecord &&record, int statusCode, const string &contentType, bool truncated);
+
+    /**
+     * @brief Get the number of archived responses
+     *
+     * @return size_t
+     */
+    size_t getRecords() const;
+
+    /**
+     * @brief Get the number of compressed bytes written to all files
+     *
+     * @return size_t
+     */
+    size_t getBytes() const;
+
+    /**
+     * @brief Get the SURT form of the URL used as the CDX key (eg. "com,example)/index.html")
+     *
+     * @param url
+     * @return string
+     */
+    static string surt(const string &url);
+
+    /**
+     * @brief Get the RFC 4648 base32 encoding of the data, used for SHA-1 digests
+     *
+     * @param data
+     * @return string
+     */
+    static string base32(const string &data);
+
+    // Singleton stuff:
+
+    /**
+     * @brief Get the singleton instance of CWarcWriter
+     *
+     * @return CWarcWriter&
+     */
+    static CWarcWriter &getInstance();
+
+    /**
+     * @brief Disabled copy constructor because of CWarcWriter being singleton
+     *
+     */
+    CWarcWriter(const CWarcWriter &) = delete;
+
+    /**
+     * @brief Disabled operator= because of CWarcWriter being singleton
+     *
+     */
+    void operator=(const CWarcWriter &) = delete;
+
+private:
+    CWarcWriter() = default;
+    ~CWarcWriter();
+
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+    static constexpr size_t SPOOL_THRESHOLD = 64 * 1024;
+
+    mutable std::mutex m_Mutex;
+    bool m_Enabled = false;
+    bool m_Failed = false;
+
+    string m_Prefix;
+    size_t m_MaxFileSize = 0;
+    size_t m_FileIndex = 0;
+    string m_FileName;
+    size_t m_FileSize = 0;
+    size_t m_FileRecords = 0;
+    std::ofstream m_File;
+    vector<char> m_Buffer;
+
+    vector<string> m_Index;
+    size_t m_Records = 0;
+    size_t m_Bytes = 0;
+
+    /**
+     * @brief Start the next .warc.gz file with its warcinfo record
+     *
+     * @return true
+     * @return false
+     */
+    bool rotate();
+
+    /**
+     * @brief Stop archiving after a write error, the records written so far are indexed by close()
+     *
+     * @param reason
+     */
+    void fail(const string &reason);
+
+    /**
+     * @brief Append the data to the current file
+     *
+     * @param data
+     */
+    void write(const string &data);
+
+    /**
+     * @brief Append the data to the current file
+     *
+     * @param data
+     * @param length
+     */
+    void write(const char *data, size_t length);
+
+    /**
+     * @brief Compress the whole record into a gzip member
+     *
+     * @param record
+     * @return string Empty if the compression failed
+     */
+    static string gzip(const string &record);
+
+    /**
+     * @brief Get the gzip member trailer
+     *
+     * @param crc CRC-32 of the uncompressed data
+     * @param length Length of the uncompressed data
+     * @return string
+     */
+    static string trailer(uLong crc, size_t length);
+
+    /**
+     * @brief Get new "<urn:uuid:...>" record id
+     *
+     * @return string
+     */
+    static string recordId();
+
+    /**
+     * @brief Get the current UTC time as WARC-Date (eg. "2022-05-01T12:00:00Z")
+     *
+     * @return string
+     */
+    static string now();
+};
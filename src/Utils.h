@@ -74,4 +74,12 @@ namespace Utils
      */
     std::vector<std::string> splitString(const std::string &str, const std::string &delimiter);
 
+    /**
+     * @brief Appends the code point encoded as UTF-8
+     *
+     * @param str String to append to
+     * @param codePoint Unicode code point
+     */
+    void appendUtf8(std::string &str, unsigned long codePoint);
+
 } // namespace Utils
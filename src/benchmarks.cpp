@@ -0,0 +1,1566 @@
+/**
+ * @file benchmarks.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ */
+
+#ifdef IS_BENCH
+
+#include "CByteScanner.h"
+#include "CConfig.h"
+#include "CCssTokenizer.h"
+#include "CDirectoryCache.h"
+#include "CDomainMatcher.h"
+#include "CEditList.h"
+#include "CHtmlTokenizer.h"
+#include "CHttpsDownloader.h"
+#include "CInternTable.h"
+#include "CLogger.h"
+#include "CMetrics.h"
+#include "CRegexRegistry.h"
+#include "CTracer.h"
+#include "CURLHandler.h"
+#include "CURLParser.h"
+#include "Utils.h"
+
+#include <algorithm> // min
+#include <atomic>
+#include <chrono>
+#include <cstring> // memchr
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+#include <regex>
+#include <set>
+#include <unordered_set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::string, std::cout, std::endl;
+namespace fs = std::filesystem;
+
+/**
+ * @brief Number of heap allocations made by the whole process
+ *
+ */
+static std::atomic<size_t> ALLOCATIONS{0};
+
+// Not inlined, so the compiler doesn't pair the malloc() and free() with the new and delete expressions of the callers
+__attribute__((noinline)) void *operator new(size_t size)
+{
+     ALLOCATIONS++;
+
+     if (void *memory = malloc(size > 0 ? size : 1))
+          return memory;
+
+     throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *memory) noexcept
+{
+     free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void *memory, size_t) noexcept
+{
+     free(memory);
+}
+
+namespace Benchmarks
+{
+     /**
+      * @brief Number of syscalls made by the workload, by kind
+      *
+      */
+     struct TSyscalls
+     {
+          size_t m_Stat = 0;
+          size_t m_Mkdir = 0;
+          size_t m_Total = 0;
+     };
+
+     /**
+      * @brief Run the workload in a traced child process and count its syscalls
+      *
+      * @param workload
+      * @return TSyscalls
+      */
+     TSyscalls countSyscalls(const std::function<void()> &workload)
+     {
+          TSyscalls count;
+
+          pid_t child = fork();
+          if (child == 0)
+          {
+               ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+               raise(SIGSTOP);
+               workload();
+               _exit(0);
+          }
+
+          int status;
+          waitpid(child, &status, 0);
+          ptrace(PTRACE_SETOPTIONS, child, nullptr, PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+
+          while (true)
+          {
+               ptrace(PTRACE_SYSCALL, child, nullptr, nullptr);
+               if (waitpid(child, &status, 0) < 0 || WIFEXITED(status) || WIFSIGNALED(status))
+                    break;
+
+               if (!WIFSTOPPED(status) || WSTOPSIG(status) != (SIGTRAP | 0x80))
+                    continue;
+
+               __ptrace_syscall_info info;
+               if (ptrace(PTRACE_GET_SYSCALL_INFO, child, sizeof(info), &info) <= 0 || info.op != PTRACE_SYSCALL_INFO_ENTRY)
+                    continue;
+
+               count.m_Total++;
+
+               switch (info.entry.nr)
+               {
+#ifdef SYS_stat
+               case SYS_stat:
+               case SYS_lstat:
+               case SYS_access:
+#endif
+               case SYS_newfstatat:
+               case SYS_statx:
+               case SYS_faccessat:
+                    count.m_Stat++;
+                    break;
+#ifdef SYS_mkdir
+               case SYS_mkdir:
+#endif
+               case SYS_mkdirat:
+                    count.m_Mkdir++;
+                    break;
+               default:
+                    break;
+               }
+          }
+
+          return count;
+     }
+
+     /**
+      * @brief Run the workload once and return its duration in milliseconds
+      *
+      * @param workload
+      * @return double
+      */
+     double measure(const std::function<void()> &workload)
+     {
+          auto start = std::chrono::steady_clock::now();
+          workload();
+          return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+     }
+
+     /**
+      * @brief Save many small files into few folders, once with the per-file exists/create_directories
+      * walk and once through CDirectoryCache
+      *
+      */
+     void directoryCache()
+     {
+          const int FILES = 5000;
+          const int DIRECTORIES = 20;
+
+          fs::path outputPath = fs::temp_directory_path() / "wget_clone_dircache_bench";
+
+          auto saveAll = [&](bool cached)
+          {
+               auto &cache = CDirectoryCache::getInstance();
+
+               for (int i = 0; i < FILES; i++)
+               {
+                    fs::path dir = outputPath / "site" / ("dir" + std::to_string(i % DIRECTORIES)) / "sub";
+                    string file = (dir / ("file" + std::to_string(i) + ".html")).string();
+
+                    if (cached)
+                    {
+                         if (cache.fileExists(file))
+                              continue;
+                         cache.create(dir.string());
+                    }
+                    else
+                    {
+                         if (fs::exists(file))
+                              continue;
+                         fs::create_directories(dir);
+                    }
+
+                    std::ofstream(file, std::ios::binary) << "lorem";
+               }
+          };
+
+          cout << std::left << std::setw(10) << "variant"
+               << std::right << std::setw(12) << "stat" << std::setw(12) << "mkdir"
+               << std::setw(12) << "total" << std::setw(12) << "time [ms]" << endl;
+
+          for (bool cached : {false, true})
+          {
+               auto cleanup = [&]
+               {
+                    fs::remove_all(outputPath);
+                    CDirectoryCache::getInstance().clear();
+               };
+
+               cleanup();
+               TSyscalls syscalls = countSyscalls([&]
+                                                  { saveAll(cached); });
+               // Best of a few runs, the disk is noisy
+               double time = 0;
+               for (int run = 0; run < 3; run++)
+               {
+                    cleanup();
+                    double current = measure([&]
+                                             { saveAll(cached); });
+                    time = run == 0 ? current : std::min(time, current);
+               }
+
+               cout << std::left << std::setw(10) << (cached ? "cached" : "legacy")
+                    << std::right << std::setw(12) << syscalls.m_Stat << std::setw(12) << syscalls.m_Mkdir
+                    << std::setw(12) << syscalls.m_Total << std::setw(12) << std::fixed << std::setprecision(1) << time << endl;
+          }
+
+          fs::remove_all(outputPath);
+     }
+
+     /**
+      * @brief Generate a page similar to a real website, with text, navigation, images, srcsets and scripts
+      *
+      * @param size Approximate size in bytes
+      * @return string
+      */
+     string generateHtml(size_t size)
+     {
+          string html = "<!DOCTYPE html>\n<html lang=\"en\">\n<head>\n<meta charset=\"utf-8\">\n<title>Benchmark page</title>\n"
+                        "<link rel=\"stylesheet\" href=\"/assets/main.css\">\n<script src=\"/assets/app.js\"></script>\n</head>\n<body>\n";
+
+          for (int i = 0; html.length() < size; i++)
+          {
+               string n = std::to_string(i);
+
+               html += "<div class=\"article\" id=\"article-" + n + "\">\n"
+                       "<h2><a href=\"/articles/" + n + ".html\">Article number " + n + "</a></h2>\n"
+                       "<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore et dolore "
+                       "magna aliqua. Ut enim ad minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo "
+                       "consequat. Duis aute irure dolor in reprehenderit in voluptate velit esse cillum dolore eu fugiat nulla.</p>\n"
+                       "<img src=\"images/photo-" + n + ".jpg\" alt=\"Photo " + n + "\" width=\"640\" height=\"480\">\n"
+                       "<img srcset=\"images/thumb-" + n + ".png 1x, images/thumb-" + n + "@2x.png 2x\" alt=\"\">\n"
+                       "<p>See also <a href=\"https://example.com/page-" + n + ".html\">the source</a>, "
+                       "<a href=\"#comments\">comments</a> or <a href=\"mailto:info@example.com\">write us</a>.</p>\n"
+                       "<script>window.stats.push({id: " + n + ", url: 'track.js'});</script>\n"
+                       "</div>\n";
+          }
+
+          return html + "</body>\n</html>\n";
+     }
+
+     /**
+      * @brief Link extraction from the previous versions, a separate std::regex scan for every kind of link
+      *
+      * @param content
+      * @return size_t Number of found links
+      */
+     size_t legacyHtmlLinks(string content)
+     {
+          auto getUrls = [](const string &pattern, const string &text)
+          {
+               std::set<string> urls;
+               const std::regex re(pattern, std::regex_constants::icase);
+
+               for (std::sregex_iterator it(text.begin(), text.end(), re), end; it != end; ++it)
+                    urls.emplace((*it)[1]);
+
+               return urls;
+          };
+
+          const std::regex root("(srcset=|src=|href=)[\"']\\/([^\\/][^\"']*)[\"']", std::regex_constants::icase);
+          content = std::regex_replace(content, root, "$1\"../$2\"");
+
+          size_t found = 0;
+          found += getUrls("(?:src=|href=)[\"'](?!http:\\/\\/|https:\\/\\/|data:|tel:|javascript:|mailto:|\\/\\/)([^\"'#]*)(#?[^\"']*)[\"']", content).size();
+
+          for (const auto &srcset : getUrls("(?:srcset=)[\"'](?!http:\\/\\/|https:\\/\\/|data:|tel:|javascript:|mailto:|\\/\\/)([^\"'#]*)(#?[^\"']*)[\"']", content))
+               found += getUrls("([^\"'=\\s]+\\.[^\\s]+)", srcset).size();
+
+          found += getUrls("(?:src=|href=)[\"']((?:http:\\/\\/|https:\\/\\/)[^\"'#]*)(#?[^\"']*)[\"']", content).size();
+
+          return found;
+     }
+
+     /**
+      * @brief Compare the regex link extraction with CHtmlTokenizer
+      *
+      */
+     void htmlTokenizer()
+     {
+          string html = generateHtml(256 * 1024);
+          double megabytes = html.length() / (1024.0 * 1024.0);
+
+          auto report = [&](const string &name, const std::function<size_t()> &extract, int runs)
+          {
+               size_t links = 0;
+               double time = measure([&]
+                                     { for (int i = 0; i < runs; i++) links = extract(); }) /
+                             runs;
+
+               cout << std::left << std::setw(12) << name
+                    << std::right << std::setw(10) << links << " links"
+                    << std::setw(12) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(1) << megabytes / (time / 1000) << " MB/s" << endl;
+
+               return time;
+          };
+
+          cout << "Page size: " << html.length() / 1024 << " kB" << endl;
+
+          double legacy = report("regex", [&]
+                                 { return legacyHtmlLinks(html); },
+                                 3);
+
+          double tokenizer = report("tokenizer", [&]
+                                    { return CHtmlTokenizer::tokenize(html).size(); },
+                                    50);
+
+          cout << "Speedup: " << std::setprecision(1) << legacy / tokenizer << "x" << endl;
+     }
+
+     /**
+      * @brief Generate a stylesheet in the style of big CSS frameworks (many rules, comments, few URLs)
+      *
+      * @param size Minimal size in bytes
+      * @return string
+      */
+     string generateCss(size_t size)
+     {
+          string css = "/*!\n * Benchmark framework v1.0.0\n * Licensed under MIT\n */\n"
+                       "@import url(\"https://fonts.example.com/css?family=Sans\");\n@import \"reboot.css\";\n"
+                       ":root { --primary: #0d6efd; --font-sans: system-ui, -apple-system, \"Segoe UI\", Roboto, sans-serif; }\n";
+
+          for (int i = 0; css.length() < size; i++)
+          {
+               string n = std::to_string(i);
+
+               css += "/* Component " + n + " */\n"
+                      ".btn-" + n + " { display: inline-block; padding: .375rem .75rem; font-size: 1rem; line-height: 1.5; "
+                      "border: 1px solid transparent; border-radius: .25rem; transition: color .15s ease-in-out, background-color .15s ease-in-out; }\n"
+                      ".btn-" + n + ":hover, .btn-" + n + ":focus { color: #fff; background-color: var(--primary); box-shadow: 0 0 0 .25rem rgba(13, 110, 253, .5); }\n"
+                      "@media (min-width: 768px) { .col-md-" + n + " { flex: 0 0 auto; width: calc(100% / 12 * " + n + "); } }\n";
+
+               if (i % 10 == 0)
+                    css += ".icon-" + n + " { background: url(\"../img/icons/" + n + ".svg\") no-repeat center / 1em; }\n"
+                           ".hero-" + n + " { background-image: image-set(\"/img/hero-" + n + ".webp\" 1x, url(/img/hero-" + n + "@2x.webp) 2x); }\n"
+                           "@font-face { font-family: \"Font" + n + "\"; src: url(../fonts/font-" + n + ".woff2) format(\"woff2\"), url('../fonts/font-" + n + ".woff') format(\"woff\"); }\n";
+          }
+
+          return css;
+     }
+
+     /**
+      * @brief Link extraction from the previous versions, a separate std::regex scan for every kind of link
+      *
+      * @param content
+      * @return size_t Number of found links
+      */
+     size_t legacyCssLinks(string content)
+     {
+          auto getUrls = [](const string &pattern, const string &text)
+          {
+               std::set<string> urls;
+               const std::regex re(pattern, std::regex_constants::icase);
+
+               for (std::sregex_iterator it(text.begin(), text.end(), re), end; it != end; ++it)
+                    urls.emplace((*it)[1]);
+
+               return urls;
+          };
+
+          const std::regex rootUrl("(?:url ?\\([\"']?(?!data:|#)((?:\\/)[^;\"'\\s]+)[\"']?)\\)", std::regex_constants::icase);
+          const std::regex rootImport("(?:@import [\"']?(?!url\\(|data:|#)((?:\\/)[^;\"'\\s]+)[\"']?)", std::regex_constants::icase);
+          content = std::regex_replace(content, rootUrl, "../$1\"");
+          content = std::regex_replace(content, rootImport, "../$1\"");
+
+          size_t found = 0;
+          found += getUrls("(?:url ?\\([\"']?(?!data:|#|http)([^;\"'\\s]+)[\"']?)\\)", content).size();
+          found += getUrls("(?:@import [\"']?(?!url\\(|data:|#|http)([^;\"'\\s]+)[\"']?)", content).size();
+          found += getUrls("(?:url ?\\([\"']?(?!data:|#)((?:http:\\/\\/|https:\\/\\/)[^;\"'\\s]+)[\"']?)\\)", content).size();
+          found += getUrls("(?:@import [\"']?(?!url\\(|data:|#)((?:http:\\/\\/|https:\\/\\/)[^;\"'\\s]+)[\"']?)", content).size();
+
+          return found;
+     }
+
+     /**
+      * @brief Compare the regex link extraction with CCssTokenizer on a framework sized stylesheet
+      *
+      */
+     void cssTokenizer()
+     {
+          string css = generateCss(1024 * 1024);
+          double megabytes = css.length() / (1024.0 * 1024.0);
+
+          auto report = [&](const string &name, const std::function<size_t()> &extract, int runs)
+          {
+               size_t links = 0;
+               double time = measure([&]
+                                     { for (int i = 0; i < runs; i++) links = extract(); }) /
+                             runs;
+
+               cout << std::left << std::setw(12) << name
+                    << std::right << std::setw(10) << links << " links"
+                    << std::setw(12) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(1) << megabytes / (time / 1000) << " MB/s" << endl;
+
+               return time;
+          };
+
+          cout << "Stylesheet size: " << css.length() / 1024 << " kB" << endl;
+
+          double legacy = report("regex", [&]
+                                 { return legacyCssLinks(css); },
+                                 1);
+
+          double tokenizer = report("tokenizer", [&]
+                                    { return CCssTokenizer::tokenize(css).size(); },
+                                    20);
+
+          cout << "Speedup: " << std::setprecision(1) << legacy / tokenizer << "x" << endl;
+     }
+
+     /**
+      * @brief Matching the HTTP status line with the pattern compiled for every call and with the precompiled
+      * pattern from CRegexRegistry
+      *
+      */
+     void regexRegistry()
+     {
+          using EPattern = CRegexRegistry::EPattern;
+
+          const int MATCHES = 20000;
+
+          std::regex_constants::syntax_option_type flags;
+          string source = CRegexRegistry::getSource(EPattern::HTTP_STATUS, flags);
+          const std::regex &compiled = CRegexRegistry::getInstance().get(EPattern::HTTP_STATUS);
+
+          auto run = [&](const std::function<bool(const string &, std::smatch &)> &match)
+          {
+               size_t matched = 0;
+               double time = measure([&]
+                                     {
+                                          for (int i = 0; i < MATCHES; i++)
+                                          {
+                                               std::smatch result;
+                                               string line = "HTTP/1.1 " + std::to_string(200 + i % 300) + " OK";
+                                               matched += match(line, result);
+                                          } });
+
+               return std::make_pair(time, matched);
+          };
+
+          auto [legacy, matchedLegacy] = run([&](const string &line, std::smatch &result)
+                                             { return std::regex_match(line, result, std::regex(source, flags)); });
+
+          auto [registry, matchedRegistry] = run([&](const string &line, std::smatch &result)
+                                                 { return std::regex_match(line, result, compiled); });
+
+          cout << std::left << std::setw(14) << "pattern" << std::right << std::setw(16) << "compile/call"
+               << std::setw(16) << "registry" << std::setw(12) << "speedup" << endl;
+
+          cout << std::left << std::setw(14) << "http status" << std::right
+               << std::setw(13) << std::fixed << std::setprecision(3) << legacy << " ms"
+               << std::setw(13) << registry << " ms"
+               << std::setw(11) << std::setprecision(1) << legacy / registry << "x"
+               << (matchedLegacy == matchedRegistry ? "" : " (results differ)") << endl;
+     }
+
+     /**
+      * @brief URL parsing from the previous versions, raw path levels normalized with stringstreams on every call
+      *
+      */
+     struct TLegacyUrl
+     {
+          bool m_IsHttps = false;
+          string m_Domain;
+          vector<string> m_PathLevels;
+
+          explicit TLegacyUrl(const string &url)
+          {
+               static const std::regex re("((?:http://|https://)?[^/]*)/?(.*)");
+               std::smatch result;
+               std::regex_match(url, result, re);
+
+               m_Domain = Utils::toLowerCase(result[1].str());
+               m_IsHttps = Utils::startsWith(m_Domain, "https://");
+               m_Domain = m_Domain.substr(m_IsHttps ? 8 : 7);
+
+               string path = result[2].str();
+               size_t start = 0, end;
+               while ((end = path.find('/', start)) != string::npos)
+               {
+                    m_PathLevels.push_back(path.substr(start, end - start));
+                    start = end + 1;
+               }
+               m_PathLevels.push_back(path.substr(start));
+          }
+
+          vector<string> getNormalizedLevels() const
+          {
+               vector<string> levels;
+               for (const auto &level : m_PathLevels)
+               {
+                    if (level == "..")
+                    {
+                         if (!levels.empty())
+                              levels.pop_back();
+                    }
+                    else if (level != "." && !level.empty())
+                         levels.push_back(level);
+               }
+               return levels;
+          }
+
+          string getNormFilePath() const
+          {
+               vector<string> levels = getNormalizedLevels();
+               std::stringstream path;
+               for (size_t i = 0; i < levels.size(); i++)
+               {
+                    path << levels[i];
+                    if (i != levels.size() - 1 || levels[i].find('.') == string::npos)
+                         path << "/";
+               }
+               return path.str();
+          }
+
+          string getNormURL() const
+          {
+               std::stringstream url;
+               url << (m_IsHttps ? "https://" : "http://") << m_Domain << "/" << getNormFilePath();
+               return url.str();
+          }
+
+          size_t getPathDepth() const
+          {
+               auto levels = getNormalizedLevels();
+               if (levels.empty())
+                    return 0;
+               return levels.back().find('.') != string::npos ? levels.size() - 1 : levels.size();
+          }
+     };
+
+     /**
+      * @brief Parse links the way CFile::transformUrlsToFiles does (construct, check the extension of the normalized
+      * URL, get the file path and the depth), count the heap allocations per link
+      *
+      */
+     void urlHandler()
+     {
+          const size_t LINKS = 20000;
+
+          vector<string> links;
+          for (size_t i = 0; i < LINKS; i++)
+               links.push_back("https://www.example.com/blog/" + std::to_string(i % 97) + "/../assets/./post-" + std::to_string(i) + ".html");
+
+          auto run = [&](const string &name, const std::function<size_t(const string &)> &parse)
+          {
+               size_t checksum = 0;
+               size_t allocations = ALLOCATIONS;
+               double time = measure([&]
+                                     { for (const auto &link : links) checksum += parse(link); });
+               allocations = ALLOCATIONS - allocations;
+
+               cout << std::left << std::setw(14) << name << std::right
+                    << std::setw(13) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(1) << static_cast<double>(allocations) / LINKS << " allocs/link"
+                    << std::setw(12) << std::setprecision(0) << time * 1000000 / LINKS << " ns/link" << endl;
+
+               return checksum;
+          };
+
+          size_t legacy = run("vector<string>", [](const string &link)
+                              {
+                                   TLegacyUrl url(link);
+                                   size_t kind = Utils::endsWith(url.getNormURL(), ".html") || Utils::endsWith(url.getNormURL(), ".php") ||
+                                                 Utils::endsWith(url.getNormURL(), "/") || Utils::endsWith(url.getNormURL(), ".css");
+                                   return kind + url.getNormFilePath().length() + url.getPathDepth(); });
+
+          size_t compact = run("CURLHandler", [](const string &link)
+                               {
+                                    CURLHandler url(link);
+                                    size_t kind = Utils::endsWith(url.getNormURL(), ".html") || Utils::endsWith(url.getNormURL(), ".php") ||
+                                                  Utils::endsWith(url.getNormURL(), "/") || Utils::endsWith(url.getNormURL(), ".css");
+                                    return kind + url.getNormFilePath().length() + url.getPathDepth(); });
+
+          if (legacy != compact)
+               cout << "(results differ)" << endl;
+     }
+
+     /**
+      * @brief Throughput of CURLParser compared with the precompiled regular expression of RFC 3986 Appendix B
+      *
+      */
+     void urlParser()
+     {
+          const size_t URLS = 20000;
+
+          vector<string> urls;
+          size_t bytes = 0;
+
+          for (size_t i = 0; i < URLS; i++)
+          {
+               string n = std::to_string(i);
+
+               switch (i % 4)
+               {
+               case 0:
+                    urls.push_back("https://www.example.com/blog/" + n + "/post-" + n + ".html");
+                    break;
+               case 1:
+                    urls.push_back("HTTP://User@Example.COM:80/a/./b/../%7euser/index.php?id=" + n + "&sort=desc#comments");
+                    break;
+               case 2:
+                    urls.push_back("../../assets/img/photo-" + n + ".jpg?v=" + n);
+                    break;
+               default:
+                    urls.push_back("https://cdn.example.org:8443/static/%e2%9c%93/" + n + "/app.min.js");
+                    break;
+               }
+
+               bytes += urls.back().length();
+          }
+
+          double megabytes = bytes / (1024.0 * 1024.0);
+          const std::regex appendixB("^(([^:/?#]+):)?(//([^/?#]*))?([^?#]*)(\\?([^#]*))?(#(.*))?");
+
+          auto run = [&](const string &name, const std::function<size_t(const string &)> &parse)
+          {
+               size_t checksum = 0;
+               double time = measure([&]
+                                     { for (const auto &url : urls) checksum += parse(url); });
+
+               cout << std::left << std::setw(16) << name << std::right
+                    << std::setw(11) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(10) << std::setprecision(0) << time * 1000000 / URLS << " ns/URL"
+                    << std::setw(10) << std::setprecision(1) << megabytes / (time / 1000) << " MB/s" << endl;
+
+               return checksum;
+          };
+
+          size_t regexPath = run("regex split", [&](const string &url)
+                                 {
+                                      std::smatch m;
+                                      std::regex_match(url, m, appendixB);
+                                      return static_cast<size_t>(m.length(5)); });
+
+          size_t parserPath = run("parse", [](const string &url)
+                                  { return CURLParser::parse(url).m_Path.length(); });
+
+          run("canonicalize", [](const string &url)
+              { return CURLParser::canonicalize(url, true).length(); });
+
+          run("resolve", [](const string &url)
+              { return CURLParser::resolve("https://www.example.com/blog/2024/index.html", url).length(); });
+
+          if (regexPath != parserPath)
+               cout << "(results differ)" << endl;
+     }
+
+     /**
+      * @brief Seen-URL checks of many files linking the same URLs, with a set of strings per file and with interned
+      * IDs, a URL is copied into every set but interned only once
+      *
+      */
+     void internTable()
+     {
+          const size_t FILES = 200;
+          const size_t URLS = 2000;
+
+          vector<string> urls;
+          for (size_t i = 0; i < URLS; i++)
+               urls.push_back("https://www.example.com/blog/" + std::to_string(i % 97) + "/post-" + std::to_string(i) + ".html");
+
+          auto run = [&](const string &name, const std::function<size_t()> &check)
+          {
+               size_t allocations = ALLOCATIONS;
+               size_t inserted = 0;
+               double time = measure([&]
+                                     { inserted = check(); });
+               allocations = ALLOCATIONS - allocations;
+
+               cout << std::left << std::setw(14) << name << std::right
+                    << std::setw(13) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(2) << static_cast<double>(allocations) / (FILES * URLS) << " allocs/link"
+                    << std::setw(10) << inserted << " inserted" << endl;
+          };
+
+          run("set<string>", [&]
+              {
+                   size_t inserted = 0;
+                   for (size_t file = 0; file < FILES; file++)
+                   {
+                        std::set<string> scheduled;
+                        for (size_t i = 0; i < URLS; i++)
+                             inserted += scheduled.insert(urls[(i * 7 + file) % URLS]).second;
+                   }
+                   return inserted; });
+
+          run("interned IDs", [&]
+              {
+                   auto &table = CInternTable::getInstance();
+                   size_t inserted = 0;
+                   for (size_t file = 0; file < FILES; file++)
+                   {
+                        std::unordered_set<CInternTable::TId> scheduled;
+                        for (size_t i = 0; i < URLS; i++)
+                             inserted += scheduled.insert(table.intern(urls[(i * 7 + file) % URLS])).second;
+                   }
+                   return inserted; });
+     }
+
+     /**
+      * @brief Previous CLogger, formatting each message with a stringstream and writing it with endl under a mutex
+      *
+      */
+     struct TLegacyLogger
+     {
+          std::ofstream m_Ofs;
+          std::mutex m_Mutex;
+
+          explicit TLegacyLogger(const string &path)
+              : m_Ofs(path, std::ios_base::app) {}
+
+          void log(const string &msg)
+          {
+               std::stringstream ss;
+
+               time_t now = time(0);
+               struct tm tstruct;
+               char buf[80];
+               tstruct = *localtime(&now);
+               strftime(buf, sizeof(buf), "%Y-%m-%d %X", &tstruct);
+
+               ss << "[INFO] (" << buf << "): " << msg;
+
+               std::lock_guard<std::mutex> lock(m_Mutex);
+               m_Ofs << ss.str() << endl;
+          }
+     };
+
+     /**
+      * @brief Workers logging many messages to a file at once, with the synchronous logger and with the ring buffer
+      * of CLogger, the time until the producers are done and until everything is written
+      *
+      */
+     void loggerThroughput()
+     {
+          const int THREADS = 4;
+          const int MESSAGES = 50000;
+
+          string path = (fs::temp_directory_path() / "wget_clone_logger_bench.log").string();
+
+          auto produce = [&](const std::function<void(const string &)> &log)
+          {
+               vector<std::thread> threads;
+               for (int t = 0; t < THREADS; t++)
+                    threads.emplace_back([&log, t]
+                                         {
+                                              string msg = "Processing HTML: https://www.example.com/blog/" + std::to_string(t) + "/post.html | (depth 2)";
+                                              for (int i = 0; i < MESSAGES; i++)
+                                                   log(msg); });
+
+               for (auto &thread : threads)
+                    thread.join();
+          };
+
+          auto print = [&](const string &name, double producers, double total)
+          {
+               cout << std::left << std::setw(14) << name << std::right << std::fixed << std::setprecision(3)
+                    << std::setw(13) << producers << " ms producers"
+                    << std::setw(13) << total << " ms total"
+                    << std::setw(12) << std::setprecision(0) << THREADS * MESSAGES / total * 1000 << " msgs/s" << endl;
+          };
+
+          {
+               fs::remove(path);
+               TLegacyLogger logger(path);
+
+               double time = measure([&]
+                                     { produce([&](const string &msg)
+                                               { logger.log(msg); }); });
+               print("synchronous", time, time);
+          }
+
+          {
+               fs::remove(path);
+               CLogger logger(CLogger::ELogLevel::Info);
+               logger.setToFile(path);
+
+               double producers = 0;
+               double total = measure([&]
+                                      {
+                                           producers = measure([&]
+                                                               { produce([&](const string &msg)
+                                                                         { logger.log(CLogger::ELogLevel::Info, msg); }); });
+                                           logger.flush(); });
+               print("ring buffer", producers, total);
+          }
+
+          fs::remove(path);
+     }
+
+     /**
+      * @brief Verbose messages of the crawl with the default info level, once built and passed to log() and once
+      * with LOG_AT, which checks the level first
+      *
+      */
+     void loggerDisabled()
+     {
+          const size_t MESSAGES = 1000000;
+
+          CLogger logger(CLogger::ELogLevel::Info);
+          CURLHandler url("https://www.example.com/blog/2024/post.html");
+          size_t depth = 2;
+
+          auto run = [&](const string &name, const std::function<void()> &log)
+          {
+               size_t allocations = ALLOCATIONS;
+               double time = measure(log);
+               allocations = ALLOCATIONS - allocations;
+
+               cout << std::left << std::setw(14) << name << std::right
+                    << std::setw(13) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(2) << static_cast<double>(allocations) / MESSAGES << " allocs/message" << endl;
+          };
+
+          run("eager", [&]
+              {
+                   for (size_t i = 0; i < MESSAGES; i++)
+                        logger.log(CLogger::ELogLevel::Verbose, "Processing: " + url.getNormURL() + " | (depth " + std::to_string(depth) + ")"); });
+
+          run("lazy", [&]
+              {
+                   for (size_t i = 0; i < MESSAGES; i++)
+                        LOG_AT(logger, CLogger::ELogLevel::Verbose, "Processing: " + url.getNormURL() + " | (depth " + std::to_string(depth) + ")"); });
+     }
+
+     /**
+      * @brief Settings read on the hot paths (per link and per request), once from the string map and once from
+      * the typed snapshot
+      *
+      */
+     void configLookups()
+     {
+          const size_t LOOKUPS = 1000000;
+          auto &cfg = CConfig::getInstance();
+
+          auto run = [&](const string &name, const std::function<size_t()> &lookup)
+          {
+               size_t allocations = ALLOCATIONS;
+               size_t sum = 0;
+               double time = measure([&]
+                                     { sum = lookup(); });
+               allocations = ALLOCATIONS - allocations;
+
+               cout << std::left << std::setw(14) << name << std::right
+                    << std::setw(13) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(2) << static_cast<double>(allocations) / LOOKUPS << " allocs/lookup"
+                    << std::setw(10) << sum << endl;
+          };
+
+          run("string map", [&]
+              {
+                   size_t sum = 0;
+                   for (size_t i = 0; i < LOOKUPS; i++)
+                        sum += static_cast<int>(cfg["depth"]) + static_cast<bool>(cfg["remote_images"]);
+                   return sum; });
+
+          run("snapshot", [&]
+              {
+                   size_t sum = 0;
+                   for (size_t i = 0; i < LOOKUPS; i++)
+                        sum += cfg.getSnapshot().m_Depth + cfg.getSnapshot().m_RemoteImages;
+                   return sum; });
+     }
+
+     /**
+      * @brief Allowlist checks against a list of many domains, with a substring search in the comma separated list
+      * and with the compiled CDomainMatcher
+      *
+      */
+     void domainMatcher()
+     {
+          const size_t LOOKUPS = 1000;
+
+          cout << std::left << std::setw(10) << "domains" << std::right << std::setw(16) << "substring"
+               << std::setw(16) << "matcher" << std::setw(16) << "compile" << endl;
+
+          for (size_t domains : {100, 10000, 100000})
+          {
+               string list;
+               for (size_t i = 0; i < domains; i++)
+                    list += (i % 2 ? "*.site-" : "site-") + std::to_string(i) + ".example.com,";
+
+               vector<string> hosts;
+               for (size_t i = 0; i < LOOKUPS; i++)
+                    hosts.push_back((i % 3 ? "cdn.site-" : "site-") + std::to_string((i * 7919) % (domains * 2)) + ".example.com");
+
+               size_t substringMatches = 0;
+               double substring = measure([&]
+                                          {
+                                               for (const auto &host : hosts)
+                                                    substringMatches += Utils::contains(list, host); });
+
+               auto &matcher = CDomainMatcher::getInstance();
+               double compile = measure([&]
+                                        { matcher.setRules(list); });
+
+               size_t matcherMatches = 0;
+               double matched = measure([&]
+                                        {
+                                             for (const auto &host : hosts)
+                                                  matcherMatches += matcher.matches(host); });
+
+               cout << std::left << std::setw(10) << domains << std::right << std::fixed << std::setprecision(3)
+                    << std::setw(13) << substring << " ms" << std::setw(13) << matched << " ms"
+                    << std::setw(13) << compile << " ms"
+                    << "  (" << substringMatches << " vs " << matcherMatches << " matches)" << endl;
+          }
+
+          CDomainMatcher::getInstance().setRules("");
+     }
+
+     /**
+      * @brief Rewrite of external links, once with replaceAll for every link and once with one pass of CEditList
+      *
+      */
+     void linkRewrite()
+     {
+          cout << std::left << std::setw(10) << "size" << std::right << std::setw(10) << "links"
+               << std::setw(16) << "replaceAll" << std::setw(16) << "edit list" << endl;
+
+          for (size_t size : {64 * 1024, 256 * 1024, 1024 * 1024})
+          {
+               string html = generateHtml(size);
+
+               vector<std::pair<CHtmlTokenizer::TLink, string>> externals;
+               for (const auto &link : CHtmlTokenizer::tokenize(html))
+                    if (html.compare(link.m_Offset, 8, "https://") == 0)
+                         externals.emplace_back(link, "../__external/" + html.substr(link.m_Offset + 8, link.m_Length - 8));
+
+               string legacy = html;
+               double legacyTime = measure([&]
+                                           { for (const auto &[link, local] : externals)
+                                                  Utils::replaceAll(legacy, html.substr(link.m_Offset, link.m_Length), local); });
+
+               string edited = html;
+               double editTime = measure([&]
+                                         {
+                                              CEditList edits;
+                                              for (const auto &[link, local] : externals)
+                                                   edits.add(link.m_Offset, link.m_Length, local);
+                                              edits.apply(edited); });
+
+               cout << std::left << std::setw(10) << (std::to_string(size / 1024) + " kB") << std::right << std::setw(10) << externals.size()
+                    << std::setw(13) << std::fixed << std::setprecision(3) << legacyTime << " ms"
+                    << std::setw(13) << editTime << " ms"
+                    << (legacy == edited ? "" : " (outputs differ)") << endl;
+          }
+     }
+
+     /**
+      * @brief Throughput of the byte scanner kernels on text without any match
+      *
+      */
+     void byteScanner()
+     {
+          // Letters without 'u', so the whole buffer is scanned
+          string text(16 * 1024 * 1024, 'a');
+          for (size_t i = 0; i < text.length(); i++)
+               text[i] = i % 7 == 0 ? ' ' : static_cast<char>('a' + i % 19);
+
+          double gigabytes = text.length() / (1024.0 * 1024.0 * 1024.0);
+          const int runs = 20;
+
+          auto report = [&](const string &bytes, const string &name, const std::function<size_t()> &scan)
+          {
+               bool matched = false;
+               double time = measure([&]
+                                     { for (int i = 0; i < runs; i++) matched |= scan() != string::npos; }) /
+                             runs;
+
+               cout << std::left << std::setw(10) << ("\"" + bytes + "\"") << std::setw(10) << name
+                    << std::right << std::setw(12) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(10) << std::setprecision(2) << gigabytes / (time / 1000) << " GB/s"
+                    << (matched ? " (unexpected match)" : "") << endl;
+          };
+
+          for (const string bytes : {"<", "uU@", "<=\"'uU@"})
+          {
+               for (auto kernel : {CByteScanner::EKernel::SCALAR, CByteScanner::EKernel::SSE2, CByteScanner::EKernel::AVX2})
+               {
+                    if (!CByteScanner::isSupported(kernel))
+                         continue;
+
+                    CByteScanner scanner(bytes, kernel);
+                    report(bytes, CByteScanner::getName(kernel), [&]
+                           { return scanner.find(text); });
+               }
+
+               if (bytes.length() == 1)
+                    report(bytes, "memchr", [&]
+                           { return memchr(text.data(), bytes[0], text.length()) ? 0 : string::npos; });
+               else
+                    report(bytes, "std", [&]
+                           { return text.find_first_of(bytes); });
+          }
+     }
+
+     /**
+      * @brief Fetch workers counting requests and bytes, once into one shared atomic and once into the sharded
+      * counter of CMetrics
+      *
+      */
+     void metricsCounter()
+     {
+          const int THREADS = 8;
+          const int INCREMENTS = 1000000;
+
+          auto run = [&](const string &name, const std::function<void()> &increment, const std::function<uint64_t()> &get)
+          {
+               double time = measure([&]
+                                     {
+                                          vector<std::thread> threads;
+                                          for (int t = 0; t < THREADS; t++)
+                                               threads.emplace_back([&increment]
+                                                                    { for (int i = 0; i < INCREMENTS; i++) increment(); });
+
+                                          for (auto &thread : threads)
+                                               thread.join(); });
+
+               cout << std::left << std::setw(14) << name << std::right
+                    << std::setw(13) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(1) << time * 1000000 / (THREADS * INCREMENTS) << " ns/increment"
+                    << std::setw(12) << get() << endl;
+          };
+
+          std::atomic<uint64_t> shared = 0;
+          run("shared atomic", [&]
+              { shared.fetch_add(1, std::memory_order_relaxed); },
+              [&]
+              { return shared.load(); });
+
+          auto &counter = CMetrics::getInstance().counter("bench_increments_total", "Increments of the benchmark");
+          run("sharded", [&]
+              { counter.add(); },
+              [&]
+              { return counter.get(); });
+     }
+
+     /**
+      * @brief Spans as recorded for every file (about 15 per file), with tracing disabled and enabled, from several
+      * threads at once
+      *
+      */
+     void tracerSpans()
+     {
+          const int THREADS = 4;
+          const int SPANS = 250000;
+
+          auto &tracer = CTracer::getInstance();
+          string path = (fs::temp_directory_path() / "wget_clone_trace_bench.json").string();
+          CURLHandler url("https://www.example.com/blog/2024/post.html");
+
+          auto run = [&](const string &name)
+          {
+               size_t allocations = ALLOCATIONS;
+               double time = measure([&]
+                                     {
+                                          vector<std::thread> threads;
+                                          for (int t = 0; t < THREADS; t++)
+                                               threads.emplace_back([&url]
+                                                                    {
+                                                                         for (int i = 0; i < SPANS; i++)
+                                                                              CTracer::CSpan span("parse", "pipeline", url.getNormURL()); });
+
+                                          for (auto &thread : threads)
+                                               thread.join(); });
+               allocations = ALLOCATIONS - allocations;
+
+               cout << std::left << std::setw(14) << name << std::right
+                    << std::setw(13) << std::fixed << std::setprecision(3) << time << " ms"
+                    << std::setw(12) << std::setprecision(1) << time * 1000000 / (THREADS * SPANS) << " ns/span"
+                    << std::setw(12) << std::setprecision(2) << static_cast<double>(allocations) / (THREADS * SPANS) << " allocs/span" << endl;
+          };
+
+          run("disabled");
+
+          tracer.start(path);
+          run("enabled");
+
+          double write = measure([&]
+                                 { tracer.stop(); });
+          cout << std::left << std::setw(14) << "write" << std::right
+               << std::setw(13) << std::fixed << std::setprecision(3) << write << " ms"
+               << std::setw(12) << fs::file_size(path) / 1024 / 1024 << " MB" << endl;
+
+          fs::remove(path);
+     }
+
+     // ============ Microbenchmarks over the corpus ============
+
+     /**
+      * @brief Folder of the checked-in corpus of realistic pages
+      *
+      */
+     const string CORPUS_DIR = "./assets/bench/";
+
+     /**
+      * @brief Result of one microbenchmark
+      *
+      */
+     struct TMicroResult
+     {
+          string m_Name;
+          size_t m_Operations = 0;     // Operations in the measured batch
+          double m_NsPerOp = 0;        // Of the fastest batch
+          double m_BytesPerSecond = 0; // 0 if the operation doesn't process bytes
+          double m_AllocsPerOp = 0;
+     };
+
+     vector<TMicroResult> MICRO_RESULTS;
+     std::map<string, TMicroResult> MICRO_BASELINE;
+
+     /**
+      * @brief Checksums of the operations, so the compiler doesn't remove the work
+      *
+      */
+     volatile size_t SINK = 0;
+
+     /**
+      * @brief Read the file of the corpus
+      *
+      * @param name
+      * @return string
+      */
+     string readCorpus(const string &name)
+     {
+          std::ifstream file(CORPUS_DIR + name, std::ios::binary);
+          if (!file)
+               throw std::runtime_error("Cannot open " + CORPUS_DIR + name + ", run the benchmarks from the repository root!");
+
+          std::stringstream ss;
+          ss << file.rdbuf();
+          return ss.str();
+     }
+
+     /**
+      * @brief Run the operation in batches of at least 50 ms, record and print the fastest batch
+      *
+      * @param name Name of the benchmark, the key in the baseline
+      * @param bytes Bytes processed by one call, 0 if not meaningful
+      * @param items Operations done by one call (eg. URLs of a list), ns/op is per item
+      * @param op Returns a checksum of its result
+      */
+     void micro(const string &name, size_t bytes, size_t items, const std::function<size_t()> &op)
+     {
+          const double MIN_BATCH_MS = 50;
+          const int BATCHES = 5;
+
+          auto batch = [&](size_t calls)
+          {
+               return measure([&]
+                              {
+                                   size_t checksum = 0;
+                                   for (size_t i = 0; i < calls; i++)
+                                        checksum += op();
+                                   SINK = SINK + checksum; });
+          };
+
+          // Find the number of calls filling the batch
+          size_t calls = 1;
+          for (double time = batch(calls); time < MIN_BATCH_MS; time = batch(calls))
+               calls = time > 0 ? std::max(calls * 2, static_cast<size_t>(calls * MIN_BATCH_MS * 1.2 / time)) : calls * 10;
+
+          double best = std::numeric_limits<double>::max();
+          size_t allocations = 0;
+
+          for (int i = 0; i < BATCHES; i++)
+          {
+               size_t before = ALLOCATIONS;
+               best = std::min(best, batch(calls));
+               allocations = ALLOCATIONS - before;
+          }
+
+          TMicroResult result;
+          result.m_Name = name;
+          result.m_Operations = calls * items;
+          result.m_NsPerOp = best * 1000000 / result.m_Operations;
+          result.m_BytesPerSecond = bytes * calls / (best / 1000);
+          result.m_AllocsPerOp = static_cast<double>(allocations) / result.m_Operations;
+          MICRO_RESULTS.push_back(result);
+
+          cout << std::left << std::setw(26) << name << std::right << std::fixed
+               << std::setw(12) << std::setprecision(1) << result.m_NsPerOp << " ns/op"
+               << std::setw(10) << std::setprecision(1) << result.m_BytesPerSecond / 1024 / 1024 << " MB/s"
+               << std::setw(10) << std::setprecision(2) << result.m_AllocsPerOp << " allocs/op";
+
+          // Change against the baseline, a positive change is slower
+          auto baseline = MICRO_BASELINE.find(name);
+          if (baseline != MICRO_BASELINE.end() && baseline->second.m_NsPerOp > 0)
+          {
+               double change = (result.m_NsPerOp / baseline->second.m_NsPerOp - 1) * 100;
+               cout << std::setw(9) << std::showpos << std::setprecision(1) << change << std::noshowpos << " %"
+                    << (change > 10 ? " slower" : change < -10 ? " faster" : "");
+
+               if (result.m_AllocsPerOp != baseline->second.m_AllocsPerOp)
+                    cout << " (allocs " << std::setprecision(2) << baseline->second.m_AllocsPerOp << " before)";
+          }
+
+          cout << endl;
+     }
+
+     /**
+      * @brief Save the results as JSON, one benchmark per line
+      *
+      * @param path
+      * @return true If saved
+      * @return false If the file can't be written
+      */
+     bool saveResults(const string &path)
+     {
+          std::ofstream file(path, std::ios::trunc);
+          file << std::setprecision(6) << "{\"benchmarks\":[\n";
+
+          for (size_t i = 0; i < MICRO_RESULTS.size(); i++)
+          {
+               const auto &result = MICRO_RESULTS[i];
+               file << "{\"name\":\"" << result.m_Name << "\""
+                    << ",\"operations\":" << result.m_Operations
+                    << ",\"ns_per_op\":" << result.m_NsPerOp
+                    << ",\"bytes_per_second\":" << result.m_BytesPerSecond
+                    << ",\"allocs_per_op\":" << result.m_AllocsPerOp << "}"
+                    << (i + 1 < MICRO_RESULTS.size() ? ",\n" : "\n");
+          }
+
+          file << "]}\n";
+          return file.good();
+     }
+
+     /**
+      * @brief Load the results saved by saveResults() to compare with
+      *
+      * @param path
+      * @return true If loaded
+      * @return false If the file can't be read
+      */
+     bool loadBaseline(const string &path)
+     {
+          std::ifstream file(path);
+          if (!file)
+               return false;
+
+          std::regex re("\"name\":\"([^\"]*)\".*\"ns_per_op\":([^,]+),.*\"allocs_per_op\":([^}]+)\\}");
+          string line;
+          std::smatch match;
+
+          while (std::getline(file, line))
+          {
+               if (!std::regex_search(line, match, re))
+                    continue;
+
+               TMicroResult result;
+               result.m_Name = match[1];
+               result.m_NsPerOp = std::stod(match[2]);
+               result.m_AllocsPerOp = std::stod(match[3]);
+               MICRO_BASELINE[result.m_Name] = result;
+          }
+
+          return true;
+     }
+
+     /**
+      * @brief Hot operations of the crawl over the corpus: string utils, URL handling, link extraction and rewriting
+      * of HTML and CSS and parsing of HTTP headers
+      *
+      */
+     void corpus()
+     {
+          string article = readCorpus("article.html");
+          string docs = readCorpus("docs.html");
+          string css = readCorpus("style.css");
+          string responses = readCorpus("headers.txt");
+
+          // Utils
+          micro("utils/toLowerCase", article.size(), 1, [&]
+                { return Utils::toLowerCase(article).size(); });
+
+          micro("utils/splitString", article.size(), 1, [&]
+                { return Utils::splitString(article, "\n").size(); });
+
+          // Includes the copy of the page
+          micro("utils/replaceAll", article.size(), 1, [&]
+                {
+                     string page = article;
+                     return Utils::replaceAll(page, "https://", "../__external/"); });
+
+          // URLs of both pages resolved as the crawler does it
+          vector<string> urls;
+          size_t urlBytes = 0;
+          for (const auto &[page, base] : {std::make_pair(&article, "https://blog.example.com/2024/05/mirroring.html"),
+                                           std::make_pair(&docs, "https://docs.example.com/en/latest/reference/config.html")})
+               for (const auto &link : CHtmlTokenizer::tokenize(*page))
+               {
+                    string url = link.m_Value.substr(0, link.m_Value.find('#'));
+                    if (url.empty() || Utils::startsWith(url, "mailto:") || Utils::startsWith(url, "data:"))
+                         continue;
+
+                    urls.push_back(CURLParser::resolve(base, url));
+                    urlBytes += urls.back().size();
+               }
+
+          micro("url/construct", urlBytes, urls.size(), [&]
+                {
+                     size_t checksum = 0;
+                     for (const auto &url : urls)
+                          checksum += CURLHandler(url).getNormURL().size();
+                     return checksum; });
+
+          vector<CURLHandler> handlers(urls.begin(), urls.end());
+          micro("url/localPath", urlBytes, handlers.size(), [&]
+                {
+                     size_t checksum = 0;
+                     for (const auto &url : handlers)
+                          checksum += url.getNormFilePath().size() + url.getPathDepth();
+                     return checksum; });
+
+          // Link extraction
+          micro("html/tokenize article", article.size(), 1, [&]
+                { return CHtmlTokenizer::tokenize(article).size(); });
+
+          micro("html/tokenize docs", docs.size(), 1, [&]
+                { return CHtmlTokenizer::tokenize(docs).size(); });
+
+          micro("css/tokenize", css.size(), 1, [&]
+                { return CCssTokenizer::tokenize(css).size(); });
+
+          // Link rewriting as in the parse and rewrite stages, root links become relative and external links point
+          // to the local copy, includes the copy of the page
+          micro("html/rewrite article", article.size(), 1, [&]
+                {
+                     string page = article;
+                     CEditList edits;
+
+                     for (const auto &link : CHtmlTokenizer::tokenize(page))
+                     {
+                          const string &url = link.m_Value;
+
+                          if (Utils::startsWith(url, "https://"))
+                               edits.add(link.m_Offset, link.m_Length, "../../__external/" + url.substr(8));
+                          else if (url.length() > 1 && url[0] == '/' && url[1] != '/')
+                               edits.add(link.m_Offset, link.m_Length, "../.." + url);
+                     }
+
+                     edits.apply(page);
+                     return page.size(); });
+
+          micro("css/rewrite", css.size(), 1, [&]
+                {
+                     string page = css;
+                     CEditList edits;
+
+                     for (const auto &link : CCssTokenizer::tokenize(page))
+                          if (Utils::startsWith(link.m_Value, "../"))
+                               edits.add(link.m_Offset, link.m_Length, CCssTokenizer::escape(link.m_Value.substr(3), link.m_Quoted));
+
+                     edits.apply(page);
+                     return page.size(); });
+
+          // Headers of the responses, each block ends with "\r\n"
+          vector<string> headers;
+          size_t headerBytes = 0;
+          for (string header : Utils::splitString(responses, "\r\n\r\n"))
+          {
+               if (!Utils::endsWith(header, "\r\n"))
+                    header += "\r\n";
+
+               headerBytes += header.size();
+               headers.push_back(header);
+          }
+
+          CURLHandler requested("https://blog.example.com/docs/private/");
+          micro("http/parseHeader", headerBytes, headers.size(), [&]
+                {
+                     size_t checksum = 0;
+                     for (const auto &header : headers)
+                          checksum += CHttpsDownloader::parseHeader(header, requested).m_StatusCode;
+                     return checksum; });
+     }
+
+} // namespace Benchmarks
+
+int main(int argc, char const *argv[])
+{
+     string jsonPath;
+     string baselinePath;
+     bool microOnly = false;
+
+     for (int i = 1; i < argc; i++)
+     {
+          string arg = argv[i];
+
+          if (arg == "--micro")
+               microOnly = true;
+          else if (arg == "--json" && i + 1 < argc)
+               jsonPath = argv[++i];
+          else if (arg == "--baseline" && i + 1 < argc)
+               baselinePath = argv[++i];
+          else
+          {
+               cout << "Usage: " << argv[0] << " [--micro] [--json <results.json>] [--baseline <results.json>]\n"
+                    << "\t--micro\t\tRun only the microbenchmarks over the corpus\n"
+                    << "\t--json\t\tSave the microbenchmark results\n"
+                    << "\t--baseline\tCompare the microbenchmarks with the saved results" << endl;
+               return EXIT_FAILURE;
+          }
+     }
+
+     // Parsing of the headers may log
+     CLogger::init(CLogger::ELogLevel::Error);
+
+     cout << "--------- [STARTING BENCHMARKS] ---------\n"
+          << endl;
+
+     // ============ Corpus ============
+     cout << "------ [Benchmarking corpus] ------" << endl;
+
+     if (!baselinePath.empty() && !Benchmarks::loadBaseline(baselinePath))
+     {
+          cout << "Cannot read the baseline " << baselinePath << endl;
+          return EXIT_FAILURE;
+     }
+
+     Benchmarks::corpus();
+
+     if (!jsonPath.empty() && !Benchmarks::saveResults(jsonPath))
+     {
+          cout << "Cannot write the results into " << jsonPath << endl;
+          return EXIT_FAILURE;
+     }
+
+     cout << endl;
+
+     if (microOnly)
+          return 0;
+
+     // ============ CDirectoryCache ============
+     cout << "------ [Benchmarking CDirectoryCache] ------" << endl;
+
+     Benchmarks::directoryCache();
+
+     cout << endl;
+
+     // ============ CHtmlTokenizer ============
+     cout << "------ [Benchmarking CHtmlTokenizer] ------" << endl;
+
+     Benchmarks::htmlTokenizer();
+
+     cout << endl;
+
+     // ============ CCssTokenizer ============
+     cout << "------ [Benchmarking CCssTokenizer] ------" << endl;
+
+     Benchmarks::cssTokenizer();
+
+     cout << endl;
+
+     // ============ CRegexRegistry ============
+     cout << "------ [Benchmarking CRegexRegistry] ------" << endl;
+
+     Benchmarks::regexRegistry();
+
+     cout << endl;
+
+     // ============ CURLHandler ============
+     cout << "------ [Benchmarking CURLHandler] ------" << endl;
+
+     Benchmarks::urlHandler();
+     Benchmarks::urlParser();
+
+     cout << endl;
+
+     // ============ CInternTable ============
+     cout << "------ [Benchmarking CInternTable] ------" << endl;
+
+     Benchmarks::internTable();
+
+     cout << endl;
+
+     // ============ CLogger ============
+     cout << "------ [Benchmarking CLogger] ------" << endl;
+
+     Benchmarks::loggerThroughput();
+     Benchmarks::loggerDisabled();
+
+     cout << endl;
+
+     // ============ CConfig ============
+     cout << "------ [Benchmarking CConfig] ------" << endl;
+
+     Benchmarks::configLookups();
+
+     cout << endl;
+
+     // ============ CDomainMatcher ============
+     cout << "------ [Benchmarking CDomainMatcher] ------" << endl;
+
+     Benchmarks::domainMatcher();
+
+     cout << endl;
+
+     // ============ CByteScanner ============
+     cout << "------ [Benchmarking CByteScanner] ------" << endl;
+
+     Benchmarks::byteScanner();
+
+     cout << endl;
+
+     // ============ CEditList ============
+     cout << "------ [Benchmarking CEditList] ------" << endl;
+
+     Benchmarks::linkRewrite();
+
+     cout << endl;
+
+     // ============ CMetrics ============
+     cout << "------ [Benchmarking CMetrics] ------" << endl;
+
+     Benchmarks::metricsCounter();
+
+     cout << endl;
+
+     // ============ CTracer ============
+     cout << "------ [Benchmarking CTracer] ------" << endl;
+
+     Benchmarks::tracerSpans();
+
+     cout << endl;
+
+     return 0;
+}
+
+#endif
@@ -4,7 +4,7 @@
  * @brief Entry point for Wget Clone
  */
 
-#ifndef IS_TESTS
+#if !defined(IS_TESTS) && !defined(IS_BENCH)
 
 #include "CLogger.h"
 #include "CConfig.h"
@@ -13,29 +13,39 @@
 #include "CFileHtml.h"
 #include "CFileCss.h"
 #include "CURLHandler.h"
+#include "CDomainMatcher.h"
+#include "CPipeline.h"
+#include "CRequestStats.h"
+#include "CMemoryBudget.h"
+#include "CContentStore.h"
+#include "COutputWriter.h"
+#include "CWarcWriter.h"
+#include "CMetricsExporter.h"
+#include "CTracer.h"
 #include "Utils.h"
 
 #include <stdlib.h>
+#include <memory>
 
 // using namespace std;
-using std::string, std::make_shared;
+using std::string, std::make_shared, std::unique_ptr, std::make_unique;
 
 int main(int argc, char const *argv[])
 {
     // Init Logger
     CLogger::init(CLogger::ELogLevel::Info);
-    CLogger &logger = CLogger::getInstance();
 
     // Init Config and parse input
-    CConfig &cfg = CConfig::getInstance();
-    if (!cfg.parseArgs(argc, argv))
+    if (!CConfig::getInstance().parseArgs(argc, argv))
         return EXIT_SUCCESS;
 
+    const auto &cfg = CConfig::getInstance().getSnapshot();
+
     // Create Https downloader
     auto httpd = make_shared<CHttpsDownloader>();
 
-    // Create Root URL
-    CURLHandler rootUrl((string)cfg["url"]);
+    // Root URL
+    const CURLHandler &rootUrl = cfg.m_RootUrl;
 
     // Create root HTML file
     shared_ptr<CFile> rootFile;
@@ -47,19 +57,118 @@ int main(int argc, char const *argv[])
     else
         rootFile = make_shared<CFile>(httpd, 1, rootUrl);
 
+    // Setup the pipeline stages
+    CPipeline::TSettings settings;
+    settings.m_FetchWorkers = cfg.m_FetchWorkers;
+    settings.m_ParseWorkers = cfg.m_ParseWorkers;
+    settings.m_RewriteWorkers = cfg.m_RewriteWorkers;
+    settings.m_WriteWorkers = cfg.m_WriteWorkers;
+    settings.m_QueueSize = cfg.m_QueueSize;
+
+    CPipeline pipeline(settings);
+
+    // Compile the domain allowlist
+    CDomainMatcher::getInstance().setRules(cfg.m_Limit);
+
+    // Limit the content buffered in memory
+    auto &budget = CMemoryBudget::getInstance();
+    budget.setLimit(cfg.m_MemoryLimit);
+
+    // Select how the files are written
+    COutputWriter::setBackend(cfg.m_OutputBackend, cfg.m_IoThreads);
+    LOG_VERBOSE("Output backend: " + COutputWriter::getInstance().getName());
+
+    // Store identical content only once
+    auto &store = CContentStore::getInstance();
+    store.setEnabled(cfg.m_Dedup);
+
+    // Write the timings of every request
+    auto &requestStats = CRequestStats::getInstance();
+
+    if (!cfg.m_RequestLog.empty() && !requestStats.openLog(cfg.m_RequestLog))
+    {
+        LOG_ERROR("Cannot open the request log " + cfg.m_RequestLog);
+        return EXIT_FAILURE;
+    }
+
+    // Archive the responses instead of saving separate files
+    auto &warc = CWarcWriter::getInstance();
+
+    if (cfg.m_Warc &&
+        !warc.open(cfg.m_Output + "/crawl", cfg.m_WarcMaxSize))
+        return EXIT_FAILURE;
+
+    // Export the metrics during the crawl
+    unique_ptr<CMetricsExporter> exporter;
+
+    try
+    {
+        if (!cfg.m_MetricsFile.empty() || cfg.m_MetricsPort > 0)
+            exporter = make_unique<CMetricsExporter>(cfg.m_MetricsFile,
+                                                     cfg.m_MetricsPort > 0 ? cfg.m_MetricsPort : CMetricsExporter::NO_LISTENER);
+    }
+    catch (std::exception &e)
+    {
+        LOG_ERROR(e.what());
+        warc.close();
+        return EXIT_FAILURE;
+    }
+
+    // Record the timeline of the crawl
+    auto &tracer = CTracer::getInstance();
+
+    if (!cfg.m_Trace.empty())
+    {
+        tracer.start(cfg.m_Trace);
+        tracer.setThreadName("main");
+    }
+
     // Download the file and recursively other linked files
     try
     {
-        rootFile->download();
+        pipeline.run(rootFile);
     }
     catch (std::exception &e)
     {
-        CLogger::getInstance().log(CLogger::ELogLevel::Error, e.what());
+        // Keep what was archived so far usable, with its index
+        LOG_ERROR(e.what());
+        warc.close();
         return EXIT_FAILURE;
     }
 
+    // Closed also when it stopped after a write error, the crawl then fails
+    bool archived = true;
+
+    if (cfg.m_Warc)
+    {
+        archived = warc.close();
+        LOG_INFO("Archived " + std::to_string(warc.getRecords()) + " responses into " +
+                 std::to_string(warc.getBytes() / 1024) + " kB of WARC files");
+    }
+
+    if (tracer.isEnabled())
+    {
+        size_t spans = tracer.getSpans();
+
+        if (!tracer.stop())
+            LOG_ERROR("Cannot write the trace into " + cfg.m_Trace);
+        else
+            LOG_INFO("Written " + std::to_string(spans) + " trace spans into " + cfg.m_Trace);
+    }
+
+    if (!requestStats.closeLog())
+        LOG_ERROR("Cannot write the request log " + cfg.m_RequestLog);
+
+    pipeline.logStats();
+    requestStats.logSummary();
+    LOG_INFO("Peak buffered content: " + std::to_string(budget.getPeak() / 1024) + " kB");
+
+    if (store.isEnabled())
+        LOG_INFO("Written " + std::to_string(store.getWrittenBytes() / 1024) + " kB, deduplicated " +
+                 std::to_string(store.getDedupedFiles()) + " files saving " + std::to_string(store.getDedupedBytes() / 1024) + " kB");
+
     // Exit
-    logger.log(CLogger::ELogLevel::Info, "Done.");
-    return EXIT_SUCCESS;
+    LOG_INFO("Done.");
+    return archived ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 #endif
\ No newline at end of file
@@ -9,8 +9,45 @@
 #include "CURLHandler.h"
 #include "CConfig.h"
 #include "CLogger.h"
+#include "CBoundedQueue.h"
+#include "CPipeline.h"
+#include "CMemoryBudget.h"
+#include "CFileHtml.h"
+#include "CContentStore.h"
+#include "COutputWriter.h"
+#include "CUringWriter.h"
+#include "CDirectoryCache.h"
+#include "CWarcWriter.h"
+#include "CHtmlTokenizer.h"
+#include "CCssTokenizer.h"
+#include "CByteScanner.h"
+#include "CEditList.h"
+#include "CRegexRegistry.h"
+#include "CInternTable.h"
+#include "CDomainMatcher.h"
+#include "CURLParser.h"
+#include "CRequestStats.h"
+#include "CMetrics.h"
+#include "CMetricsExporter.h"
+#include "CTracer.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <thread>
+#include <vector>
+
+#include <zlib.h>
+
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
 
 using std::string, std::cout, std::endl, std::boolalpha;
 
@@ -180,6 +217,320 @@ namespace Tests
           ASSERT(url.getPathDepth() == 3);
      }
 
+     void CURLHandler_normalize()
+     {
+          CURLHandler url("HTTP://Example.COM/a/./b//c/../../d/");
+
+          ASSERT(!url.isHttps());
+          ASSERT(url.getDomain() == "example.com");
+          ASSERT(url.getNormURL() == "http://example.com/a/d/");
+          ASSERT(url.getNormURLPath() == "a/d/");
+          ASSERT(url.getPathDepth() == 2);
+
+          // Moving above the root stays in the root
+          url.addPath("../../../x/page.html");
+          ASSERT(url.getNormURL() == "http://example.com/x/page.html");
+          ASSERT(url.getPathDepth() == 1);
+
+          // The path stays when the domain changes
+          url.setDomain("https://www.Other.org/");
+          ASSERT(url.getNormURL() == "https://www.other.org/x/page.html");
+          ASSERT(url.getDomainNorm() == "other.org");
+
+          url.addPath("/");
+          ASSERT(url.getNormURL() == "https://www.other.org/");
+          ASSERT(url.getPathDepth() == 0);
+
+          // Copies don't share the buffer
+          CURLHandler copy = url;
+          copy.addPath("dir");
+          ASSERT(url.getNormURL() == "https://www.other.org/");
+          ASSERT(copy.getNormURL() == "https://www.other.org/dir/");
+          ASSERT(copy.getNormURLPath() == "dir");
+
+          CURLHandler empty;
+          ASSERT(empty.getNormURL() == "http:///" && empty.getDomain().empty() && empty.getPathDepth() == 0);
+
+          // Default port, user info and fragment are dropped, the query is not split into levels
+          CURLHandler query("https://user@Example.com:443/%7Edir/list?page=/2&x=%2f#top");
+          ASSERT(query.getNormURL() == "https://example.com/~dir/list/?page=/2&x=%2F");
+          ASSERT(query.getNormURLPath() == "~dir/list?page=/2&x=%2F");
+          ASSERT(query.getPathDepth() == 2);
+
+          CURLHandler port("localhost:8080/a/%2e%2e/b.html");
+          ASSERT(port.getDomain() == "localhost:8080" && port.getNormURL() == "http://localhost:8080/b.html");
+     }
+
+     /**
+      * @brief Random string made of the characters that are significant for URLs
+      *
+      */
+     string randomUrl(std::mt19937 &random, size_t maxLength)
+     {
+          static const string ALPHABET = ":/?#@[].%2eEaB1-_~&=";
+
+          string url;
+          size_t length = random() % (maxLength + 1);
+
+          for (size_t i = 0; i < length; i++)
+               url += ALPHABET[random() % ALPHABET.length()];
+
+          return url;
+     }
+
+     void CURLParser_parse()
+     {
+          auto c = CURLParser::parse("HTTPS://user:pw@[::1]:8080/a/b?x=1&y#frag");
+
+          ASSERT(c.m_Scheme == "HTTPS" && c.m_UserInfo == "user:pw" && c.m_Host == "[::1]" && c.m_Port == "8080");
+          ASSERT(c.m_Path == "/a/b" && c.m_Query == "x=1&y" && c.m_Fragment == "frag");
+          ASSERT(CURLParser::compose(c) == "HTTPS://user:pw@[::1]:8080/a/b?x=1&y#frag");
+
+          c = CURLParser::parse("../a?#");
+          ASSERT(!c.m_HasScheme && !c.m_HasAuthority && c.m_Path == "../a" && c.m_HasQuery && c.m_Query.empty() && c.m_HasFragment);
+
+          // Differential with the regular expression of RFC 3986 Appendix B
+          const std::regex appendixB("^(([^:/?#]+):)?(//([^/?#]*))?([^?#]*)(\\?([^#]*))?(#(.*))?");
+          std::mt19937 random(3986);
+          bool same = true;
+
+          for (int i = 0; i < 5000; i++)
+          {
+               string url = randomUrl(random, 24);
+               std::smatch m;
+               std::regex_match(url, m, appendixB);
+
+               auto parts = CURLParser::parse(url);
+               same &= parts.m_HasScheme == m[1].matched && parts.m_Scheme == m[2].str() &&
+                       parts.m_HasAuthority == m[3].matched && parts.m_Authority == m[4].str() &&
+                       parts.m_Path == m[5].str() &&
+                       parts.m_HasQuery == m[6].matched && parts.m_Query == m[7].str() &&
+                       parts.m_HasFragment == m[8].matched && parts.m_Fragment == m[9].str() &&
+                       CURLParser::compose(parts) == url;
+          }
+
+          ASSERT(same);
+     }
+
+     void CURLParser_resolve()
+     {
+          // Examples of RFC 3986 section 5.4
+          const string base = "http://a/b/c/d;p?q";
+          vector<std::pair<string, string>> examples = {
+              {"g:h", "g:h"}, {"g", "http://a/b/c/g"}, {"./g", "http://a/b/c/g"}, {"g/", "http://a/b/c/g/"},
+              {"/g", "http://a/g"}, {"//g", "http://g"}, {"?y", "http://a/b/c/d;p?y"}, {"g?y", "http://a/b/c/g?y"},
+              {"#s", "http://a/b/c/d;p?q#s"}, {"g#s", "http://a/b/c/g#s"}, {"g?y#s", "http://a/b/c/g?y#s"},
+              {";x", "http://a/b/c/;x"}, {"g;x", "http://a/b/c/g;x"}, {"", "http://a/b/c/d;p?q"}, {".", "http://a/b/c/"},
+              {"./", "http://a/b/c/"}, {"..", "http://a/b/"}, {"../", "http://a/b/"}, {"../g", "http://a/b/g"},
+              {"../..", "http://a/"}, {"../../", "http://a/"}, {"../../g", "http://a/g"},
+              // Abnormal examples
+              {"../../../g", "http://a/g"}, {"../../../../g", "http://a/g"}, {"/./g", "http://a/g"}, {"/../g", "http://a/g"},
+              {"g.", "http://a/b/c/g."}, {".g", "http://a/b/c/.g"}, {"g..", "http://a/b/c/g.."}, {"..g", "http://a/b/c/..g"},
+              {"./../g", "http://a/b/g"}, {"./g/.", "http://a/b/c/g/"}, {"g/./h", "http://a/b/c/g/h"}, {"g/../h", "http://a/b/c/h"},
+              {"g;x=1/./y", "http://a/b/c/g;x=1/y"}, {"g;x=1/../y", "http://a/b/c/y"}, {"g?y/./x", "http://a/b/c/g?y/./x"},
+              {"g?y/../x", "http://a/b/c/g?y/../x"}, {"g#s/./x", "http://a/b/c/g#s/./x"}, {"g#s/../x", "http://a/b/c/g#s/../x"},
+              {"http:g", "http:g"}};
+
+          bool all = true;
+          for (const auto &[reference, target] : examples)
+               all &= CURLParser::resolve(base, reference) == target;
+
+          ASSERT(all);
+          ASSERT(CURLParser::resolve("https://example.com", "page.html") == "https://example.com/page.html");
+     }
+
+     void CURLParser_canonicalize()
+     {
+          ASSERT(CURLParser::canonicalize("HTTP://User@Example.COM:80/a/./b/../%7euser/%2e%2E/c%2fd?b=2&a=1#top") ==
+                 "http://User@example.com/a/c%2Fd?b=2&a=1");
+          ASSERT(CURLParser::canonicalize("https://example.com:443") == "https://example.com/");
+          ASSERT(CURLParser::canonicalize("https://example.com:8443/") == "https://example.com:8443/");
+          ASSERT(CURLParser::canonicalize("https://example.com/?b=2&a=1&a=0", true) == "https://example.com/?a=0&a=1&b=2");
+          ASSERT(CURLParser::canonicalize("HTTPS://%45xample.com/%c4%8Dl%C3%A1nky") == "https://example.com/%C4%8Dl%C3%A1nky");
+
+          std::mt19937 random(6);
+          bool idempotent = true;
+          bool sameDots = true;
+
+          // Reference removal of dot segments with a stack of segments
+          auto removeDots = [](const string &path)
+          {
+               vector<string> segments;
+               size_t start = 0;
+               bool absolute = !path.empty() && path[0] == '/';
+               string rest = absolute ? path.substr(1) : path;
+
+               while (true)
+               {
+                    size_t end = std::min(rest.find('/', start), rest.length());
+                    string segment = rest.substr(start, end - start);
+                    bool last = end == rest.length();
+
+                    if (segment == "..")
+                    {
+                         if (!segments.empty())
+                              segments.pop_back();
+                         if (last)
+                              segments.push_back("");
+                    }
+                    else if (segment == ".")
+                    {
+                         if (last)
+                              segments.push_back("");
+                    }
+                    else
+                         segments.push_back(segment);
+
+                    if (last)
+                         break;
+                    start = end + 1;
+               }
+
+               string result = absolute ? "/" : "";
+               for (size_t i = 0; i < segments.size(); i++)
+                    result += (i > 0 ? "/" : "") + segments[i];
+
+               return result;
+          };
+
+          for (int i = 0; i < 5000; i++)
+          {
+               string url = randomUrl(random, 24);
+               string canonical = CURLParser::canonicalize(url, i % 2);
+               idempotent &= CURLParser::canonicalize(canonical, i % 2) == canonical;
+
+               // Absolute paths made of dot and plain segments
+               string path;
+               for (size_t segments = random() % 8; segments > 0; segments--)
+                    path += "/" + string(vector<string>{"..", ".", "a", "b", ""}[random() % 5]);
+
+               sameDots &= CURLParser::removeDotSegments(path) == removeDots(path);
+          }
+
+          ASSERT(idempotent);
+          ASSERT(sameDots);
+     }
+
+     void CRegexRegistry_concurrent()
+     {
+          using EPattern = CRegexRegistry::EPattern;
+
+          auto &registry = CRegexRegistry::getInstance();
+
+          // The same compiled instance is returned every time
+          ASSERT(&registry.get(EPattern::HTTP_STATUS) == &registry.get(EPattern::HTTP_STATUS));
+
+          std::smatch status;
+          string line = "http/1.1 404 Not Found";
+          ASSERT(std::regex_match(line, status, registry.get(EPattern::HTTP_STATUS)) && status[1] == "404");
+
+          // Many workers parse status lines at the same time
+          std::atomic<size_t> failed{0};
+          vector<std::thread> threads;
+
+          for (int t = 0; t < 8; t++)
+               threads.emplace_back([&failed, t]
+                                    {
+                                         for (int i = 0; i < 200; i++)
+                                         {
+                                              std::smatch result;
+                                              string line = "HTTP/1.1 " + std::to_string(200 + i + t) + " OK";
+
+                                              if (!std::regex_match(line, result, CRegexRegistry::getInstance().get(EPattern::HTTP_STATUS)) ||
+                                                  result[1] != std::to_string(200 + i + t))
+                                                   failed++;
+                                         } });
+
+          for (auto &thread : threads)
+               thread.join();
+
+          ASSERT(failed == 0);
+     }
+
+     void CInternTable_concurrent()
+     {
+          auto &table = CInternTable::getInstance();
+
+          CInternTable::TId id = table.intern("https://example.com/interned.html");
+          ASSERT(table.intern(string("https://example.com/") + "interned.html") == id);
+          ASSERT(table.find("https://example.com/interned.html") == id);
+          ASSERT(table.get(id) == "https://example.com/interned.html");
+          ASSERT(table.find("https://example.com/never-interned.html") == CInternTable::NONE);
+
+          // Equal domains have equal IDs
+          ASSERT(CURLHandler("https://WWW.Example.com/a.html").getDomainId() == CURLHandler("http://www.example.com/b/").getDomainId());
+          ASSERT(CURLHandler("https://www.example.com/").getDomainId() != CURLHandler("https://example.com/").getDomainId());
+          ASSERT(CURLHandler().getDomainId() == table.find(""));
+
+          // Workers intern overlapping URLs at the same time, every URL gets exactly one ID
+          const int THREADS = 8;
+          const int URLS = 500;
+
+          size_t before = table.size();
+          vector<vector<CInternTable::TId>> ids(THREADS, vector<CInternTable::TId>(URLS));
+          vector<std::thread> threads;
+
+          for (int t = 0; t < THREADS; t++)
+               threads.emplace_back([&ids, &table, t]
+                                    {
+                                         for (int i = 0; i < URLS; i++)
+                                         {
+                                              int url = (i + t * 37) % URLS;
+                                              ids[t][url] = table.intern("https://example.com/concurrent/" + std::to_string(url) + ".html");
+                                         } });
+
+          for (auto &thread : threads)
+               thread.join();
+
+          bool same = true;
+          for (int t = 1; t < THREADS; t++)
+               same &= ids[t] == ids[0];
+
+          ASSERT(same);
+          ASSERT(table.size() == before + URLS);
+          ASSERT(table.get(ids[0][42]) == "https://example.com/concurrent/42.html");
+     }
+
+     void CDomainMatcher_matches()
+     {
+          auto &matcher = CDomainMatcher::getInstance();
+
+          // No rules, everything is allowed
+          matcher.setRules("");
+          ASSERT(matcher.isEmpty());
+          ASSERT(matcher.matches("anything.com"));
+
+          matcher.setRules(" a.com, *.Example.org ,,localhost,*.");
+          ASSERT(matcher.size() == 3);
+
+          // Exact rule, a substring of the list is not a match
+          ASSERT(matcher.matches("a.com"));
+          ASSERT(matcher.matches("www.a.com"));
+          ASSERT(matcher.matches("a.com:8080"));
+          ASSERT(!matcher.matches("aa.com"));
+          ASSERT(!matcher.matches("sub.a.com"));
+          ASSERT(!matcher.matches("a.co"));
+          ASSERT(!matcher.matches("com"));
+
+          // Wildcard rule matches subdomains only
+          ASSERT(matcher.matches("cdn.example.org"));
+          ASSERT(matcher.matches("a.b.example.org"));
+          ASSERT(!matcher.matches("example.org"));
+          ASSERT(!matcher.matches("badexample.org"));
+          ASSERT(!matcher.matches("example.org.evil.com"));
+
+          ASSERT(matcher.matches("localhost:8765"));
+          ASSERT(!matcher.matches("localhost.evil.com"));
+
+          // Both kinds of the same domain
+          matcher.setRules("example.org,*.example.org");
+          ASSERT(matcher.size() == 1);
+          ASSERT(matcher.matches("example.org"));
+          ASSERT(matcher.matches("cdn.example.org"));
+
+          matcher.setRules("");
+     }
+
      void CConfig_storeValues()
      {
           CConfig &cfg = CConfig::getInstance();
@@ -261,47 +612,1747 @@ namespace Tests
           ASSERT(static_cast<string>(cfg["url"]) == "google.com");
           ASSERT(static_cast<int>(cfg["log_level"]) == 2);
           ASSERT(static_cast<string>(cfg["output"]) == "./folder");
+
+          // Typed values are available after parsing
+          const auto &snapshot = cfg.getSnapshot();
+          ASSERT(snapshot.m_Depth == 2);
+          ASSERT(snapshot.m_Url == "google.com");
+          ASSERT(snapshot.m_RootUrl.getNormURL() == "http://google.com/");
+          ASSERT(snapshot.m_LogLevel == 2);
+          ASSERT(snapshot.m_Output == "./folder");
      }
 
-} // namespace Tests
+     void CConfig_snapshot()
+     {
+          CConfig &cfg = CConfig::getInstance();
 
-int main(void)
-{
-     Tests::ALL_PASSED = true;
+          cfg["cookies"] = string("session=1");
+          cfg["user_agent"] = string("Agent/1.0");
+          cfg["memory_limit"] = 3;
 
-     cout << "---------- [STARTING TESTS] ----------\n"
-          << endl;
+          // The snapshot is not changed until it's updated
+          ASSERT(cfg.getSnapshot().m_Cookies != "session=1");
 
-     // ============ Utils ============
-     cout << "---------- [Testing Utils] -----------" << endl;
+          cfg.updateSnapshot();
 
-     Tests::Utils_startsWith();
-     Tests::Utils_endsWith();
-     Tests::Utils_contains();
-     Tests::Utils_toLowerCase();
-     Tests::Utils_replaceAll();
-     Tests::Utils_splitString();
+          const auto &snapshot = cfg.getSnapshot();
+          ASSERT(snapshot.m_Cookies == "session=1");
+          ASSERT(snapshot.m_RequestHeaders == "Cookie: session=1\r\nUser-Agent: Agent/1.0\r\n");
+          ASSERT(snapshot.m_MemoryLimit == 3 * 1024 * 1024);
 
-     cout << endl;
+          cfg["cookies"] = string("");
+          cfg.updateSnapshot();
+          ASSERT(cfg.getSnapshot().m_RequestHeaders == "User-Agent: Agent/1.0\r\n");
+     }
 
-     // ============ CURLHandler ============
-     cout << "------- [Testing CURLHandler] --------" << endl;
+     void CLogger_async()
+     {
+          string path = (std::filesystem::temp_directory_path() / "wget_clone_logger_test.log").string();
+          std::filesystem::remove(path);
 
-     Tests::CURLHandler_construct();
-     Tests::CURLHandler_addPath();
-     Tests::CURLHandler_setDomain();
+          auto readLines = [&]
+          {
+               vector<string> lines;
+               std::ifstream file(path);
+               for (string line; std::getline(file, line);)
+                    lines.push_back(line);
+               return lines;
+          };
 
-     cout << endl;
+          // Messages of concurrent producers are all written, each producer's in order
+          {
+               const int THREADS = 4;
+               const int MESSAGES = 500;
 
-     // ============ CConfig ============
-     cout << "------- [Testing CConfig] --------" << endl;
+               CLogger logger(CLogger::ELogLevel::Info);
+               logger.setToFile(path);
 
-     CLogger::init(CLogger::ELogLevel::Error);
-     Tests::CConfig_storeValues();
-     Tests::CConfig_getValues();
-     Tests::CConfig_parseArgsMissingUrl();
-     Tests::CConfig_parseArgsInvalid();
-     Tests::CConfig_parseArgsValid();
+               vector<std::thread> threads;
+               for (int t = 0; t < THREADS; t++)
+                    threads.emplace_back([&logger, t]
+                                         {
+                                              for (int i = 0; i < MESSAGES; i++)
+                                                   logger.log(CLogger::ELogLevel::Info, "thread " + std::to_string(t) + " message " + std::to_string(i));
+                                              logger.log(CLogger::ELogLevel::Verbose, "filtered"); });
+
+               for (auto &thread : threads)
+                    thread.join();
+
+               logger.flush();
+
+               auto lines = readLines();
+               ASSERT(lines.size() == THREADS * MESSAGES);
+
+               vector<int> next(THREADS, 0);
+               bool ordered = true;
+               for (const auto &line : lines)
+               {
+                    int t, i;
+                    size_t start = line.find("): thread ");
+                    if (!Utils::startsWith(line, "[INFO] (") || start == string::npos ||
+                        sscanf(line.c_str() + start, "): thread %d message %d", &t, &i) != 2 || i != next[t]++)
+                         ordered = false;
+               }
+
+               ASSERT(ordered);
+          }
+
+          // Tiny ring buffer, verbose messages may be dropped but never other ones
+          {
+               std::filesystem::remove(path);
+
+               CLogger logger(CLogger::ELogLevel::Verbose, 4);
+               logger.setToFile(path);
+
+               for (int i = 0; i < 10000; i++)
+                    logger.log(CLogger::ELogLevel::Verbose, "verbose");
+               logger.log(CLogger::ELogLevel::Error, "done");
+
+               logger.flush();
+
+               size_t verbose = 0;
+               bool hasError = false;
+               for (const auto &line : readLines())
+               {
+                    verbose += Utils::endsWith(line, "): verbose");
+                    hasError |= line.find("[ERROR]") == 0 && Utils::endsWith(line, "): done");
+               }
+
+               ASSERT(hasError);
+               ASSERT(verbose + logger.getDropped() == 10000);
+          }
+
+          std::filesystem::remove(path);
+     }
+
+     void CLogger_lazy()
+     {
+          string path = (std::filesystem::temp_directory_path() / "wget_clone_logger_lazy_test.log").string();
+          std::filesystem::remove(path);
+
+          CLogger logger(CLogger::ELogLevel::Info);
+          logger.setToFile(path);
+
+          int evaluated = 0;
+          auto message = [&]
+          {
+               evaluated++;
+               return string("message");
+          };
+
+          // Message of a filtered level is not built
+          LOG_AT(logger, CLogger::ELogLevel::Verbose, message());
+          ASSERT(evaluated == 0);
+          ASSERT(!logger.isEnabled(CLogger::ELogLevel::Verbose));
+
+          LOG_AT(logger, CLogger::ELogLevel::Info, message());
+          ASSERT(evaluated == 1);
+
+          logger.setLevel(CLogger::ELogLevel::Verbose);
+          LOG_AT(logger, CLogger::ELogLevel::Verbose, message());
+          ASSERT(evaluated == (CLogger::isCompiled(CLogger::ELogLevel::Verbose) ? 2 : 1));
+
+          ASSERT(CLogger::isCompiled(CLogger::ELogLevel::Error));
+
+          logger.flush();
+          std::filesystem::remove(path);
+     }
+
+     void CBoundedQueue_pushPop()
+     {
+          CBoundedQueue<int> queue(3);
+
+          ASSERT(queue.capacity() == 3);
+          ASSERT(queue.push(1));
+          ASSERT(queue.push(2));
+          ASSERT(queue.size() == 2);
+
+          int value = 0;
+          ASSERT(queue.pop(value) && value == 1);
+          ASSERT(queue.pop(value) && value == 2);
+          ASSERT(queue.size() == 0);
+
+          queue.push(3);
+          queue.close();
+
+          ASSERT(!queue.push(4));
+          ASSERT(queue.pop(value) && value == 3);
+          ASSERT(!queue.pop(value));
+     }
+
+     void CBoundedQueue_backpressure()
+     {
+          CBoundedQueue<int> queue(2);
+          std::atomic<int> pushed{0};
+
+          std::thread producer([&]
+                               {
+                                    for (int i = 0; i < 5; i++)
+                                    {
+                                         queue.push(i);
+                                         pushed++;
+                                    } });
+
+          // Producer has to stop at the capacity until somebody pops
+          while (queue.size() < 2)
+               std::this_thread::yield();
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          ASSERT(pushed == 2);
+
+          int value = 0;
+          bool inOrder = true;
+          for (int i = 0; i < 5; i++)
+               inOrder = queue.pop(value) && value == i && inOrder;
+
+          producer.join();
+          ASSERT(inOrder);
+          ASSERT(pushed == 5);
+     }
+
+     /**
+      * @brief Fake file without network, every file with depth below 3 links to two new files, one of them shared by all
+      *
+      */
+     class TFakeFile : public CFile
+     {
+     public:
+          TFakeFile(size_t depth, const string &name, const string &outputPath, std::atomic<int> &fetched, const string &query = "")
+              : CFile(nullptr, depth, CURLHandler("http://example.com/" + name + query)), m_Fetched(fetched)
+          {
+               m_OutputPath = outputPath;
+               m_Filename = name;
+          }
+
+          bool prepare() override { return true; }
+
+          bool fetch() override
+          {
+               m_Fetched++;
+               m_Content = m_Filename;
+               return true;
+          }
+
+          set<shared_ptr<CFile>> parse() override
+          {
+               // "shared" is found at depth 2 and 3 and either of them may be claimed first, so it has no children
+               if (m_Depth >= 3 || m_Filename == "shared")
+                    return {};
+
+               // The second child has the same name for all files, so it has to be fetched only once
+               return {std::make_shared<TFakeFile>(m_Depth + 1, m_Filename + "a", m_OutputPath, m_Fetched),
+                       std::make_shared<TFakeFile>(m_Depth + 1, "shared", m_OutputPath, m_Fetched)};
+          }
+
+          void rewrite() override { m_Content += "!"; }
+
+     protected:
+          std::atomic<int> &m_Fetched;
+     };
+
+     void CPipeline_run()
+     {
+          string outputPath = (std::filesystem::temp_directory_path() / "wget_clone_pipeline_test/").string();
+          std::filesystem::remove_all(outputPath);
+          CDirectoryCache::getInstance().clear();
+
+          CPipeline::TSettings settings;
+          settings.m_FetchWorkers = 3;
+          settings.m_ParseWorkers = 2;
+          settings.m_QueueSize = 1;
+
+          std::atomic<int> fetched{0};
+          CPipeline pipeline(settings);
+          pipeline.run(std::make_shared<TFakeFile>(1, "root", outputPath, fetched));
+
+          // root, roota, rootaa and shared
+          ASSERT(fetched == 4);
+
+          std::ifstream ifs(outputPath + "rootaa");
+          string content;
+          ifs >> content;
+          ASSERT(content == "rootaa!");
+
+          const auto &stats = pipeline.getStats();
+          ASSERT(stats.size() == 4);
+          ASSERT(stats[0].m_Name == "fetch" && stats[0].m_Workers == 3);
+          ASSERT(stats[3].m_Name == "write" && stats[3].m_Items == 4);
+          ASSERT(stats[0].getUtilization(pipeline.getWallTime()) <= 1.0);
+
+          std::filesystem::remove_all(outputPath);
+     }
+
+     /**
+      * @brief Root page linking to the same file with two different queries
+      *
+      */
+     class TQueryRoot : public TFakeFile
+     {
+     public:
+          using TFakeFile::TFakeFile;
+
+          set<shared_ptr<CFile>> parse() override
+          {
+               return {std::make_shared<TFakeFile>(3, "list", m_OutputPath, m_Fetched, "?page=1"),
+                       std::make_shared<TFakeFile>(3, "list", m_OutputPath, m_Fetched, "?page=2")};
+          }
+     };
+
+     void CPipeline_warcClaim()
+     {
+          string outputPath = (std::filesystem::temp_directory_path() / "wget_clone_claim_test/").string();
+          std::filesystem::remove_all(outputPath);
+          CDirectoryCache::getInstance().clear();
+
+          // One output file, but two archived responses
+          for (bool archive : {false, true})
+          {
+               auto &warc = CWarcWriter::getInstance();
+               if (archive)
+                    ASSERT(warc.open(outputPath + "crawl", 1024 * 1024));
+
+               std::atomic<int> fetched{0};
+               CPipeline pipeline(CPipeline::TSettings{});
+               pipeline.run(std::make_shared<TQueryRoot>(1, "root", outputPath, fetched));
+
+               ASSERT(fetched == (archive ? 3 : 2));
+               warc.close();
+          }
+
+          std::filesystem::remove_all(outputPath);
+     }
+
+     void CMemoryBudget_reserve()
+     {
+          auto &budget = CMemoryBudget::getInstance();
+          budget.setLimit(100);
+
+          {
+               CMemoryBudget::TReservation first;
+               first.acquire(60);
+               ASSERT(budget.getUsed() == 60);
+
+               CMemoryBudget::TReservation second;
+               ASSERT(!second.tryAcquire(50));
+               ASSERT(second.tryAcquire(40));
+               ASSERT(budget.getUsed() == 100);
+
+               // Waiting acquire continues once the other reservation is released
+               CMemoryBudget::TReservation third;
+               std::thread waiting([&]
+                                   { third.acquire(30); });
+
+               std::this_thread::sleep_for(std::chrono::milliseconds(20));
+               ASSERT(third.size() == 0);
+
+               first.release();
+               waiting.join();
+               ASSERT(third.size() == 30);
+               ASSERT(budget.getUsed() == 70);
+
+               // Moved reservation is released only once
+               CMemoryBudget::TReservation moved = std::move(second);
+               ASSERT(second.size() == 0 && moved.size() == 40);
+
+               // Only the single reservation may grow over the limit, the unused part can be returned
+               ASSERT(!moved.tryExtend(40));
+               third.release();
+               ASSERT(moved.tryExtend(100));
+               ASSERT(budget.getUsed() == 140);
+               moved.shrink(50);
+               ASSERT(moved.size() == 50 && budget.getUsed() == 50);
+          }
+
+          ASSERT(budget.getUsed() == 0);
+          ASSERT(budget.getPeak() >= 100);
+
+          budget.setLimit(0);
+     }
+
+     /**
+      * @brief Minimal local HTTP server, serves the root page with links to pages and the same big page for every other path,
+      * paths containing "nolength" without Content-Length
+      *
+      */
+     class TLocalServer
+     {
+     public:
+          TLocalServer(const string &rootPage, const string &page)
+              : m_RootPage(rootPage), m_Page(page)
+          {
+               m_Socket = socket(AF_INET, SOCK_STREAM, 0);
+
+               int enable = 1;
+               setsockopt(m_Socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+               sockaddr_in address{};
+               address.sin_family = AF_INET;
+               address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+               address.sin_port = 0;
+
+               socklen_t length = sizeof(address);
+               bind(m_Socket, reinterpret_cast<sockaddr *>(&address), length);
+               listen(m_Socket, 64);
+               getsockname(m_Socket, reinterpret_cast<sockaddr *>(&address), &length);
+               m_Port = ntohs(address.sin_port);
+
+               m_Thread = std::thread(&TLocalServer::serve, this);
+          }
+
+          ~TLocalServer()
+          {
+               shutdown(m_Socket, SHUT_RDWR);
+               close(m_Socket);
+               m_Thread.join();
+
+               for (auto &t : m_Connections)
+                    t.join();
+          }
+
+          int getPort() const { return m_Port; }
+
+     private:
+          string m_RootPage;
+          string m_Page;
+          int m_Socket;
+          int m_Port;
+          std::thread m_Thread;
+          std::vector<std::thread> m_Connections;
+
+          void serve()
+          {
+               int client;
+               while ((client = accept(m_Socket, nullptr, nullptr)) >= 0)
+                    m_Connections.emplace_back(&TLocalServer::respond, this, client);
+          }
+
+          void respond(int client)
+          {
+               string request;
+               char buffer[1024];
+               ssize_t length;
+
+               while (request.find("\r\n\r\n") == string::npos && (length = recv(client, buffer, sizeof(buffer), 0)) > 0)
+                    request.append(buffer, length);
+
+               const string &body = Utils::startsWith(request, "GET / ") ? m_RootPage : m_Page;
+               string header = "HTTP/1.0 200 OK\r\nContent-Type: text/html\r\n";
+
+               // The end of the body is the end of the connection
+               if (request.substr(0, request.find("\r\n")).find("nolength") == string::npos)
+                    header += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+
+               header += "\r\n";
+
+               send(client, header.data(), header.size(), MSG_NOSIGNAL);
+
+               // Sent slowly in parts, so the downloads overlap like with a real server
+               for (size_t sent = 0; sent < body.size(); sent += length)
+               {
+                    if ((length = send(client, body.data() + sent, std::min<size_t>(256 * 1024, body.size() - sent), MSG_NOSIGNAL)) <= 0)
+                         break;
+
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+               }
+
+               close(client);
+          }
+     };
+
+     /**
+      * @brief Get the peak (VmHWM) or the current (VmRSS) resident set size of this process in kB, -1 if unknown
+      *
+      */
+     long getRss(const string &field = "VmHWM:")
+     {
+          std::ifstream status("/proc/self/status");
+          string line;
+
+          while (std::getline(status, line))
+               if (Utils::startsWith(line, field))
+                    return std::stol(line.substr(field.size()));
+
+          return -1;
+     }
+
+     /**
+      * @brief Reset the peak resident set size to the current one, returns false if not supported
+      *
+      */
+     bool resetPeakRss()
+     {
+          std::ofstream clearRefs("/proc/self/clear_refs");
+          clearRefs << "5";
+          clearRefs.close();
+
+          return !clearRefs.fail();
+     }
+
+     void CMemoryBudget_stress()
+     {
+          // Without the budget most of the 96 MB of pages are buffered at once
+          const size_t pageCount = 24;
+          const size_t pageSize = 4 * 1024 * 1024;
+          const size_t budgetLimit = 8 * 1024 * 1024;
+
+          // Root page linking to big pages, every big page is plain text with a few links, half of them are served
+          // without Content-Length, so their size is not known until they are received
+          string rootPage = "<html><body>";
+          for (size_t i = 0; i < pageCount; i++)
+               rootPage += "<a href=\"" + string(i % 2 ? "nolength" : "page") + std::to_string(i) + ".html\">page</a>";
+          rootPage += "</body></html>";
+
+          string page = "<html><body><a href=\"#bottom\">bottom</a>\n";
+          while (page.size() < pageSize)
+               page += "<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor incididunt ut labore.</p>\n";
+          page += "<a href=\"#top\">top</a></body></html>";
+
+          TLocalServer server(rootPage, page);
+
+          string outputPath = (std::filesystem::temp_directory_path() / "wget_clone_stress_test").string();
+
+          CConfig &cfg = CConfig::getInstance();
+          cfg["url"] = "http://127.0.0.1:" + std::to_string(server.getPort()) + "/";
+          cfg["output"] = outputPath;
+          cfg["depth"] = 2;
+          cfg["remote"] = true;
+          cfg["remote_images"] = false;
+          cfg["error_page"] = false;
+          cfg["advertisement"] = false;
+          cfg.updateSnapshot();
+
+          auto &budget = CMemoryBudget::getInstance();
+          bool measureRss = true;
+
+          // Crawl all pages with the limit, returns the peak RSS growth in kB
+          auto crawl = [&](size_t limit)
+          {
+               std::filesystem::remove_all(outputPath);
+               CDirectoryCache::getInstance().clear();
+               budget.setLimit(limit);
+
+               long rssBefore = getRss("VmRSS:");
+               measureRss = measureRss && resetPeakRss() && rssBefore >= 0;
+
+               CPipeline::TSettings settings;
+               settings.m_FetchWorkers = 16;
+               settings.m_QueueSize = 16;
+
+               CPipeline pipeline(settings);
+               pipeline.run(std::make_shared<CFileHtml>(std::make_shared<CHttpsDownloader>(), 1, CURLHandler(static_cast<string>(cfg["url"]))));
+
+               ASSERT(pipeline.getStats()[3].m_Items == pageCount + 1);
+               ASSERT(std::filesystem::file_size(outputPath + "/page0.html") == page.size());
+               ASSERT(std::filesystem::file_size(outputPath + "/nolength1.html") == page.size());
+               ASSERT(budget.getUsed() == 0);
+
+               return getRss() - rssBefore;
+          };
+
+          long rssGrowth = crawl(budgetLimit);
+          ASSERT(budget.getPeak() <= budgetLimit);
+          size_t budgetPeak = budget.getPeak();
+
+          // The same crawl without the budget, run second, so the memory kept by malloc only helps it
+          long controlGrowth = crawl(0);
+
+          // Outside of the budget is the copy of the page being rewritten (the edits are applied into a new string),
+          // the small allocations of the workers and the file being written, together about 2 pages, the bound
+          // allows twice that. Many links per page would add their lists too, they are not charged (~100 B per link).
+          ASSERT(!measureRss || rssGrowth < static_cast<long>((budgetLimit + 4 * pageSize) / 1024));
+          ASSERT(!measureRss || rssGrowth * 2 < controlGrowth);
+
+          cout << "Peak RSS growth: " << rssGrowth << " kB, peak budget: " << budgetPeak / 1024
+               << " kB, without the budget: " << controlGrowth << " kB" << endl;
+
+          budget.setLimit(0);
+          std::filesystem::remove_all(outputPath);
+     }
+
+     /**
+      * @brief Stylesheet with every kind of token the CSS tokenizer handles
+      *
+      */
+     string cssTokenizerPage()
+     {
+          return "@import \"imp1.css\";\n@import url( imp2.css ) screen;\n@IMPORT 'imp3.css';\n"
+                 "/* url(no1.png) @import \"no2.css\"; */\n"
+                 "a { background: url(  \"sp ace.png\"  ) }\n"
+                 "b { background: URL( plain.png ) }\n"
+                 "c { background: url(a\\).png) }\n"
+                 "d { background: u\\72l(esc.png) }\n"
+                 "e { content: \"url(no3.png)\"; background: myurl(no4.png) #url(no5.png) }\n"
+                 "f { background-image: image-set(\"set1.png\" 1x, url(set2.png) 2x, 'set3.png' 2x) }\n"
+                 "g { background-image: -webkit-image-set('set4.png' 1x); content: \"no6.png\" }\n"
+                 "h { background: url(bad url.png) url() url(after-bad.png) }\n"
+                 "i { background: url(\"str\\\"q.png\") }\n";
+     }
+
+     void CCssTokenizer_tokenize()
+     {
+          using EKind = CCssTokenizer::EKind;
+
+          string css = cssTokenizerPage();
+          auto links = CCssTokenizer::tokenize(css);
+
+          vector<string> values;
+          for (const auto &link : links)
+               values.push_back(link.m_Value);
+
+          ASSERT((values == vector<string>{"imp1.css", "imp2.css", "imp3.css", "sp ace.png", "plain.png", "a).png", "esc.png",
+                                           "set1.png", "set2.png", "set3.png", "set4.png", "after-bad.png", "str\"q.png"}));
+
+          if (links.size() == 13)
+          {
+               ASSERT(links[0].m_Kind == EKind::IMPORT && links[1].m_Kind == EKind::IMPORT && !links[1].m_Quoted);
+               ASSERT(links[3].m_Kind == EKind::URL && links[3].m_Quoted);
+               ASSERT(css.substr(links[3].m_Offset, links[3].m_Length) == "sp ace.png");
+               ASSERT(css.substr(links[5].m_Offset, links[5].m_Length) == "a\\).png");
+               ASSERT(links[7].m_Kind == EKind::IMAGE_SET && links[8].m_Kind == EKind::URL && links[10].m_Kind == EKind::IMAGE_SET);
+          }
+
+          // Escaped values are tokenized back to the same value
+          for (bool quoted : {false, true})
+          {
+               string value = "a b(c)'d\"e\\f\ng";
+               string escaped = CCssTokenizer::escape(value, quoted);
+               auto parsed = CCssTokenizer::tokenize(quoted ? "url(\"" + escaped + "\")" : "url(" + escaped + ")");
+
+               ASSERT(parsed.size() == 1 && parsed[0].m_Value == value);
+          }
+
+          // Broken stylesheets don't loop or crash
+          ASSERT(CCssTokenizer::tokenize("url(").empty());
+          ASSERT(CCssTokenizer::tokenize("a { background: url(x.png").size() == 1);
+          ASSERT(CCssTokenizer::tokenize("/* url(x.png)").empty());
+          ASSERT(CCssTokenizer::tokenize("@import").empty());
+          ASSERT(CCssTokenizer::tokenize("\\").empty());
+     }
+
+     void CCssTokenizer_feed()
+     {
+          string css = cssTokenizerPage();
+          auto expected = CCssTokenizer::tokenize(css);
+
+          auto equal = [](const vector<CCssTokenizer::TLink> &a, const vector<CCssTokenizer::TLink> &b)
+          {
+               return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto &x, const auto &y)
+                                 { return x.m_Kind == y.m_Kind && x.m_Offset == y.m_Offset && x.m_Length == y.m_Length && x.m_Value == y.m_Value; });
+          };
+
+          // Data split at every position, then received byte by byte
+          for (size_t split = 0; split < css.length(); split++)
+          {
+               CCssTokenizer tokenizer;
+               vector<CCssTokenizer::TLink> links;
+
+               tokenizer.feed(css.substr(0, split), false, links);
+               tokenizer.feed(css, true, links);
+
+               ASSERT(equal(links, expected));
+          }
+
+          CCssTokenizer tokenizer;
+          vector<CCssTokenizer::TLink> links;
+
+          for (size_t length = 1; length < css.length(); length++)
+               tokenizer.feed(css.substr(0, length), false, links);
+
+          tokenizer.feed(css, true, links);
+
+          ASSERT(equal(links, expected));
+          ASSERT(tokenizer.getPosition() == css.length());
+     }
+
+     void CFileHtml_streaming()
+     {
+          // Links at both ends of a big page, the first one is known long before the page is received
+          string rootPage = "<html><body><a href=\"first.html\">first</a>";
+          while (rootPage.size() < 1024 * 1024)
+               rootPage += "<p>Lorem ipsum dolor sit amet, consectetur adipiscing elit.</p>\n";
+          rootPage += "<a href=\"last.html\">last</a><a href=\"first.html#again\">again</a>"
+                      "<a href=\"./last.html\">same</a><a href=\"sub/../first.html\">same</a></body></html>";
+
+          TLocalServer server(rootPage, "<html></html>");
+
+          string outputPath = (std::filesystem::temp_directory_path() / "wget_clone_streaming_test").string();
+          std::filesystem::remove_all(outputPath);
+          CDirectoryCache::getInstance().clear();
+
+          CConfig &cfg = CConfig::getInstance();
+          cfg["url"] = "http://127.0.0.1:" + std::to_string(server.getPort()) + "/";
+          cfg["output"] = outputPath;
+          cfg["depth"] = 2;
+          cfg["remote"] = true;
+          cfg["remote_images"] = false;
+          cfg["error_page"] = false;
+          cfg["advertisement"] = false;
+          cfg.updateSnapshot();
+
+          auto root = std::make_shared<CFileHtml>(std::make_shared<CHttpsDownloader>(), 1, CURLHandler(static_cast<string>(cfg["url"])));
+
+          vector<string> scheduled;
+          root->setScheduler([&](shared_ptr<CFile> next)
+                             { next->prepare();
+                               scheduled.push_back(next->getOutputFile()); });
+
+          ASSERT(root->prepare());
+          ASSERT(root->fetch());
+
+          // Found during download, before parse
+          ASSERT(std::count(scheduled.begin(), scheduled.end(), outputPath + "/first.html") == 1);
+
+          for (const auto &next : root->parse())
+          {
+               next->prepare();
+               scheduled.push_back(next->getOutputFile());
+          }
+
+          std::sort(scheduled.begin(), scheduled.end());
+          ASSERT((scheduled == vector<string>{outputPath + "/first.html", outputPath + "/last.html"}));
+
+          // Links are interned resolved, not as written
+          auto &table = CInternTable::getInstance();
+          ASSERT(table.find(static_cast<string>(cfg["url"]) + "last.html") != CInternTable::NONE);
+          ASSERT(table.find("./last.html") == CInternTable::NONE);
+          ASSERT(table.find("sub/../first.html") == CInternTable::NONE);
+
+          std::filesystem::remove_all(outputPath);
+     }
+
+     void CRequestStats_percentiles()
+     {
+          ASSERT(CRequestStats::percentile({}, 50) == 0);
+          ASSERT(CRequestStats::percentile({7}, 99) == 7);
+          ASSERT(CRequestStats::percentile({1, 2, 3, 4}, 50) == 2);
+          ASSERT(CRequestStats::percentile({1, 2, 3, 4}, 0) == 1);
+          ASSERT(CRequestStats::percentile({1, 2, 3, 4}, 100) == 4);
+
+          vector<double> hundred;
+          for (int i = 1; i <= 100; i++)
+               hundred.push_back(i);
+          ASSERT(CRequestStats::percentile(hundred, 90) == 90);
+          ASSERT(CRequestStats::percentile(hundred, 99) == 99);
+
+          auto &stats = CRequestStats::getInstance();
+          stats.clear();
+
+          // Requests of one host with made up timestamps, the failed one has no TTFB
+          using TClock = CResponse::TTimings::TClock;
+          TClock::time_point start = TClock::now();
+
+          for (int i = 1; i <= 10; i++)
+          {
+               CResponse::TTimings timings;
+               timings.m_Start = start;
+               timings.m_Resolved = start + std::chrono::milliseconds(1);
+               timings.m_Connected = start + std::chrono::milliseconds(2);
+               timings.m_RequestSent = start + std::chrono::milliseconds(2);
+               timings.m_FirstByte = start + std::chrono::milliseconds(2 + i);
+               timings.m_Finished = start + std::chrono::milliseconds(20);
+               timings.m_BytesReceived = 100;
+
+               stats.record(CURLHandler("http://stats.example.com/" + std::to_string(i) + ".html"), 200, timings);
+          }
+
+          CResponse::TTimings failed;
+          failed.m_Start = start;
+          failed.m_Finished = start + std::chrono::milliseconds(5);
+          stats.record(CURLHandler("http://stats.example.com/failed.html"), 0, failed);
+
+          ASSERT(stats.getRequests("stats.example.com") == 11);
+          ASSERT(std::abs(stats.getPercentile("stats.example.com", CRequestStats::TTFB, 50) - 5) < 0.001);
+          ASSERT(std::abs(stats.getPercentile("stats.example.com", CRequestStats::TTFB, 90) - 9) < 0.001);
+          ASSERT(stats.getPercentile("stats.example.com", CRequestStats::TLS, 50) == 0);
+          ASSERT(std::abs(stats.getPercentile("stats.example.com", CRequestStats::TOTAL, 50) - 20) < 0.001);
+
+          string json = CRequestStats::toJson("http://a.com/\"q\"", 200, failed);
+          ASSERT(Utils::startsWith(json, "{\"url\":\"http://a.com/\\\"q\\\"\",\"status\":200,"));
+          ASSERT(json.find("\"total_ms\":5.000") != string::npos);
+
+          // Many more requests than the reservoir holds, the percentiles of the sample stay close
+          stats.clear();
+
+          for (int i = 0; i < 20000; i++)
+          {
+               CResponse::TTimings timings;
+               timings.m_Start = start;
+               timings.m_Finished = start + std::chrono::milliseconds(1 + i % 100);
+
+               stats.record(CURLHandler("http://many.example.com/"), 200, timings);
+          }
+
+          ASSERT(stats.getRequests("many.example.com") == 20000);
+          ASSERT(std::abs(stats.getPercentile("many.example.com", CRequestStats::TOTAL, 50) - 50) <= 8);
+          ASSERT(std::abs(stats.getPercentile("many.example.com", CRequestStats::TOTAL, 90) - 90) <= 5);
+
+          stats.clear();
+     }
+
+     void CRequestStats_log()
+     {
+          namespace fs = std::filesystem;
+
+          fs::path logPath = fs::temp_directory_path() / "wget_clone_requests.jsonl";
+          auto &stats = CRequestStats::getInstance();
+
+          // Nothing is written before the log is opened
+          CResponse::TTimings timings;
+          timings.m_Start = CResponse::TTimings::TClock::now();
+          timings.m_Finished = timings.m_Start + std::chrono::milliseconds(3);
+          stats.record(CURLHandler("http://log.example.com/before.html"), 200, timings);
+
+          ASSERT(stats.openLog(logPath.string()));
+          stats.record(CURLHandler("http://log.example.com/a.html"), 200, timings);
+          stats.record(CURLHandler("http://log.example.com/b.html"), 0, timings);
+          ASSERT(stats.closeLog());
+          stats.record(CURLHandler("http://log.example.com/after.html"), 200, timings);
+
+          std::ifstream ifs(logPath);
+          vector<string> lines;
+          for (string line; std::getline(ifs, line);)
+               lines.push_back(line);
+
+          ASSERT(lines.size() == 2);
+          if (lines.size() == 2)
+          {
+               ASSERT(Utils::startsWith(lines[0], "{\"url\":\"http://log.example.com/a.html\",\"status\":200,"));
+               ASSERT(Utils::startsWith(lines[1], "{\"url\":\"http://log.example.com/b.html\",\"status\":0,"));
+               ASSERT(Utils::endsWith(lines[1], "}"));
+          }
+
+          ASSERT(!stats.openLog((logPath / "missing" / "requests.jsonl").string()));
+          ASSERT(stats.closeLog());
+
+          stats.clear();
+          fs::remove(logPath);
+     }
+
+     void CHttpsDownloader_timings()
+     {
+          TLocalServer server("<html></html>", "<html></html>");
+
+          // "localhost" may resolve to IPv6 first, the server only listens on IPv4
+          CURLHandler url("http://localhost:" + std::to_string(server.getPort()) + "/");
+          CResponse response = CHttpsDownloader().get(url);
+
+          const auto &timings = response.m_Timings;
+          ASSERT(response.m_Status == CResponse::EStatus::FINISHED);
+          ASSERT(response.m_StatusCode == 200);
+          ASSERT(timings.m_Start <= timings.m_Resolved && timings.m_Resolved <= timings.m_Connected);
+          ASSERT(timings.m_Connected <= timings.m_RequestSent && timings.m_RequestSent <= timings.m_FirstByte);
+          ASSERT(timings.m_FirstByte <= timings.m_Finished);
+          ASSERT(timings.m_Handshaked == CResponse::TTimings::TClock::time_point());
+          ASSERT(timings.m_BytesReceived > response.m_Body.length());
+          ASSERT(CRequestStats::getInstance().getRequests(string(url.getDomain())) == 1);
+
+          CRequestStats::getInstance().clear();
+     }
+
+     void CHttpsDownloader_parseHeader()
+     {
+          CURLHandler url("https://example.com/docs/private/");
+
+          CResponse ok = CHttpsDownloader::parseHeader("HTTP/1.1 200 OK\r\nContent-type: text/css\r\nContent-Length: 1534\r\n"
+                                                       "Content-Disposition: attachment; filename=\"a.css\"\r\n",
+                                                       url);
+          ASSERT(ok.m_Status == CResponse::EStatus::IN_PROGRESS);
+          ASSERT(ok.m_StatusCode == 200);
+          ASSERT(ok.m_ContentType == "text/css");
+          ASSERT(ok.m_ContentLength == 1534);
+          ASSERT(ok.m_ContentDisposition == "attachment; filename=\"a.css\"");
+
+          // Relative location is resolved against the requested URL
+          CResponse moved = CHttpsDownloader::parseHeader("HTTP/1.1 302 Found\r\nLocation: /login?next=%2F\r\nContent-Length: 0\r\n", url);
+          ASSERT(moved.m_Status == CResponse::EStatus::MOVED);
+          ASSERT(moved.m_StatusCode == 302);
+          ASSERT(moved.m_MovedUrl.getNormURL() == "https://example.com/login/?next=%2F");
+
+          ASSERT(CHttpsDownloader::parseHeader("SSH-2.0-OpenSSH_9.6\r\n", url).m_Status == CResponse::EStatus::SERVER_ERROR);
+          ASSERT(CHttpsDownloader::parseHeader("", url).m_Status == CResponse::EStatus::SERVER_ERROR);
+     }
+
+     void CMetrics_counter()
+     {
+          auto &metrics = CMetrics::getInstance();
+          auto &counter = metrics.counter("test_counter_total", "Counter of the test");
+
+          // Same name and labels return the same metric
+          ASSERT(&counter == &metrics.counter("test_counter_total", "Counter of the test"));
+          ASSERT(&counter != &metrics.counter("test_counter_total", "Counter of the test", {{"kind", "other"}}));
+
+          uint64_t before = counter.get();
+
+          // Threads increment different shards
+          vector<std::thread> threads;
+          for (int t = 0; t < 8; t++)
+               threads.emplace_back([&counter]()
+                                    { for (int i = 0; i < 10000; i++) counter.add(); });
+
+          for (auto &thread : threads)
+               thread.join();
+
+          ASSERT(counter.get() - before == 80000);
+
+          auto &gauge = metrics.gauge("test_gauge", "Gauge of the test");
+          gauge.set(5);
+          gauge.add(-7);
+          ASSERT(gauge.get() == -2);
+     }
+
+     void CMetrics_render()
+     {
+          auto &metrics = CMetrics::getInstance();
+
+          auto &histogram = metrics.histogram("test_duration_seconds", "Histogram of the test", {0.1, 1}, {{"stage", "a\"b"}});
+          histogram.observe(0.05);
+          histogram.observe(0.5);
+          histogram.observe(0.5);
+          histogram.observe(3);
+
+          ASSERT((histogram.getCounts() == vector<uint64_t>{1, 2, 1}));
+          ASSERT(histogram.getCount() == 4);
+          ASSERT(std::abs(histogram.getSum() - 4.05) < 0.0001);
+
+          metrics.counter("test_rendered_total", "Line\nbreak", {{"code", "200"}}).add(3);
+
+          string text = metrics.render();
+          ASSERT(text.find("# HELP test_duration_seconds Histogram of the test\n# TYPE test_duration_seconds histogram\n") != string::npos);
+
+          // Buckets are cumulative, the label value is escaped
+          ASSERT(text.find("test_duration_seconds_bucket{stage=\"a\\\"b\",le=\"0.1\"} 1\n") != string::npos);
+          ASSERT(text.find("test_duration_seconds_bucket{stage=\"a\\\"b\",le=\"1\"} 3\n") != string::npos);
+          ASSERT(text.find("test_duration_seconds_bucket{stage=\"a\\\"b\",le=\"+Inf\"} 4\n") != string::npos);
+          ASSERT(text.find("test_duration_seconds_sum{stage=\"a\\\"b\"} 4.05\n") != string::npos);
+          ASSERT(text.find("test_duration_seconds_count{stage=\"a\\\"b\"} 4\n") != string::npos);
+
+          ASSERT(text.find("# HELP test_rendered_total Line\\nbreak\n") != string::npos);
+          ASSERT(text.find("# TYPE test_rendered_total counter\ntest_rendered_total{code=\"200\"} 3\n") != string::npos);
+     }
+
+     void CMetricsExporter_scrape()
+     {
+          string filePath = "/tmp/wget_test_metrics.prom";
+          std::filesystem::remove(filePath);
+
+          CMetrics::getInstance().counter("test_scraped_total", "Scraped counter of the test").add(42);
+
+          {
+               CMetricsExporter exporter(filePath, 0);
+               ASSERT(exporter.isListening());
+               ASSERT(exporter.getPort() > 0);
+
+               int client = socket(AF_INET, SOCK_STREAM, 0);
+               ASSERT(client >= 0);
+
+               sockaddr_in address = {};
+               address.sin_family = AF_INET;
+               address.sin_port = htons(exporter.getPort());
+               address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+               ASSERT(connect(client, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0);
+
+               string request = "GET /metrics HTTP/1.0\r\n\r\n";
+               ASSERT(send(client, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+
+               string response;
+               char buffer[4096];
+               ssize_t received;
+               while ((received = recv(client, buffer, sizeof(buffer), 0)) > 0)
+                    response.append(buffer, received);
+               close(client);
+
+               ASSERT(Utils::startsWith(response, "HTTP/1.0 200 OK\r\n"));
+               ASSERT(response.find("Content-Type: text/plain; version=0.0.4") != string::npos);
+               ASSERT(response.find("\ntest_scraped_total 42\n") != string::npos);
+          }
+
+          // The final file is written when the exporter stops
+          std::ifstream file(filePath);
+          std::stringstream content;
+          content << file.rdbuf();
+          ASSERT(content.str().find("\ntest_scraped_total 42\n") != string::npos);
+          ASSERT(!std::filesystem::exists(filePath + ".tmp"));
+
+          std::filesystem::remove(filePath);
+     }
+
+     void CTracer_spans()
+     {
+          auto &tracer = CTracer::getInstance();
+          string path = "/tmp/wget_test_trace.json";
+
+          // Nothing is recorded before start()
+          {
+               CTracer::CSpan span("ignored", "test", "http://example.com/");
+          }
+          ASSERT(!tracer.isEnabled());
+
+          tracer.start(path);
+          ASSERT(tracer.isEnabled());
+          ASSERT(tracer.getSpans() == 0);
+
+          vector<std::thread> threads;
+          for (int t = 0; t < 4; t++)
+               threads.emplace_back([&tracer, t]()
+                                    {
+                                         tracer.setThreadName("worker " + std::to_string(t));
+
+                                         for (int i = 0; i < 100; i++)
+                                         {
+                                              CTracer::CSpan outer("outer", "test", "http://example.com/\"" + std::to_string(t) + "\"");
+                                              CTracer::CSpan inner("inner", "test", "http://example.com/");
+                                         } });
+
+          for (auto &thread : threads)
+               thread.join();
+
+          ASSERT(tracer.getSpans() == 800);
+          ASSERT(tracer.stop());
+          ASSERT(!tracer.isEnabled());
+
+          std::ifstream file(path);
+          std::stringstream content;
+          content << file.rdbuf();
+          string trace = content.str();
+
+          ASSERT(Utils::startsWith(trace, "{\"traceEvents\":["));
+          ASSERT(trace.find("\"name\":\"thread_name\",\"ph\":\"M\"") != string::npos);
+          ASSERT(trace.find("{\"name\":\"worker 3\"}") != string::npos);
+          ASSERT(trace.find("\"args\":{\"url\":\"http://example.com/\\\"2\\\"\"}") != string::npos);
+          ASSERT(trace.find("ignored") == string::npos);
+
+          // One event per line, every thread has its own tid
+          size_t events = 0;
+          std::set<string> tids;
+          std::istringstream lines(trace);
+          string line;
+          while (std::getline(lines, line))
+          {
+               size_t tid = line.find("\"tid\":");
+               if (tid == string::npos)
+                    continue;
+
+               events++;
+               tids.insert(line.substr(tid, line.find(',', tid) - tid));
+          }
+
+          ASSERT(events == 804);
+          ASSERT(tids.size() == 4);
+
+          std::filesystem::remove(path);
+     }
+
+     void CContentStore_hash()
+     {
+          ASSERT(CContentStore::hash("lorem").size() == 64);
+          ASSERT(CContentStore::hash("lorem") == CContentStore::hash("lorem"));
+          ASSERT(CContentStore::hash("lorem") != CContentStore::hash("Lorem"));
+          ASSERT(CContentStore::hash("") != CContentStore::hash(" "));
+     }
+
+     void CContentStore_write()
+     {
+          namespace fs = std::filesystem;
+
+          fs::path outputPath = fs::temp_directory_path() / "wget_clone_store_test";
+          fs::remove_all(outputPath);
+          CDirectoryCache::getInstance().clear();
+
+          auto &store = CContentStore::getInstance();
+          store.setEnabled(true);
+
+          // Duplicates have to wait for the asynchronous write of the first copy
+          COutputWriter::setBackend("auto", 2);
+
+          auto write = [&](const string &path, const string &content)
+          {
+               COutputWriter::TRequest request;
+               request.m_Path = path;
+               request.m_Content = content;
+               store.write(std::move(request));
+          };
+
+          size_t written = store.getWrittenBytes();
+          size_t deduped = store.getDedupedBytes();
+
+          string content(1000, 'x');
+          write((outputPath / "a.js").string(), content);
+          write((outputPath / "__external" / "b.js").string(), content);
+          write((outputPath / "c.js").string(), content + "y");
+          COutputWriter::getInstance().flush();
+
+          ASSERT(fs::file_size(outputPath / "__external" / "b.js") == 1000);
+          ASSERT(fs::hard_link_count(outputPath / "a.js") == 2);
+          ASSERT(fs::hard_link_count(outputPath / "c.js") == 1);
+          ASSERT(store.getWrittenBytes() - written == 2001);
+          ASSERT(store.getDedupedBytes() - deduped == 1000);
+
+          // Files streamed to disk during the fetch are only registered
+          auto stream = [&](const string &path, const string &content)
+          {
+               std::ofstream(path, std::ios_base::out | std::ios_base::binary) << content;
+               store.adopt(path, content.size());
+          };
+
+          stream((outputPath / "e.js").string(), content);
+          stream((outputPath / "f.js").string(), content + "z");
+          ASSERT(fs::file_size(outputPath / "e.js") == 1000);
+          ASSERT(fs::hard_link_count(outputPath / "a.js") == 3);
+          ASSERT(fs::hard_link_count(outputPath / "f.js") == 1);
+          ASSERT(store.getWrittenBytes() - written == 3002);
+          ASSERT(store.getDedupedBytes() - deduped == 2000);
+
+          // Disabled store writes every copy
+          store.setEnabled(false);
+          write((outputPath / "d.js").string(), content);
+          COutputWriter::getInstance().flush();
+          ASSERT(fs::hard_link_count(outputPath / "d.js") == 1);
+          ASSERT(store.getDedupedBytes() - deduped == 2000);
+
+          COutputWriter::setBackend("sync", 1);
+          fs::remove_all(outputPath);
+     }
+
+     void CWarcWriter_failure()
+     {
+          namespace fs = std::filesystem;
+
+          fs::path outputPath = fs::temp_directory_path() / "wget_clone_warc_failure_test";
+          fs::remove_all(outputPath);
+          CDirectoryCache::getInstance().clear();
+
+          auto &warc = CWarcWriter::getInstance();
+          ASSERT(warc.open((outputPath / "crawl").string(), 1024 * 1024));
+
+          // Files can't grow over 100 kB, like on a full disk, the third record doesn't fit
+          rlimit original;
+          getrlimit(RLIMIT_FSIZE, &original);
+          rlimit limited = original;
+          limited.rlim_cur = 100 * 1024;
+
+          auto handler = signal(SIGXFSZ, SIG_IGN);
+          setrlimit(RLIMIT_FSIZE, &limited);
+
+          std::mt19937 random(7);
+          for (int i = 0; i < 4; i++)
+          {
+               string body;
+               while (body.size() < 40000)
+                    body += static_cast<char>(random());
+
+               auto record = warc.begin("http://example.com/" + std::to_string(i), "GET / HTTP/1.0\r\n\r\n", "HTTP/1.0 200 OK\r\n\r\n");
+               record.append(body);
+               warc.commit(std::move(record), 200, "", false);
+          }
+
+          bool enabled = warc.isEnabled();
+          bool closed = warc.close();
+
+          setrlimit(RLIMIT_FSIZE, &original);
+          signal(SIGXFSZ, handler);
+
+          // The output redirected to a file failed meanwhile as well
+          CLogger::getInstance().flush();
+          cout.clear();
+          std::cerr.clear();
+
+          ASSERT(!enabled);
+          ASSERT(!closed);
+          ASSERT(warc.getRecords() == 2);
+
+          // Only the records that reached the disk are indexed, all of them within the file
+          std::ifstream cdx(outputPath / "crawl.cdx");
+          string line;
+          std::getline(cdx, line);
+
+          int lines = 0;
+          bool inside = true;
+
+          while (std::getline(cdx, line))
+          {
+               vector<string> fields = Utils::splitString(line, " ");
+               inside = inside && fields.size() == 11 &&
+                        std::stoul(fields[8]) + std::stoul(fields[9]) <= fs::file_size(outputPath / fields[10]);
+               lines++;
+          }
+
+          ASSERT(lines == 2);
+          ASSERT(inside);
+
+          // Closed, the next archive starts cleanly
+          ASSERT(warc.close());
+
+          fs::remove_all(outputPath);
+     }
+
+     void COutputWriter_backends()
+     {
+          namespace fs = std::filesystem;
+
+          fs::path outputPath = fs::temp_directory_path() / "wget_clone_writer_test";
+
+          ASSERT(!COutputWriter::setBackend("unknown", 1));
+          ASSERT(COutputWriter::setBackend("pool", 2));
+          ASSERT(COutputWriter::getInstance().getName() == "pool");
+
+          bool uringAvailable = CUringWriter().isAvailable();
+          ASSERT(COutputWriter::setBackend("uring", 2));
+          ASSERT(COutputWriter::getInstance().getName() == (uringAvailable ? "uring" : "pool"));
+
+          for (const string backend : {"sync", "pool", "uring"})
+          {
+               fs::remove_all(outputPath);
+               CDirectoryCache::getInstance().clear();
+               COutputWriter::setBackend(backend, 2);
+
+               auto &writer = COutputWriter::getInstance();
+               std::atomic<int> written{0};
+
+               // Many files in nested folders, also more files than the io_uring slots
+               for (int i = 0; i < 200; i++)
+               {
+                    COutputWriter::TRequest request;
+                    request.m_Path = (outputPath / ("dir" + std::to_string(i % 7)) / "sub" / ("file" + std::to_string(i) + ".txt")).string();
+                    request.m_Content = string(i * 10, 'a' + i % 26);
+                    request.m_Done = [&](bool result)
+                    { written += result; };
+
+                    writer.submit(std::move(request));
+               }
+
+               writer.flush();
+               ASSERT(written == 200);
+
+               if (auto *uring = dynamic_cast<CUringWriter *>(&writer))
+                    ASSERT(uring->getFallbacks() == 0);
+
+               bool allValid = true;
+               for (int i = 0; i < 200; i++)
+               {
+                    std::ifstream ifs(outputPath / ("dir" + std::to_string(i % 7)) / "sub" / ("file" + std::to_string(i) + ".txt"), std::ios::binary);
+                    string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+                    allValid = allValid && content == string(i * 10, 'a' + i % 26);
+               }
+               ASSERT(allValid);
+          }
+
+          COutputWriter::setBackend("sync", 1);
+          fs::remove_all(outputPath);
+     }
+
+     void CUringWriter_longChain()
+     {
+          namespace fs = std::filesystem;
+
+          CUringWriter writer(4);
+          if (!writer.isAvailable())
+               return;
+
+          fs::path outputPath = fs::temp_directory_path() / "wget_clone_uring_test";
+          fs::remove_all(outputPath);
+          CDirectoryCache::getInstance().clear();
+
+          // More new folder levels than the ring entries, the chain can never be submitted
+          std::atomic<int> written{0};
+          for (const fs::path &path : {outputPath / "a" / "b" / "c" / "long.txt", outputPath / "a" / "short.txt"})
+          {
+               COutputWriter::TRequest request;
+               request.m_Path = path.string();
+               request.m_Content = "lorem";
+               request.m_Done = [&](bool result)
+               { written += result; };
+
+               writer.submit(std::move(request));
+               writer.flush();
+          }
+
+          // The folders are known after the synchronous write, the next file goes through the ring
+          ASSERT(written == 2);
+          ASSERT(writer.getFallbacks() == 1);
+          ASSERT(fs::file_size(outputPath / "a" / "b" / "c" / "long.txt") == 5);
+          ASSERT(fs::file_size(outputPath / "a" / "short.txt") == 5);
+
+          fs::remove_all(outputPath);
+     }
+
+     void CDirectoryCache_create()
+     {
+          namespace fs = std::filesystem;
+
+          fs::path outputPath = fs::temp_directory_path() / "wget_clone_dircache_test";
+          fs::remove_all(outputPath);
+          fs::create_directories(outputPath / "old");
+          std::ofstream(outputPath / "old" / "index.html") << "lorem";
+
+          auto &cache = CDirectoryCache::getInstance();
+          cache.clear();
+
+          // Every level is created only once
+          size_t mkdirs = cache.getMkdirCalls();
+          ASSERT(cache.create((outputPath / "a" / "b" / "c").string()));
+          ASSERT(fs::is_directory(outputPath / "a" / "b" / "c"));
+          size_t firstMkdirs = cache.getMkdirCalls() - mkdirs;
+
+          ASSERT(cache.create((outputPath / "a" / "b" / "c").string() + "/"));
+          ASSERT(cache.create((outputPath / "a" / "b").string()));
+          ASSERT(cache.getMkdirCalls() - mkdirs == firstMkdirs);
+          ASSERT(cache.create((outputPath / "a" / "d").string()));
+          ASSERT(cache.getMkdirCalls() - mkdirs == firstMkdirs + 1);
+          ASSERT(cache.contains((outputPath / "a" / "d").string()));
+
+          // Files from the previous runs are found, fresh folders are not checked at all
+          ASSERT(cache.fileExists((outputPath / "old" / "index.html").string()));
+          ASSERT(!cache.fileExists((outputPath / "old" / "other.html").string()));
+
+          size_t stats = cache.getStatCalls();
+          ASSERT(!cache.fileExists((outputPath / "a" / "b" / "c" / "index.html").string()));
+          ASSERT(cache.getStatCalls() == stats);
+
+          // Missing folder is checked once and still created later
+          ASSERT(!cache.fileExists((outputPath / "new" / "a.html").string()));
+          ASSERT(!cache.fileExists((outputPath / "new" / "b.html").string()));
+          ASSERT(cache.getStatCalls() == stats + 1);
+          ASSERT(!cache.contains((outputPath / "new").string()));
+          ASSERT(cache.create((outputPath / "new").string()));
+          ASSERT(fs::is_directory(outputPath / "new"));
+
+          // File in place of a folder
+          ASSERT(!cache.create((outputPath / "old" / "index.html" / "x").string()));
+
+          cache.clear();
+          fs::remove_all(outputPath);
+     }
+
+     void CWarcWriter_helpers()
+     {
+          ASSERT(CWarcWriter::surt("https://www.Example.com/A/b.html?x=1") == "com,example)/a/b.html?x=1");
+          ASSERT(CWarcWriter::surt("http://localhost:8080") == "localhost:8080)/");
+          ASSERT(CWarcWriter::base32("") == "");
+          ASSERT(CWarcWriter::base32("f") == "MY======");
+          ASSERT(CWarcWriter::base32("foobar") == "MZXW6YTBOI======");
+     }
+
+     void CWarcWriter_archive()
+     {
+          namespace fs = std::filesystem;
+
+          fs::path outputPath = fs::temp_directory_path() / "wget_clone_warc_test";
+          fs::remove_all(outputPath);
+          CDirectoryCache::getInstance().clear();
+
+          // Every file holds only one response
+          auto &warc = CWarcWriter::getInstance();
+          ASSERT(warc.open((outputPath / "crawl").string(), 1));
+          ASSERT(warc.isEnabled());
+
+          // The last body doesn't compress, so it's spooled to disk
+          auto makeBody = [](int i)
+          {
+               string body = "body " + std::to_string(i) + string(10000, 'x');
+               std::mt19937 random(i);
+               while (i == 2 && body.size() < 200000)
+                    body += static_cast<char>(random());
+               return body;
+          };
+
+          for (int i = 0; i < 3; i++)
+          {
+               string body = makeBody(i);
+               auto record = warc.begin("http://example.com/" + std::to_string(i) + ".html", "GET / HTTP/1.0\r\n\r\n",
+                                        "HTTP/1.0 200 OK\r\nContent-Type: text/html; charset=utf-8\r\n\r\n");
+               ASSERT(record.isActive());
+
+               // Received in parts
+               record.append(body.substr(0, 100));
+               record.append(body.substr(100));
+               warc.commit(std::move(record), 200, "text/html; charset=utf-8", false);
+          }
+
+          warc.close();
+          ASSERT(!warc.isEnabled());
+          ASSERT(warc.getRecords() == 3);
+          ASSERT(fs::exists(outputPath / "crawl-00002.warc.gz"));
+          ASSERT(!fs::exists(outputPath / "crawl-00003.warc.gz"));
+
+          // Every indexed offset is a separate gzip member with the whole response record
+          std::ifstream cdx(outputPath / "crawl.cdx");
+          string line;
+          std::getline(cdx, line);
+          ASSERT(line == " CDX N b a m s k r M S V g");
+
+          int lines = 0;
+          bool allValid = true;
+
+          while (std::getline(cdx, line))
+          {
+               vector<string> fields = Utils::splitString(line, " ");
+               if (fields.size() != 11)
+               {
+                    allValid = false;
+                    break;
+               }
+
+               std::ifstream warcFile(outputPath / fields[10], std::ios::binary);
+               string compressed(std::stoul(fields[8]), '\0');
+               warcFile.seekg(std::stoul(fields[9]));
+               warcFile.read(compressed.data(), compressed.size());
+
+               z_stream stream = z_stream();
+               inflateInit2(&stream, 16 + MAX_WBITS);
+               string record(300000, '\0');
+               stream.next_in = reinterpret_cast<Bytef *>(compressed.data());
+               stream.avail_in = compressed.size();
+               stream.next_out = reinterpret_cast<Bytef *>(record.data());
+               stream.avail_out = record.size();
+               int result = inflate(&stream, Z_FINISH);
+               record.resize(record.size() - stream.avail_out);
+               inflateEnd(&stream);
+
+               string body = makeBody(lines);
+               allValid = allValid && result == Z_STREAM_END && stream.avail_in == 0 &&
+                          Utils::startsWith(record, "WARC/1.1\r\nWARC-Type: response\r\n") &&
+                          Utils::endsWith(record, "\r\n\r\n" + body + "\r\n\r\n") &&
+                          fields[0] == "com,example)/" + std::to_string(lines) + ".html" &&
+                          fields[3] == "text/html" && fields[4] == "200" && fields[5].size() == 32;
+               lines++;
+          }
+
+          ASSERT(allValid);
+          ASSERT(lines == 3);
+
+          // Only the archive files and the index are left, no spool files
+          ASSERT(std::distance(fs::directory_iterator(outputPath), fs::directory_iterator()) == 4);
+
+          fs::remove_all(outputPath);
+     }
+
+     /**
+      * @brief Page with every kind of markup the tokenizer handles
+      *
+      */
+     string tokenizerPage()
+     {
+          return "<!DOCTYPE html><html><head><link rel=stylesheet HREF = 'style.css'>"
+                        "<script>var a = '<img src=\"no.png\">';</script ><!-- <a href=\"no.html\"> -->"
+                        "<style>a { background: url(block.png) } /* url(no.png) */ b { background: url(es\\63 .png) }</style></head>"
+                        "<body><a href=\"page.html#top\" class=x>link</a> 1 < 2 <IMG Src=\" img.png \" alt=\"src=no.png\">"
+                        "<img srcset=\"a.png 1x, b.png 2x,c.png\"><div style=\"background: url('bg.png')\"></div>"
+                        "<textarea><a href=\"no.html\"></textarea><a href=>empty</a><input disabled src=unquoted.png /></body></html>";
+     }
+
+     void CHtmlTokenizer_tokenize()
+     {
+          using EAttribute = CHtmlTokenizer::EAttribute;
+
+          string html = tokenizerPage();
+          auto links = CHtmlTokenizer::tokenize(html);
+
+          vector<string> values;
+          for (const auto &link : links)
+               values.push_back(link.m_Value);
+
+          ASSERT((values == vector<string>{"style.css", "block.png", "esc.png", "page.html#top", "img.png", "a.png", "b.png", "c.png", "bg.png", "unquoted.png"}));
+          ASSERT(links.size() == 10);
+
+          if (links.size() == 10)
+          {
+               ASSERT(links[0].m_Tag == "link" && links[0].m_Attribute == EAttribute::HREF);
+               ASSERT(links[1].m_Tag == "style" && links[1].m_Attribute == EAttribute::STYLE && !links[1].m_Quoted);
+               ASSERT(html.substr(links[2].m_Offset, links[2].m_Length) == "es\\63 .png");
+               ASSERT(links[4].m_Tag == "img" && links[4].m_Attribute == EAttribute::SRC);
+               ASSERT(html.substr(links[4].m_Offset, links[4].m_Length) == "img.png");
+               ASSERT(links[6].m_Attribute == EAttribute::SRCSET);
+               ASSERT(links[8].m_Tag == "div" && links[8].m_Attribute == EAttribute::STYLE && links[8].m_Quoted);
+               ASSERT(links[9].m_Tag == "input");
+          }
+
+          // Character references in attributes are decoded, the offsets still cover the raw link
+          string encoded = "<div style=\"background:url(&quot;/img/a&#46;png&quot;)\"></div><a href=\"list?a=1&amp;b=&#x32;\">";
+          auto decoded = CHtmlTokenizer::tokenize(encoded);
+          ASSERT(decoded.size() == 2);
+
+          if (decoded.size() == 2)
+          {
+               ASSERT(decoded[0].m_Value == "/img/a.png" && decoded[0].m_Quoted && !decoded[0].m_Element);
+               ASSERT(encoded.substr(decoded[0].m_Offset, decoded[0].m_Length) == "/img/a&#46;png");
+               ASSERT(decoded[1].m_Value == "list?a=1&b=2");
+               ASSERT(encoded.substr(decoded[1].m_Offset, decoded[1].m_Length) == "list?a=1&amp;b=&#x32;");
+          }
+
+          // Unknown and unterminated references stay as written, the style element has none
+          ASSERT(CHtmlTokenizer::tokenize("<a href='a&copy;b&#;&amp'>")[0].m_Value == "a&copy;b&#;&amp");
+          ASSERT(CHtmlTokenizer::tokenize("<style>a { background: url(a&amp;b.png) }</style>")[0].m_Value == "a&amp;b.png");
+          ASSERT(CHtmlTokenizer::tokenize("<style>a { background: url(a&amp;b.png) }</style>")[0].m_Element);
+          ASSERT(CHtmlTokenizer::escape("a.png") == "a.png");
+          ASSERT(CHtmlTokenizer::escape("list?a=1&b=\"2\"") == "list?a=1&amp;b=&quot;2&quot;");
+
+          // Broken markup doesn't loop or crash
+          ASSERT(CHtmlTokenizer::tokenize("<a href=\"x.html").empty());
+          ASSERT(CHtmlTokenizer::tokenize("<script><a href=\"x.html\">").empty());
+          ASSERT(CHtmlTokenizer::tokenize("<a = href=x.html>").size() == 1);
+          ASSERT(CHtmlTokenizer::tokenize("<<<!-<!").empty());
+     }
+
+     void CHtmlTokenizer_feed()
+     {
+          string html = tokenizerPage();
+          auto expected = CHtmlTokenizer::tokenize(html);
+
+          auto equal = [](const vector<CHtmlTokenizer::TLink> &a, const vector<CHtmlTokenizer::TLink> &b)
+          {
+               return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const auto &x, const auto &y)
+                                 { return x.m_Tag == y.m_Tag && x.m_Attribute == y.m_Attribute && x.m_Offset == y.m_Offset && x.m_Length == y.m_Length && x.m_Value == y.m_Value; });
+          };
+
+          // Data split at every position, then received byte by byte
+          for (size_t split = 0; split < html.length(); split++)
+          {
+               CHtmlTokenizer tokenizer;
+               vector<CHtmlTokenizer::TLink> links;
+
+               tokenizer.feed(html.substr(0, split), false, links);
+               tokenizer.feed(html, true, links);
+
+               ASSERT(equal(links, expected));
+          }
+
+          CHtmlTokenizer tokenizer;
+          vector<CHtmlTokenizer::TLink> links;
+
+          for (size_t length = 1; length < html.length(); length++)
+               tokenizer.feed(html.substr(0, length), false, links);
+
+          tokenizer.feed(html, true, links);
+
+          ASSERT(equal(links, expected));
+          ASSERT(tokenizer.getPosition() == html.length());
+     }
+
+     void CEditList_apply()
+     {
+          CEditList edits;
+
+          // Added out of order, insertions at the same offset keep their order
+          string content = "0123456789";
+          edits.add(5, 2, "X");
+          edits.add(0, 0, ">");
+          edits.add(9, 1, "");
+          edits.add(0, 0, "!");
+          edits.apply(content);
+
+          ASSERT(content == ">!01234X78");
+          ASSERT(edits.size() == 0);
+
+          edits.apply(content);
+          ASSERT(content == ">!01234X78");
+
+          // Overlapping and out of range edits
+          for (auto [offset, length] : {std::pair<size_t, size_t>{1, 3}, {11, 0}})
+          {
+               edits.add(0, 2, "a");
+               edits.add(offset, length, "b");
+
+               try
+               {
+                    edits.apply(content);
+                    ASSERT(false);
+               }
+               catch (const std::invalid_argument &e)
+               {
+               }
+
+               ASSERT(content == ">!01234X78");
+               edits.clear();
+          }
+     }
+
+     void CByteScanner_differential()
+     {
+          using EKernel = CByteScanner::EKernel;
+
+          // Sparse hits, high bytes and every alignment and length around the vector sizes
+          std::mt19937 random(42);
+          string data(300, 'a');
+          for (auto &c : data)
+               c = static_cast<char>(random() % 8 == 0 ? "<=\"'u@\xff"[random() % 7] : 'a' + random() % 20);
+
+          for (const string bytes : {"<", "=\"'", "uU@", "\xff", "<=\"'uU@/"})
+          {
+               CByteScanner scalar(bytes, EKernel::SCALAR);
+
+               for (EKernel kernel : {EKernel::SSE2, EKernel::AVX2})
+               {
+                    if (!CByteScanner::isSupported(kernel))
+                         continue;
+
+                    CByteScanner simd(bytes, kernel);
+
+                    for (size_t length = 0; length <= 80; length++)
+                         for (size_t from = 0; from <= length; from++)
+                              ASSERT(simd.find(data.data() + 3, length, from) == scalar.find(data.data() + 3, length, from));
+
+                    for (size_t from = 0; from < data.length(); from++)
+                         ASSERT(simd.find(data, from) == scalar.find(data, from));
+               }
+
+               // Scalar agrees with the standard library
+               for (size_t from = 0; from < data.length(); from++)
+                    ASSERT(scalar.find(data, from) == data.find_first_of(bytes, from));
+          }
+
+          ASSERT(CByteScanner::isSupported(CByteScanner::getBestKernel()));
+          ASSERT(CByteScanner("<").find("") == string::npos);
+     }
+
+} // namespace Tests
+
+int main(void)
+{
+     Tests::ALL_PASSED = true;
+
+     cout << "---------- [STARTING TESTS] ----------\n"
+          << endl;
+
+     // ============ Utils ============
+     cout << "---------- [Testing Utils] -----------" << endl;
+
+     Tests::Utils_startsWith();
+     Tests::Utils_endsWith();
+     Tests::Utils_contains();
+     Tests::Utils_toLowerCase();
+     Tests::Utils_replaceAll();
+     Tests::Utils_splitString();
+
+     cout << endl;
+
+     // ============ CURLHandler ============
+     cout << "------- [Testing CURLHandler] --------" << endl;
+
+     Tests::CURLHandler_construct();
+     Tests::CURLHandler_addPath();
+     Tests::CURLHandler_setDomain();
+     Tests::CURLHandler_normalize();
+     Tests::CURLParser_parse();
+     Tests::CURLParser_resolve();
+     Tests::CURLParser_canonicalize();
+     Tests::CRegexRegistry_concurrent();
+     Tests::CInternTable_concurrent();
+     Tests::CDomainMatcher_matches();
+
+     cout << endl;
+
+     // ============ CConfig ============
+     cout << "------- [Testing CConfig] --------" << endl;
+
+     CLogger::init(CLogger::ELogLevel::Error);
+     Tests::CConfig_storeValues();
+     Tests::CConfig_getValues();
+     Tests::CConfig_parseArgsMissingUrl();
+     Tests::CConfig_parseArgsInvalid();
+     Tests::CConfig_parseArgsValid();
+     Tests::CConfig_snapshot();
+
+     cout << endl;
+
+     // ============ CLogger ============
+     cout << "------- [Testing CLogger] --------" << endl;
+
+     Tests::CLogger_async();
+     Tests::CLogger_lazy();
+
+     cout << endl;
+
+     // ============ CPipeline ============
+     cout << "------- [Testing CPipeline] --------" << endl;
+
+     Tests::CBoundedQueue_pushPop();
+     Tests::CBoundedQueue_backpressure();
+     Tests::CPipeline_run();
+     Tests::CPipeline_warcClaim();
+
+     cout << endl;
+
+     // ============ CRequestStats ============
+     cout << "------- [Testing CRequestStats] --------" << endl;
+
+     Tests::CRequestStats_percentiles();
+     Tests::CRequestStats_log();
+     Tests::CHttpsDownloader_timings();
+     Tests::CHttpsDownloader_parseHeader();
+
+     cout << endl;
+
+     // ============ CMetrics ============
+     cout << "------- [Testing CMetrics] --------" << endl;
+
+     Tests::CMetrics_counter();
+     Tests::CMetrics_render();
+     Tests::CMetricsExporter_scrape();
+
+     cout << endl;
+
+     // ============ CTracer ============
+     cout << "------- [Testing CTracer] --------" << endl;
+
+     Tests::CTracer_spans();
+
+     cout << endl;
+
+     // ============ CMemoryBudget ============
+     cout << "------- [Testing CMemoryBudget] --------" << endl;
+
+     Tests::CMemoryBudget_reserve();
+     Tests::CMemoryBudget_stress();
+
+     cout << endl;
+
+     // ============ COutputWriter ============
+     cout << "------- [Testing COutputWriter] --------" << endl;
+
+     Tests::COutputWriter_backends();
+     Tests::CUringWriter_longChain();
+
+     cout << endl;
+
+     // ============ CDirectoryCache ============
+     cout << "------- [Testing CDirectoryCache] --------" << endl;
+
+     Tests::CDirectoryCache_create();
+
+     cout << endl;
+
+     // ============ CHtmlTokenizer ============
+     cout << "------- [Testing CHtmlTokenizer] --------" << endl;
+
+     Tests::CHtmlTokenizer_tokenize();
+     Tests::CHtmlTokenizer_feed();
+     Tests::CFileHtml_streaming();
+
+     cout << endl;
+
+     // ============ CCssTokenizer ============
+     cout << "------- [Testing CCssTokenizer] --------" << endl;
+
+     Tests::CCssTokenizer_tokenize();
+     Tests::CCssTokenizer_feed();
+     Tests::CByteScanner_differential();
+     Tests::CEditList_apply();
+
+     cout << endl;
+
+     // ============ CWarcWriter ============
+     cout << "------- [Testing CWarcWriter] --------" << endl;
+
+     Tests::CWarcWriter_helpers();
+     Tests::CWarcWriter_archive();
+     Tests::CWarcWriter_failure();
+
+     cout << endl;
+
+     // ============ CContentStore ============
+     cout << "------- [Testing CContentStore] --------" << endl;
+
+     Tests::CContentStore_hash();
+     Tests::CContentStore_write();
 
      cout << endl;
 
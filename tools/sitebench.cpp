@@ -0,0 +1,954 @@
+/**
+ * @file sitebench.cpp
+ * @author Jan Cerny (cernyj87@fit.cvut.cz)
+ * @brief End-to-end crawl benchmark, serves a synthetic site on the loopback and runs the crawler against it
+ *
+ * The site is generated in memory from its parameters: pages form a tree with the given fan-out and depth, every page
+ * also links two other pages, its own images and one stylesheet shared by all pages. The server can be slowed down
+ * with a latency before every response and a bandwidth limit of every connection. With --https it creates
+ * a self-signed certificate that the crawler trusts through --cert-store.
+ *
+ * Build and run with "make bench_e2e", eg. make bench_e2e E2E_ARGS="--pages 2000 --latency 20 --https"
+ *
+ */
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using std::string, std::vector, std::cout, std::cerr, std::endl;
+namespace fs = std::filesystem;
+using TClock = std::chrono::steady_clock;
+
+/**
+ * @brief Deleter of the OpenSSL objects, see TDeleter in CHttpsDownloader.h
+ *
+ */
+struct TSslDeleter
+{
+    void operator()(SSL_CTX *ctx) const { SSL_CTX_free(ctx); }
+    void operator()(SSL *ssl) const { SSL_free(ssl); }
+    void operator()(EVP_PKEY *key) const { EVP_PKEY_free(key); }
+    void operator()(EVP_PKEY_CTX *ctx) const { EVP_PKEY_CTX_free(ctx); }
+    void operator()(X509 *cert) const { X509_free(cert); }
+    void operator()(X509_EXTENSION *ext) const { X509_EXTENSION_free(ext); }
+};
+
+template <typename T>
+using TSslPtr = std::unique_ptr<T, TSslDeleter>;
+
+/**
+ * @brief Parameters of the benchmark
+ *
+ */
+struct TOptions
+{
+    // Site
+    size_t m_Pages = 500;
+    size_t m_Fanout = 8;
+    size_t m_Depth = 4;          // Deepest level of the page tree, the root is level 0
+    size_t m_Assets = 2;         // Images of every page
+    size_t m_PageSize = 8 * 1024; // Text of every page in bytes
+    size_t m_AssetSize = 16 * 1024;
+
+    // Server
+    bool m_Https = false;
+    size_t m_LatencyMs = 0;     // Before every response
+    size_t m_BandwidthKBs = 0;  // Of every connection, 0 = unlimited
+    size_t m_ServerThreads = 32;
+    int m_Port = 0;             // 0 = any free port
+
+    // Driver
+    string m_Crawler = "./cernyj87";
+    vector<string> m_CrawlerArgs;
+    size_t m_Runs = 3;
+    string m_Json;
+    bool m_Serve = false; // Only serve the site until interrupted
+    bool m_Keep = false;  // Keep the output of the last run
+};
+
+// ============ Site ============
+
+/**
+ * @brief Synthetic site, every response is generated from the path
+ *
+ */
+class CSite
+{
+public:
+    explicit CSite(const TOptions &options) : m_Options(options)
+    {
+        // Levels of the tree, the page count is limited by the depth
+        m_Levels.push_back(0);
+        for (size_t page = 1; page < options.m_Pages; page++)
+        {
+            size_t level = m_Levels[(page - 1) / options.m_Fanout] + 1;
+            if (level > options.m_Depth)
+                break;
+
+            m_Levels.push_back(level);
+        }
+
+        string text = "The crawler downloads every page of the site and rewrites the links, so the mirror works offline. ";
+        while (m_Filler.size() < options.m_PageSize)
+            m_Filler += text;
+        m_Filler.resize(options.m_PageSize);
+    }
+
+    size_t getPages() const { return m_Levels.size(); }
+
+    /**
+     * @brief Number of files the crawler should save, pages, images and the stylesheet with its images
+     *
+     * @return size_t
+     */
+    size_t getFiles() const { return getPages() * (1 + m_Options.m_Assets) + 1 + BACKGROUNDS; }
+
+    /**
+     * @brief Crawl depth needed to reach the images of the deepest pages (the root has depth 1)
+     *
+     * @return size_t
+     */
+    size_t getCrawlDepth() const { return m_Levels.back() + 2; }
+
+    /**
+     * @brief Generate the response body
+     *
+     * @param path Requested path
+     * @param[out] contentType
+     * @param[out] body
+     * @return true If the path exists
+     */
+    bool get(const string &path, string &contentType, string &body) const
+    {
+        size_t page = 0;
+        size_t asset = 0;
+
+        if (path == "/" || path == "/index.html")
+            return getPage(0, contentType, body);
+
+        if (std::sscanf(path.c_str(), "/p/%zu.html", &page) == 1 && page < getPages())
+            return getPage(page, contentType, body);
+
+        if (path == "/static/site.css")
+        {
+            contentType = "text/css";
+            for (size_t i = 0; i < BACKGROUNDS; i++)
+                body += ".bg-" + std::to_string(i) + " { background: url(\"../img/bg-" + std::to_string(i) + ".png\") no-repeat; }\n";
+            return true;
+        }
+
+        if ((std::sscanf(path.c_str(), "/img/%zu-%zu.png", &page, &asset) == 2 && page < getPages() && asset < m_Options.m_Assets) ||
+            (std::sscanf(path.c_str(), "/img/bg-%zu.png", &asset) == 1 && asset < BACKGROUNDS))
+        {
+            contentType = "image/png";
+            body = "\x89PNG\r\n\x1a\n";
+            body.resize(std::max(body.size(), m_Options.m_AssetSize), static_cast<char>(page + asset));
+            return true;
+        }
+
+        return false;
+    }
+
+private:
+    static const size_t BACKGROUNDS = 3;
+
+    const TOptions &m_Options;
+    vector<size_t> m_Levels;
+    string m_Filler;
+
+    static string pageUrl(size_t page)
+    {
+        return page == 0 ? "/index.html" : "/p/" + std::to_string(page) + ".html";
+    }
+
+    bool getPage(size_t page, string &contentType, string &body) const
+    {
+        std::stringstream ss;
+        ss << "<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>Page " << page << "</title>\n"
+           << "<link rel=\"stylesheet\" href=\"/static/site.css\">\n</head>\n<body class=\"bg-" << page % BACKGROUNDS << "\">\n"
+           << "<nav><a href=\"/index.html\">Home</a>";
+
+        if (page > 0)
+            ss << " <a href=\"" << pageUrl((page - 1) / m_Options.m_Fanout) << "\">Up</a>";
+
+        ss << "</nav>\n<ul>\n";
+
+        for (size_t child = page * m_Options.m_Fanout + 1; child <= page * m_Options.m_Fanout + m_Options.m_Fanout && child < getPages(); child++)
+            ss << "<li><a href=\"" << pageUrl(child) << "\">Page " << child << "</a></li>\n";
+
+        // Links across the tree, found more than once by the crawler
+        for (size_t i = 1; i <= 2; i++)
+            ss << "<li><a href=\"" << pageUrl((page * 7919 + i * 104729) % getPages()) << "\">See also</a></li>\n";
+
+        ss << "</ul>\n";
+
+        for (size_t asset = 0; asset < m_Options.m_Assets; asset++)
+            ss << "<img src=\"/img/" << page << "-" << asset << ".png\" alt=\"Image " << asset << "\">\n";
+
+        ss << "<p>" << m_Filler << "</p>\n</body>\n</html>\n";
+
+        contentType = "text/html; charset=utf-8";
+        body = ss.str();
+        return true;
+    }
+};
+
+// ============ Certificate ============
+
+/**
+ * @brief Create a self-signed certificate for localhost, written as PEM files into the folder
+ *
+ * @param dir
+ * @param[out] certFile
+ * @param[out] keyFile
+ */
+void createCertificate(const fs::path &dir, string &certFile, string &keyFile)
+{
+    TSslPtr<EVP_PKEY_CTX> keyCtx(EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr));
+    EVP_PKEY *rawKey = nullptr;
+
+    if (!keyCtx || EVP_PKEY_keygen_init(keyCtx.get()) <= 0 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyCtx.get(), NID_X9_62_prime256v1) <= 0 ||
+        EVP_PKEY_keygen(keyCtx.get(), &rawKey) <= 0)
+        throw std::runtime_error("Cannot generate the key!");
+
+    TSslPtr<EVP_PKEY> key(rawKey);
+    TSslPtr<X509> cert(X509_new());
+
+    X509_set_version(cert.get(), 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert.get()), static_cast<long>(time(nullptr)));
+    X509_gmtime_adj(X509_getm_notBefore(cert.get()), -3600);
+    X509_gmtime_adj(X509_getm_notAfter(cert.get()), 7 * 24 * 3600);
+    X509_set_pubkey(cert.get(), key.get());
+
+    X509_NAME *name = X509_get_subject_name(cert.get());
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert.get(), name);
+
+    // Trusted directly through --cert-store, so it's its own CA
+    X509V3_CTX ctx;
+    X509V3_set_ctx_nodb(&ctx);
+    X509V3_set_ctx(&ctx, cert.get(), cert.get(), nullptr, nullptr, 0);
+
+    for (const auto &[nid, value] : {std::make_pair(NID_basic_constraints, "critical,CA:TRUE"),
+                               std::make_pair(NID_key_usage, "critical,digitalSignature,keyCertSign"),
+                               std::make_pair(NID_subject_alt_name, "DNS:localhost,IP:127.0.0.1,IP:::1")})
+    {
+        TSslPtr<X509_EXTENSION> extension(X509V3_EXT_conf_nid(nullptr, &ctx, nid, value));
+        if (!extension || !X509_add_ext(cert.get(), extension.get(), -1))
+            throw std::runtime_error("Cannot add the certificate extension!");
+    }
+
+    if (!X509_sign(cert.get(), key.get(), EVP_sha256()))
+        throw std::runtime_error("Cannot sign the certificate!");
+
+    certFile = (dir / "cert.pem").string();
+    keyFile = (dir / "key.pem").string();
+
+    std::unique_ptr<FILE, decltype(&fclose)> certOut(fopen(certFile.c_str(), "w"), fclose);
+    std::unique_ptr<FILE, decltype(&fclose)> keyOut(fopen(keyFile.c_str(), "w"), fclose);
+
+    if (!certOut || !keyOut ||
+        !PEM_write_X509(certOut.get(), cert.get()) ||
+        !PEM_write_PrivateKey(keyOut.get(), key.get(), nullptr, nullptr, 0, nullptr, nullptr))
+        throw std::runtime_error("Cannot write the certificate into " + dir.string());
+}
+
+// ============ Server ============
+
+/**
+ * @brief HTTP/HTTPS server of the site on the loopback, one connection per request, handled by a pool of threads
+ *
+ */
+class CSiteServer
+{
+public:
+    CSiteServer(const CSite &site, const TOptions &options, const string &certFile, const string &keyFile)
+        : m_Site(site), m_Options(options)
+    {
+        if (options.m_Https)
+        {
+            m_Ctx.reset(SSL_CTX_new(TLS_server_method()));
+
+            if (!m_Ctx ||
+                SSL_CTX_use_certificate_file(m_Ctx.get(), certFile.c_str(), SSL_FILETYPE_PEM) != 1 ||
+                SSL_CTX_use_PrivateKey_file(m_Ctx.get(), keyFile.c_str(), SSL_FILETYPE_PEM) != 1)
+                throw std::runtime_error("Cannot load the certificate of the server!");
+        }
+
+        // The crawler may try "localhost" over IPv6 first, both are served
+        m_Sockets.push_back(listenOn(AF_INET, options.m_Port));
+        m_Port = getBoundPort(m_Sockets[0]);
+
+        int ipv6 = -1;
+        try
+        {
+            ipv6 = listenOn(AF_INET6, m_Port);
+        }
+        catch (const std::exception &)
+        {
+            // No IPv6 loopback, the crawler falls back to IPv4
+        }
+
+        if (ipv6 >= 0)
+            m_Sockets.push_back(ipv6);
+
+        for (size_t i = 0; i < std::max<size_t>(options.m_ServerThreads, 1); i++)
+            m_Workers.emplace_back(&CSiteServer::work, this);
+
+        m_Acceptor = std::thread(&CSiteServer::accept, this);
+    }
+
+    ~CSiteServer()
+    {
+        m_Stop = true;
+        m_Acceptor.join();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Closed = true;
+        }
+        m_Condition.notify_all();
+
+        for (auto &worker : m_Workers)
+            worker.join();
+
+        for (int socket : m_Sockets)
+            close(socket);
+    }
+
+    CSiteServer(const CSiteServer &) = delete;
+    void operator=(const CSiteServer &) = delete;
+
+    int getPort() const { return m_Port; }
+
+    size_t getPages() const { return m_Pages; }
+    size_t getResponses() const { return m_Responses; }
+    size_t getBytes() const { return m_Bytes; }
+
+    void resetStats()
+    {
+        m_Pages = 0;
+        m_Responses = 0;
+        m_Bytes = 0;
+    }
+
+private:
+    const CSite &m_Site;
+    const TOptions &m_Options;
+    TSslPtr<SSL_CTX> m_Ctx;
+
+    vector<int> m_Sockets;
+    int m_Port = 0;
+
+    std::atomic<bool> m_Stop{false};
+    std::thread m_Acceptor;
+    vector<std::thread> m_Workers;
+
+    // Accepted connections waiting for a worker
+    std::queue<int> m_Connections;
+    bool m_Closed = false;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+
+    std::atomic<size_t> m_Pages{0};
+    std::atomic<size_t> m_Responses{0};
+    std::atomic<size_t> m_Bytes{0};
+
+    static int listenOn(int family, int port)
+    {
+        int fd = socket(family, SOCK_STREAM, 0);
+        if (fd < 0)
+            throw std::runtime_error("Cannot create the socket!");
+
+        int enable = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+        int result;
+        if (family == AF_INET)
+        {
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            result = bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        }
+        else
+        {
+            setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &enable, sizeof(enable));
+
+            sockaddr_in6 address = {};
+            address.sin6_family = AF_INET6;
+            address.sin6_port = htons(port);
+            address.sin6_addr = in6addr_loopback;
+            result = bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+        }
+
+        if (result != 0 || listen(fd, SOMAXCONN) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Cannot listen on port " + std::to_string(port) + "!");
+        }
+
+        return fd;
+    }
+
+    static int getBoundPort(int fd)
+    {
+        sockaddr_in address = {};
+        socklen_t length = sizeof(address);
+        getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length);
+        return ntohs(address.sin_port);
+    }
+
+    void accept()
+    {
+        vector<pollfd> fds;
+        for (int socket : m_Sockets)
+            fds.push_back({socket, POLLIN, 0});
+
+        while (!m_Stop)
+        {
+            if (poll(fds.data(), fds.size(), 100) <= 0)
+                continue;
+
+            for (const auto &fd : fds)
+            {
+                if (!(fd.revents & POLLIN))
+                    continue;
+
+                int client = ::accept(fd.fd, nullptr, nullptr);
+                if (client < 0)
+                    continue;
+
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_Connections.push(client);
+                }
+                m_Condition.notify_one();
+            }
+        }
+    }
+
+    void work()
+    {
+        while (true)
+        {
+            int client;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [this]
+                              { return m_Closed || !m_Connections.empty(); });
+
+                if (m_Connections.empty())
+                    return;
+
+                client = m_Connections.front();
+                m_Connections.pop();
+            }
+
+            respond(client);
+            close(client);
+        }
+    }
+
+    void respond(int client)
+    {
+        timeval timeout = {10, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        TSslPtr<SSL> ssl;
+        if (m_Ctx)
+        {
+            ssl.reset(SSL_new(m_Ctx.get()));
+            SSL_set_fd(ssl.get(), client);
+
+            if (SSL_accept(ssl.get()) <= 0)
+                return;
+        }
+
+        auto receive = [&](char *buffer, size_t size) -> ssize_t
+        {
+            return ssl ? SSL_read(ssl.get(), buffer, static_cast<int>(size)) : recv(client, buffer, size, 0);
+        };
+
+        auto send = [&](const char *data, size_t size) -> bool
+        {
+            while (size > 0)
+            {
+                ssize_t sent = ssl ? SSL_write(ssl.get(), data, static_cast<int>(size)) : ::send(client, data, size, MSG_NOSIGNAL);
+                if (sent <= 0)
+                    return false;
+
+                data += sent;
+                size -= sent;
+            }
+
+            return true;
+        };
+
+        // Read the request line and the headers
+        string request;
+        char buffer[4096];
+        while (request.find("\r\n\r\n") == string::npos && request.size() < 64 * 1024)
+        {
+            ssize_t received = receive(buffer, sizeof(buffer));
+            if (received <= 0)
+                return;
+
+            request.append(buffer, received);
+        }
+
+        string path = request.substr(0, request.find("\r\n"));
+        size_t pathStart = path.find(' ') + 1;
+        path = path.substr(pathStart, path.find(' ', pathStart) - pathStart);
+        path = path.substr(0, path.find('?'));
+
+        string contentType;
+        string body;
+        bool found = m_Site.get(path, contentType, body);
+
+        if (!found)
+            body = "Not Found";
+
+        string response = string(found ? "HTTP/1.1 200 OK" : "HTTP/1.1 404 Not Found") + "\r\n" +
+                       "Content-Type: " + (found ? contentType : "text/plain") + "\r\n" +
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                       "Connection: close\r\n\r\n" + body;
+
+        if (m_Options.m_LatencyMs > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(m_Options.m_LatencyMs));
+
+        // Shaped into slots of 50 ms
+        bool sent = true;
+        if (m_Options.m_BandwidthKBs == 0)
+            sent = send(response.data(), response.size());
+        else
+        {
+            size_t chunk = std::max<size_t>(m_Options.m_BandwidthKBs * 1024 / 20, 1);
+            auto slot = TClock::now();
+
+            for (size_t offset = 0; sent && offset < response.size(); offset += chunk)
+            {
+                std::this_thread::sleep_until(slot);
+                sent = send(response.data() + offset, std::min(chunk, response.size() - offset));
+                slot += std::chrono::milliseconds(50);
+            }
+        }
+
+        if (!sent)
+            return;
+
+        m_Responses++;
+        m_Bytes += response.size();
+        if (startsWith(contentType, "text/html"))
+            m_Pages++;
+
+        if (ssl)
+            SSL_shutdown(ssl.get());
+    }
+
+    static bool startsWith(const string &str, const string &prefix)
+    {
+        return str.compare(0, prefix.size(), prefix) == 0;
+    }
+};
+
+// ============ Driver ============
+
+/**
+ * @brief Measurements of one crawl
+ *
+ */
+struct TRun
+{
+    double m_Wall = 0; // Seconds
+    double m_Cpu = 0;  // User and system seconds of the crawler
+    double m_PeakRss = 0; // MB
+    int m_ExitCode = 0;
+    size_t m_Pages = 0;
+    size_t m_Responses = 0;
+    size_t m_Bytes = 0;
+    size_t m_Files = 0;
+
+    double getPagesPerSecond() const { return m_Wall > 0 ? m_Pages / m_Wall : 0; }
+    double getMBPerSecond() const { return m_Wall > 0 ? m_Bytes / 1024.0 / 1024.0 / m_Wall : 0; }
+};
+
+/**
+ * @brief Run the crawler once and measure it
+ *
+ * @param options
+ * @param server Server of the site, its counters are reset
+ * @param args Arguments of the crawler
+ * @param outputDir Output folder of the crawler, removed before the run
+ * @param logFile Output of the crawler is written here
+ * @return TRun
+ */
+TRun crawl(const TOptions &options, CSiteServer &server, const vector<string> &args, const fs::path &outputDir, const fs::path &logFile)
+{
+    fs::remove_all(outputDir);
+    server.resetStats();
+
+    vector<char *> argv;
+    argv.push_back(const_cast<char *>(options.m_Crawler.c_str()));
+    for (const auto &arg : args)
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    auto start = TClock::now();
+
+    pid_t child = fork();
+    if (child < 0)
+        throw std::runtime_error("Cannot start the crawler!");
+
+    if (child == 0)
+    {
+        int log = open(logFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log >= 0)
+        {
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+        }
+
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    rusage usage = {};
+    wait4(child, &status, 0, &usage);
+
+    TRun run;
+    run.m_Wall = std::chrono::duration<double>(TClock::now() - start).count();
+    run.m_Cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    run.m_PeakRss = usage.ru_maxrss / 1024.0; // Kilobytes on Linux
+    run.m_ExitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    run.m_Pages = server.getPages();
+    run.m_Responses = server.getResponses();
+    run.m_Bytes = server.getBytes();
+
+    if (fs::exists(outputDir))
+        for (const auto &entry : fs::recursive_directory_iterator(outputDir))
+            run.m_Files += entry.is_regular_file();
+
+    return run;
+}
+
+void printRun(const string &name, const TRun &run, size_t expectedFiles)
+{
+    cout << std::left << std::setw(8) << name << std::right << std::fixed
+        << std::setw(10) << std::setprecision(3) << run.m_Wall
+        << std::setw(8) << run.m_Pages
+        << std::setw(10) << std::setprecision(1) << run.getPagesPerSecond()
+        << std::setw(9) << std::setprecision(2) << run.getMBPerSecond()
+        << std::setw(9) << std::setprecision(3) << run.m_Cpu
+        << std::setw(10) << std::setprecision(1) << run.m_PeakRss
+        << std::setw(13) << (std::to_string(run.m_Files) + "/" + std::to_string(expectedFiles))
+        << (run.m_ExitCode != 0 ? "  exit code " + std::to_string(run.m_ExitCode) : "") << endl;
+}
+
+/**
+ * @brief Median of every measurement, separately
+ *
+ * @param runs
+ * @return TRun
+ */
+TRun median(const vector<TRun> &runs)
+{
+    auto of = [&](const std::function<double(const TRun &)> &get)
+    {
+        vector<double> values;
+        for (const auto &run : runs)
+            values.push_back(get(run));
+
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    };
+
+    TRun result;
+    result.m_Wall = of([](const TRun &run)
+                    { return run.m_Wall; });
+    result.m_Cpu = of([](const TRun &run)
+                   { return run.m_Cpu; });
+    result.m_PeakRss = of([](const TRun &run)
+                      { return run.m_PeakRss; });
+    result.m_Pages = static_cast<size_t>(of([](const TRun &run)
+                                    { return static_cast<double>(run.m_Pages); }));
+    result.m_Bytes = static_cast<size_t>(of([](const TRun &run)
+                                    { return static_cast<double>(run.m_Bytes); }));
+    result.m_Files = static_cast<size_t>(of([](const TRun &run)
+                                    { return static_cast<double>(run.m_Files); }));
+    result.m_ExitCode = static_cast<int>(of([](const TRun &run)
+                                    { return static_cast<double>(run.m_ExitCode); }));
+    return result;
+}
+
+bool saveJson(const string &path, const TOptions &options, const vector<TRun> &runs, const TRun &summary)
+{
+    std::ofstream file(path, std::ios::trunc);
+
+    auto write = [&](const TRun &run)
+    {
+        file << "{\"wall_s\":" << run.m_Wall << ",\"pages\":" << run.m_Pages << ",\"pages_per_s\":" << run.getPagesPerSecond()
+            << ",\"mb_per_s\":" << run.getMBPerSecond() << ",\"cpu_s\":" << run.m_Cpu << ",\"peak_rss_mb\":" << run.m_PeakRss
+            << ",\"files\":" << run.m_Files << ",\"exit_code\":" << run.m_ExitCode << "}";
+    };
+
+    file << std::setprecision(6) << "{\"site\":{\"pages\":" << options.m_Pages << ",\"fanout\":" << options.m_Fanout
+        << ",\"depth\":" << options.m_Depth << ",\"assets\":" << options.m_Assets << ",\"page_size\":" << options.m_PageSize
+        << ",\"asset_size\":" << options.m_AssetSize << ",\"https\":" << (options.m_Https ? "true" : "false")
+        << ",\"latency_ms\":" << options.m_LatencyMs << ",\"bandwidth_kbs\":" << options.m_BandwidthKBs << "},\n\"runs\":[\n";
+
+    for (size_t i = 0; i < runs.size(); i++)
+    {
+        write(runs[i]);
+        file << (i + 1 < runs.size() ? ",\n" : "\n");
+    }
+
+    file << "],\n\"median\":";
+    write(summary);
+    file << "}\n";
+
+    return file.good();
+}
+
+void printHelp(const string &programName)
+{
+    cout << "Usage: " << programName << " [options]\n\n"
+        << "Site:\n"
+        << "\t--pages <int>\t\tNumber of pages, limited by the depth (default = 500)\n"
+        << "\t--fanout <int>\t\tLinks to child pages of every page (default = 8)\n"
+        << "\t--depth <int>\t\tDeepest level of the pages, the root is 0 (default = 4)\n"
+        << "\t--assets <int>\t\tImages of every page (default = 2)\n"
+        << "\t--page-size <bytes>\tText of every page (default = 8192)\n"
+        << "\t--asset-size <bytes>\tSize of every image (default = 16384)\n\n"
+        << "Server:\n"
+        << "\t--https\t\t\tServe HTTPS with a self-signed certificate passed to the crawler with --cert-store\n"
+        << "\t--latency <ms>\t\tDelay before every response (default = 0)\n"
+        << "\t--bandwidth <kB/s>\tBandwidth of every connection (default = 0; unlimited)\n"
+        << "\t--server-threads <int>\tConnections served at once (default = 32)\n"
+        << "\t--port <int>\t\tPort on the loopback (default = any free port)\n\n"
+        << "Driver:\n"
+        << "\t--crawler <path>\tCrawler binary (default = ./cernyj87)\n"
+        << "\t--runs <int>\t\tNumber of crawls, the median is reported (default = 3)\n"
+        << "\t--json <path>\t\tSave the results as JSON\n"
+        << "\t--keep\t\t\tKeep the output and the log of the last crawl\n"
+        << "\t--serve\t\t\tOnly serve the site until interrupted\n"
+        << "\t-- <args>\t\tRest of the arguments is passed to the crawler, eg. -- --fetch-workers 8\n"
+        << endl;
+}
+
+/**
+ * @brief Parse the arguments into the options
+ *
+ * @return true If valid
+ */
+bool parseArgs(int argc, char const *argv[], TOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+
+        auto next = [&](size_t &value)
+        {
+            if (i + 1 >= argc)
+                return false;
+
+            string text = argv[++i];
+            if (text.empty() || text.length() > 12 || text.find_first_not_of("0123456789") != string::npos)
+            {
+                cerr << "Value of " << arg << " is not a valid number!" << endl;
+                return false;
+            }
+
+            value = std::stoull(text);
+            return true;
+        };
+
+        size_t port = 0;
+        size_t runs = 0;
+        bool valid = true;
+
+        if (arg == "--pages")
+            valid = next(options.m_Pages) && options.m_Pages > 0;
+        else if (arg == "--fanout")
+            valid = next(options.m_Fanout) && options.m_Fanout > 0;
+        else if (arg == "--depth")
+            valid = next(options.m_Depth);
+        else if (arg == "--assets")
+            valid = next(options.m_Assets);
+        else if (arg == "--page-size")
+            valid = next(options.m_PageSize);
+        else if (arg == "--asset-size")
+            valid = next(options.m_AssetSize);
+        else if (arg == "--https")
+            options.m_Https = true;
+        else if (arg == "--latency")
+            valid = next(options.m_LatencyMs);
+        else if (arg == "--bandwidth")
+            valid = next(options.m_BandwidthKBs);
+        else if (arg == "--server-threads")
+            valid = next(options.m_ServerThreads) && options.m_ServerThreads > 0;
+        else if (arg == "--port")
+        {
+            valid = next(port) && port <= 65535;
+            options.m_Port = static_cast<int>(port);
+        }
+        else if (arg == "--crawler" && i + 1 < argc)
+            options.m_Crawler = argv[++i];
+        else if (arg == "--runs")
+        {
+            valid = next(runs) && runs > 0;
+            options.m_Runs = runs;
+        }
+        else if (arg == "--json" && i + 1 < argc)
+            options.m_Json = argv[++i];
+        else if (arg == "--keep")
+            options.m_Keep = true;
+        else if (arg == "--serve")
+            options.m_Serve = true;
+        else if (arg == "--")
+        {
+            options.m_CrawlerArgs.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        else
+            valid = false;
+
+        if (!valid)
+        {
+            cerr << "Invalid argument: " << arg << endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char const *argv[])
+{
+    TOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        printHelp(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Interrupt of --serve is waited for, the connections closed by the crawler don't stop the server
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    fs::path workDir = fs::temp_directory_path() / ("wget_sitebench_" + std::to_string(getpid()));
+
+    try
+    {
+        fs::create_directories(workDir);
+
+        string certFile;
+        string keyFile;
+        if (options.m_Https)
+            createCertificate(workDir, certFile, keyFile);
+
+        CSite site(options);
+        CSiteServer server(site, options, certFile, keyFile);
+
+        string url = string(options.m_Https ? "https" : "http") + "://localhost:" + std::to_string(server.getPort()) + "/";
+
+        cout << "Site: " << site.getPages() << " pages, " << site.getFiles() << " files, " << url << endl;
+
+        if (options.m_Serve)
+        {
+            if (options.m_Https)
+                cout << "Certificate: " << certFile << endl;
+
+            cout << "Serving until interrupted" << endl;
+
+            int signal;
+            sigwait(&signals, &signal);
+            fs::remove_all(workDir);
+            return EXIT_SUCCESS;
+        }
+
+        if (access(options.m_Crawler.c_str(), X_OK) != 0)
+            throw std::runtime_error("Cannot run the crawler " + options.m_Crawler + ", build it with make compile!");
+
+        vector<string> args = {url, "-o", (workDir / "output").string(), "-d", std::to_string(site.getCrawlDepth())};
+        if (options.m_Https)
+            args.insert(args.end(), {"--cert-store", certFile});
+        args.insert(args.end(), options.m_CrawlerArgs.begin(), options.m_CrawlerArgs.end());
+
+        cout << "Crawler: " << options.m_Crawler;
+        for (const auto &arg : args)
+            cout << " " << arg;
+        cout << "\n"
+            << endl;
+
+        cout << std::left << std::setw(8) << "run" << std::right << std::setw(10) << "wall s" << std::setw(8) << "pages"
+            << std::setw(10) << "pages/s" << std::setw(9) << "MB/s" << std::setw(9) << "CPU s" << std::setw(10) << "RSS MB"
+            << std::setw(13) << "files" << endl;
+
+        vector<TRun> runs;
+        for (size_t i = 0; i < options.m_Runs; i++)
+        {
+            runs.push_back(crawl(options, server, args, workDir / "output", workDir / "crawl.log"));
+            printRun(std::to_string(i + 1), runs.back(), site.getFiles());
+        }
+
+        TRun summary = median(runs);
+        printRun("median", summary, site.getFiles());
+
+        if (!options.m_Json.empty() && !saveJson(options.m_Json, options, runs, summary))
+            throw std::runtime_error("Cannot write the results into " + options.m_Json);
+
+        if (options.m_Keep)
+            cout << "\nOutput and log of the last crawl: " << workDir.string() << endl;
+        else
+            fs::remove_all(workDir);
+
+        return summary.m_ExitCode == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    catch (const std::exception &e)
+    {
+        cerr << e.what() << endl;
+        fs::remove_all(workDir);
+        return EXIT_FAILURE;
+    }
+}